@@ -0,0 +1,279 @@
+/*
+ * Optional CPython extension for ai_bridge.py's hot paths.
+ *
+ * Calls the bridge without ctypes: the GIL is released around blocking bridge
+ * calls, and stream chunks reach the Python handler as bytes through a C
+ * trampoline. ai_bridge.py falls back to ctypes when the module is missing or
+ * AI_BRIDGE_DISABLE_NATIVE is set.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ai_bridge.h"
+
+typedef char *(*generate_fn)(ai_bridge_session_id_t, const char *, double,
+                             int32_t);
+typedef char *(*generate_structured_fn)(ai_bridge_session_id_t, const char *,
+                                        const char *, double, int32_t);
+typedef ai_bridge_stream_id_t (*stream_fn)(ai_bridge_session_id_t,
+                                           const char *, double, int32_t,
+                                           void *, ai_bridge_stream_callback_t,
+                                           void *);
+typedef ai_bridge_stream_id_t (*structured_stream_fn)(
+    ai_bridge_session_id_t, const char *, const char *, double, int32_t,
+    void *, ai_bridge_stream_callback_t, void *);
+typedef int32_t (*stream_read_fn)(ai_bridge_stream_id_t, char *, int32_t,
+                                  int32_t, int32_t *);
+typedef void (*free_string_fn)(char *);
+
+/*
+ * Bridge entry points resolved by bind(). Symbols are looked up at runtime
+ * rather than linked so the module works with whichever bridge library
+ * ai_bridge.py loaded, including the synthetic one used for benchmarks.
+ */
+static struct {
+  void *handle;
+  generate_fn generate_response;
+  generate_structured_fn generate_structured_response;
+  stream_fn generate_response_stream;
+  structured_stream_fn generate_structured_response_stream;
+  stream_read_fn stream_read;
+  free_string_fn free_string;
+} bridge;
+
+static bool require_bound(void) {
+  if (bridge.handle) {
+    return true;
+  }
+  PyErr_SetString(PyExc_RuntimeError, "_libai is not bound to a library");
+  return false;
+}
+
+static PyObject *libai_bind(PyObject *self, PyObject *args) {
+  (void)self;
+  const char *path;
+  if (!PyArg_ParseTuple(args, "s", &path)) {
+    return NULL;
+  }
+
+  void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!handle) {
+    PyErr_Format(PyExc_OSError, "dlopen failed: %s", dlerror());
+    return NULL;
+  }
+
+  struct {
+    const char *name;
+    void **slot;
+  } symbols[] = {
+      {"ai_bridge_generate_response", (void **)&bridge.generate_response},
+      {"ai_bridge_generate_structured_response",
+       (void **)&bridge.generate_structured_response},
+      {"ai_bridge_generate_response_stream",
+       (void **)&bridge.generate_response_stream},
+      {"ai_bridge_generate_structured_response_stream",
+       (void **)&bridge.generate_structured_response_stream},
+      {"ai_bridge_stream_read", (void **)&bridge.stream_read},
+      {"ai_bridge_free_string", (void **)&bridge.free_string},
+  };
+
+  for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+    void *symbol = dlsym(handle, symbols[i].name);
+    if (!symbol) {
+      PyErr_Format(PyExc_OSError, "missing symbol %s", symbols[i].name);
+      dlclose(handle);
+      return NULL;
+    }
+    *symbols[i].slot = symbol;
+  }
+
+  if (bridge.handle) {
+    dlclose(bridge.handle);
+  }
+  bridge.handle = handle;
+  Py_RETURN_NONE;
+}
+
+/* Converts an owned bridge string to str (or None) and frees it. */
+static PyObject *take_bridge_string(char *response) {
+  if (!response) {
+    Py_RETURN_NONE;
+  }
+  PyObject *result = PyUnicode_DecodeUTF8(response, strlen(response), NULL);
+  bridge.free_string(response);
+  return result;
+}
+
+static PyObject *libai_generate(PyObject *self, PyObject *args) {
+  (void)self;
+  unsigned char session_id;
+  const char *prompt;
+  double temperature;
+  int max_tokens;
+  if (!PyArg_ParseTuple(args, "bsdi", &session_id, &prompt, &temperature,
+                        &max_tokens)) {
+    return NULL;
+  }
+  if (!require_bound()) {
+    return NULL;
+  }
+
+  PyThreadState *thread = PyEval_SaveThread();
+  char *response = bridge.generate_response(session_id, prompt, temperature,
+                                            max_tokens);
+  PyEval_RestoreThread(thread);
+
+  return take_bridge_string(response);
+}
+
+static PyObject *libai_generate_structured(PyObject *self, PyObject *args) {
+  (void)self;
+  unsigned char session_id;
+  const char *prompt;
+  const char *schema_json;
+  double temperature;
+  int max_tokens;
+  if (!PyArg_ParseTuple(args, "bszdi", &session_id, &prompt, &schema_json,
+                        &temperature, &max_tokens)) {
+    return NULL;
+  }
+  if (!require_bound()) {
+    return NULL;
+  }
+
+  PyThreadState *thread = PyEval_SaveThread();
+  char *response = bridge.generate_structured_response(
+      session_id, prompt, schema_json, temperature, max_tokens);
+  PyEval_RestoreThread(thread);
+
+  return take_bridge_string(response);
+}
+
+/*
+ * Stream callback. The context is a strong reference to the Python handler,
+ * released on the NULL chunk that ends every stream. A failed stream sends
+ * its "Error:" chunk before that NULL, so the handler sees both.
+ */
+static void stream_trampoline(void *context, const char *chunk,
+                              void *user_data) {
+  (void)user_data;
+  PyObject *handler = context;
+
+  PyGILState_STATE gil = PyGILState_Ensure();
+
+  PyObject *token = chunk ? PyBytes_FromString(chunk) : Py_NewRef(Py_None);
+  PyObject *result = token ? PyObject_CallOneArg(handler, token) : NULL;
+  if (!result) {
+    PyErr_WriteUnraisable(handler);
+  }
+  Py_XDECREF(result);
+  Py_XDECREF(token);
+
+  if (!chunk) {
+    Py_DECREF(handler);
+  }
+
+  PyGILState_Release(gil);
+}
+
+static PyObject *libai_stream(PyObject *self, PyObject *args) {
+  (void)self;
+  unsigned char session_id;
+  const char *prompt;
+  const char *schema_json;
+  double temperature;
+  int max_tokens;
+  PyObject *handler;
+  int structured;
+  if (!PyArg_ParseTuple(args, "bszdiOp", &session_id, &prompt, &schema_json,
+                        &temperature, &max_tokens, &handler, &structured)) {
+    return NULL;
+  }
+  if (!require_bound()) {
+    return NULL;
+  }
+  if (!PyCallable_Check(handler)) {
+    PyErr_SetString(PyExc_TypeError, "handler must be callable");
+    return NULL;
+  }
+
+  /* The bridge owns this reference from here on; see stream_trampoline. */
+  Py_INCREF(handler);
+
+  ai_bridge_stream_id_t stream_id;
+  PyThreadState *thread = PyEval_SaveThread();
+  if (structured) {
+    stream_id = bridge.generate_structured_response_stream(
+        session_id, prompt, schema_json, temperature, max_tokens, handler,
+        stream_trampoline, NULL);
+  } else {
+    stream_id = bridge.generate_response_stream(
+        session_id, prompt, temperature, max_tokens, handler,
+        stream_trampoline, NULL);
+  }
+  PyEval_RestoreThread(thread);
+
+  // A stream that never started will never send the NULL chunk
+  if (stream_id == AI_BRIDGE_INVALID_ID) {
+    Py_DECREF(handler);
+  }
+  return PyLong_FromUnsignedLong(stream_id);
+}
+
+static PyObject *libai_stream_read_into(PyObject *self, PyObject *args) {
+  (void)self;
+  unsigned int stream_id;
+  Py_buffer buffer;
+  int timeout_ms;
+  if (!PyArg_ParseTuple(args, "Iw*i", &stream_id, &buffer, &timeout_ms)) {
+    return NULL;
+  }
+  if (!require_bound()) {
+    PyBuffer_Release(&buffer);
+    return NULL;
+  }
+
+  int32_t capacity = buffer.len > INT32_MAX ? INT32_MAX : (int32_t)buffer.len;
+  int32_t status = AI_BRIDGE_STREAM_UNKNOWN;
+  PyThreadState *thread = PyEval_SaveThread();
+  int32_t count = bridge.stream_read(stream_id, buffer.buf, capacity,
+                                     timeout_ms, &status);
+  PyEval_RestoreThread(thread);
+
+  PyBuffer_Release(&buffer);
+  return Py_BuildValue("(ii)", count, status);
+}
+
+static PyMethodDef libai_methods[] = {
+    {"bind", libai_bind, METH_VARARGS,
+     "bind(path)\n\nResolve bridge functions from the library at path."},
+    {"generate", libai_generate, METH_VARARGS,
+     "generate(session_id, prompt, temperature, max_tokens) -> str | None"},
+    {"generate_structured", libai_generate_structured, METH_VARARGS,
+     "generate_structured(session_id, prompt, schema_json, temperature, "
+     "max_tokens) -> str | None"},
+    {"stream", libai_stream, METH_VARARGS,
+     "stream(session_id, prompt, schema_json, temperature, max_tokens, "
+     "handler, structured) -> int\n\nStart a callback stream. handler "
+     "receives each chunk as bytes and None on completion, on a bridge "
+     "thread."},
+    {"stream_read_into", libai_stream_read_into, METH_VARARGS,
+     "stream_read_into(stream_id, buffer, timeout_ms) -> (count, status)"},
+    {NULL, NULL, 0, NULL},
+};
+
+static struct PyModuleDef libai_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "_libai",
+    .m_doc = "Native fast paths for ai_bridge.py",
+    .m_size = -1,
+    .m_methods = libai_methods,
+};
+
+PyMODINIT_FUNC PyInit__libai(void) { return PyModule_Create(&libai_module); }
@@ -1,5 +1,6 @@
 #include "ai.h"
 
+#include <errno.h>
 #include <inttypes.h>
 #include <pthread.h>
 #include <stdarg.h>
@@ -8,25 +9,92 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "ai_bridge.h"
+#include "ai_internal.h"
 
 #define MAX_SESSIONS_PER_CONTEXT 32
+#define CIRCUIT_OPEN_ERROR \
+  "Model unavailable; failing fast while the circuit breaker is open"
+#define WATCHDOG_MAX_STALLS_PER_SCAN 64
+#define WATCHDOG_SHARDS 16
+#define AVAILABILITY_POLL_MS 1000
+#define AVAILABILITY_IDLE_POLL_MS 10000
 
 typedef struct {
   _Atomic(bool) initialized;
   _Atomic(uint64_t) next_context_id;
+  _Atomic(uint64_t) next_request_id;
+  _Atomic(bool) preflight;
 } global_state_t;
 
-static global_state_t g_state = {.initialized = false, .next_context_id = 1};
+static global_state_t g_state = {.initialized = false,
+                                 .next_context_id = 1,
+                                 .next_request_id = 1,
+                                 .preflight = true};
+
+typedef struct {
+  ai_op_counters_t model;
+  ai_op_counters_t tools;
+  // Transcript size for the preflight estimate, reset with the history
+  _Atomic(uint64_t) history_bytes;
+  _Atomic(uint64_t) tokens_saved;
+} session_counters_t;
+
+typedef struct tool_binding {
+  ai_tool_callback_t callback;
+  void *user_data;
+  ai_tool_metrics_t *metrics;
+  session_counters_t *session;
+  ai_op_counters_t counters;
+  struct tool_binding *next;
+  char name[];
+} tool_binding_t;
+
+typedef struct stream_binding {
+  ai_context_t *context;
+  ai_stream_callback_t callback;
+  void *user_data;
+  ai_request_kind_t kind;
+  ai_session_id_t session_id;
+  ai_use_case_t model;
+  uint64_t request_id;
+  double started_ms;
+  bool received_chunk;
+  size_t bytes_in;
+  size_t bytes_out;
+  char *error; /* the bridge's "Error:" chunk, delivered on the NULL */
+
+  // Watchdog bookkeeping, guarded by the stream's watch shard except for
+  // last_chunk_ms, which only the stream's own callback writes
+  ai_stream_id_t stream_id;
+  _Atomic(double) last_chunk_ms;
+  double stall_reported_ms;
+  struct stream_binding *watch_prev;
+  struct stream_binding *watch_next;
+} stream_binding_t;
 
 struct ai_context {
   uint64_t context_id;
   char last_error[512];
+  ai_result_t last_error_code;
   pthread_mutex_t mutex;
   void (*error_handler)(ai_result_t, const char *);
 
   ai_session_id_t active_sessions[MAX_SESSIONS_PER_CONTEXT];
+  ai_use_case_t use_cases[MAX_SESSIONS_PER_CONTEXT];
+  // Content-tagging companions of AI_USE_CASE_AUTO sessions. One routed
+  // request owns a companion at a time; companion_dirty is written only by
+  // the owner and says whether the previous one left history behind.
+  ai_bridge_session_id_t tagging_sessions[MAX_SESSIONS_PER_CONTEXT];
+  _Atomic(bool) companion_busy[MAX_SESSIONS_PER_CONTEXT];
+  bool companion_dirty[MAX_SESSIONS_PER_CONTEXT];
+  tool_binding_t *tool_bindings[MAX_SESSIONS_PER_CONTEXT];
+  session_counters_t session_counters[MAX_SESSIONS_PER_CONTEXT];
+  // Instructions and tool definitions, which every request pays for
+  size_t fixed_bytes[MAX_SESSIONS_PER_CONTEXT];
+  uint32_t compaction[MAX_SESSIONS_PER_CONTEXT];
   int session_count;
 
   uint64_t total_requests;
@@ -34,22 +102,71 @@ struct ai_context {
   uint64_t failed_requests;
 };
 
+// Log and handler get their own copy; another thread may already be
+// overwriting last_error
+static void store_error(ai_context_t *context, ai_result_t code,
+                        const char *message) {
+  pthread_mutex_lock(&context->mutex);
+  snprintf(context->last_error, sizeof(context->last_error), "%s", message);
+  context->last_error_code = code;
+  pthread_mutex_unlock(&context->mutex);
+
+  AI_LOG(AI_LOG_WARN, "error", AI_LOG_UINT("context", context->context_id),
+         AI_LOG_INT("code", code), AI_LOG_STR("message", message));
+
+  if (context->error_handler) {
+    context->error_handler(code, message);
+  }
+}
+
+static void set_error_v(ai_context_t *context, ai_result_t code,
+                        const char *fmt, va_list args) {
+  ai_metrics_record_error(code);
+
+  if (context) {
+    char message[sizeof(context->last_error)];
+    vsnprintf(message, sizeof(message), fmt, args);
+    store_error(context, code, message);
+  }
+}
+
 static void set_error(ai_context_t *context, ai_result_t code, const char *fmt,
                       ...) {
   va_list args;
   va_start(args, fmt);
+  set_error_v(context, code, fmt, args);
+  va_end(args);
+}
+
+void ai_set_error(ai_context_t *context, ai_result_t code, const char *fmt,
+                  ...) {
+  va_list args;
+  va_start(args, fmt);
+  set_error_v(context, code, fmt, args);
+  va_end(args);
+}
 
-  if (context) {
-    pthread_mutex_lock(&context->mutex);
-    vsnprintf(context->last_error, sizeof(context->last_error), fmt, args);
-    pthread_mutex_unlock(&context->mutex);
+void ai_copy_error(ai_context_t *context, ai_context_t *from) {
+  char message[sizeof(from->last_error)];
+  pthread_mutex_lock(&from->mutex);
+  memcpy(message, from->last_error, sizeof(message));
+  ai_result_t code = from->last_error_code;
+  pthread_mutex_unlock(&from->mutex);
+  store_error(context, code, message);
+}
 
-    if (context->error_handler) {
-      context->error_handler(code, context->last_error);
-    }
-  }
+void ai_add_stats(ai_context_t *context, ai_context_t *from) {
+  pthread_mutex_lock(&from->mutex);
+  uint64_t total = from->total_requests;
+  uint64_t successful = from->successful_requests;
+  uint64_t failed = from->failed_requests;
+  pthread_mutex_unlock(&from->mutex);
 
-  va_end(args);
+  pthread_mutex_lock(&context->mutex);
+  context->total_requests += total;
+  context->successful_requests += successful;
+  context->failed_requests += failed;
+  pthread_mutex_unlock(&context->mutex);
 }
 
 static void update_stats(ai_context_t *context, bool success) {
@@ -64,6 +181,491 @@ static void update_stats(ai_context_t *context, bool success) {
   pthread_mutex_unlock(&context->mutex);
 }
 
+static double monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t next_request_id(void) {
+  return atomic_fetch_add_explicit(&g_state.next_request_id, 1,
+                                   memory_order_relaxed);
+}
+
+static ai_result_t convert_bridge_error(const char *error_msg) {
+  if (!error_msg) return AI_ERROR_UNKNOWN;
+
+  if (strstr(error_msg, "Session not found")) return AI_ERROR_SESSION_NOT_FOUND;
+  if (strstr(error_msg, "Tool not found")) return AI_ERROR_TOOL_NOT_FOUND;
+  if (strstr(error_msg, "Guardrail violation"))
+    return AI_ERROR_GUARDRAIL_VIOLATION;
+  if (strstr(error_msg, "Tool execution")) return AI_ERROR_TOOL_EXECUTION;
+  if (strstr(error_msg, "JSON")) return AI_ERROR_JSON_PARSE;
+  if (strstr(error_msg, "timeout")) return AI_ERROR_TIMEOUT;
+  if (strstr(error_msg, "Model not ready") ||
+      strstr(error_msg, "model is not available"))
+    return AI_ERROR_NOT_AVAILABLE;
+
+  return AI_ERROR_GENERATION;
+}
+
+typedef struct {
+  pthread_mutex_t mutex;
+  ai_retry_policy_t policy;
+  ai_circuit_state_t state;
+  int consecutive_failures;
+  double open_until_ms;
+} retry_state_t;
+
+static retry_state_t g_retry = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .policy = AI_DEFAULT_RETRY_POLICY,
+    .state = AI_CIRCUIT_CLOSED,
+};
+
+static const char *retry_class_names[AI_RETRY_CLASS_COUNT] = {
+    "not_ready", "rate_limited", "timeout", "generation"};
+
+// Returns the ai_retry_class_t of a failed bridge response, or -1 when the
+// model answered and retrying cannot help
+static int classify_failure(const char *response) {
+  if (!response) return AI_RETRY_CLASS_GENERATION;
+  if (strstr(response, "Rate limited") ||
+      strstr(response, "Concurrent requests"))
+    return AI_RETRY_CLASS_RATE_LIMITED;
+
+  switch (convert_bridge_error(response)) {
+    case AI_ERROR_NOT_AVAILABLE:
+      return AI_RETRY_CLASS_NOT_READY;
+    case AI_ERROR_TIMEOUT:
+      return AI_RETRY_CLASS_TIMEOUT;
+    case AI_ERROR_GENERATION:
+      return AI_RETRY_CLASS_GENERATION;
+    default:
+      return -1;
+  }
+}
+
+static void set_circuit_state(ai_circuit_state_t state) {
+  bool opened = state == AI_CIRCUIT_OPEN && g_retry.state != AI_CIRCUIT_OPEN;
+  g_retry.state = state;
+  ai_metrics_set_circuit_state(state, opened);
+}
+
+// Whether a request may reach the model. Once an open breaker's period has
+// passed it lets exactly one trial request through.
+static bool circuit_admit(void) {
+  pthread_mutex_lock(&g_retry.mutex);
+  bool admitted = g_retry.state == AI_CIRCUIT_CLOSED;
+  if (g_retry.state == AI_CIRCUIT_OPEN &&
+      monotonic_ms() >= g_retry.open_until_ms) {
+    set_circuit_state(AI_CIRCUIT_HALF_OPEN);
+    admitted = true;
+  }
+  pthread_mutex_unlock(&g_retry.mutex);
+
+  if (!admitted) ai_metrics_record_circuit_rejection();
+  return admitted;
+}
+
+// Feeds one attempt's outcome to the breaker: a retry class from
+// classify_failure(), or -1 when the model answered
+static void circuit_record(int retry_class) {
+  pthread_mutex_lock(&g_retry.mutex);
+  const ai_retry_policy_t *policy = &g_retry.policy;
+  bool failure = retry_class >= 0 && (policy->retry_on & (1u << retry_class));
+
+  if (policy->breaker_threshold <= 0) {
+    // Disabled; nothing to track
+  } else if (!failure) {
+    g_retry.consecutive_failures = 0;
+    if (g_retry.state != AI_CIRCUIT_CLOSED) {
+      set_circuit_state(AI_CIRCUIT_CLOSED);
+    }
+  } else if (++g_retry.consecutive_failures >= policy->breaker_threshold ||
+             g_retry.state == AI_CIRCUIT_HALF_OPEN) {
+    g_retry.open_until_ms = monotonic_ms() + policy->breaker_open_ms;
+    set_circuit_state(AI_CIRCUIT_OPEN);
+  }
+  pthread_mutex_unlock(&g_retry.mutex);
+}
+
+static double random_unit(void) {
+  static _Thread_local uint64_t state;
+  if (state == 0) {
+    state = (uint64_t)(monotonic_ms() * 1000.0) ^ (uintptr_t)&state;
+  }
+  // splitmix64
+  uint64_t z = (state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  z ^= z >> 31;
+  return (z >> 11) / 9007199254740992.0;
+}
+
+static double backoff_ms(const ai_retry_policy_t *policy, int attempt) {
+  double delay = policy->initial_backoff_ms;
+  for (int i = 0; i < attempt && delay < policy->max_backoff_ms; i++) {
+    delay *= policy->backoff_multiplier;
+  }
+  if (delay > policy->max_backoff_ms) delay = policy->max_backoff_ms;
+
+  return delay * (1.0 - policy->jitter * random_unit());
+}
+
+static void sleep_ms(double ms) {
+  time_t seconds = (time_t)(ms / 1000.0);
+  struct timespec ts = {.tv_sec = seconds,
+                        .tv_nsec = (long)((ms - seconds * 1000.0) * 1e6)};
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+
+// Runs a synchronous generation under the retry policy and returns the last
+// attempt's bridge response. *rejected is set when the breaker refused the
+// request before any attempt.
+static char *generate_with_retry(ai_context_t *context,
+                                 ai_bridge_session_id_t bridge_session,
+                                 const char *prompt, const char *schema_json,
+                                 bool structured,
+                                 const ai_generation_params_t *params,
+                                 uint64_t request_id, bool *rejected) {
+  ai_retry_policy_t policy;
+  ai_get_retry_policy(&policy);
+  *rejected = false;
+
+  char *response = NULL;
+  for (int attempt = 0;; attempt++) {
+    // A breaker that opened meanwhile ends the retries with the last error
+    if (!circuit_admit()) {
+      *rejected = attempt == 0;
+      return response;
+    }
+
+    if (response) ai_bridge_free_string(response);
+    if (structured) {
+      response = ai_bridge_generate_structured_response(
+          bridge_session, prompt, schema_json, params->temperature,
+          params->max_tokens);
+    } else {
+      response = ai_bridge_generate_response(
+          bridge_session, prompt, params->temperature, params->max_tokens);
+    }
+
+    bool failed = !response || strncmp(response, "Error:", 6) == 0;
+    int retry_class = failed ? classify_failure(response) : -1;
+    circuit_record(retry_class);
+
+    if (retry_class < 0 || !(policy.retry_on & (1u << retry_class))) {
+      return response;
+    }
+    if (attempt >= policy.max_retries) {
+      if (policy.max_retries > 0) ai_metrics_record_retries_exhausted();
+      return response;
+    }
+
+    double delay_ms = backoff_ms(&policy, attempt);
+    ai_metrics_record_retry(retry_class);
+    AI_LOG(AI_LOG_INFO, "generate.retry", AI_LOG_UINT("request_id", request_id),
+           AI_LOG_UINT("context", context->context_id),
+           AI_LOG_INT("attempt", attempt + 1),
+           AI_LOG_STR("class", retry_class_names[retry_class]),
+           AI_LOG_DOUBLE("delay_ms", delay_ms));
+    sleep_ms(delay_ms);
+  }
+}
+
+static const char *model_name(ai_use_case_t model) {
+  return model == AI_USE_CASE_CONTENT_TAGGING ? "content_tagging" : "general";
+}
+
+static bool is_companion(ai_context_t *context, int index,
+                         ai_use_case_t model) {
+  return context->use_cases[index] == AI_USE_CASE_AUTO &&
+         model == AI_USE_CASE_CONTENT_TAGGING;
+}
+
+static bool claim_companion(ai_context_t *context, int index) {
+  return !atomic_exchange_explicit(&context->companion_busy[index], true,
+                                   memory_order_acquire);
+}
+
+static void release_companion(ai_context_t *context,
+                              ai_session_id_t session_id,
+                              ai_use_case_t model) {
+  if (session_id == AI_INVALID_ID || session_id > MAX_SESSIONS_PER_CONTEXT ||
+      !is_companion(context, session_id - 1, model))
+    return;
+  atomic_store_explicit(&context->companion_busy[session_id - 1], false,
+                        memory_order_release);
+}
+
+static void finish_generation(ai_context_t *context,
+                              ai_session_id_t session_id, ai_use_case_t model,
+                              ai_request_kind_t kind, uint64_t request_id,
+                              const char *event, double started_ms,
+                              size_t prompt_bytes, size_t response_bytes,
+                              bool success) {
+  double latency_ms = monotonic_ms() - started_ms;
+
+  release_companion(context, session_id, model);
+  update_stats(context, success);
+  ai_metrics_record_request(kind, success, latency_ms / 1000.0);
+  ai_metrics_record_model_request(model, success, latency_ms / 1000.0,
+                                  prompt_bytes, response_bytes);
+
+  if (session_id != AI_INVALID_ID && session_id <= MAX_SESSIONS_PER_CONTEXT) {
+    session_counters_t *counters = &context->session_counters[session_id - 1];
+    ai_op_counters_record(&counters->model, success, latency_ms / 1000.0,
+                          prompt_bytes, response_bytes);
+    // Requests routed to an AUTO session's companion leave no history
+    if (success && !is_companion(context, session_id - 1, model)) {
+      atomic_fetch_add_explicit(&counters->history_bytes,
+                                prompt_bytes + response_bytes,
+                                memory_order_relaxed);
+    }
+  }
+
+  AI_LOG(success ? AI_LOG_INFO : AI_LOG_WARN, event,
+         AI_LOG_UINT("request_id", request_id),
+         AI_LOG_UINT("context", context->context_id),
+         AI_LOG_UINT("session", session_id),
+         AI_LOG_STR("model", model_name(model)),
+         AI_LOG_DOUBLE("latency_ms", latency_ms),
+         AI_LOG_UINT("bytes_in", prompt_bytes),
+         AI_LOG_UINT("bytes_out", response_bytes), AI_LOG_BOOL("ok", success));
+}
+
+static char *tool_trampoline(const char *parameters_json, void *user_data) {
+  tool_binding_t *binding = user_data;
+
+  double started_ms = monotonic_ms();
+  char *result = binding->callback(parameters_json, binding->user_data);
+  double seconds = (monotonic_ms() - started_ms) / 1000.0;
+
+  bool success = result != NULL;
+  size_t bytes_in = parameters_json ? strlen(parameters_json) : 0;
+  size_t bytes_out = result ? strlen(result) : 0;
+
+  ai_metrics_record_tool_call(binding->metrics, seconds, success);
+  ai_op_counters_record(&binding->counters, success, seconds, bytes_in,
+                        bytes_out);
+  ai_op_counters_record(&binding->session->tools, success, seconds, bytes_in,
+                        bytes_out);
+  atomic_fetch_add_explicit(&binding->session->history_bytes,
+                            bytes_in + bytes_out, memory_order_relaxed);
+  return result;
+}
+
+static void free_tool_bindings(tool_binding_t *binding) {
+  while (binding) {
+    tool_binding_t *next = binding->next;
+    free(binding);
+    binding = next;
+  }
+}
+
+/*
+ * Streams are spread over shards by request ID, so starting or finishing a
+ * stream only waits for the watchdog while it scans that one shard.
+ * A stream whose stall is being reported cannot finish until the report is
+ * done, which keeps its context alive for the stall callback.
+ */
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t reported_cond;
+  stream_binding_t *streams;
+  stream_binding_t *reporting;
+  pthread_t reporter;
+} watch_shard_t;
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t wake_cond;
+  ai_stall_watchdog_config_t config;
+  bool running;
+  pthread_t thread;
+  watch_shard_t shards[WATCHDOG_SHARDS];
+} watchdog_state_t;
+
+static watchdog_state_t g_watchdog = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_cond = PTHREAD_COND_INITIALIZER,
+};
+static pthread_once_t g_watch_shards_once = PTHREAD_ONCE_INIT;
+
+static void init_watch_shards(void) {
+  for (int i = 0; i < WATCHDOG_SHARDS; i++) {
+    pthread_mutex_init(&g_watchdog.shards[i].mutex, NULL);
+    pthread_cond_init(&g_watchdog.shards[i].reported_cond, NULL);
+  }
+}
+
+static watch_shard_t *watch_shard(uint64_t request_id) {
+  pthread_once(&g_watch_shards_once, init_watch_shards);
+  return &g_watchdog.shards[request_id % WATCHDOG_SHARDS];
+}
+
+static void watch_stream(stream_binding_t *binding) {
+  watch_shard_t *shard = watch_shard(binding->request_id);
+  pthread_mutex_lock(&shard->mutex);
+  binding->watch_prev = NULL;
+  binding->watch_next = shard->streams;
+  if (shard->streams) shard->streams->watch_prev = binding;
+  shard->streams = binding;
+  pthread_mutex_unlock(&shard->mutex);
+}
+
+// A stall callback that cancels its own stream may finish it on the
+// watchdog thread, which must not wait for itself
+static void unwatch_stream(stream_binding_t *binding) {
+  watch_shard_t *shard = watch_shard(binding->request_id);
+  pthread_mutex_lock(&shard->mutex);
+  while (shard->reporting == binding &&
+         !pthread_equal(shard->reporter, pthread_self())) {
+    pthread_cond_wait(&shard->reported_cond, &shard->mutex);
+  }
+  if (binding->watch_prev) {
+    binding->watch_prev->watch_next = binding->watch_next;
+  } else {
+    shard->streams = binding->watch_next;
+  }
+  if (binding->watch_next) {
+    binding->watch_next->watch_prev = binding->watch_prev;
+  }
+  pthread_mutex_unlock(&shard->mutex);
+}
+
+// The bridge may finish the stream before start_stream learns its ID, so
+// the binding is looked up again rather than written through blindly
+static void set_watched_stream_id(uint64_t request_id,
+                                  ai_stream_id_t stream_id) {
+  watch_shard_t *shard = watch_shard(request_id);
+  pthread_mutex_lock(&shard->mutex);
+  for (stream_binding_t *binding = shard->streams; binding;
+       binding = binding->watch_next) {
+    if (binding->request_id == request_id) {
+      binding->stream_id = stream_id;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&shard->mutex);
+}
+
+static void stream_trampoline(void *bridge_context, const char *chunk,
+                              void *user_data) {
+  (void)bridge_context;
+  stream_binding_t *binding = user_data;
+
+  // The bridge ends every stream with NULL, preceded by one "Error:" chunk
+  // on failure; text chunks never carry that prefix
+  if (chunk && strncmp(chunk, "Error:", 6) == 0) {
+    free(binding->error);
+    binding->error = strdup(chunk);
+    if (!binding->error) binding->error = strdup("Error: stream failed");
+    return;
+  }
+
+  if (chunk) {
+    double now_ms = monotonic_ms();
+    if (!binding->received_chunk) {
+      binding->received_chunk = true;
+      ai_metrics_record_first_chunk((now_ms - binding->started_ms) / 1000.0);
+    } else {
+      ai_metrics_record_chunk_gap((now_ms - binding->last_chunk_ms) / 1000.0);
+    }
+    binding->last_chunk_ms = now_ms;
+    binding->bytes_out += strlen(chunk);
+    binding->callback(binding->context, chunk, binding->user_data);
+    return;
+  }
+
+  // Callers see the error chunk as the last one, without a NULL after it
+  bool is_error = binding->error != NULL;
+  unwatch_stream(binding);
+  ai_metrics_stream_finished();
+  circuit_record(is_error ? classify_failure(binding->error) : -1);
+  finish_generation(binding->context, binding->session_id, binding->model,
+                    binding->kind, binding->request_id, "stream.complete",
+                    binding->started_ms, binding->bytes_in, binding->bytes_out,
+                    !is_error);
+
+  // Copy out first: the user callback may free the context
+  stream_binding_t finished = *binding;
+  free(binding);
+  finished.callback(finished.context, finished.error, finished.user_data);
+  free(finished.error);
+}
+
+static ai_stream_id_t start_stream(ai_context_t *context,
+                                   ai_bridge_session_id_t bridge_session,
+                                   ai_session_id_t session_id,
+                                   ai_use_case_t model,
+                                   ai_request_kind_t kind, const char *prompt,
+                                   const char *schema_json,
+                                   const ai_generation_params_t *params,
+                                   ai_stream_callback_t callback,
+                                   void *user_data) {
+  stream_binding_t *binding = malloc(sizeof(stream_binding_t));
+  if (!binding) {
+    set_error(context, AI_ERROR_MEMORY, "Failed to allocate stream state");
+    return AI_INVALID_ID;
+  }
+
+  uint64_t request_id = next_request_id();
+  double started_ms = monotonic_ms();
+
+  *binding = (stream_binding_t){
+      .context = context,
+      .callback = callback,
+      .user_data = user_data,
+      .kind = kind,
+      .session_id = session_id,
+      .model = model,
+      .request_id = request_id,
+      .started_ms = started_ms,
+      .bytes_in = strlen(prompt),
+      .stream_id = AI_INVALID_ID,
+      .last_chunk_ms = started_ms,
+  };
+
+  ai_metrics_stream_started();
+  watch_stream(binding);
+
+  // Ownership of the binding passes to the bridge task, which always
+  // delivers a terminal chunk to stream_trampoline
+  ai_bridge_stream_id_t bridge_stream;
+  if (kind == AI_REQUEST_STRUCTURED_STREAM) {
+    bridge_stream = ai_bridge_generate_structured_response_stream(
+        bridge_session, prompt, schema_json, params->temperature,
+        params->max_tokens, context, stream_trampoline, binding);
+  } else {
+    bridge_stream = ai_bridge_generate_response_stream(
+        bridge_session, prompt, params->temperature, params->max_tokens,
+        context, stream_trampoline, binding);
+  }
+
+  // A stream that never started will never call back, so the binding is
+  // still ours
+  if (bridge_stream == AI_BRIDGE_INVALID_ID) {
+    unwatch_stream(binding);
+    ai_metrics_stream_finished();
+    release_companion(context, session_id, model);
+    free(binding);
+  } else {
+    set_watched_stream_id(request_id, bridge_stream);
+    AI_LOG(AI_LOG_INFO, "stream.start",
+           AI_LOG_UINT("request_id", request_id),
+           AI_LOG_UINT("context", context->context_id),
+           AI_LOG_UINT("session", session_id),
+           AI_LOG_UINT("stream", bridge_stream),
+           AI_LOG_UINT("bytes_in", strlen(prompt)),
+           AI_LOG_BOOL("structured", kind == AI_REQUEST_STRUCTURED_STREAM));
+  }
+
+  return bridge_stream;
+}
+
 static ai_availability_t convert_availability(ai_availability_status_t status) {
   switch (status) {
     case AI_BRIDGE_AVAILABLE:
@@ -79,18 +681,214 @@ static ai_availability_t convert_availability(ai_availability_status_t status) {
   }
 }
 
-static ai_result_t convert_bridge_error(const char *error_msg) {
-  if (!error_msg) return AI_ERROR_UNKNOWN;
+// Availability is cached so hot paths never cross into the bridge; a
+// background thread refreshes it on a timer and on change notifications
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t wake_cond;
+  pthread_cond_t changed_cond;
+  bool running;
+  bool valid;
+  bool refresh_requested;
+  bool observing;
+  pthread_t thread;
+  ai_availability_t status;
+  // status once valid and 0 otherwise, for ai_check_availability(), which
+  // reads it without the lock
+  _Atomic(int) published;
+  char *reason;
+  ai_availability_callback_t callback;
+  void *user_data;
+} availability_cache_t;
+
+static availability_cache_t g_availability = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_cond = PTHREAD_COND_INITIALIZER,
+    .changed_cond = PTHREAD_COND_INITIALIZER,
+    .status = AI_AVAILABILITY_UNKNOWN,
+};
 
-  if (strstr(error_msg, "Session not found")) return AI_ERROR_SESSION_NOT_FOUND;
-  if (strstr(error_msg, "Tool not found")) return AI_ERROR_TOOL_NOT_FOUND;
-  if (strstr(error_msg, "Guardrail violation"))
-    return AI_ERROR_GUARDRAIL_VIOLATION;
-  if (strstr(error_msg, "Tool execution")) return AI_ERROR_TOOL_EXECUTION;
-  if (strstr(error_msg, "JSON")) return AI_ERROR_JSON_PARSE;
-  if (strstr(error_msg, "timeout")) return AI_ERROR_TIMEOUT;
+static void refresh_availability(void) {
+  ai_availability_t status =
+      convert_availability(ai_bridge_check_availability());
+  char *reason = ai_bridge_get_availability_reason();
+
+  pthread_mutex_lock(&g_availability.mutex);
+  bool changed = g_availability.valid && g_availability.status != status;
+  ai_availability_t previous = g_availability.status;
+  if (g_availability.reason) ai_bridge_free_string(g_availability.reason);
+  g_availability.reason = reason;
+  g_availability.status = status;
+  g_availability.valid = true;
+  atomic_store_explicit(&g_availability.published, status,
+                        memory_order_relaxed);
+  pthread_cond_broadcast(&g_availability.changed_cond);
+
+  ai_availability_callback_t callback =
+      changed ? g_availability.callback : NULL;
+  void *user_data = g_availability.user_data;
+  char *reason_copy = callback && reason ? strdup(reason) : NULL;
+  pthread_mutex_unlock(&g_availability.mutex);
+
+  if (changed) {
+    AI_LOG(AI_LOG_INFO, "availability.change", AI_LOG_INT("from", previous),
+           AI_LOG_INT("to", status));
+  }
+  if (callback) callback(status, reason_copy ? reason_copy : "", user_data);
+  free(reason_copy);
+}
 
-  return AI_ERROR_GENERATION;
+static void availability_observer(void *user_data) {
+  (void)user_data;
+
+  pthread_mutex_lock(&g_availability.mutex);
+  g_availability.refresh_requested = true;
+  pthread_cond_signal(&g_availability.wake_cond);
+  pthread_mutex_unlock(&g_availability.mutex);
+}
+
+static void *availability_main(void *arg) {
+  (void)arg;
+
+  pthread_mutex_lock(&g_availability.mutex);
+  while (g_availability.running) {
+    if (!g_availability.refresh_requested) {
+      int interval_ms = g_availability.status == AI_AVAILABLE
+                            ? AVAILABILITY_IDLE_POLL_MS
+                            : AVAILABILITY_POLL_MS;
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += (long)(interval_ms % 1000) * 1000000L;
+      deadline.tv_sec += interval_ms / 1000 + deadline.tv_nsec / 1000000000L;
+      deadline.tv_nsec %= 1000000000L;
+      pthread_cond_timedwait(&g_availability.wake_cond,
+                             &g_availability.mutex, &deadline);
+    }
+    if (!g_availability.running) break;
+
+    g_availability.refresh_requested = false;
+    pthread_mutex_unlock(&g_availability.mutex);
+    refresh_availability();
+    pthread_mutex_lock(&g_availability.mutex);
+  }
+  pthread_mutex_unlock(&g_availability.mutex);
+
+  return NULL;
+}
+
+static bool start_availability_cache(void) {
+  refresh_availability();
+
+  pthread_mutex_lock(&g_availability.mutex);
+  // Bridge observation lasts for the process, so it is registered once
+  if (!g_availability.observing) {
+    g_availability.observing =
+        ai_bridge_observe_availability(availability_observer, NULL);
+  }
+  g_availability.running = true;
+  bool started = pthread_create(&g_availability.thread, NULL,
+                                availability_main, NULL) == 0;
+  if (!started) g_availability.running = false;
+  pthread_mutex_unlock(&g_availability.mutex);
+
+  return started;
+}
+
+static void stop_availability_cache(void) {
+  pthread_mutex_lock(&g_availability.mutex);
+  bool was_running = g_availability.running;
+  g_availability.running = false;
+  pthread_cond_signal(&g_availability.wake_cond);
+  pthread_cond_broadcast(&g_availability.changed_cond);
+  pthread_mutex_unlock(&g_availability.mutex);
+
+  if (was_running) pthread_join(g_availability.thread, NULL);
+
+  pthread_mutex_lock(&g_availability.mutex);
+  if (g_availability.reason) ai_bridge_free_string(g_availability.reason);
+  g_availability.reason = NULL;
+  g_availability.valid = false;
+  atomic_store_explicit(&g_availability.published, 0, memory_order_relaxed);
+  pthread_mutex_unlock(&g_availability.mutex);
+}
+
+// Snapshots are never changed once published. A newer one replaces an old
+// one without freeing it, so pointers handed out stay valid until cleanup
+typedef struct capabilities_snapshot {
+  ai_capabilities_t capabilities;
+  struct capabilities_snapshot *previous;
+  ai_language_t languages[];  // Followed by the identifier and name text
+} capabilities_snapshot_t;
+
+typedef struct {
+  pthread_mutex_t mutex;
+  _Atomic(capabilities_snapshot_t *) current;
+} capabilities_cache_t;
+
+static capabilities_cache_t g_capabilities = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static capabilities_snapshot_t *build_capabilities(
+    ai_availability_t availability) {
+  char *list = ai_bridge_get_supported_languages();
+  if (!list) return NULL;
+
+  // The last line may or may not end in a newline
+  size_t count = 0;
+  for (const char *p = list; *p; p++) {
+    if (*p == '\n' || !p[1]) count++;
+  }
+
+  size_t text_bytes = strlen(list) + 1;
+  capabilities_snapshot_t *snapshot =
+      malloc(sizeof(*snapshot) + count * sizeof(ai_language_t) + text_bytes);
+  if (!snapshot) {
+    ai_bridge_free_string(list);
+    return NULL;
+  }
+
+  char *text = (char *)&snapshot->languages[count];
+  memcpy(text, list, text_bytes);
+  ai_bridge_free_string(list);
+
+  // Split "identifier\tname\n" lines in place
+  size_t parsed = 0;
+  for (char *line = text; parsed < count && *line;) {
+    char *end = line + strcspn(line, "\n");
+    char *next = *end ? end + 1 : end;
+    *end = '\0';
+    char *tab = strchr(line, '\t');
+    if (tab) *tab = '\0';
+    snapshot->languages[parsed++] = (ai_language_t){
+        .identifier = line,
+        .display_name = tab ? tab + 1 : line,
+    };
+    line = next;
+  }
+
+  snapshot->previous = NULL;
+  snapshot->capabilities = (ai_capabilities_t){
+      .availability = availability,
+      .language_count = (int32_t)parsed,
+      .languages = snapshot->languages,
+      .context_window_tokens = AI_CONTEXT_WINDOW_TOKENS,
+      .max_sessions_per_context = MAX_SESSIONS_PER_CONTEXT,
+  };
+  return snapshot;
+}
+
+static void free_capabilities(void) {
+  pthread_mutex_lock(&g_capabilities.mutex);
+  capabilities_snapshot_t *snapshot = atomic_exchange(&g_capabilities.current,
+                                                      NULL);
+  pthread_mutex_unlock(&g_capabilities.mutex);
+
+  while (snapshot) {
+    capabilities_snapshot_t *previous = snapshot->previous;
+    free(snapshot);
+    snapshot = previous;
+  }
 }
 
 static bool validate_init(void) { return atomic_load(&g_state.initialized); }
@@ -115,6 +913,9 @@ static ai_bridge_session_id_t find_bridge_session(ai_context_t *context,
   return AI_BRIDGE_INVALID_ID;
 }
 
+// Picks the bridge session, and with it the model, that serves a request.
+// AUTO sessions send short structured requests to their content-tagging
+// companion, cleared first so that each runs without history.
 ai_result_t ai_init(void) {
   if (atomic_load(&g_state.initialized)) {
     return AI_SUCCESS;
@@ -124,6 +925,15 @@ ai_result_t ai_init(void) {
     return AI_ERROR_INIT_FAILED;
   }
 
+  if (!start_availability_cache()) {
+    return AI_ERROR_INIT_FAILED;
+  }
+
+  // AI_PREFLIGHT=0 turns off the context-window check on generation
+  const char *preflight_env = getenv("AI_PREFLIGHT");
+  atomic_store(&g_state.preflight,
+               !(preflight_env && strcmp(preflight_env, "0") == 0));
+
   atomic_store(&g_state.next_context_id, 1);
   atomic_store(&g_state.initialized, true);
 
@@ -133,7 +943,10 @@ ai_result_t ai_init(void) {
 void ai_cleanup(void) {
   if (!atomic_load(&g_state.initialized)) return;
 
+  ai_set_stall_watchdog(NULL);
   atomic_store(&g_state.initialized, false);
+  stop_availability_cache();
+  free_capabilities();
 }
 
 const char *ai_get_version(void) { return AI_VERSION_STRING; }
@@ -144,26 +957,129 @@ const char *ai_get_last_error(ai_context_t *context) {
   return context->last_error;
 }
 
+ai_result_t ai_get_last_error_code(ai_context_t *context) {
+  if (!context) return AI_ERROR_INVALID_PARAMS;
+
+  pthread_mutex_lock(&context->mutex);
+  ai_result_t code = context->last_error_code;
+  pthread_mutex_unlock(&context->mutex);
+  return code;
+}
+
 ai_availability_t ai_check_availability(void) {
-  ai_availability_status_t status = ai_bridge_check_availability();
-  return convert_availability(status);
+  int status = atomic_load_explicit(&g_availability.published,
+                                    memory_order_relaxed);
+  if (status != 0) return (ai_availability_t)status;
+  return convert_availability(ai_bridge_check_availability());
 }
 
 char *ai_get_availability_reason(void) {
   if (!validate_init()) return NULL;
-  return ai_bridge_get_availability_reason();
+
+  pthread_mutex_lock(&g_availability.mutex);
+  char *reason = g_availability.valid && g_availability.reason
+                     ? strdup(g_availability.reason)
+                     : NULL;
+  bool valid = g_availability.valid;
+  pthread_mutex_unlock(&g_availability.mutex);
+
+  return valid ? reason : ai_bridge_get_availability_reason();
 }
 
 bool ai_is_ready(void) { return ai_check_availability() == AI_AVAILABLE; }
 
+void ai_set_availability_callback(ai_availability_callback_t callback,
+                                  void *user_data) {
+  pthread_mutex_lock(&g_availability.mutex);
+  g_availability.callback = callback;
+  g_availability.user_data = user_data;
+  pthread_mutex_unlock(&g_availability.mutex);
+}
+
+ai_result_t ai_wait_until_ready(int32_t timeout_ms) {
+  if (!validate_init()) return AI_ERROR_INIT_FAILED;
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  if (timeout_ms > 0) {
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    deadline.tv_sec += timeout_ms / 1000 + deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+  }
+
+  ai_result_t result;
+  bool timed_out = timeout_ms == 0;
+  pthread_mutex_lock(&g_availability.mutex);
+  for (;;) {
+    ai_availability_t status = g_availability.status;
+    if (g_availability.valid && status == AI_AVAILABLE) {
+      result = AI_SUCCESS;
+      break;
+    }
+    // Nothing short of new hardware changes this one
+    if (g_availability.valid && status == AI_DEVICE_NOT_ELIGIBLE) {
+      result = AI_ERROR_NOT_AVAILABLE;
+      break;
+    }
+    if (!g_availability.running) {
+      result = AI_ERROR_INIT_FAILED;
+      break;
+    }
+    if (timed_out) {
+      result = AI_ERROR_TIMEOUT;
+      break;
+    }
+
+    if (timeout_ms < 0) {
+      pthread_cond_wait(&g_availability.changed_cond, &g_availability.mutex);
+    } else {
+      timed_out = pthread_cond_timedwait(&g_availability.changed_cond,
+                                         &g_availability.mutex,
+                                         &deadline) == ETIMEDOUT;
+    }
+  }
+  pthread_mutex_unlock(&g_availability.mutex);
+
+  return result;
+}
+
 int32_t ai_get_supported_languages_count(void) {
-  if (!validate_init()) return 0;
-  return ai_bridge_get_supported_languages_count();
+  const ai_capabilities_t *capabilities = ai_get_capabilities();
+  return capabilities ? capabilities->language_count : 0;
 }
 
 char *ai_get_supported_language(int32_t index) {
+  const ai_capabilities_t *capabilities = ai_get_capabilities();
+  if (!capabilities || index < 0 || index >= capabilities->language_count)
+    return NULL;
+  return strdup(capabilities->languages[index].display_name);
+}
+
+const ai_capabilities_t *ai_get_capabilities(void) {
   if (!validate_init()) return NULL;
-  return ai_bridge_get_supported_language(index);
+
+  ai_availability_t availability = ai_check_availability();
+  capabilities_snapshot_t *snapshot =
+      atomic_load_explicit(&g_capabilities.current, memory_order_acquire);
+  if (snapshot && snapshot->capabilities.availability == availability)
+    return &snapshot->capabilities;
+
+  pthread_mutex_lock(&g_capabilities.mutex);
+  snapshot = atomic_load_explicit(&g_capabilities.current,
+                                  memory_order_relaxed);
+  if (!snapshot || snapshot->capabilities.availability != availability) {
+    capabilities_snapshot_t *fresh = build_capabilities(availability);
+    // Keep serving the stale snapshot if a new one cannot be built
+    if (fresh) {
+      fresh->previous = snapshot;
+      atomic_store_explicit(&g_capabilities.current, fresh,
+                            memory_order_release);
+      snapshot = fresh;
+    }
+  }
+  pthread_mutex_unlock(&g_capabilities.mutex);
+
+  return snapshot ? &snapshot->capabilities : NULL;
 }
 
 ai_context_t *ai_context_create(void) {
@@ -181,6 +1097,7 @@ ai_context_t *ai_context_create(void) {
 
   for (int i = 0; i < MAX_SESSIONS_PER_CONTEXT; i++) {
     context->active_sessions[i] = AI_BRIDGE_INVALID_ID;
+    context->tagging_sessions[i] = AI_BRIDGE_INVALID_ID;
   }
 
   return context;
@@ -192,7 +1109,12 @@ void ai_context_free(ai_context_t *context) {
   for (int i = 0; i < context->session_count; i++) {
     if (context->active_sessions[i] != AI_BRIDGE_INVALID_ID) {
       ai_bridge_destroy_session(context->active_sessions[i]);
+      ai_metrics_session_destroyed();
+    }
+    if (context->tagging_sessions[i] != AI_BRIDGE_INVALID_ID) {
+      ai_bridge_destroy_session(context->tagging_sessions[i]);
     }
+    free_tool_bindings(context->tool_bindings[i]);
   }
 
   pthread_mutex_destroy(&context->mutex);
@@ -212,6 +1134,19 @@ ai_session_id_t ai_create_session(ai_context_t *context,
   ai_session_config_t default_config = AI_DEFAULT_SESSION_CONFIG;
   if (!config) config = &default_config;
 
+  if (config->use_case < AI_USE_CASE_GENERAL ||
+      config->use_case > AI_USE_CASE_AUTO) {
+    set_error(context, AI_ERROR_INVALID_PARAMS, "Unknown use case %d",
+              (int)config->use_case);
+    return AI_INVALID_ID;
+  }
+
+  if (config->compaction & ~AI_COMPACT_ALL) {
+    set_error(context, AI_ERROR_INVALID_PARAMS,
+              "Unknown compaction passes 0x%x", config->compaction);
+    return AI_INVALID_ID;
+  }
+
   int session_index = -1;
   pthread_mutex_lock(&context->mutex);
   for (int i = 0; i < MAX_SESSIONS_PER_CONTEXT; i++) {
@@ -229,25 +1164,58 @@ ai_session_id_t ai_create_session(ai_context_t *context,
   }
 
   ai_bridge_session_id_t bridge_session =
-      ai_bridge_create_session(config->instructions, config->tools_json,
-                               config->enable_guardrails, true, // enable_history
-                               false, // enable_structured_responses
-                               NULL,  // default_schema_json
-                               config->prewarm);
+      ai_bridge_create_session_with_use_case(
+          config->instructions, config->tools_json, config->enable_guardrails,
+          true,  // enable_history
+          false, // enable_structured_responses
+          NULL,  // default_schema_json
+          config->prewarm,
+          config->use_case == AI_USE_CASE_CONTENT_TAGGING
+              ? AI_BRIDGE_USE_CASE_CONTENT_TAGGING
+              : AI_BRIDGE_USE_CASE_GENERAL);
 
   if (bridge_session == AI_BRIDGE_INVALID_ID) {
     set_error(context, AI_ERROR_GENERATION, "Failed to create bridge session");
     return AI_INVALID_ID;
   }
 
+  // Without the content-tagging model an AUTO session simply never routes
+  ai_bridge_session_id_t tagging_session = AI_BRIDGE_INVALID_ID;
+  if (config->use_case == AI_USE_CASE_AUTO) {
+    tagging_session = ai_bridge_create_session_with_use_case(
+        config->instructions, NULL, config->enable_guardrails, true, false,
+        NULL, config->prewarm, AI_BRIDGE_USE_CASE_CONTENT_TAGGING);
+  }
+
   pthread_mutex_lock(&context->mutex);
   context->active_sessions[session_index] = bridge_session;
+  context->use_cases[session_index] = config->use_case;
+  context->tagging_sessions[session_index] = tagging_session;
+  atomic_store_explicit(&context->companion_busy[session_index], false,
+                        memory_order_relaxed);
+  context->companion_dirty[session_index] = false;
+  memset(&context->session_counters[session_index], 0,
+         sizeof(session_counters_t));
+  context->fixed_bytes[session_index] =
+      (config->instructions ? strlen(config->instructions) : 0) +
+      (config->tools_json ? strlen(config->tools_json) : 0);
+  context->compaction[session_index] = config->compaction;
 
   if (session_index >= context->session_count) {
     context->session_count = session_index + 1;
   }
   pthread_mutex_unlock(&context->mutex);
 
+  ai_metrics_session_created();
+
+  AI_LOG(AI_LOG_INFO, "session.create",
+         AI_LOG_UINT("context", context->context_id),
+         AI_LOG_UINT("session", session_index + 1),
+         AI_LOG_BOOL("tools", config->tools_json != NULL),
+         AI_LOG_BOOL("prewarm", config->prewarm),
+         AI_LOG_INT("use_case", config->use_case),
+         AI_LOG_BOOL("routed", tagging_session != AI_BRIDGE_INVALID_ID));
+
   return session_index + 1;
 }
 
@@ -267,16 +1235,35 @@ ai_result_t ai_register_tool(ai_context_t *context, ai_session_id_t session_id,
     return AI_ERROR_SESSION_NOT_FOUND;
   }
 
-  ai_bridge_tool_callback_t bridge_callback =
-      (ai_bridge_tool_callback_t)callback;
+  size_t name_size = strlen(tool_name) + 1;
+  tool_binding_t *binding = calloc(1, sizeof(tool_binding_t) + name_size);
+  if (!binding) {
+    set_error(context, AI_ERROR_MEMORY, "Failed to allocate tool binding");
+    return AI_ERROR_MEMORY;
+  }
+
+  binding->callback = callback;
+  binding->user_data = user_data;
+  binding->metrics = ai_metrics_tool(tool_name);
+  binding->session = &context->session_counters[session_id - 1];
+  memcpy(binding->name, tool_name, name_size);
 
-  if (!ai_bridge_register_tool(bridge_session, tool_name, bridge_callback,
-                               user_data)) {
+  if (!ai_bridge_register_tool(bridge_session, tool_name, tool_trampoline,
+                               binding)) {
+    free(binding);
     set_error(context, AI_ERROR_TOOL_EXECUTION,
               "Failed to register tool with bridge");
     return AI_ERROR_TOOL_EXECUTION;
   }
 
+  // Bindings live until the session is destroyed; a re-registered tool
+  // leaves its previous binding on the list
+  int index = session_id - 1;
+  pthread_mutex_lock(&context->mutex);
+  binding->next = context->tool_bindings[index];
+  context->tool_bindings[index] = binding;
+  pthread_mutex_unlock(&context->mutex);
+
   return AI_SUCCESS;
 }
 
@@ -288,12 +1275,27 @@ void ai_destroy_session(ai_context_t *context, ai_session_id_t session_id) {
   if (bridge_session != AI_BRIDGE_INVALID_ID) {
     ai_bridge_destroy_session(bridge_session);
 
+    ai_metrics_session_destroyed();
+
     int index = session_id - 1;
     if (index >= 0 && index < MAX_SESSIONS_PER_CONTEXT) {
       pthread_mutex_lock(&context->mutex);
       context->active_sessions[index] = AI_BRIDGE_INVALID_ID;
+      ai_bridge_session_id_t tagging_session = context->tagging_sessions[index];
+      context->tagging_sessions[index] = AI_BRIDGE_INVALID_ID;
+      tool_binding_t *bindings = context->tool_bindings[index];
+      context->tool_bindings[index] = NULL;
       pthread_mutex_unlock(&context->mutex);
+
+      if (tagging_session != AI_BRIDGE_INVALID_ID) {
+        ai_bridge_destroy_session(tagging_session);
+      }
+      free_tool_bindings(bindings);
     }
+
+    AI_LOG(AI_LOG_INFO, "session.destroy",
+           AI_LOG_UINT("context", context->context_id),
+           AI_LOG_UINT("session", session_id));
   }
 }
 
@@ -334,6 +1336,9 @@ ai_result_t ai_clear_session_history(ai_context_t *context,
     return AI_ERROR_INVALID_PARAMS;
   }
 
+  atomic_store_explicit(
+      &context->session_counters[session_id - 1].history_bytes, 0,
+      memory_order_relaxed);
   return AI_SUCCESS;
 }
 
@@ -359,35 +1364,196 @@ ai_result_t ai_add_message_to_history(ai_context_t *context,
     return AI_ERROR_INVALID_PARAMS;
   }
 
+  atomic_fetch_add_explicit(
+      &context->session_counters[session_id - 1].history_bytes,
+      strlen(content), memory_order_relaxed);
   return AI_SUCCESS;
 }
 
-char *ai_generate_response(ai_context_t *context, ai_session_id_t session_id,
-                           const char *prompt,
-                           const ai_generation_params_t *params) {
-  if (!prompt) {
-    set_error(context, AI_ERROR_INVALID_PARAMS, "Prompt cannot be NULL");
-    return NULL;
+// Estimated cost of a request: the session's instructions and tool
+// definitions, its transcript unless the request runs on a fresh companion
+// session, the prompt and schema, and the response budget
+static size_t estimate_request_tokens(ai_context_t *context, int index,
+                                      bool with_history, const char *prompt,
+                                      const char *schema_json,
+                                      const ai_generation_params_t *params) {
+  size_t bytes = context->fixed_bytes[index] + strlen(prompt);
+  if (schema_json) bytes += strlen(schema_json);
+  if (with_history) {
+    bytes += atomic_load_explicit(
+        &context->session_counters[index].history_bytes, memory_order_relaxed);
   }
 
-  if (!validate_context(context)) return NULL;
+  size_t tokens = ai_estimate_tokens_for_bytes(bytes);
+  if (params->max_tokens > 0) tokens += (size_t)params->max_tokens;
+  return tokens;
+}
+
+// Rejects a routed request that cannot fit the context window before it
+// costs a round trip to the model
+static bool preflight(ai_context_t *context, ai_session_id_t session_id,
+                      ai_use_case_t model, const char *prompt,
+                      const char *schema_json,
+                      const ai_generation_params_t *params) {
+  if (!atomic_load_explicit(&g_state.preflight, memory_order_relaxed))
+    return true;
+
+  int index = session_id - 1;
+  bool companion = is_companion(context, index, model);
+  size_t tokens = estimate_request_tokens(context, index, !companion, prompt,
+                                          schema_json, params);
+  if (tokens <= AI_CONTEXT_WINDOW_TOKENS) return true;
+
+  ai_metrics_record_preflight_rejection();
+  set_error(context, AI_ERROR_PROMPT_TOO_LONG,
+            "Request needs about %zu tokens with instructions, tools and "
+            "history; the context window holds %d",
+            tokens, AI_CONTEXT_WINDOW_TOKENS);
+  return false;
+}
 
+/*
+ * Picks the bridge session a request runs on and preflights it there.
+ * Short structured requests on an AUTO session go to its companion when no
+ * other request holds it; the request then owns the companion until
+ * finish_generation() or release_companion(). The companion's history from
+ * the previous routed request is cleared only after preflight has passed,
+ * and only if there is any.
+ */
+static ai_bridge_session_id_t route_request(
+    ai_context_t *context, ai_session_id_t session_id, const char *prompt,
+    const char *schema_json, bool structured,
+    const ai_generation_params_t *params, ai_use_case_t *model) {
   ai_bridge_session_id_t bridge_session =
       find_bridge_session(context, session_id);
   if (bridge_session == AI_BRIDGE_INVALID_ID) {
     set_error(context, AI_ERROR_SESSION_NOT_FOUND, "Session not found");
+    return AI_BRIDGE_INVALID_ID;
+  }
+
+  int index = session_id - 1;
+  ai_use_case_t use_case = context->use_cases[index];
+  ai_bridge_session_id_t tagging = context->tagging_sessions[index];
+  *model = use_case == AI_USE_CASE_CONTENT_TAGGING
+               ? AI_USE_CASE_CONTENT_TAGGING
+               : AI_USE_CASE_GENERAL;
+
+  if (use_case == AI_USE_CASE_AUTO && structured &&
+      tagging != AI_BRIDGE_INVALID_ID &&
+      strlen(prompt) <= AI_ROUTER_MAX_PROMPT_BYTES &&
+      claim_companion(context, index)) {
+    if (!preflight(context, session_id, AI_USE_CASE_CONTENT_TAGGING, prompt,
+                   schema_json, params)) {
+      release_companion(context, session_id, AI_USE_CASE_CONTENT_TAGGING);
+      return AI_BRIDGE_INVALID_ID;
+    }
+    if (!context->companion_dirty[index] ||
+        ai_bridge_clear_session_history(tagging)) {
+      context->companion_dirty[index] = true;
+      *model = AI_USE_CASE_CONTENT_TAGGING;
+      return tagging;
+    }
+    // A companion that cannot be cleared is skipped, as if it were busy
+    release_companion(context, session_id, AI_USE_CASE_CONTENT_TAGGING);
+  }
+
+  if (!preflight(context, session_id, *model, prompt, schema_json, params))
+    return AI_BRIDGE_INVALID_ID;
+  return bridge_session;
+}
+
+// Applies the session's compaction passes. NULL means the prompt goes out
+// unchanged, including when compaction itself runs out of memory.
+static char *compact_prompt(ai_context_t *context, ai_session_id_t session_id,
+                            const char *prompt) {
+  if (find_bridge_session(context, session_id) == AI_BRIDGE_INVALID_ID)
     return NULL;
+
+  int index = session_id - 1;
+  if (!context->compaction[index]) return NULL;
+
+  int32_t tokens_saved;
+  char *compacted =
+      ai_compact_prompt(prompt, context->compaction[index], &tokens_saved);
+  if (!compacted) return NULL;
+
+  atomic_fetch_add_explicit(&context->session_counters[index].tokens_saved,
+                            (uint64_t)tokens_saved, memory_order_relaxed);
+  ai_metrics_record_compaction((size_t)tokens_saved);
+  AI_LOG(AI_LOG_DEBUG, "prompt.compact",
+         AI_LOG_UINT("context", context->context_id),
+         AI_LOG_UINT("session", session_id),
+         AI_LOG_UINT("bytes_in", strlen(prompt)),
+         AI_LOG_UINT("bytes_out", strlen(compacted)),
+         AI_LOG_INT("tokens_saved", tokens_saved));
+  return compacted;
+}
+
+ai_result_t ai_preflight_prompt(ai_context_t *context,
+                                ai_session_id_t session_id, const char *prompt,
+                                const char *schema_json,
+                                const ai_generation_params_t *params,
+                                int32_t *estimated_tokens) {
+  if (!validate_context(context) || !prompt) {
+    set_error(context, AI_ERROR_INVALID_PARAMS,
+              "Invalid parameters for prompt preflight");
+    return AI_ERROR_INVALID_PARAMS;
+  }
+
+  if (find_bridge_session(context, session_id) == AI_BRIDGE_INVALID_ID) {
+    set_error(context, AI_ERROR_SESSION_NOT_FOUND, "Session not found");
+    return AI_ERROR_SESSION_NOT_FOUND;
   }
 
   ai_generation_params_t default_params = AI_DEFAULT_PARAMS;
   if (!params) params = &default_params;
 
-  char *response = ai_bridge_generate_response(
-      bridge_session, prompt, params->temperature, params->max_tokens);
+  // Mirrors route_request without claiming or clearing the companion
+  int index = session_id - 1;
+  bool companion = context->use_cases[index] == AI_USE_CASE_AUTO &&
+                   schema_json &&
+                   context->tagging_sessions[index] != AI_BRIDGE_INVALID_ID &&
+                   strlen(prompt) <= AI_ROUTER_MAX_PROMPT_BYTES;
+  size_t tokens = estimate_request_tokens(context, index, !companion, prompt,
+                                          schema_json, params);
+
+  if (estimated_tokens) {
+    *estimated_tokens = tokens > INT32_MAX ? INT32_MAX : (int32_t)tokens;
+  }
+  if (!atomic_load_explicit(&g_state.preflight, memory_order_relaxed))
+    return AI_SUCCESS;
+  return tokens <= AI_CONTEXT_WINDOW_TOKENS ? AI_SUCCESS
+                                            : AI_ERROR_PROMPT_TOO_LONG;
+}
+
+static char *generate_response(ai_context_t *context,
+                               ai_session_id_t session_id, const char *prompt,
+                               const ai_generation_params_t *params) {
+  ai_generation_params_t default_params = AI_DEFAULT_PARAMS;
+  if (!params) params = &default_params;
+
+  ai_use_case_t model;
+  ai_bridge_session_id_t bridge_session = route_request(
+      context, session_id, prompt, NULL, false, params, &model);
+  if (bridge_session == AI_BRIDGE_INVALID_ID) return NULL;
+
+  uint64_t request_id = next_request_id();
+  double started_ms = monotonic_ms();
+
+  bool rejected;
+  char *response =
+      generate_with_retry(context, bridge_session, prompt, NULL, false, params,
+                          request_id, &rejected);
 
   if (!response) {
-    set_error(context, AI_ERROR_GENERATION, "Response generation failed");
-    update_stats(context, false);
+    if (rejected) {
+      set_error(context, AI_ERROR_NOT_AVAILABLE, CIRCUIT_OPEN_ERROR);
+    } else {
+      set_error(context, AI_ERROR_GENERATION, "Response generation failed");
+    }
+    finish_generation(context, session_id, model, AI_REQUEST_GENERATE,
+                      request_id, "generate.complete", started_ms,
+                      strlen(prompt), 0, false);
     return NULL;
   }
 
@@ -395,19 +1561,21 @@ char *ai_generate_response(ai_context_t *context, ai_session_id_t session_id,
     ai_result_t error_code = convert_bridge_error(response);
     set_error(context, error_code, "%s", response);
     ai_bridge_free_string(response);
-    update_stats(context, false);
+    finish_generation(context, session_id, model, AI_REQUEST_GENERATE,
+                      request_id, "generate.complete", started_ms,
+                      strlen(prompt), 0, false);
     return NULL;
   }
 
-  update_stats(context, true);
+  finish_generation(context, session_id, model, AI_REQUEST_GENERATE,
+                    request_id, "generate.complete", started_ms,
+                    strlen(prompt), strlen(response), true);
   return response;
 }
 
-char *ai_generate_structured_response(ai_context_t *context,
-                                      ai_session_id_t session_id,
-                                      const char *prompt,
-                                      const char *schema_json,
-                                      const ai_generation_params_t *params) {
+char *ai_generate_response(ai_context_t *context, ai_session_id_t session_id,
+                           const char *prompt,
+                           const ai_generation_params_t *params) {
   if (!prompt) {
     set_error(context, AI_ERROR_INVALID_PARAMS, "Prompt cannot be NULL");
     return NULL;
@@ -415,24 +1583,42 @@ char *ai_generate_structured_response(ai_context_t *context,
 
   if (!validate_context(context)) return NULL;
 
-  ai_bridge_session_id_t bridge_session =
-      find_bridge_session(context, session_id);
-  if (bridge_session == AI_BRIDGE_INVALID_ID) {
-    set_error(context, AI_ERROR_SESSION_NOT_FOUND, "Session not found");
-    return NULL;
-  }
+  char *compacted = compact_prompt(context, session_id, prompt);
+  char *response = generate_response(
+      context, session_id, compacted ? compacted : prompt, params);
+  free(compacted);
+  return response;
+}
 
+static char *generate_structured_response(
+    ai_context_t *context, ai_session_id_t session_id, const char *prompt,
+    const char *schema_json, const ai_generation_params_t *params) {
   ai_generation_params_t default_params = AI_DEFAULT_PARAMS;
   if (!params) params = &default_params;
 
-  char *response = ai_bridge_generate_structured_response(
-      bridge_session, prompt, schema_json, params->temperature,
-      params->max_tokens);
+  ai_use_case_t model;
+  ai_bridge_session_id_t bridge_session = route_request(
+      context, session_id, prompt, schema_json, true, params, &model);
+  if (bridge_session == AI_BRIDGE_INVALID_ID) return NULL;
+
+  uint64_t request_id = next_request_id();
+  double started_ms = monotonic_ms();
+
+  bool rejected;
+  char *response =
+      generate_with_retry(context, bridge_session, prompt, schema_json, true,
+                          params, request_id, &rejected);
 
   if (!response) {
-    set_error(context, AI_ERROR_GENERATION,
-              "Structured response generation failed");
-    update_stats(context, false);
+    if (rejected) {
+      set_error(context, AI_ERROR_NOT_AVAILABLE, CIRCUIT_OPEN_ERROR);
+    } else {
+      set_error(context, AI_ERROR_GENERATION,
+                "Structured response generation failed");
+    }
+    finish_generation(context, session_id, model, AI_REQUEST_STRUCTURED,
+                      request_id, "generate.structured", started_ms,
+                      strlen(prompt), 0, false);
     return NULL;
   }
 
@@ -440,14 +1626,69 @@ char *ai_generate_structured_response(ai_context_t *context,
     ai_result_t error_code = convert_bridge_error(response);
     set_error(context, error_code, "%s", response);
     ai_bridge_free_string(response);
-    update_stats(context, false);
+    finish_generation(context, session_id, model, AI_REQUEST_STRUCTURED,
+                      request_id, "generate.structured", started_ms,
+                      strlen(prompt), 0, false);
     return NULL;
   }
 
-  update_stats(context, true);
+  finish_generation(context, session_id, model, AI_REQUEST_STRUCTURED,
+                    request_id, "generate.structured", started_ms,
+                    strlen(prompt), strlen(response), true);
   return response;
 }
 
+char *ai_generate_structured_response(ai_context_t *context,
+                                      ai_session_id_t session_id,
+                                      const char *prompt,
+                                      const char *schema_json,
+                                      const ai_generation_params_t *params) {
+  if (!prompt) {
+    set_error(context, AI_ERROR_INVALID_PARAMS, "Prompt cannot be NULL");
+    return NULL;
+  }
+
+  if (!validate_context(context)) return NULL;
+
+  char *compacted = compact_prompt(context, session_id, prompt);
+  char *response = generate_structured_response(
+      context, session_id, compacted ? compacted : prompt, schema_json, params);
+  free(compacted);
+  return response;
+}
+
+static ai_stream_id_t generate_response_stream(
+    ai_context_t *context, ai_session_id_t session_id, const char *prompt,
+    const ai_generation_params_t *params, ai_stream_callback_t callback,
+    void *user_data) {
+  ai_generation_params_t default_params = AI_DEFAULT_PARAMS;
+  if (!params) params = &default_params;
+
+  ai_use_case_t model;
+  ai_bridge_session_id_t bridge_session = route_request(
+      context, session_id, prompt, NULL, false, params, &model);
+  if (bridge_session == AI_BRIDGE_INVALID_ID) return AI_INVALID_ID;
+
+  if (!circuit_admit()) {
+    release_companion(context, session_id, model);
+    set_error(context, AI_ERROR_NOT_AVAILABLE, CIRCUIT_OPEN_ERROR);
+    return AI_INVALID_ID;
+  }
+
+  ai_bridge_stream_id_t bridge_stream =
+      start_stream(context, bridge_session, session_id, model,
+                   AI_REQUEST_STREAM, prompt, NULL, params, callback,
+                   user_data);
+
+  if (bridge_stream == AI_BRIDGE_INVALID_ID) {
+    circuit_record(AI_RETRY_CLASS_GENERATION);
+    set_error(context, AI_ERROR_GENERATION, "Failed to start streaming");
+    return AI_INVALID_ID;
+  }
+
+  return bridge_stream;
+}
+
 ai_stream_id_t ai_generate_response_stream(ai_context_t *context,
                                            ai_session_id_t session_id,
                                            const char *prompt,
@@ -462,25 +1703,41 @@ ai_stream_id_t ai_generate_response_stream(ai_context_t *context,
 
   if (!validate_context(context)) return AI_INVALID_ID;
 
-  ai_bridge_session_id_t bridge_session =
-      find_bridge_session(context, session_id);
-  if (bridge_session == AI_BRIDGE_INVALID_ID) {
-    set_error(context, AI_ERROR_SESSION_NOT_FOUND, "Session not found");
-    return AI_INVALID_ID;
-  }
+  char *compacted = compact_prompt(context, session_id, prompt);
+  ai_stream_id_t stream =
+      generate_response_stream(context, session_id,
+                               compacted ? compacted : prompt, params,
+                               callback, user_data);
+  free(compacted);
+  return stream;
+}
 
+static ai_stream_id_t generate_structured_response_stream(
+    ai_context_t *context, ai_session_id_t session_id, const char *prompt,
+    const char *schema_json, const ai_generation_params_t *params,
+    ai_stream_callback_t callback, void *user_data) {
   ai_generation_params_t default_params = AI_DEFAULT_PARAMS;
   if (!params) params = &default_params;
 
-  ai_bridge_stream_callback_t bridge_callback =
-      (ai_bridge_stream_callback_t)callback;
+  ai_use_case_t model;
+  ai_bridge_session_id_t bridge_session = route_request(
+      context, session_id, prompt, schema_json, true, params, &model);
+  if (bridge_session == AI_BRIDGE_INVALID_ID) return AI_INVALID_ID;
 
-  ai_bridge_stream_id_t bridge_stream = ai_bridge_generate_response_stream(
-      bridge_session, prompt, params->temperature, params->max_tokens, context,
-      bridge_callback, user_data);
+  if (!circuit_admit()) {
+    release_companion(context, session_id, model);
+    set_error(context, AI_ERROR_NOT_AVAILABLE, CIRCUIT_OPEN_ERROR);
+    return AI_INVALID_ID;
+  }
+
+  ai_bridge_stream_id_t bridge_stream = start_stream(
+      context, bridge_session, session_id, model, AI_REQUEST_STRUCTURED_STREAM,
+      prompt, schema_json, params, callback, user_data);
 
   if (bridge_stream == AI_BRIDGE_INVALID_ID) {
-    set_error(context, AI_ERROR_GENERATION, "Failed to start streaming");
+    circuit_record(AI_RETRY_CLASS_GENERATION);
+    set_error(context, AI_ERROR_GENERATION,
+              "Failed to start structured streaming");
     return AI_INVALID_ID;
   }
 
@@ -499,31 +1756,12 @@ ai_stream_id_t ai_generate_structured_response_stream(
 
   if (!validate_context(context)) return AI_INVALID_ID;
 
-  ai_bridge_session_id_t bridge_session =
-      find_bridge_session(context, session_id);
-  if (bridge_session == AI_BRIDGE_INVALID_ID) {
-    set_error(context, AI_ERROR_SESSION_NOT_FOUND, "Session not found");
-    return AI_INVALID_ID;
-  }
-
-  ai_generation_params_t default_params = AI_DEFAULT_PARAMS;
-  if (!params) params = &default_params;
-
-  ai_bridge_stream_callback_t bridge_callback =
-      (ai_bridge_stream_callback_t)callback;
-
-  ai_bridge_stream_id_t bridge_stream =
-      ai_bridge_generate_structured_response_stream(
-          bridge_session, prompt, schema_json, params->temperature,
-          params->max_tokens, context, bridge_callback, user_data);
-
-  if (bridge_stream == AI_BRIDGE_INVALID_ID) {
-    set_error(context, AI_ERROR_GENERATION,
-              "Failed to start structured streaming");
-    return AI_INVALID_ID;
-  }
-
-  return bridge_stream;
+  char *compacted = compact_prompt(context, session_id, prompt);
+  ai_stream_id_t stream = generate_structured_response_stream(
+      context, session_id, compacted ? compacted : prompt, schema_json, params,
+      callback, user_data);
+  free(compacted);
+  return stream;
 }
 
 ai_result_t ai_cancel_stream(ai_context_t *context, ai_stream_id_t stream_id) {
@@ -535,6 +1773,9 @@ ai_result_t ai_cancel_stream(ai_context_t *context, ai_stream_id_t stream_id) {
   }
 
   if (ai_bridge_cancel_stream(stream_id)) {
+    AI_LOG(AI_LOG_INFO, "stream.cancel",
+           AI_LOG_UINT("context", context->context_id),
+           AI_LOG_UINT("stream", stream_id));
     return AI_SUCCESS;
   }
 
@@ -543,6 +1784,183 @@ ai_result_t ai_cancel_stream(ai_context_t *context, ai_stream_id_t stream_id) {
   return AI_ERROR_STREAM_NOT_FOUND;
 }
 
+static int watchdog_interval_ms(int32_t stall_ms) {
+  int interval = stall_ms / 4;
+  if (interval < 10) return 10;
+  if (interval > 1000) return 1000;
+  return interval;
+}
+
+// The first stream in the shard that has gone quiet for stall_ms and has
+// not been reported for this gap yet
+static stream_binding_t *find_stall(watch_shard_t *shard, double now_ms,
+                                    int32_t stall_ms) {
+  for (stream_binding_t *binding = shard->streams; binding;
+       binding = binding->watch_next) {
+    double last_ms = binding->last_chunk_ms;
+    if (binding->stream_id != AI_INVALID_ID &&
+        binding->stall_reported_ms != last_ms && now_ms - last_ms >= stall_ms)
+      return binding;
+  }
+  return NULL;
+}
+
+/*
+ * Reports up to limit stalls in one shard, each once; a later chunk re-arms
+ * the stream. The shard is unlocked for cancellation and the callback, and
+ * the stream is pinned meanwhile so it cannot finish and take its context
+ * with it. A cancelled stream finishes through stream_trampoline once the
+ * pin is dropped. Returns the number reported.
+ */
+static int report_stalls(watch_shard_t *shard,
+                         const ai_stall_watchdog_config_t *config, int limit) {
+  int reported = 0;
+  pthread_mutex_lock(&shard->mutex);
+  while (reported < limit) {
+    double now_ms = monotonic_ms();
+    stream_binding_t *binding = find_stall(shard, now_ms, config->stall_ms);
+    if (!binding) break;
+
+    double last_ms = binding->last_chunk_ms;
+    binding->stall_reported_ms = last_ms;
+    ai_context_t *context = binding->context;
+    ai_stream_id_t stream_id = binding->stream_id;
+    double stalled_ms = now_ms - last_ms;
+    shard->reporting = binding;
+    shard->reporter = pthread_self();
+    pthread_mutex_unlock(&shard->mutex);
+
+    bool cancelled = config->auto_cancel && ai_bridge_cancel_stream(stream_id);
+    ai_metrics_record_stall(cancelled);
+    AI_LOG(AI_LOG_WARN, "stream.stall",
+           AI_LOG_UINT("context", context->context_id),
+           AI_LOG_UINT("stream", stream_id),
+           AI_LOG_DOUBLE("stalled_ms", stalled_ms),
+           AI_LOG_BOOL("cancelled", cancelled));
+    if (config->callback) {
+      config->callback(context, stream_id, stalled_ms, cancelled,
+                       config->user_data);
+    }
+    reported++;
+
+    pthread_mutex_lock(&shard->mutex);
+    shard->reporting = NULL;
+    pthread_cond_broadcast(&shard->reported_cond);
+  }
+  pthread_mutex_unlock(&shard->mutex);
+  return reported;
+}
+
+static void *watchdog_main(void *arg) {
+  (void)arg;
+
+  pthread_mutex_lock(&g_watchdog.mutex);
+  while (g_watchdog.running &&
+         pthread_equal(g_watchdog.thread, pthread_self())) {
+    int interval_ms = watchdog_interval_ms(g_watchdog.config.stall_ms);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)(interval_ms % 1000) * 1000000L;
+    deadline.tv_sec += interval_ms / 1000 + deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&g_watchdog.wake_cond, &g_watchdog.mutex,
+                           &deadline);
+    if (!g_watchdog.running ||
+        !pthread_equal(g_watchdog.thread, pthread_self()))
+      break;
+
+    ai_stall_watchdog_config_t config = g_watchdog.config;
+    pthread_mutex_unlock(&g_watchdog.mutex);
+
+    int reported = 0;
+    for (int i = 0; i < WATCHDOG_SHARDS; i++) {
+      if (reported == WATCHDOG_MAX_STALLS_PER_SCAN) break;
+      reported += report_stalls(watch_shard((uint64_t)i), &config,
+                                WATCHDOG_MAX_STALLS_PER_SCAN - reported);
+    }
+
+    pthread_mutex_lock(&g_watchdog.mutex);
+  }
+  pthread_mutex_unlock(&g_watchdog.mutex);
+
+  return NULL;
+}
+
+ai_result_t ai_set_stall_watchdog(const ai_stall_watchdog_config_t *config) {
+  if (config && config->stall_ms < 0) return AI_ERROR_INVALID_PARAMS;
+
+  bool enable = config && config->stall_ms > 0;
+
+  pthread_mutex_lock(&g_watchdog.mutex);
+  bool was_running = g_watchdog.running;
+  pthread_t previous = g_watchdog.thread;
+
+  if (enable) {
+    g_watchdog.config = *config;
+    if (was_running) {
+      pthread_cond_signal(&g_watchdog.wake_cond);
+      pthread_mutex_unlock(&g_watchdog.mutex);
+      return AI_SUCCESS;
+    }
+
+    // The new thread blocks on the mutex until g_watchdog.thread is set
+    if (pthread_create(&g_watchdog.thread, NULL, watchdog_main, NULL) != 0) {
+      pthread_mutex_unlock(&g_watchdog.mutex);
+      return AI_ERROR_INIT_FAILED;
+    }
+    g_watchdog.running = true;
+    pthread_mutex_unlock(&g_watchdog.mutex);
+    return AI_SUCCESS;
+  }
+
+  g_watchdog.running = false;
+  pthread_cond_signal(&g_watchdog.wake_cond);
+  pthread_mutex_unlock(&g_watchdog.mutex);
+
+  // A stall callback that turns the watchdog off cannot join itself
+  if (was_running && !pthread_equal(previous, pthread_self())) {
+    pthread_join(previous, NULL);
+  } else if (was_running) {
+    pthread_detach(previous);
+  }
+  return AI_SUCCESS;
+}
+
+ai_result_t ai_set_retry_policy(const ai_retry_policy_t *policy) {
+  ai_retry_policy_t default_policy = AI_DEFAULT_RETRY_POLICY;
+  if (!policy) policy = &default_policy;
+
+  if (policy->max_retries < 0 || policy->initial_backoff_ms < 0 ||
+      policy->max_backoff_ms < policy->initial_backoff_ms ||
+      !(policy->backoff_multiplier >= 1.0) || !(policy->jitter >= 0.0) ||
+      policy->jitter > 1.0 || policy->breaker_threshold < 0 ||
+      policy->breaker_open_ms < 0)
+    return AI_ERROR_INVALID_PARAMS;
+
+  pthread_mutex_lock(&g_retry.mutex);
+  g_retry.policy = *policy;
+  g_retry.consecutive_failures = 0;
+  set_circuit_state(AI_CIRCUIT_CLOSED);
+  pthread_mutex_unlock(&g_retry.mutex);
+
+  return AI_SUCCESS;
+}
+
+void ai_get_retry_policy(ai_retry_policy_t *policy) {
+  if (!policy) return;
+
+  pthread_mutex_lock(&g_retry.mutex);
+  *policy = g_retry.policy;
+  pthread_mutex_unlock(&g_retry.mutex);
+}
+
+ai_circuit_state_t ai_get_circuit_state(void) {
+  pthread_mutex_lock(&g_retry.mutex);
+  ai_circuit_state_t state = g_retry.state;
+  pthread_mutex_unlock(&g_retry.mutex);
+  return state;
+}
+
 bool ai_validate_messages_json(const char *messages_json) {
   if (!messages_json) return false;
 
@@ -584,6 +2002,8 @@ const char *ai_get_error_description(ai_result_t result) {
       return "Tool callback not registered";
     case AI_ERROR_TOOL_EXECUTION:
       return "Tool execution failed";
+    case AI_ERROR_PROMPT_TOO_LONG:
+      return "Prompt exceeds the context window";
     case AI_ERROR_UNKNOWN:
       return "Unknown error";
     default:
@@ -628,4 +2048,65 @@ void ai_reset_stats(ai_context_t *context) {
   context->successful_requests = 0;
   context->failed_requests = 0;
   pthread_mutex_unlock(&context->mutex);
+}
+
+ai_result_t ai_get_session_stats(ai_context_t *context,
+                                 ai_session_id_t session_id,
+                                 ai_session_stats_t *stats) {
+  if (!validate_context(context) || !stats) return AI_ERROR_INVALID_PARAMS;
+
+  if (find_bridge_session(context, session_id) == AI_BRIDGE_INVALID_ID) {
+    set_error(context, AI_ERROR_SESSION_NOT_FOUND, "Session not found");
+    return AI_ERROR_SESSION_NOT_FOUND;
+  }
+
+  session_counters_t *counters = &context->session_counters[session_id - 1];
+  ai_op_counters_snapshot(&counters->model, &stats->model);
+  ai_op_counters_snapshot(&counters->tools, &stats->tools);
+  stats->prompt_tokens_saved =
+      atomic_load_explicit(&counters->tokens_saved, memory_order_relaxed);
+
+  return AI_SUCCESS;
+}
+
+ai_result_t ai_get_tool_stats(ai_context_t *context, ai_session_id_t session_id,
+                              const char *tool_name, ai_op_stats_t *stats) {
+  if (!validate_context(context) || !tool_name || !stats)
+    return AI_ERROR_INVALID_PARAMS;
+
+  if (find_bridge_session(context, session_id) == AI_BRIDGE_INVALID_ID) {
+    set_error(context, AI_ERROR_SESSION_NOT_FOUND, "Session not found");
+    return AI_ERROR_SESSION_NOT_FOUND;
+  }
+
+  memset(stats, 0, sizeof(ai_op_stats_t));
+  bool found = false;
+
+  pthread_mutex_lock(&context->mutex);
+  for (tool_binding_t *binding = context->tool_bindings[session_id - 1];
+       binding; binding = binding->next) {
+    if (strcmp(binding->name, tool_name) != 0) continue;
+
+    ai_op_stats_t snapshot;
+    ai_op_counters_snapshot(&binding->counters, &snapshot);
+
+    stats->invocations += snapshot.invocations;
+    stats->errors += snapshot.errors;
+    stats->bytes_in += snapshot.bytes_in;
+    stats->bytes_out += snapshot.bytes_out;
+    stats->total_time += snapshot.total_time;
+    for (int i = 0; i < AI_STATS_HISTOGRAM_BUCKETS; i++) {
+      stats->latency_buckets[i] += snapshot.latency_buckets[i];
+    }
+    found = true;
+  }
+  pthread_mutex_unlock(&context->mutex);
+
+  if (!found) {
+    set_error(context, AI_ERROR_TOOL_NOT_FOUND, "Tool '%s' not registered",
+              tool_name);
+    return AI_ERROR_TOOL_NOT_FOUND;
+  }
+
+  return AI_SUCCESS;
 }
\ No newline at end of file
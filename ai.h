@@ -95,6 +95,8 @@ typedef enum {
       -11, /**< Tool callback not registered for session */
   AI_ERROR_TOOL_EXECUTION =
       -12, /**< Tool execution failed or returned invalid result */
+  AI_ERROR_PROMPT_TOO_LONG =
+      -13, /**< Estimated request size exceeds the context window */
   AI_ERROR_UNKNOWN = -99 /**< Unknown error occurred */
 } ai_result_t;
 
@@ -112,6 +114,25 @@ typedef enum {
   AI_AVAILABILITY_UNKNOWN = -99 /**< Unknown availability status */
 } ai_availability_t;
 
+/**
+ * @brief System model a session runs on
+ *
+ * The content-tagging model is specialised for classification, tagging and
+ * entity extraction; it is faster than the general model for those tasks but
+ * poor at open-ended generation.
+ */
+typedef enum {
+  AI_USE_CASE_GENERAL = 0,         /**< The default system model */
+  AI_USE_CASE_CONTENT_TAGGING = 1, /**< The content-tagging model */
+  AI_USE_CASE_AUTO = 2 /**< The general model, routing short structured
+                          requests to the content-tagging model */
+} ai_use_case_t;
+
+/**
+ * @brief Longest prompt AI_USE_CASE_AUTO routes to the content-tagging model
+ */
+#define AI_ROUTER_MAX_PROMPT_BYTES 2048
+
 /**
  * @brief Session configuration structure
  *
@@ -127,6 +148,10 @@ typedef struct {
   bool enable_guardrails; /**< Whether to enable content safety filtering */
   bool prewarm; /**< Whether to preload session resources for faster first
                    response */
+  ai_use_case_t use_case; /**< Model to run on; zero-initialised configs get
+                             the general model */
+  uint32_t compaction; /**< AI_COMPACT_* passes applied to every prompt before
+                          it is sent (0 = send prompts unchanged) */
 } ai_session_config_t;
 
 /**
@@ -135,11 +160,13 @@ typedef struct {
  * Provides reasonable defaults: no custom instructions, no tools,
  * guardrails enabled, no prewarming.
  */
-#define AI_DEFAULT_SESSION_CONFIG \
-  {.instructions = NULL,          \
-   .tools_json = NULL,            \
-   .enable_guardrails = true,     \
-   .prewarm = false}
+#define AI_DEFAULT_SESSION_CONFIG    \
+  {.instructions = NULL,             \
+   .tools_json = NULL,               \
+   .enable_guardrails = true,        \
+   .prewarm = false,                 \
+   .use_case = AI_USE_CASE_GENERAL,  \
+   .compaction = 0}
 
 /** @} */
 
@@ -162,7 +189,7 @@ typedef uint8_t ai_session_id_t;
  * Unique identifier for streaming operations. Valid IDs are non-zero.
  * Streams automatically clean up when generation completes or is cancelled.
  */
-typedef uint8_t ai_stream_id_t;
+typedef uint32_t ai_stream_id_t;
 
 /**
  * @brief Invalid session/stream identifier
@@ -353,6 +380,19 @@ const char *ai_get_version(void);
  */
 const char *ai_get_last_error(ai_context_t *context);
 
+/**
+ * @brief Get the code of the last error for a context
+ *
+ * Pairs with ai_get_last_error() so callers can tell failures apart without
+ * parsing the message, for example AI_ERROR_PROMPT_TOO_LONG from a
+ * preflight rejection.
+ *
+ * @param context Context to get the error code for
+ * @return Code of the most recent error, AI_SUCCESS if none has occurred,
+ * or AI_ERROR_INVALID_PARAMS if @p context is NULL
+ */
+ai_result_t ai_get_last_error_code(ai_context_t *context);
+
 /** @} */
 
 /**
@@ -364,12 +404,17 @@ const char *ai_get_last_error(ai_context_t *context);
  * @brief Check Apple Intelligence availability on this device
  *
  * Determines whether Apple Intelligence is available and ready for use.
- * This check is performed in real-time and may change based on system state.
+ * After ai_init() the answer comes from a cache that a background thread
+ * keeps current, so the call is cheap enough for hot paths.
  *
  * @return Availability status from ai_availability_t enum
  *
- * @note This function can be called before library initialization.
- * @note Availability may change if system settings are modified.
+ * @note This function can be called before library initialization, in which
+ * case it queries the system directly.
+ * @note Availability may change if system settings are modified. The cache
+ * follows change notifications from the framework where they are available,
+ * and otherwise notices within about a second while the model is unavailable
+ * and within ten seconds while it is available.
  */
 ai_availability_t ai_check_availability(void);
 
@@ -399,6 +444,45 @@ char *ai_get_availability_reason(void);
  */
 bool ai_is_ready(void);
 
+/**
+ * @brief Called when the cached availability changes
+ *
+ * @param availability New availability status
+ * @param reason Human-readable explanation, valid only during the call
+ * @param user_data User data passed to ai_set_availability_callback()
+ *
+ * @note Runs on the availability refresh thread.
+ */
+typedef void (*ai_availability_callback_t)(ai_availability_t availability,
+                                           const char *reason,
+                                           void *user_data);
+
+/**
+ * @brief Register a callback for availability changes
+ *
+ * Replaces any previous callback. The callback is not called for the current
+ * status, only for later changes; read that with ai_check_availability().
+ *
+ * @param callback Function to call, or NULL to stop notifications
+ * @param user_data User data passed to the callback
+ */
+void ai_set_availability_callback(ai_availability_callback_t callback,
+                                  void *user_data);
+
+/**
+ * @brief Block until Apple Intelligence is ready
+ *
+ * Useful right after install or login, while the model is still
+ * downloading.
+ *
+ * @param timeout_ms Longest time to wait; 0 only checks and a negative value
+ * waits indefinitely
+ * @return AI_SUCCESS once ready, AI_ERROR_TIMEOUT if the timeout passed,
+ * AI_ERROR_NOT_AVAILABLE at once if the device is not eligible, or
+ * AI_ERROR_INIT_FAILED if the library is not initialized
+ */
+ai_result_t ai_wait_until_ready(int32_t timeout_ms);
+
 /** @} */
 
 /**
@@ -426,11 +510,60 @@ int32_t ai_get_supported_languages_count(void);
  * @param index Zero-based language index
  * @return Localized language display name, or NULL if index is invalid.
  *         **Memory ownership**: Caller must call ai_free_string().
+ *
+ * @note Languages are ordered by identifier, as in ai_get_capabilities().
  */
 char *ai_get_supported_language(int32_t index);
 
 /** @} */
 
+/**
+ * @defgroup capabilities Capabilities
+ * @{
+ */
+
+/** Tokens the system model can attend to: instructions, history, prompt and
+ * response together */
+#define AI_CONTEXT_WINDOW_TOKENS 4096
+
+/**
+ * @brief A language the system model supports
+ */
+typedef struct {
+  const char *identifier;   /**< Maximal BCP 47 identifier, e.g. "en-Latn-US" */
+  const char *display_name; /**< Name in the language itself */
+} ai_language_t;
+
+/**
+ * @brief What the system model can do, as of one point in time
+ */
+typedef struct {
+  ai_availability_t availability; /**< Availability when the snapshot was
+                                     taken */
+  int32_t language_count;         /**< Entries in @c languages */
+  const ai_language_t *languages; /**< Supported languages by identifier */
+  int32_t context_window_tokens;  /**< AI_CONTEXT_WINDOW_TOKENS */
+  int32_t max_sessions_per_context; /**< Sessions one context can hold */
+} ai_capabilities_t;
+
+/**
+ * @brief Get a snapshot of the model's capabilities
+ *
+ * The first call asks the bridge for everything at once; later calls return
+ * the same snapshot with two atomic loads, taking no lock and not crossing
+ * into the bridge. A new snapshot is taken only once the cached availability
+ * differs from the one recorded, since the language list can change when the
+ * model finishes downloading.
+ *
+ * @return Immutable snapshot that any thread may read without locking, or
+ * NULL if the library is not initialized or memory ran out.
+ * **Memory ownership**: Owned by the library and valid until ai_cleanup();
+ * do not free.
+ */
+const ai_capabilities_t *ai_get_capabilities(void);
+
+/** @} */
+
 /**
  * @defgroup sessions Session Management
  * @{
@@ -453,6 +586,13 @@ char *ai_get_supported_language(int32_t index);
  * @note Tools defined in config->tools_json must be registered with
  * ai_register_tool().
  * @note Session creation fails if Apple Intelligence is not available.
+ * @note An AI_USE_CASE_AUTO session also opens a content-tagging session with
+ * the same instructions and no tools. Structured requests whose prompt is at
+ * most AI_ROUTER_MAX_PROMPT_BYTES run there, each without the conversation
+ * history, and are not added to the general session's history. The
+ * companion takes one request at a time; a structured request that arrives
+ * while it is busy runs on the general model. Without the content-tagging
+ * model every request stays on the general model.
  */
 ai_session_id_t ai_create_session(ai_context_t *context,
                                   const ai_session_config_t *config);
@@ -705,6 +845,374 @@ ai_stream_id_t ai_generate_structured_response_stream(
  */
 ai_result_t ai_cancel_stream(ai_context_t *context, ai_stream_id_t stream_id);
 
+/**
+ * @brief Called when a stream has gone quiet for longer than the threshold
+ *
+ * @param context Context the stream was started on
+ * @param stream_id Stalled stream
+ * @param stalled_ms Time since the stream's last chunk, or since it started
+ * if none has arrived yet
+ * @param cancelled Whether the watchdog cancelled the stream
+ * @param user_data User data from the watchdog configuration
+ *
+ * @note Runs on the watchdog thread. The stream's terminal chunk is held
+ * back until the callback returns, so @p context stays valid; keep the
+ * callback short, since the stream cannot finish meanwhile.
+ */
+typedef void (*ai_stall_callback_t)(ai_context_t *context,
+                                    ai_stream_id_t stream_id,
+                                    double stalled_ms, bool cancelled,
+                                    void *user_data);
+
+/**
+ * @brief Stall watchdog configuration
+ */
+typedef struct {
+  int32_t stall_ms; /**< Gap without chunks that counts as a stall
+                       (0 disables the watchdog) */
+  bool auto_cancel; /**< Cancel stalled streams with ai_cancel_stream() */
+  ai_stall_callback_t callback; /**< Called once per stall, may be NULL */
+  void *user_data;              /**< Passed to the callback */
+} ai_stall_watchdog_config_t;
+
+/**
+ * @brief Report streams that go 30 seconds without a chunk, without
+ * cancelling them
+ */
+#define AI_DEFAULT_STALL_WATCHDOG_CONFIG \
+  {.stall_ms = 30000, .auto_cancel = false, .callback = NULL, .user_data = NULL}
+
+/**
+ * @brief Watch active streams for gaps between chunks
+ *
+ * Starts a process-wide watchdog thread that tracks when every active stream
+ * last delivered a chunk. A stream that stays quiet for @c stall_ms is
+ * reported once per stall to the callback and, with @c auto_cancel, cancelled
+ * so its callback receives the usual terminal NULL chunk. Each stall is
+ * counted in ai_stream_stalls_total; gaps between chunks are recorded in the
+ * ai_stream_chunk_gap_seconds histogram whether or not the watchdog runs.
+ *
+ * @param config Watchdog configuration. NULL, or a @c stall_ms of 0, stops
+ * the watchdog.
+ * @return AI_SUCCESS, AI_ERROR_INVALID_PARAMS for a negative threshold, or
+ * AI_ERROR_INIT_FAILED if the thread could not be started
+ *
+ * @note Streams started before the call are watched too. ai_cleanup() stops
+ * the watchdog.
+ */
+ai_result_t ai_set_stall_watchdog(const ai_stall_watchdog_config_t *config);
+
+/** @} */
+
+/**
+ * @defgroup retry Retries and Circuit Breaker
+ * @{
+ */
+
+/** Retry when the model is not ready or its assets are unavailable */
+#define AI_RETRY_ON_NOT_READY (1u << 0)
+/** Retry when the model is rate limited or busy with other requests */
+#define AI_RETRY_ON_RATE_LIMITED (1u << 1)
+/** Retry when a generation times out */
+#define AI_RETRY_ON_TIMEOUT (1u << 2)
+/** Retry any other generation failure; these are often not transient */
+#define AI_RETRY_ON_GENERATION (1u << 3)
+
+/**
+ * @brief Process-wide policy for retrying failed generations
+ *
+ * ai_generate_response() and ai_generate_structured_response() retry failures
+ * of the classes in @c retry_on, sleeping between attempts. Guardrail, tool,
+ * session and JSON errors are never retried.
+ *
+ * The circuit breaker opens after @c breaker_threshold consecutive failures of
+ * retryable classes. While it is open, generation calls and stream starts fail
+ * at once with AI_ERROR_NOT_AVAILABLE. Once @c breaker_open_ms has passed, one
+ * trial request is let through. Its success closes the breaker; its failure
+ * opens it again.
+ */
+typedef struct {
+  int32_t max_retries; /**< Retries after the first attempt (0 disables) */
+  int32_t initial_backoff_ms; /**< Delay before the first retry */
+  int32_t max_backoff_ms;     /**< Upper bound for any single delay */
+  double backoff_multiplier;  /**< Delay growth per retry (at least 1) */
+  double jitter; /**< Fraction of each delay that is randomised, 0 to 1 */
+  uint32_t retry_on; /**< Bitmask of AI_RETRY_ON_* failure classes */
+  int32_t breaker_threshold; /**< Consecutive failures that open the circuit
+                                breaker (0 disables it) */
+  int32_t breaker_open_ms; /**< How long the breaker stays open before a trial
+                              request */
+} ai_retry_policy_t;
+
+/**
+ * @brief Policy in effect until ai_set_retry_policy() is called
+ *
+ * Two retries after 200 ms and 400 ms, each up to half shorter at random,
+ * for unavailable, rate-limited or timed-out models; the breaker opens for 10
+ * seconds after 5 consecutive such failures.
+ */
+#define AI_DEFAULT_RETRY_POLICY                                     \
+  {.max_retries = 2,                                                \
+   .initial_backoff_ms = 200,                                       \
+   .max_backoff_ms = 5000,                                          \
+   .backoff_multiplier = 2.0,                                       \
+   .jitter = 0.5,                                                   \
+   .retry_on = AI_RETRY_ON_NOT_READY | AI_RETRY_ON_RATE_LIMITED |   \
+               AI_RETRY_ON_TIMEOUT,                                 \
+   .breaker_threshold = 5,                                          \
+   .breaker_open_ms = 10000}
+
+/**
+ * @brief Circuit breaker states
+ */
+typedef enum {
+  AI_CIRCUIT_CLOSED = 0,   /**< Requests flow normally */
+  AI_CIRCUIT_OPEN = 1,     /**< Requests fail fast */
+  AI_CIRCUIT_HALF_OPEN = 2 /**< One trial request is in flight */
+} ai_circuit_state_t;
+
+/**
+ * @brief Replace the process-wide retry policy
+ *
+ * @param policy New policy. NULL restores AI_DEFAULT_RETRY_POLICY.
+ * @return AI_SUCCESS, or AI_ERROR_INVALID_PARAMS if a field is out of range
+ *
+ * @note The circuit breaker is reset to closed.
+ * @note Streams are not retried, since chunks may already have been
+ * delivered; they only fail fast while the breaker is open and report their
+ * outcome to it.
+ */
+ai_result_t ai_set_retry_policy(const ai_retry_policy_t *policy);
+
+/**
+ * @brief Get the process-wide retry policy
+ *
+ * @param policy Receives the policy in effect
+ */
+void ai_get_retry_policy(ai_retry_policy_t *policy);
+
+/**
+ * @brief Get the current circuit breaker state
+ */
+ai_circuit_state_t ai_get_circuit_state(void);
+
+/** @} */
+
+/**
+ * @defgroup mapreduce Map-Reduce over Large Inputs
+ * @{
+ */
+
+/**
+ * @brief How ai_map_reduce() splits its input and combines partial results
+ *
+ * Token counts are estimated from byte lengths; the model's tokenizer is not
+ * exposed. Chunks end at the last paragraph break that fits, falling back to
+ * a sentence end, then whitespace, then a UTF-8 character boundary.
+ */
+typedef struct {
+  int32_t max_chunk_tokens; /**< Budget for one prompt plus its input,
+                               including the map or reduce prompt (0 = 2048) */
+  int32_t max_fan_in; /**< Most partial results one reduce step combines (0 =
+                         8, minimum 2) */
+} ai_chunk_policy_t;
+
+/**
+ * @brief Default chunk policy: 2048-token steps, reducing 8 results at a time
+ */
+#define AI_DEFAULT_CHUNK_POLICY {.max_chunk_tokens = 0, .max_fan_in = 0}
+
+/**
+ * @brief Phase of a map-reduce step
+ */
+typedef enum {
+  AI_MAP_REDUCE_MAP = 0,   /**< Map step over one chunk of the input */
+  AI_MAP_REDUCE_REDUCE = 1 /**< Reduce step over several partial results */
+} ai_map_reduce_stage_t;
+
+/**
+ * @brief Progress of an ai_map_reduce() call, reported after each step
+ */
+typedef struct {
+  ai_map_reduce_stage_t stage; /**< Phase of the step that finished */
+  int32_t level;   /**< 0 for the map round, 1.. for successive reduce rounds */
+  size_t step;     /**< Index of the finished step within its round */
+  size_t completed; /**< Steps finished so far in this round */
+  size_t total;     /**< Steps in this round */
+  size_t chunks;    /**< Chunks the input was split into */
+  const char *result; /**< The step's response, i.e. a partial result */
+} ai_map_reduce_progress_t;
+
+/**
+ * @brief Callback reporting map-reduce progress and partial results
+ *
+ * @param context Context passed to ai_map_reduce()
+ * @param progress Progress snapshot; valid only during the callback
+ * @param user_data User data from the map-reduce configuration
+ *
+ * @note Called from worker threads, but never concurrently.
+ */
+typedef void (*ai_map_reduce_callback_t)(
+    ai_context_t *context, const ai_map_reduce_progress_t *progress,
+    void *user_data);
+
+/**
+ * @brief Map-reduce execution settings
+ */
+typedef struct {
+  const ai_session_config_t *session_config; /**< Settings for the session
+                                                pool (NULL uses defaults) */
+  const ai_generation_params_t *params; /**< Parameters for every step (NULL
+                                           uses defaults) */
+  int32_t parallelism; /**< Sessions running steps concurrently (0 = 4) */
+  ai_map_reduce_callback_t progress; /**< Optional progress callback */
+  void *user_data; /**< User data passed to the progress callback */
+} ai_map_reduce_config_t;
+
+/**
+ * @brief Default map-reduce settings: four default sessions, no callback
+ */
+#define AI_DEFAULT_MAP_REDUCE_CONFIG \
+  {.session_config = NULL,           \
+   .params = NULL,                   \
+   .parallelism = 0,                 \
+   .progress = NULL,                 \
+   .user_data = NULL}
+
+/**
+ * @brief Summarise or extract from an input larger than the context window
+ *
+ * Splits the input into chunks that fit the chunk policy, runs @p map_prompt
+ * over every chunk in parallel on a pool of fresh sessions, then combines the
+ * partial results with @p reduce_prompt, at most max_fan_in at a time, round
+ * after round until one result remains. With a single chunk no reduce step
+ * runs.
+ *
+ * Every step is prompted with its instruction, a blank line and its input.
+ * With a schema, each step is a structured generation and reduce steps
+ * receive the "object" members of earlier results as a JSON array, so the
+ * schema must describe both per-chunk and combined results. Without one,
+ * steps generate text and reduce steps receive earlier results separated by
+ * blank lines.
+ *
+ * @param context Context that owns the session pool and receives errors
+ * @param config Execution settings (NULL uses AI_DEFAULT_MAP_REDUCE_CONFIG)
+ * @param input Text to process; need not be NUL-terminated
+ * @param length Length of @p input in bytes
+ * @param policy Chunking policy (NULL uses AI_DEFAULT_CHUNK_POLICY)
+ * @param map_prompt Instruction applied to each chunk
+ * @param reduce_prompt Instruction that combines partial results
+ * @param schema_json Optional JSON schema for every step's result
+ * @return The final result in the format ai_generate_structured_response()
+ * or ai_generate_response() returns, or NULL on error. **Memory ownership**:
+ * Caller must call ai_free_string().
+ *
+ * @note Blocks until the final result is ready. The first failing step stops
+ * further steps from starting; ai_get_last_error() then describes it.
+ * @note The pool's sessions live in contexts of their own for the duration of
+ * the call, so they take none of @p context's session slots; their request
+ * counts are added to @p context's statistics. The pool runs with as many
+ * sessions as it could create.
+ */
+char *ai_map_reduce(ai_context_t *context,
+                    const ai_map_reduce_config_t *config, const char *input,
+                    size_t length, const ai_chunk_policy_t *policy,
+                    const char *map_prompt, const char *reduce_prompt,
+                    const char *schema_json);
+
+/**
+ * @brief Run ai_map_reduce() over a file without reading it into memory
+ *
+ * The file is memory-mapped for the duration of the call, so only the pages
+ * of chunks being prompted need to be resident.
+ *
+ * @param path Path of the file to process
+ * @return As for ai_map_reduce(); NULL also if the file cannot be mapped
+ */
+char *ai_map_reduce_file(ai_context_t *context,
+                         const ai_map_reduce_config_t *config,
+                         const char *path, const ai_chunk_policy_t *policy,
+                         const char *map_prompt, const char *reduce_prompt,
+                         const char *schema_json);
+
+/** @} */
+
+/**
+ * @defgroup budget Prompt Budget
+ * @{
+ */
+
+/** Collapse runs of spaces and tabs, trailing whitespace and blank lines */
+#define AI_COMPACT_WHITESPACE (1u << 0)
+/** Replace paragraphs that repeat an earlier one with a short marker */
+#define AI_COMPACT_DUPLICATES (1u << 1)
+/** Keep only the head and tail of long runs of log lines */
+#define AI_COMPACT_LOGS (1u << 2)
+/** Every compaction pass */
+#define AI_COMPACT_ALL \
+  (AI_COMPACT_WHITESPACE | AI_COMPACT_DUPLICATES | AI_COMPACT_LOGS)
+
+/**
+ * @brief Estimate how many tokens a text costs the model
+ *
+ * The model's tokenizer is not exposed, so this assumes about four bytes per
+ * token, a fair average for English prose. Other languages and dense code can
+ * cost more.
+ *
+ * @param text Text to measure (NULL counts as empty)
+ * @return Estimated token count
+ */
+int32_t ai_estimate_tokens(const char *text);
+
+/**
+ * @brief Shrink a prompt without changing what it asks
+ *
+ * Passes run in the order logs, duplicates, whitespace. Leading indentation
+ * is kept so that code keeps its structure. Paragraphs shorter than 64 bytes
+ * are never treated as duplicates.
+ *
+ * @param prompt Prompt to compact
+ * @param passes Bitmask of AI_COMPACT_* passes
+ * @param tokens_saved Receives the estimated tokens removed. May be NULL.
+ * @return Compacted prompt, or NULL if @p prompt is NULL or memory ran out.
+ * **Memory ownership**: Caller must call ai_free_string().
+ */
+char *ai_compact_prompt(const char *prompt, uint32_t passes,
+                        int32_t *tokens_saved);
+
+/**
+ * @brief Check whether a request fits the context window before sending it
+ *
+ * Adds the estimated cost of the session's instructions and tool
+ * definitions, the history it has accumulated, the prompt, the schema and
+ * the response budget in @c params->max_tokens. The generation functions run
+ * the same check after applying the session's compaction, and fail with
+ * AI_ERROR_PROMPT_TOO_LONG without contacting the model when it does not
+ * pass.
+ *
+ * @param context Context containing the session
+ * @param session_id Session the request would run on
+ * @param prompt Prompt as it would be sent
+ * @param schema_json Schema for a structured request, or NULL
+ * @param params Generation parameters (NULL uses defaults)
+ * @param estimated_tokens Receives the estimate. May be NULL.
+ * @return AI_SUCCESS if the estimate fits in AI_CONTEXT_WINDOW_TOKENS,
+ * AI_ERROR_PROMPT_TOO_LONG if it does not, or another error code
+ *
+ * @note The history estimate is reset by ai_clear_session_history(). It
+ * counts prompts, responses, tool calls and added messages, so it can
+ * overestimate for a session whose transcript the framework has trimmed.
+ *
+ * @note Setting AI_PREFLIGHT=0 in the environment before ai_init() turns the
+ * check off: the generation functions send oversized requests to the model,
+ * and this function still reports the estimate but returns AI_SUCCESS.
+ */
+ai_result_t ai_preflight_prompt(ai_context_t *context,
+                                ai_session_id_t session_id, const char *prompt,
+                                const char *schema_json,
+                                const ai_generation_params_t *params,
+                                int32_t *estimated_tokens);
+
 /** @} */
 
 /**
@@ -841,6 +1349,365 @@ ai_result_t ai_get_stats(ai_context_t *context, ai_stats_t *stats);
  */
 void ai_reset_stats(ai_context_t *context);
 
+/**
+ * @brief Number of buckets in ai_op_stats_t latency histograms
+ *
+ * Bucket i counts operations that took at most the i-th bound returned by
+ * ai_get_stats_histogram_bounds() and more than the previous one; the last
+ * bucket counts everything slower than the largest bound.
+ */
+#define AI_STATS_HISTOGRAM_BUCKETS 13
+
+/**
+ * @brief Statistics for one kind of operation
+ *
+ * Used for the model requests of a session, for all tool callbacks of a
+ * session, and for an individual tool.
+ */
+typedef struct {
+  uint64_t invocations; /**< Completed operations */
+  uint64_t errors;      /**< Operations that failed or returned NULL */
+  uint64_t bytes_in;  /**< Prompt bytes (model) or argument bytes (tools) */
+  uint64_t bytes_out; /**< Response bytes (model) or result bytes (tools) */
+  double total_time;  /**< Sum of operation latencies in seconds */
+  uint64_t latency_buckets[AI_STATS_HISTOGRAM_BUCKETS]; /**< Non-cumulative
+                                                           latency histogram */
+} ai_op_stats_t;
+
+/**
+ * @brief Per-session statistics
+ */
+typedef struct {
+  ai_op_stats_t model; /**< Generation requests, including streams, measured
+                          from request to final response or chunk */
+  ai_op_stats_t tools; /**< All tool callbacks invoked for this session,
+                          measured around the callback itself */
+  uint64_t prompt_tokens_saved; /**< Estimated tokens removed from this
+                                   session's prompts by compaction */
+} ai_session_stats_t;
+
+/**
+ * @brief Get the upper bounds of the latency histogram buckets
+ *
+ * @param count Receives the number of finite bounds
+ * (AI_STATS_HISTOGRAM_BUCKETS - 1). May be NULL.
+ * @return Ascending bucket upper bounds in seconds. **Memory ownership**: Do
+ * not free.
+ */
+const double *ai_get_stats_histogram_bounds(size_t *count);
+
+/**
+ * @brief Get statistics for a single session
+ *
+ * @param context Context containing the session
+ * @param session_id Session to report on
+ * @param stats Pointer to statistics structure to populate
+ * @return AI_SUCCESS on success, AI_ERROR_SESSION_NOT_FOUND if the session
+ * does not exist, AI_ERROR_INVALID_PARAMS on invalid arguments
+ *
+ * @note Counters are kept per session with atomics, so this never waits for
+ * in-flight generations or tool calls.
+ * @note Statistics start from zero when the session is created.
+ */
+ai_result_t ai_get_session_stats(ai_context_t *context,
+                                 ai_session_id_t session_id,
+                                 ai_session_stats_t *stats);
+
+/**
+ * @brief Get statistics for one tool registered on a session
+ *
+ * @param context Context containing the session
+ * @param session_id Session the tool was registered on
+ * @param tool_name Name passed to ai_register_tool()
+ * @param stats Pointer to statistics structure to populate
+ * @return AI_SUCCESS on success, AI_ERROR_SESSION_NOT_FOUND if the session
+ * does not exist, AI_ERROR_TOOL_NOT_FOUND if no tool of that name is
+ * registered, AI_ERROR_INVALID_PARAMS on invalid arguments
+ *
+ * @note If the tool was registered more than once the registrations are
+ * summed.
+ */
+ai_result_t ai_get_tool_stats(ai_context_t *context, ai_session_id_t session_id,
+                              const char *tool_name, ai_op_stats_t *stats);
+
+/**
+ * @brief Get process-wide statistics for the requests served by one model
+ *
+ * Requests from AI_USE_CASE_AUTO sessions count toward the model that
+ * actually served them.
+ *
+ * @param model AI_USE_CASE_GENERAL or AI_USE_CASE_CONTENT_TAGGING
+ * @param stats Pointer to statistics structure to populate
+ * @return AI_SUCCESS on success, AI_ERROR_INVALID_PARAMS for any other model
+ * or a NULL @p stats
+ *
+ * @note Counters accumulate across all contexts since the process started.
+ */
+ai_result_t ai_get_model_stats(ai_use_case_t model, ai_op_stats_t *stats);
+
+/** @} */
+
+/**
+ * @defgroup metrics Metrics Export
+ * @{
+ */
+
+/**
+ * @brief Metrics exporter configuration
+ *
+ * Exactly one transport is used: the Unix domain socket when
+ * unix_socket_path is set, otherwise a TCP listener on 127.0.0.1:port.
+ */
+typedef struct {
+  const char *unix_socket_path; /**< Socket path to listen on (can be NULL) */
+  uint16_t port; /**< Loopback TCP port, used when unix_socket_path is NULL */
+} ai_metrics_exporter_config_t;
+
+/**
+ * @brief Render all libai metrics in OpenMetrics text format
+ *
+ * Covers request counts by kind and outcome, error counts by result code,
+ * request and time-to-first-chunk latency histograms, in-flight streams,
+ * active sessions, per-tool call counts and latency, and logging counters.
+ *
+ * @return Exposition text terminated by "# EOF", or NULL on allocation
+ * failure. **Memory ownership**: Caller must free with ai_free_string().
+ *
+ * @note Rendering only reads atomic counters and never blocks generation,
+ * streaming or tool callbacks.
+ */
+char *ai_metrics_render(void);
+
+/**
+ * @brief Start serving `GET /metrics` from a background thread
+ *
+ * Serves the output of ai_metrics_render() with the OpenMetrics content type.
+ * Connections are handled one at a time on the exporter thread.
+ *
+ * @param config Transport configuration
+ * @return AI_SUCCESS on success (or if already running),
+ * AI_ERROR_INVALID_PARAMS if no transport was given, AI_ERROR_INIT_FAILED if
+ * the listener could not be created
+ */
+ai_result_t ai_metrics_exporter_start(
+    const ai_metrics_exporter_config_t *config);
+
+/**
+ * @brief Stop the metrics exporter thread and close its listener
+ *
+ * Removes the Unix domain socket file if one was created.
+ */
+void ai_metrics_exporter_stop(void);
+
+/** @} */
+
+/**
+ * @defgroup logging Structured Logging
+ * @{
+ */
+
+/**
+ * @brief Log severity levels
+ *
+ * Records below the configured level are rejected before any formatting or
+ * copying takes place, so disabled levels cost a single atomic load.
+ */
+typedef enum {
+  AI_LOG_TRACE = 0, /**< Per-chunk and per-call detail */
+  AI_LOG_DEBUG = 1, /**< Diagnostic events useful during development */
+  AI_LOG_INFO = 2,  /**< Request lifecycle events */
+  AI_LOG_WARN = 3,  /**< Recoverable problems */
+  AI_LOG_ERROR = 4, /**< Failed operations */
+  AI_LOG_OFF = 5    /**< Logging disabled */
+} ai_log_level_t;
+
+/**
+ * @brief Value type of a structured log field
+ */
+typedef enum {
+  AI_LOG_FIELD_INT = 0,    /**< Signed 64-bit integer */
+  AI_LOG_FIELD_UINT = 1,   /**< Unsigned 64-bit integer */
+  AI_LOG_FIELD_DOUBLE = 2, /**< Double precision number */
+  AI_LOG_FIELD_STRING = 3, /**< NUL-terminated string (copied on write) */
+  AI_LOG_FIELD_BOOL = 4    /**< Boolean */
+} ai_log_field_type_t;
+
+/**
+ * @brief Structured key/value field attached to a log record
+ *
+ * Use the AI_LOG_INT(), AI_LOG_UINT(), AI_LOG_DOUBLE(), AI_LOG_STR() and
+ * AI_LOG_BOOL() helpers to build fields inline.
+ */
+typedef struct {
+  const char *key;          /**< Field name (copied, truncated to 63 bytes) */
+  ai_log_field_type_t type; /**< Type of the value union member in use */
+  union {
+    int64_t i;
+    uint64_t u;
+    double d;
+    const char *s;
+    bool b;
+  } value; /**< Field value */
+} ai_log_field_t;
+
+#define AI_LOG_INT(k, v) \
+  ((ai_log_field_t){.key = (k), .type = AI_LOG_FIELD_INT, .value.i = (v)})
+#define AI_LOG_UINT(k, v) \
+  ((ai_log_field_t){.key = (k), .type = AI_LOG_FIELD_UINT, .value.u = (v)})
+#define AI_LOG_DOUBLE(k, v) \
+  ((ai_log_field_t){.key = (k), .type = AI_LOG_FIELD_DOUBLE, .value.d = (v)})
+#define AI_LOG_STR(k, v) \
+  ((ai_log_field_t){.key = (k), .type = AI_LOG_FIELD_STRING, .value.s = (v)})
+#define AI_LOG_BOOL(k, v) \
+  ((ai_log_field_t){.key = (k), .type = AI_LOG_FIELD_BOOL, .value.b = (v)})
+
+/**
+ * @brief Logging configuration
+ *
+ * Records are written as JSON lines to `<directory>/<file_prefix>.log`. When
+ * the file exceeds max_file_bytes it is rotated to `<file_prefix>.1.log`,
+ * keeping at most max_files rotated files.
+ */
+typedef struct {
+  const char *directory;   /**< Log directory (NULL = ~/.momo/logs) */
+  const char *file_prefix; /**< File name prefix (NULL = "libai") */
+  ai_log_level_t level;    /**< Minimum level to record */
+  size_t max_file_bytes;   /**< Rotation threshold in bytes */
+  int max_files;           /**< Number of rotated files to keep */
+  uint32_t flush_interval_ms; /**< Maximum delay before records hit disk */
+  uint32_t ring_records; /**< Records each logging thread can queue for the
+                            writer, about 500 bytes each (0 = 128). Rounded
+                            up to a power of two, at most 65536. */
+} ai_log_config_t;
+
+/**
+ * @brief Default logging configuration
+ *
+ * Logs INFO and above to ~/.momo/logs/libai.log, rotating at 8 MiB and
+ * keeping 4 old files, flushing at least every 200 ms. Each logging thread
+ * queues up to 128 records, about 62 KiB.
+ */
+#define AI_DEFAULT_LOG_CONFIG      \
+  {.directory = NULL,              \
+   .file_prefix = NULL,            \
+   .level = AI_LOG_INFO,           \
+   .max_file_bytes = 8u << 20,     \
+   .max_files = 4,                 \
+   .flush_interval_ms = 200,       \
+   .ring_records = 128}
+
+/**
+ * @brief Logging subsystem counters
+ */
+typedef struct {
+  uint64_t records_written; /**< Records formatted and written to disk */
+  uint64_t records_dropped; /**< Records lost because a thread's ring was full
+                               or a field set did not fit in one record */
+  uint64_t bytes_written;   /**< Bytes written across all log files */
+  uint64_t files_rotated;   /**< Number of rotations performed */
+  uint32_t active_threads;  /**< Threads currently owning a log ring */
+} ai_log_stats_t;
+
+/**
+ * @brief Start the logging subsystem
+ *
+ * Creates the log directory if needed, opens the log file and starts the
+ * background writer thread. Until this is called every log call is a no-op.
+ *
+ * @param config Logging configuration, or NULL for AI_DEFAULT_LOG_CONFIG
+ * @return AI_SUCCESS on success, AI_ERROR_INIT_FAILED if the directory or
+ * file could not be opened or the writer thread could not be started
+ *
+ * @note Calling this while logging is already running returns AI_SUCCESS and
+ * only applies the new level.
+ */
+ai_result_t ai_log_init(const ai_log_config_t *config);
+
+/**
+ * @brief Stop the logging subsystem
+ *
+ * Drains every thread's ring, writes the remaining records, stops the writer
+ * thread and closes the log file. The rings of exited threads and of the
+ * calling thread are freed; any other thread frees its own the next time it
+ * logs or when it exits.
+ */
+void ai_log_shutdown(void);
+
+/**
+ * @brief Change the minimum level recorded
+ *
+ * @param level New minimum level. AI_LOG_OFF disables logging.
+ */
+void ai_log_set_level(ai_log_level_t level);
+
+/**
+ * @brief Get the minimum level recorded
+ *
+ * @return Current level, AI_LOG_OFF when logging has not been started
+ */
+ai_log_level_t ai_log_get_level(void);
+
+/**
+ * @brief Check whether records at a level would be recorded
+ *
+ * @param level Level to check
+ * @return true if a record at this level would be queued
+ *
+ * @note Use this to skip computing expensive field values.
+ */
+bool ai_log_enabled(ai_log_level_t level);
+
+/**
+ * @brief Queue a structured log record
+ *
+ * Copies the event name and fields into the calling thread's ring buffer and
+ * returns without taking any lock or performing I/O. Formatting and writing
+ * happen on the background writer thread.
+ *
+ * @param level Severity of the record
+ * @param event Short dotted event name, e.g. "stream.complete"
+ * @param fields Array of fields (may be NULL if field_count is 0)
+ * @param field_count Number of fields
+ *
+ * @note If the ring is full the record is dropped and counted rather than
+ * blocking the caller.
+ */
+void ai_log_write(ai_log_level_t level, const char *event,
+                  const ai_log_field_t *fields, size_t field_count);
+
+/**
+ * @brief Block until all records queued before the call are on disk
+ */
+void ai_log_flush(void);
+
+/**
+ * @brief Get logging subsystem counters
+ *
+ * @param stats Pointer to statistics structure to populate
+ * @return AI_SUCCESS on success, AI_ERROR_INVALID_PARAMS if stats is NULL
+ */
+ai_result_t ai_log_get_stats(ai_log_stats_t *stats);
+
+/**
+ * @brief Log an event with inline fields
+ *
+ * @code
+ * AI_LOG(AI_LOG_INFO, "generate.complete", AI_LOG_UINT("request_id", id),
+ *        AI_LOG_DOUBLE("latency_ms", ms), AI_LOG_UINT("bytes", len));
+ * @endcode
+ *
+ * @note At least one field is required; call ai_log_write() directly for
+ * events without fields.
+ */
+#define AI_LOG(level, event, ...)                                    \
+  do {                                                               \
+    if (ai_log_enabled(level)) {                                     \
+      const ai_log_field_t ai_log_fields_[] = {__VA_ARGS__};         \
+      ai_log_write((level), (event), ai_log_fields_,                 \
+                   sizeof(ai_log_fields_) / sizeof(ai_log_fields_[0])); \
+    }                                                                \
+  } while (0)
+
 /** @} */
 
 #ifdef __cplusplus
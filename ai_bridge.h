@@ -46,6 +46,17 @@ typedef enum {
   AI_BRIDGE_UNKNOWN_ERROR = -99   /**< Unknown error occurred */
 } ai_availability_status_t;
 
+/**
+ * @brief System model specialisations a session can be created for
+ *
+ * Mirrors SystemLanguageModel.UseCase.
+ */
+typedef enum {
+  AI_BRIDGE_USE_CASE_GENERAL = 0, /**< SystemLanguageModel.default */
+  AI_BRIDGE_USE_CASE_CONTENT_TAGGING =
+      1 /**< Tagging, entity and topic extraction */
+} ai_bridge_use_case_t;
+
 /**
  * @brief Session identifier type
  *
@@ -60,7 +71,7 @@ typedef uint8_t ai_bridge_session_id_t;
  * Unique identifier for streaming operations. Valid IDs are non-zero values.
  * Use AI_BRIDGE_INVALID_ID to check for invalid streams.
  */
-typedef uint8_t ai_bridge_stream_id_t;
+typedef uint32_t ai_bridge_stream_id_t;
 
 /**
  * @brief Invalid session/stream identifier
@@ -80,8 +91,12 @@ typedef uint8_t ai_bridge_stream_id_t;
  * @param user_data User data pointer passed from the calling function
  *
  * @note The chunk string is only valid during the callback. Copy if needed.
- * @note A NULL chunk indicates either successful completion or an error.
- *       Check for "Error:" prefix to distinguish error messages.
+ * @note Every stream that started ends with exactly one NULL chunk, which is
+ *       the only terminal signal; the context may be released once it
+ *       arrives. A failed or cancelled stream delivers a single chunk
+ *       starting with "Error:" just before the NULL. Text chunks never start
+ *       with "Error:": the bridge splits a delta that would, so the prefix
+ *       identifies the error chunk unambiguously.
  */
 typedef void (*ai_bridge_stream_callback_t)(void *context, const char *chunk,
                                             void *user_data);
@@ -137,6 +152,28 @@ ai_availability_status_t ai_bridge_check_availability(void);
  */
 char *ai_bridge_get_availability_reason(void);
 
+/**
+ * @brief Callback invoked when model availability may have changed
+ *
+ * @param user_data User data passed to ai_bridge_observe_availability()
+ */
+typedef void (*ai_bridge_availability_observer_t)(void *user_data);
+
+/**
+ * @brief Ask to be told when model availability changes
+ *
+ * The observer runs on a background thread, after the change, and may fire
+ * without the status actually differing. Observation lasts for the life of
+ * the process.
+ *
+ * @param observer Function to call on a change
+ * @param user_data User data passed to the observer
+ * @return true if change notifications are supported, false if the caller
+ * must poll ai_bridge_check_availability() instead
+ */
+bool ai_bridge_observe_availability(ai_bridge_availability_observer_t observer,
+                                    void *user_data);
+
 /**
  * @brief Get count of supported languages
  *
@@ -161,6 +198,17 @@ int32_t ai_bridge_get_supported_languages_count(void);
  */
 char *ai_bridge_get_supported_language(int32_t index);
 
+/**
+ * @brief Get every supported language in one call
+ *
+ * @return One line per language, sorted by identifier, each holding the
+ * maximal identifier and the display name separated by a tab;
+ * an empty string if none are supported, or NULL on failure.
+ *         **Memory ownership**: Caller must call ai_bridge_free_string() to
+ * release.
+ */
+char *ai_bridge_get_supported_languages(void);
+
 /**
  * @brief Create a new AI session with the specified configuration
  *
@@ -195,6 +243,20 @@ ai_bridge_session_id_t ai_bridge_create_session(const char *instructions,
                                                 const char *default_schema_json,
                                                 bool prewarm);
 
+/**
+ * @brief Create a session backed by the model for a specific use case
+ *
+ * Like ai_bridge_create_session(), which uses AI_BRIDGE_USE_CASE_GENERAL.
+ *
+ * @param use_case An ai_bridge_use_case_t
+ * @return Session identifier, or AI_BRIDGE_INVALID_ID on failure, including
+ * when the use case's model is not available
+ */
+ai_bridge_session_id_t ai_bridge_create_session_with_use_case(
+    const char *instructions, const char *tools_json, bool enable_guardrails,
+    bool enable_history, bool enable_structured_responses,
+    const char *default_schema_json, bool prewarm, int32_t use_case);
+
 /**
  * @brief Register a tool callback function for the specified session
  *
@@ -218,6 +280,51 @@ bool ai_bridge_register_tool(ai_bridge_session_id_t session_id,
                              ai_bridge_tool_callback_t callback,
                              void *user_data);
 
+/**
+ * @brief Route calls to a tool through the tool call queue
+ *
+ * Alternative to ai_bridge_register_tool() for consumers that want to choose
+ * where tools run. Calls to the tool are queued and taken with
+ * ai_bridge_tool_queue_next(); generation waits for
+ * ai_bridge_tool_call_complete() without occupying a bridge thread.
+ *
+ * @param session_id Session identifier returned by ai_bridge_create_session()
+ * @param tool_name Name of the tool as defined in the session's tools_json
+ * @return true if registration succeeded, false if session not found
+ */
+bool ai_bridge_register_queued_tool(ai_bridge_session_id_t session_id,
+                                    const char *tool_name);
+
+/**
+ * @brief Take the next queued tool call
+ *
+ * @param timeout_ms Milliseconds to wait for a call (-1 = forever, 0 = poll)
+ * @param call_id Receives the identifier for ai_bridge_tool_call_complete()
+ * @param session_id Receives the session that made the call
+ * @param tool_name Receives the tool name. **Memory ownership**: Caller must
+ * call ai_bridge_free_string() to release.
+ * @param arguments_json Receives the arguments as a JSON object. **Memory
+ * ownership**: Caller must call ai_bridge_free_string() to release.
+ * @return true if a call was taken, false on timeout
+ *
+ * @note Calls from all sessions share one queue.
+ */
+bool ai_bridge_tool_queue_next(int32_t timeout_ms, uint64_t *call_id,
+                               ai_bridge_session_id_t *session_id,
+                               char **tool_name, char **arguments_json);
+
+/**
+ * @brief Answer a queued tool call
+ *
+ * @param call_id Identifier returned by ai_bridge_tool_queue_next()
+ * @param result Tool result, or an error message when @p is_error is true
+ * @param is_error Whether the tool failed
+ * @return true if the call was still waiting, false if it was cancelled (for
+ * example because its session was destroyed) or is unknown
+ */
+bool ai_bridge_tool_call_complete(uint64_t call_id, const char *result,
+                                  bool is_error);
+
 /**
  * @brief Destroy a session and release all associated resources
  *
@@ -345,7 +452,7 @@ ai_bridge_stream_id_t ai_bridge_generate_structured_response_stream(
  * @brief Cancel an active streaming operation
  *
  * Attempts to cancel the specified stream. If successful, the stream's callback
- * will be called once more with a NULL chunk to indicate cancellation.
+ * receives an "Error:" chunk followed by the terminal NULL chunk.
  *
  * @param stream_id Stream identifier returned by a streaming function
  * @return true if the stream was found and cancelled, false if stream not found
@@ -357,6 +464,119 @@ ai_bridge_stream_id_t ai_bridge_generate_structured_response_stream(
  */
 bool ai_bridge_cancel_stream(ai_bridge_stream_id_t stream_id);
 
+/**
+ * @brief Stream read status: more output may follow
+ */
+#define AI_BRIDGE_STREAM_OPEN 0
+
+/**
+ * @brief Stream read status: generation completed and all output was read
+ */
+#define AI_BRIDGE_STREAM_FINISHED 1
+
+/**
+ * @brief Stream read status: generation failed; the buffer holds the message
+ */
+#define AI_BRIDGE_STREAM_FAILED 2
+
+/**
+ * @brief Stream read status: the stream ID is unknown or already closed
+ */
+#define AI_BRIDGE_STREAM_UNKNOWN (-1)
+
+/**
+ * @brief Start a pull-based stream
+ *
+ * Starts generation without a callback. Output accumulates in a per-stream
+ * buffer and is drained with ai_bridge_stream_read(), so consumers that pay a
+ * fixed cost per call (such as interpreter bindings) handle many chunks per
+ * read.
+ *
+ * @param session_id Session identifier
+ * @param prompt Input text prompt to send to the AI
+ * @param schema_json JSON schema for a structured response, or NULL to stream
+ * text
+ * @param temperature Controls randomness in generation (0.0 =
+ * deterministic, 2.0 = very random, 0 = use default)
+ * @param max_tokens Maximum number of tokens to generate (0 = use default
+ * limit)
+ * @return Stream identifier, or AI_BRIDGE_INVALID_ID if streaming failed to
+ * start
+ *
+ * @note Every stream opened here must be released with
+ * ai_bridge_stream_close(), including after it has finished.
+ */
+ai_bridge_stream_id_t ai_bridge_stream_open(ai_bridge_session_id_t session_id,
+                                            const char *prompt,
+                                            const char *schema_json,
+                                            double temperature,
+                                            int32_t max_tokens);
+
+/**
+ * @brief Drain pending output from a pull-based stream
+ *
+ * Copies up to @p capacity bytes of UTF-8 output into @p buffer. When nothing
+ * is pending, waits up to @p timeout_ms for output or completion. Output is
+ * always drained before an error is reported, so a failed stream yields its
+ * partial output first and the error message on the final read.
+ *
+ * @param stream_id Stream identifier returned by ai_bridge_stream_open()
+ * @param buffer Destination buffer. The data is not NUL-terminated and may
+ * end in the middle of a multi-byte character.
+ * @param capacity Size of @p buffer in bytes
+ * @param timeout_ms Milliseconds to wait for output (-1 = forever, 0 = poll)
+ * @param status Receives one of the AI_BRIDGE_STREAM_* values describing the
+ * stream after this read. May be NULL.
+ * @return Number of bytes written to @p buffer
+ *
+ * @note Safe to call from any thread, but a stream should have one reader.
+ */
+int32_t ai_bridge_stream_read(ai_bridge_stream_id_t stream_id, char *buffer,
+                              int32_t capacity, int32_t timeout_ms,
+                              int32_t *status);
+
+/**
+ * @brief Signal a file descriptor when a pull-based stream becomes readable
+ *
+ * Writes the stream ID to @p fd, as an ai_bridge_stream_id_t in native byte
+ * order, when output arrives on an empty stream and when the stream finishes.
+ * One descriptor (typically the write end of a pipe watched by an event loop)
+ * can serve many streams; on wakeup, read the IDs and drain each stream with a
+ * zero timeout. Each ID is written atomically, so reads of a multiple of
+ * sizeof(ai_bridge_stream_id_t) bytes return whole IDs.
+ *
+ * @param stream_id Stream identifier returned by ai_bridge_stream_open()
+ * @param fd Non-blocking descriptor to write to, or -1 to stop notifying
+ * @return true if the stream was found, false otherwise
+ *
+ * @note If output is already pending, @p fd is signalled immediately.
+ * @note Notifications stop once ai_bridge_stream_close() returns. Do not close
+ * @p fd while any stream is still attached to it.
+ */
+bool ai_bridge_stream_set_notify_fd(ai_bridge_stream_id_t stream_id, int fd);
+
+/**
+ * @brief Close a pull-based stream
+ *
+ * Cancels generation if it is still running and releases the stream. A reader
+ * blocked in ai_bridge_stream_read() on another thread is woken.
+ *
+ * @param stream_id Stream identifier returned by ai_bridge_stream_open()
+ * @return true if the stream was found, false otherwise
+ */
+bool ai_bridge_stream_close(ai_bridge_stream_id_t stream_id);
+
+/**
+ * @brief Count the streams the bridge is still tracking
+ *
+ * Includes callback streams that have not delivered their final chunk and
+ * pull-based streams that have not been closed. Intended for leak checks in
+ * long-running tests; the value is stale as soon as it is returned.
+ *
+ * @return Number of live streams
+ */
+int32_t ai_bridge_get_active_stream_count(void);
+
 /**
  * @brief Get the conversation history for the specified session as JSON
  *
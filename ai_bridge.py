@@ -11,17 +11,32 @@ Improvements over original:
 - Better error handling with specific exceptions
 """
 
+import codecs
 import ctypes
 import json
+import struct
 import threading
 import weakref
-from typing import Optional, Callable, Any, Dict, Tuple, Union, List
+from typing import (Optional, Callable, Any, Dict, Tuple, Union, List, Iterator,
+                    AsyncIterator, Iterable)
 from pathlib import Path
 from enum import IntEnum
+import asyncio
 import atexit
+import collections
+import concurrent.futures
+import inspect
 import os
+import time
+from contextlib import contextmanager
 from dataclasses import dataclass
 
+# Optional compiled fast paths (`make python-ext`); ctypes is used otherwise
+try:
+    import _libai
+except ImportError:
+    _libai = None
+
 
 class AIAvailabilityStatus(IntEnum):
     """Status codes for Apple Intelligence availability"""
@@ -73,21 +88,43 @@ class StreamingContext:
 
     This class manages the state of a streaming response, including
     thread-safe completion tracking and callback invocation.
+
+    Contexts are preallocated slots that the bridge reuses. A slot is held
+    by the bridge until the NULL chunk that ends its stream and by the
+    stream table while its stream ID is registered; it returns to the free
+    list once both have let go, so late chunks can never reach a recycled
+    slot.
     """
 
     def __init__(self,
                  context_id: int,
-                 callback: Callable[[Optional[str]], None],
+                 callback: Optional[Callable[[Optional[str]], None]],
                  session_id: Optional[int] = None,
                  bridge_ref: Optional[weakref.ref] = None) -> None:
         self.context_id = context_id
         self.callback = callback
         self.session_id = session_id
         self.bridge_ref = bridge_ref  # Weak reference to avoid circular refs
+        self.stream_id = 0
         self.is_complete = False
         self.is_error = False
         self.lock = threading.Lock()
         self.completion_event = threading.Event()
+        self._in_flight = False   # bridge may still call back
+        self._indexed = False     # referenced by the launcher or stream table
+
+    def reset(self,
+              callback: Callable[[Optional[str]], None],
+              session_id: Optional[int]) -> None:
+        """Prepare a free slot for a new stream."""
+        self.callback = callback
+        self.session_id = session_id
+        self.stream_id = 0
+        self.is_complete = False
+        self.is_error = False
+        self.completion_event.clear()
+        self._in_flight = True
+        self._indexed = True
 
     def cleanup(self) -> None:
         """Mark as complete and signal any waiters."""
@@ -95,6 +132,169 @@ class StreamingContext:
             self.is_complete = True
         self.completion_event.set()
 
+    def _release(self, in_flight: bool) -> None:
+        """Drop the bridge's (in_flight) or the table's hold on this slot."""
+        with self.lock:
+            if in_flight:
+                held, self._in_flight = self._in_flight, False
+            else:
+                held, self._indexed = self._indexed, False
+            # Only the last holder to let go reclaims, and only once
+            reclaim = held and not self._in_flight and not self._indexed
+        if reclaim:
+            bridge = self.bridge_ref() if self.bridge_ref else None
+            if bridge is not None:
+                bridge._free_slot(self)
+
+    def deliver(self, token: Optional[bytes]) -> None:
+        """Handle one chunk from the bridge (None on completion)."""
+        # Every stream ends with NULL, after its "Error:" chunk if it failed
+        try:
+            self._deliver(token)
+        finally:
+            if token is None:
+                self._release(in_flight=True)
+
+    def _deliver(self, token: Optional[bytes]) -> None:
+        with self.lock:
+            if self.is_complete:
+                return
+            if token is None:
+                # Stream completed
+                self.is_complete = True
+                self.completion_event.set()
+                try:
+                    self.callback(None)
+                except Exception:
+                    pass
+            else:
+                try:
+                    token_str = token.decode('utf-8')
+                    if token_str.startswith("Error:"):
+                        self.is_error = True
+                        self.completion_event.set()
+                    self.callback(token_str)
+                except Exception:
+                    self.is_error = True
+                    self.completion_event.set()
+                    try:
+                        self.callback(None)
+                    except:
+                        pass
+
+
+class _AsyncStream:
+    """Buffered stream drained by a _LoopNotifier on its event loop."""
+
+    def __init__(self,
+                 bridge: 'AIBridge',
+                 stream_id: int,
+                 loop: asyncio.AbstractEventLoop,
+                 batch_bytes: int) -> None:
+        self.stream_id = stream_id
+        self._bridge = bridge
+        self._loop = loop
+        self._buffer = ctypes.create_string_buffer(batch_bytes)
+        self._batch_bytes = batch_bytes
+        self._status = ctypes.c_int32(0)
+        self._decoder = codecs.getincrementaldecoder('utf-8')()
+        self._chunks: collections.deque = collections.deque()
+        self._done = False
+        self._error: Optional[str] = None
+        self._waiter: Optional[asyncio.Future] = None
+
+    def drain(self) -> None:
+        """Read everything pending without blocking (loop thread only)."""
+        while not self._done:
+            count, status = self._bridge._stream_read(
+                self.stream_id, self._buffer, self._status, 0)
+
+            if status == 2:
+                self._error = self._buffer.raw[:count].decode('utf-8', 'replace')
+                self._done = True
+            elif status < 0:
+                self._error = "Stream closed"
+                self._done = True
+            else:
+                if count:
+                    text = self._decoder.decode(self._buffer.raw[:count])
+                    if text:
+                        self._chunks.append(text)
+                if status == 1:
+                    tail = self._decoder.decode(b'', final=True)
+                    if tail:
+                        self._chunks.append(tail)
+                    self._done = True
+                elif count < self._batch_bytes:
+                    break
+
+        if self._waiter is not None and not self._waiter.done():
+            self._waiter.set_result(None)
+
+    async def next_chunk(self) -> Optional[str]:
+        """Wait for the next chunk of text; None once the stream finished."""
+        while not self._chunks:
+            if self._error is not None:
+                raise StreamError(f"Error: {self._error}")
+            if self._done:
+                return None
+            self._waiter = self._loop.create_future()
+            try:
+                await self._waiter
+            finally:
+                self._waiter = None
+        return self._chunks.popleft()
+
+
+class _LoopNotifier:
+    """Wakes one event loop when any of its buffered streams has output.
+
+    The bridge writes a stream's ID to the pipe, as a native-endian uint32,
+    when that stream becomes readable, so a wakeup drains only the streams
+    that have data. No helper threads are involved; everything here runs on
+    the loop's thread.
+    """
+
+    # Each ID is one atomic pipe write, so reads of whole IDs never split one
+    _TOKEN = struct.Struct('=I')
+    _READ_BYTES = _TOKEN.size * 1024
+
+    def __init__(self, bridge: 'AIBridge', loop: asyncio.AbstractEventLoop) -> None:
+        self._bridge = bridge
+        self._lib = bridge._lib
+        self._loop = loop
+        self._read_fd, self._write_fd = os.pipe()
+        os.set_blocking(self._read_fd, False)
+        os.set_blocking(self._write_fd, False)
+        self._streams: Dict[int, _AsyncStream] = {}
+        loop.add_reader(self._read_fd, self._on_readable)
+
+    def attach(self, stream_id: int, batch_bytes: int) -> _AsyncStream:
+        stream = _AsyncStream(self._bridge, stream_id, self._loop, batch_bytes)
+        self._streams[stream_id] = stream
+        self._lib.ai_bridge_stream_set_notify_fd(stream_id, self._write_fd)
+        return stream
+
+    def detach(self, stream_id: int) -> bool:
+        """Forget a closed stream; returns True when no streams remain."""
+        self._streams.pop(stream_id, None)
+        return not self._streams
+
+    def close(self) -> None:
+        self._loop.remove_reader(self._read_fd)
+        os.close(self._read_fd)
+        os.close(self._write_fd)
+
+    def _on_readable(self) -> None:
+        try:
+            ready = os.read(self._read_fd, self._READ_BYTES)
+        except BlockingIOError:
+            return
+        for stream_id in {token for token, in self._TOKEN.iter_unpack(ready)}:
+            stream = self._streams.get(stream_id)
+            if stream is not None:
+                stream.drain()
+
 
 class AISession:
     """Represents an AI session with Apple Intelligence.
@@ -104,6 +304,9 @@ class AISession:
     conversation history management.
     """
 
+    # How long stream_iter() blocks in native code before re-checking signals
+    _STREAM_READ_TIMEOUT_MS = 250
+
     def __init__(self, session_id: int, bridge: 'AIBridge') -> None:
         self.session_id = session_id
         self.bridge = bridge
@@ -143,17 +346,23 @@ class AISession:
         if not Limits.MIN_TOKENS <= max_tokens <= Limits.MAX_TOKENS:
             raise ValueError(f"max_tokens must be between {Limits.MIN_TOKENS} and {Limits.MAX_TOKENS}")
 
-        response_ptr = self.bridge._lib.ai_bridge_generate_response(
-            self.session_id,
-            prompt.encode('utf-8'),
-            ctypes.c_double(temperature),
-            ctypes.c_int32(max_tokens)
-        )
-
-        if response_ptr:
-            response = ctypes.string_at(response_ptr).decode('utf-8')
-            self.bridge._lib.ai_bridge_free_string(response_ptr)
-
+        native = self.bridge._native
+        if native is not None:
+            response = native.generate(
+                self.session_id, prompt, temperature, max_tokens)
+        else:
+            response_ptr = self.bridge._lib.ai_bridge_generate_response(
+                self.session_id,
+                prompt.encode('utf-8'),
+                ctypes.c_double(temperature),
+                ctypes.c_int32(max_tokens)
+            )
+            response = None
+            if response_ptr:
+                response = ctypes.string_at(response_ptr).decode('utf-8')
+                self.bridge._lib.ai_bridge_free_string(response_ptr)
+
+        if response is not None:
             if response.startswith("Error:"):
                 raise AIBridgeError(response)
             return response
@@ -192,18 +401,25 @@ class AISession:
 
         schema_json = json.dumps(schema).encode('utf-8') if schema else None
 
-        response_ptr = self.bridge._lib.ai_bridge_generate_structured_response(
-            self.session_id,
-            prompt.encode('utf-8'),
-            schema_json,
-            ctypes.c_double(temperature),
-            ctypes.c_int32(max_tokens)
-        )
-
-        if response_ptr:
-            response = ctypes.string_at(response_ptr).decode('utf-8')
-            self.bridge._lib.ai_bridge_free_string(response_ptr)
-
+        native = self.bridge._native
+        if native is not None:
+            response = native.generate_structured(
+                self.session_id, prompt, json.dumps(schema) if schema else None,
+                temperature, max_tokens)
+        else:
+            response_ptr = self.bridge._lib.ai_bridge_generate_structured_response(
+                self.session_id,
+                prompt.encode('utf-8'),
+                schema_json,
+                ctypes.c_double(temperature),
+                ctypes.c_int32(max_tokens)
+            )
+            response = None
+            if response_ptr:
+                response = ctypes.string_at(response_ptr).decode('utf-8')
+                self.bridge._lib.ai_bridge_free_string(response_ptr)
+
+        if response is not None:
             if response.startswith("Error:"):
                 raise AIBridgeError(response)
 
@@ -223,7 +439,8 @@ class AISession:
 
         Args:
             prompt: The input prompt
-            callback: Function called with each token (None when complete)
+            callback: Function called with each token (None when complete).
+                A failed stream passes its "Error:" message before the None.
             temperature: Controls randomness (0.0-2.0)
             max_tokens: Maximum tokens to generate
 
@@ -240,27 +457,31 @@ class AISession:
         if len(prompt) > Limits.MAX_PROMPT_LENGTH:
             raise PromptTooLongError(f"Prompt too long: {len(prompt)} characters")
 
-        # Register context with the bridge
+        # Claim a slot before launch so no chunk can arrive unregistered
         context = self.bridge._register_streaming_context(callback, self.session_id)
-        context_id_ptr = ctypes.pointer(ctypes.c_long(context.context_id))
 
         # Start streaming
-        stream_id = self.bridge._lib.ai_bridge_generate_response_stream(
-            self.session_id,
-            prompt.encode('utf-8'),
-            ctypes.c_double(temperature),
-            ctypes.c_int32(max_tokens),
-            ctypes.cast(context_id_ptr, ctypes.c_void_p),
-            self.bridge._stream_callback_func,
-            None
-        )
+        native = self.bridge._native
+        if native is not None:
+            stream_id = native.stream(
+                self.session_id, prompt, None, temperature, max_tokens,
+                context.deliver, False)
+        else:
+            stream_id = self.bridge._lib.ai_bridge_generate_response_stream(
+                self.session_id,
+                prompt.encode('utf-8'),
+                ctypes.c_double(temperature),
+                ctypes.c_int32(max_tokens),
+                self.bridge._slot_pointer(context),
+                self.bridge._stream_callback_func,
+                None
+            )
 
         if stream_id > 0:
             self.bridge._register_stream(stream_id, context)
             return stream_id
         else:
-            context.cleanup()
-            self.bridge._unregister_streaming_context(context.context_id)
+            self.bridge._abandon_slot(context)
             return None
 
     def stream_structured_response(self,
@@ -287,30 +508,225 @@ class AISession:
 
         schema_json = json.dumps(schema).encode('utf-8') if schema else None
 
-        # Register context with the bridge
+        # Claim a slot before launch so no chunk can arrive unregistered
         context = self.bridge._register_streaming_context(callback, self.session_id)
-        context_id_ptr = ctypes.pointer(ctypes.c_long(context.context_id))
 
         # Start streaming
-        stream_id = self.bridge._lib.ai_bridge_generate_structured_response_stream(
-            self.session_id,
-            prompt.encode('utf-8'),
-            schema_json,
-            ctypes.c_double(temperature),
-            ctypes.c_int32(max_tokens),
-            ctypes.cast(context_id_ptr, ctypes.c_void_p),
-            self.bridge._stream_callback_func,
-            None
-        )
+        native = self.bridge._native
+        if native is not None:
+            stream_id = native.stream(
+                self.session_id, prompt, json.dumps(schema) if schema else None,
+                temperature, max_tokens, context.deliver, True)
+        else:
+            stream_id = self.bridge._lib.ai_bridge_generate_structured_response_stream(
+                self.session_id,
+                prompt.encode('utf-8'),
+                schema_json,
+                ctypes.c_double(temperature),
+                ctypes.c_int32(max_tokens),
+                self.bridge._slot_pointer(context),
+                self.bridge._stream_callback_func,
+                None
+            )
 
         if stream_id > 0:
             self.bridge._register_stream(stream_id, context)
             return stream_id
         else:
-            context.cleanup()
-            self.bridge._unregister_streaming_context(context.context_id)
+            self.bridge._abandon_slot(context)
             return None
 
+    def stream_iter(self,
+                    prompt: str,
+                    temperature: float = 1.0,
+                    max_tokens: int = 1000,
+                    schema: Optional[Dict[str, Any]] = None,
+                    batch_bytes: int = 65536,
+                    raw: bool = False) -> Iterator[Union[str, memoryview]]:
+        """Stream a response by pulling batches of output.
+
+        Unlike stream_response(), no Python code runs on the bridge's threads.
+        Output accumulates on the native side and each iteration drains
+        everything pending in one call, so the GIL is taken once per batch
+        rather than once per chunk.
+
+        Args:
+            prompt: The input prompt
+            temperature: Controls randomness (0.0-2.0)
+            max_tokens: Maximum tokens to generate
+            schema: JSON schema for a structured response (None for text)
+            batch_bytes: Largest batch returned by one iteration
+            raw: Yield memoryviews of UTF-8 bytes instead of decoded text.
+                 Each view is only valid until the next iteration.
+
+        Yields:
+            Text (or bytes when raw) generated since the previous batch
+
+        Raises:
+            SessionDestroyedError: If session is destroyed
+            StreamError: If the stream fails to start or generation fails
+        """
+        with self._lock:
+            if self._destroyed:
+                raise SessionDestroyedError("Session has been destroyed")
+
+        # Validate parameters
+        if not prompt or not prompt.strip():
+            raise ValueError("Prompt cannot be empty")
+        if len(prompt) > Limits.MAX_PROMPT_LENGTH:
+            raise PromptTooLongError(f"Prompt too long: {len(prompt)} characters")
+        if batch_bytes <= 0:
+            raise ValueError("batch_bytes must be positive")
+
+        lib = self.bridge._lib
+        schema_json = json.dumps(schema).encode('utf-8') if schema else None
+
+        stream_id = lib.ai_bridge_stream_open(
+            self.session_id,
+            prompt.encode('utf-8'),
+            schema_json,
+            ctypes.c_double(temperature),
+            ctypes.c_int32(max_tokens)
+        )
+        if stream_id == 0:
+            raise StreamError("Failed to start stream")
+
+        buffer = ctypes.create_string_buffer(batch_bytes)
+        view = memoryview(buffer).cast('B')
+        status = ctypes.c_int32(0)
+        decoder = None if raw else codecs.getincrementaldecoder('utf-8')()
+
+        try:
+            while True:
+                # ctypes releases the GIL for the duration of the call; the
+                # short timeout keeps KeyboardInterrupt responsive.
+                count, state = self.bridge._stream_read(
+                    stream_id, buffer, status, self._STREAM_READ_TIMEOUT_MS)
+
+                if state == 2:
+                    message = bytes(view[:count]).decode('utf-8', 'replace')
+                    raise StreamError(f"Error: {message}")
+                if state < 0:
+                    raise StreamError("Stream closed")
+
+                if count:
+                    if raw:
+                        yield view[:count]
+                    else:
+                        text = decoder.decode(view[:count])
+                        if text:
+                            yield text
+
+                if state == 1:
+                    if decoder is not None:
+                        tail = decoder.decode(b'', final=True)
+                        if tail:
+                            yield tail
+                    return
+        finally:
+            view.release()
+            lib.ai_bridge_stream_close(stream_id)
+
+
+    async def astream(self,
+                      prompt: str,
+                      temperature: float = 1.0,
+                      max_tokens: int = 1000,
+                      schema: Optional[Dict[str, Any]] = None,
+                      batch_bytes: int = 65536) -> AsyncIterator[str]:
+        """Stream a response on the running asyncio event loop.
+
+        The bridge signals a pipe watched with loop.add_reader(), so
+        thousands of concurrent streams share one loop without helper
+        threads. Leaving the loop early cancels generation.
+
+        Args:
+            prompt: The input prompt
+            temperature: Controls randomness (0.0-2.0)
+            max_tokens: Maximum tokens to generate
+            schema: JSON schema for a structured response (None for text)
+            batch_bytes: Largest read from the bridge per call
+
+        Yields:
+            Text generated since the previous chunk
+
+        Raises:
+            SessionDestroyedError: If session is destroyed
+            StreamError: If the stream fails to start or generation fails
+        """
+        with self._lock:
+            if self._destroyed:
+                raise SessionDestroyedError("Session has been destroyed")
+
+        # Validate parameters
+        if not prompt or not prompt.strip():
+            raise ValueError("Prompt cannot be empty")
+        if len(prompt) > Limits.MAX_PROMPT_LENGTH:
+            raise PromptTooLongError(f"Prompt too long: {len(prompt)} characters")
+        if batch_bytes <= 0:
+            raise ValueError("batch_bytes must be positive")
+
+        loop = asyncio.get_running_loop()
+        lib = self.bridge._lib
+        schema_json = json.dumps(schema).encode('utf-8') if schema else None
+
+        stream_id = lib.ai_bridge_stream_open(
+            self.session_id,
+            prompt.encode('utf-8'),
+            schema_json,
+            ctypes.c_double(temperature),
+            ctypes.c_int32(max_tokens)
+        )
+        if stream_id == 0:
+            raise StreamError("Failed to start stream")
+
+        notifier = self.bridge._acquire_loop_notifier(loop)
+        try:
+            stream = notifier.attach(stream_id, batch_bytes)
+            while True:
+                chunk = await stream.next_chunk()
+                if chunk is None:
+                    return
+                yield chunk
+        finally:
+            # Close first: the bridge stops writing to the pipe once this
+            # returns, so the notifier may then release it.
+            lib.ai_bridge_stream_close(stream_id)
+            self.bridge._release_loop_notifier(loop, stream_id)
+
+    async def agenerate(self,
+                        prompt: str,
+                        temperature: float = 1.0,
+                        max_tokens: int = 1000,
+                        schema: Optional[Dict[str, Any]] = None
+                        ) -> Union[str, Dict[str, Any]]:
+        """Generate a response without blocking the running event loop.
+
+        Args:
+            prompt: The input prompt
+            temperature: Controls randomness (0.0-2.0)
+            max_tokens: Maximum tokens to generate
+            schema: JSON schema for a structured response (None for text)
+
+        Returns:
+            The generated text, or a dictionary with 'text' and 'object'
+            fields when a schema is given
+
+        Raises:
+            SessionDestroyedError: If session is destroyed
+            StreamError: If generation fails
+        """
+        parts = [chunk async for chunk in self.astream(
+            prompt, temperature=temperature, max_tokens=max_tokens,
+            schema=schema)]
+        response = ''.join(parts)
+
+        if schema is None:
+            return response
+        try:
+            return json.loads(response)
+        except json.JSONDecodeError as e:
+            raise AIBridgeError(f"Invalid JSON response: {e}")
 
     def cancel_stream(self, stream_id: int) -> bool:
         """Cancel an active stream.
@@ -408,6 +824,325 @@ class AISession:
         self.destroy()
 
 
+@dataclass
+class Tool:
+    """A Python function the model can call.
+
+    The function receives the arguments as keyword arguments, already parsed
+    into Python objects, and may be a coroutine function. A str result is
+    passed to the model as-is; anything else is JSON-encoded.
+    """
+    name: str
+    function: Callable[..., Any]
+    description: Optional[str] = None
+    input_schema: Optional[Dict[str, Any]] = None
+
+    def definition(self) -> Dict[str, Any]:
+        definition: Dict[str, Any] = {'name': self.name}
+        if self.description:
+            definition['description'] = self.description
+        if self.input_schema:
+            definition['input_schema'] = self.input_schema
+        return definition
+
+
+ToolExecutor = Union[concurrent.futures.Executor, asyncio.AbstractEventLoop]
+
+
+class _ToolDispatcher:
+    """Takes queued tool calls from the bridge and runs them on executors.
+
+    One thread waits in ai_bridge_tool_queue_next() with the GIL released and
+    hands each call to the executor registered for its tool. The bridge's
+    generation task stays suspended, holding no thread, until the executor
+    reports the result.
+
+    The tool queue belongs to the loaded library, not to an AIBridge, so all
+    bridges on one library share a dispatcher through acquire() and
+    release(). Tools are keyed by session ID, which the library keeps unique
+    across those bridges.
+    """
+
+    _POLL_TIMEOUT_MS = 250
+
+    _instances: Dict[str, '_ToolDispatcher'] = {}
+    _instances_lock = threading.Lock()
+
+    @classmethod
+    def acquire(cls, library_path: Path, lib: ctypes.CDLL) -> '_ToolDispatcher':
+        key = os.path.realpath(library_path)
+        with cls._instances_lock:
+            dispatcher = cls._instances.get(key)
+            if dispatcher is None:
+                dispatcher = cls._instances[key] = cls(lib)
+            dispatcher._users += 1
+            return dispatcher
+
+    def release(self) -> None:
+        with self._instances_lock:
+            self._users -= 1
+            if self._users > 0:
+                return
+            for key in [key for key, dispatcher in self._instances.items()
+                        if dispatcher is self]:
+                del self._instances[key]
+            # Stopped under the lock so that a new dispatcher never polls the
+            # queue alongside this one
+            self.shutdown()
+
+    def __init__(self, lib: ctypes.CDLL) -> None:
+        self._lib = lib
+        self._users = 0
+        self._lock = threading.Lock()
+        self._tools: Dict[Tuple[int, str], Tuple[Tool, ToolExecutor]] = {}
+        self._default_executor: Optional[concurrent.futures.ThreadPoolExecutor] = None
+        self._stop = threading.Event()
+        self._thread: Optional[threading.Thread] = None
+
+    def register(self,
+                 session_id: int,
+                 tool: Tool,
+                 executor: Optional[ToolExecutor]) -> None:
+        with self._lock:
+            if executor is None:
+                if self._default_executor is None:
+                    self._default_executor = concurrent.futures.ThreadPoolExecutor(
+                        thread_name_prefix='ai-tool')
+                executor = self._default_executor
+            self._tools[(session_id, tool.name)] = (tool, executor)
+            if self._thread is None:
+                self._thread = threading.Thread(
+                    target=self._run, name='ai-tool-dispatch', daemon=True)
+                self._thread.start()
+
+    def unregister_session(self, session_id: int) -> None:
+        with self._lock:
+            for key in [key for key in self._tools if key[0] == session_id]:
+                del self._tools[key]
+
+    def shutdown(self) -> None:
+        self._stop.set()
+        with self._lock:
+            thread, self._thread = self._thread, None
+            executor, self._default_executor = self._default_executor, None
+        if thread is not None and thread is not threading.current_thread():
+            thread.join()
+        if executor is not None:
+            executor.shutdown(wait=False)
+
+    def _run(self) -> None:
+        call_id = ctypes.c_uint64()
+        session_id = ctypes.c_uint8()
+        name_ptr = ctypes.POINTER(ctypes.c_char)()
+        arguments_ptr = ctypes.POINTER(ctypes.c_char)()
+
+        while not self._stop.is_set():
+            if not self._lib.ai_bridge_tool_queue_next(
+                    self._POLL_TIMEOUT_MS, ctypes.byref(call_id),
+                    ctypes.byref(session_id), ctypes.byref(name_ptr),
+                    ctypes.byref(arguments_ptr)):
+                continue
+
+            name = ctypes.string_at(name_ptr).decode('utf-8', 'replace')
+            arguments = ctypes.string_at(arguments_ptr)
+            self._lib.ai_bridge_free_string(name_ptr)
+            self._lib.ai_bridge_free_string(arguments_ptr)
+
+            # Every session's tool calls go through this thread, so one bad
+            # call must fail on its own rather than end the loop
+            try:
+                self._dispatch(call_id.value, session_id.value, name, arguments)
+            except Exception as e:
+                self._complete(call_id.value, f"{type(e).__name__}: {e}", True)
+
+    def _dispatch(self,
+                  call_id: int,
+                  session_id: int,
+                  name: str,
+                  arguments: bytes) -> None:
+        with self._lock:
+            entry = self._tools.get((session_id, name))
+        if entry is None:
+            self._complete(call_id, f"Tool '{name}' is not registered", True)
+            return
+
+        tool, executor = entry
+        self._submit(executor, call_id, tool, arguments)
+
+    def _submit(self,
+                executor: ToolExecutor,
+                call_id: int,
+                tool: Tool,
+                arguments: bytes) -> None:
+        if isinstance(executor, asyncio.AbstractEventLoop):
+            async def invoke() -> None:
+                try:
+                    result = tool.function(**json.loads(arguments))
+                    if inspect.isawaitable(result):
+                        result = await result
+                except Exception as e:
+                    self._complete(call_id, f"{type(e).__name__}: {e}", True)
+                else:
+                    self._complete_result(call_id, result)
+
+            coroutine = invoke()
+            try:
+                executor.call_soon_threadsafe(executor.create_task, coroutine)
+            except RuntimeError as e:
+                # Event loop closed
+                coroutine.close()
+                self._complete(call_id, str(e), True)
+            return
+
+        def invoke_sync() -> None:
+            try:
+                result = tool.function(**json.loads(arguments))
+                if inspect.isawaitable(result):
+                    result = asyncio.run(result)
+            except Exception as e:
+                self._complete(call_id, f"{type(e).__name__}: {e}", True)
+            else:
+                self._complete_result(call_id, result)
+
+        try:
+            executor.submit(invoke_sync)
+        except RuntimeError as e:
+            # Executor shut down
+            self._complete(call_id, str(e), True)
+
+    def _complete_result(self, call_id: int, result: Any) -> None:
+        try:
+            text = result if isinstance(result, str) else json.dumps(result)
+        except (TypeError, ValueError) as e:
+            self._complete(call_id, f"Tool result is not JSON serializable: {e}", True)
+            return
+        self._complete(call_id, text, False)
+
+    def _complete(self, call_id: int, text: str, is_error: bool) -> None:
+        self._lib.ai_bridge_tool_call_complete(call_id, text.encode('utf-8'), is_error)
+
+
+@dataclass
+class MapResult:
+    """Outcome of one prompt passed to AIBridge.map() or AIBridge.amap()."""
+    index: int
+    value: Optional[Union[str, Dict[str, Any]]] = None
+    error: Optional[Exception] = None
+    seconds: float = 0.0
+
+    @property
+    def ok(self) -> bool:
+        return self.error is None
+
+
+class SessionPool:
+    """A bounded set of warm sessions sharing one configuration.
+
+    Sessions are created on demand up to ``size`` and handed out one caller
+    at a time. Because a session keeps its transcript, recycle() replaces a
+    session with a fresh one so independent prompts don't see each other.
+    """
+
+    def __init__(self,
+                 bridge: 'AIBridge',
+                 size: int,
+                 instructions: Optional[str] = None,
+                 enable_structured_responses: bool = False,
+                 default_schema: Optional[Dict[str, Any]] = None) -> None:
+        if not 1 <= size <= Limits.MAX_SESSIONS_PER_BRIDGE:
+            raise ValueError(f"size must be between 1 and {Limits.MAX_SESSIONS_PER_BRIDGE}")
+        self.bridge = bridge
+        self.size = size
+        self._config = dict(instructions=instructions,
+                            enable_structured_responses=enable_structured_responses,
+                            default_schema=default_schema,
+                            prewarm=True)
+        self._idle: List[AISession] = []
+        self._created = 0
+        self._closed = False
+        self._condition = threading.Condition()
+
+    def acquire(self, timeout: Optional[float] = None) -> Optional[AISession]:
+        """Take a session, creating one if the pool has room.
+
+        Args:
+            timeout: Seconds to wait for a session (None waits forever,
+                     0 returns immediately)
+
+        Returns:
+            A session, or None if none became available in time
+        """
+        deadline = None if timeout is None else time.monotonic() + timeout
+        with self._condition:
+            while True:
+                if self._closed:
+                    raise AIBridgeError("Session pool is closed")
+                if self._idle:
+                    return self._idle.pop()
+                if self._created < self.size:
+                    self._created += 1
+                    break
+                remaining = None if deadline is None else deadline - time.monotonic()
+                if remaining is not None and remaining <= 0:
+                    return None
+                self._condition.wait(remaining)
+
+        try:
+            return self.bridge.create_session(**self._config)
+        except Exception:
+            with self._condition:
+                self._created -= 1
+                self._condition.notify()
+            raise
+
+    def release(self, session: AISession) -> None:
+        """Return a session taken with acquire()."""
+        with self._condition:
+            if not self._closed and not session._destroyed:
+                self._idle.append(session)
+                self._condition.notify()
+                return
+            self._created -= 1
+            self._condition.notify()
+        session.destroy()
+
+    def recycle(self, session: AISession) -> AISession:
+        """Replace a checked-out session with a fresh, prewarmed one."""
+        session.destroy()
+        try:
+            return self.bridge.create_session(**self._config)
+        except Exception:
+            with self._condition:
+                self._created -= 1
+                self._condition.notify()
+            raise
+
+    @contextmanager
+    def session(self) -> Iterator[AISession]:
+        """Borrow a session for the duration of a with-block."""
+        session = self.acquire()
+        try:
+            yield session
+        finally:
+            self.release(session)
+
+    def close(self) -> None:
+        """Destroy idle sessions; sessions still checked out are destroyed on release."""
+        with self._condition:
+            self._closed = True
+            idle, self._idle = self._idle, []
+            self._created -= len(idle)
+            self._condition.notify_all()
+        for session in idle:
+            session.destroy()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+
 class AIBridge:
     """Main interface to the AI Bridge library.
 
@@ -415,6 +1150,9 @@ class AIBridge:
     No global state - all contexts are managed per-bridge instance.
     """
 
+    # Preallocated streaming contexts; more are added if all are in use
+    _INITIAL_STREAM_SLOTS = 64
+
     def __init__(self, library_path: Optional[Union[Path, str]] = None):
         """Initialize the AI Bridge.
 
@@ -437,21 +1175,43 @@ class AIBridge:
         self._lib = ctypes.CDLL(str(library_path))
         self._setup_functions()
 
+        # Prefer the compiled fast paths for the same library when available
+        self._native = None
+        if _libai is not None and not os.environ.get('AI_BRIDGE_DISABLE_NATIVE'):
+            try:
+                _libai.bind(str(library_path))
+                self._native = _libai
+            except OSError:
+                pass
+
         # Initialize the bridge
         if not self._lib.ai_bridge_init():
             raise AIBridgeError("Failed to initialize AI Bridge")
 
-        # Instance-level context management (no global state!)
-        self._contexts_lock = threading.RLock()
-        self._streaming_contexts: Dict[int, StreamingContext] = {}
-        self._context_counter = 0
+        # Instance-level stream slots (no global state!). Slots are
+        # preallocated and recycled through a deque, whose append/popleft are
+        # atomic, so the streaming hot path takes no bridge-wide lock.
+        self._slots: List[StreamingContext] = [
+            StreamingContext(index, None, None, weakref.ref(self))
+            for index in range(self._INITIAL_STREAM_SLOTS)
+        ]
+        self._free_slots: collections.deque = collections.deque(range(len(self._slots)))
+        self._slots_grow_lock = threading.Lock()
 
-        self._streams_lock = threading.RLock()
-        self._active_streams: Dict[int, StreamingContext] = {}
+        # Launched streams by the bridge's stream ID
+        self._stream_table: Dict[int, StreamingContext] = {}
 
         self._sessions_lock = threading.RLock()
         self._active_sessions: List[AISession] = []
 
+        # Queued tool calls, dispatched to Python executors
+        self._tool_dispatcher: Optional[_ToolDispatcher] = \
+            _ToolDispatcher.acquire(library_path, self._lib)
+
+        # One notification pipe per event loop with async streams in flight
+        self._notifiers_lock = threading.Lock()
+        self._loop_notifiers: Dict[asyncio.AbstractEventLoop, _LoopNotifier] = {}
+
         # Create and store callback functions
         self._stream_callback_func = self._STREAM_CALLBACK(self._stream_callback)
 
@@ -549,7 +1309,7 @@ class AIBridge:
             self._STREAM_CALLBACK,   # callback
             ctypes.c_void_p          # userData
         ]
-        self._lib.ai_bridge_generate_response_stream.restype = ctypes.c_uint8
+        self._lib.ai_bridge_generate_response_stream.restype = ctypes.c_uint32
 
         # ai_bridge_generate_structured_response_stream
         self._lib.ai_bridge_generate_structured_response_stream.argtypes = [
@@ -562,12 +1322,68 @@ class AIBridge:
             self._STREAM_CALLBACK,   # callback
             ctypes.c_void_p          # userData
         ]
-        self._lib.ai_bridge_generate_structured_response_stream.restype = ctypes.c_uint8
+        self._lib.ai_bridge_generate_structured_response_stream.restype = ctypes.c_uint32
+
+# ai_bridge_stream_open
+        self._lib.ai_bridge_stream_open.argtypes = [
+            ctypes.c_uint8,          # sessionId
+            ctypes.c_char_p,         # prompt
+            ctypes.c_char_p,         # schemaJson (NULL for text)
+            ctypes.c_double,         # temperature
+            ctypes.c_int32           # maxTokens
+        ]
+        self._lib.ai_bridge_stream_open.restype = ctypes.c_uint32
+
+        # ai_bridge_stream_read
+        self._lib.ai_bridge_stream_read.argtypes = [
+            ctypes.c_uint32,                 # streamId
+            ctypes.c_char_p,                 # buffer
+            ctypes.c_int32,                  # capacity
+            ctypes.c_int32,                  # timeoutMs
+            ctypes.POINTER(ctypes.c_int32)   # status
+        ]
+        self._lib.ai_bridge_stream_read.restype = ctypes.c_int32
+
+        # ai_bridge_stream_set_notify_fd
+        self._lib.ai_bridge_stream_set_notify_fd.argtypes = [
+            ctypes.c_uint32,         # streamId
+            ctypes.c_int             # fd
+        ]
+        self._lib.ai_bridge_stream_set_notify_fd.restype = ctypes.c_bool
+
+        # ai_bridge_stream_close
+        self._lib.ai_bridge_stream_close.argtypes = [ctypes.c_uint32]
+        self._lib.ai_bridge_stream_close.restype = ctypes.c_bool
 
-# ai_bridge_cancel_stream
-        self._lib.ai_bridge_cancel_stream.argtypes = [ctypes.c_uint8]
+        # ai_bridge_cancel_stream
+        self._lib.ai_bridge_cancel_stream.argtypes = [ctypes.c_uint32]
         self._lib.ai_bridge_cancel_stream.restype = ctypes.c_bool
 
+        # ai_bridge_register_queued_tool
+        self._lib.ai_bridge_register_queued_tool.argtypes = [
+            ctypes.c_uint8,    # sessionId
+            ctypes.c_char_p    # toolName
+        ]
+        self._lib.ai_bridge_register_queued_tool.restype = ctypes.c_bool
+
+        # ai_bridge_tool_queue_next
+        self._lib.ai_bridge_tool_queue_next.argtypes = [
+            ctypes.c_int32,                                   # timeoutMs
+            ctypes.POINTER(ctypes.c_uint64),                  # callId
+            ctypes.POINTER(ctypes.c_uint8),                   # sessionId
+            ctypes.POINTER(ctypes.POINTER(ctypes.c_char)),    # toolName
+            ctypes.POINTER(ctypes.POINTER(ctypes.c_char))     # argumentsJson
+        ]
+        self._lib.ai_bridge_tool_queue_next.restype = ctypes.c_bool
+
+        # ai_bridge_tool_call_complete
+        self._lib.ai_bridge_tool_call_complete.argtypes = [
+            ctypes.c_uint64,   # callId
+            ctypes.c_char_p,   # result
+            ctypes.c_bool      # isError
+        ]
+        self._lib.ai_bridge_tool_call_complete.restype = ctypes.c_bool
+
         # ai_bridge_destroy_session
         self._lib.ai_bridge_destroy_session.argtypes = [ctypes.c_uint8]
         self._lib.ai_bridge_destroy_session.restype = None
@@ -595,44 +1411,73 @@ class AIBridge:
     def _register_streaming_context(self,
                                    callback: Callable[[Optional[str]], None],
                                    session_id: Optional[int] = None) -> StreamingContext:
-        """Register a new streaming context (thread-safe)."""
-        with self._contexts_lock:
-            context_id = self._context_counter
-            self._context_counter += 1
-            context = StreamingContext(context_id, callback, session_id, weakref.ref(self))
-            self._streaming_contexts[context_id] = context
-            return context
-
-    def _unregister_streaming_context(self, context_id: int) -> None:
-        """Remove a streaming context (thread-safe)."""
-        with self._contexts_lock:
-            self._streaming_contexts.pop(context_id, None)
+        """Claim a free streaming slot before launching a stream."""
+        try:
+            index = self._free_slots.popleft()
+        except IndexError:
+            with self._slots_grow_lock:
+                index = len(self._slots)
+                self._slots.append(StreamingContext(index, None, None, weakref.ref(self)))
+        context = self._slots[index]
+        context.reset(callback, session_id)
+        return context
+
+    def _slot_pointer(self, context: StreamingContext) -> ctypes.c_void_p:
+        """Context pointer for a slot.
+
+        The slot index itself is encoded in the pointer value (offset by one
+        so it is never NULL), so there is no ctypes object to keep alive for
+        the lifetime of the stream.
+        """
+        return ctypes.c_void_p(context.context_id + 1)
 
     def _get_streaming_context(self, context_id: int) -> Optional[StreamingContext]:
-        """Get a streaming context by ID (thread-safe)."""
-        with self._contexts_lock:
-            return self._streaming_contexts.get(context_id)
+        """Get a streaming slot by index."""
+        if 0 <= context_id < len(self._slots):
+            return self._slots[context_id]
+        return None
+
+    def _free_slot(self, context: StreamingContext) -> None:
+        """Return a slot nobody references any more to the free list."""
+        context.callback = None
+        self._free_slots.append(context.context_id)
+
+    def _abandon_slot(self, context: StreamingContext) -> None:
+        """Release a slot whose stream failed to start (no callbacks follow)."""
+        context.cleanup()
+        context._release(in_flight=True)
+        context._release(in_flight=False)
 
     def _register_stream(self, stream_id: int, context: StreamingContext) -> None:
-        """Register an active stream."""
-        with self._streams_lock:
-            self._active_streams[stream_id] = context
+        """Index a launched stream's slot by its stream ID."""
+        context.stream_id = stream_id
+        previous = self._stream_table.get(stream_id)
+        self._stream_table[stream_id] = context
+        # The bridge reuses the IDs of ended streams; drop the stale entry
+        if previous is not None and previous is not context:
+            previous._release(in_flight=False)
+
+    def _lookup_stream(self, stream_id: int) -> Optional[StreamingContext]:
+        context = self._stream_table.get(stream_id)
+        if context is None or context.stream_id != stream_id:
+            return None
+        return context
 
     def _unregister_stream(self, stream_id: int) -> None:
         """Unregister and cleanup a stream."""
-        with self._streams_lock:
-            if stream_id in self._active_streams:
-                context = self._active_streams.pop(stream_id)
-                context.cleanup()
-                self._unregister_streaming_context(context.context_id)
+        context = self._lookup_stream(stream_id)
+        if context is None:
+            return
+        self._stream_table.pop(stream_id, None)
+        context.cleanup()
+        context._release(in_flight=False)
 
     def _cleanup_session_streams(self, session_id: int) -> None:
         """Cancel all streams for a session."""
-        with self._streams_lock:
-            streams_to_cancel = [
-                sid for sid, ctx in self._active_streams.items()
-                if ctx.session_id == session_id
-            ]
+        streams_to_cancel = [
+            ctx.stream_id for ctx in list(self._stream_table.values())
+            if ctx.session_id == session_id
+        ]
 
         for stream_id in streams_to_cancel:
             try:
@@ -641,48 +1486,59 @@ class AIBridge:
             except:
                 pass
 
+    def _stream_read(self,
+                     stream_id: int,
+                     buffer: ctypes.Array,
+                     status: ctypes.c_int32,
+                     timeout_ms: int) -> Tuple[int, int]:
+        """Drain a buffered stream into buffer; returns (count, status)."""
+        if self._native is not None:
+            return self._native.stream_read_into(stream_id, buffer, timeout_ms)
+        count = self._lib.ai_bridge_stream_read(
+            stream_id, buffer, len(buffer), timeout_ms, ctypes.byref(status))
+        return count, status.value
+
+    def _acquire_loop_notifier(self, loop: asyncio.AbstractEventLoop) -> _LoopNotifier:
+        """Get the notifier for an event loop, creating it on first use."""
+        with self._notifiers_lock:
+            notifier = self._loop_notifiers.get(loop)
+            if notifier is None:
+                notifier = _LoopNotifier(self, loop)
+                self._loop_notifiers[loop] = notifier
+            return notifier
+
+    def _release_loop_notifier(self,
+                               loop: asyncio.AbstractEventLoop,
+                               stream_id: int) -> None:
+        """Detach a closed stream and drop the notifier once it is idle."""
+        with self._notifiers_lock:
+            notifier = self._loop_notifiers.get(loop)
+            if notifier is None or not notifier.detach(stream_id):
+                return
+            del self._loop_notifiers[loop]
+        notifier.close()
+
     def _unregister_session(self, session: AISession) -> None:
         """Remove a session from active sessions."""
         with self._sessions_lock:
             if session in self._active_sessions:
                 self._active_sessions.remove(session)
+        if self._tool_dispatcher is not None:
+            self._tool_dispatcher.unregister_session(session.session_id)
 
     def _stream_callback(self,
                         context_ptr: ctypes.c_void_p,
                         token: ctypes.c_char_p,
                         user_data: ctypes.c_void_p) -> None:
         """Callback for streaming responses (called from C code)."""
-        # Extract context ID from pointer
-        context_id = ctypes.cast(context_ptr, ctypes.POINTER(ctypes.c_long)).contents.value
-
-        # Get context (thread-safe)
-        context = self._get_streaming_context(context_id)
-        if not context:
+        # The pointer value is the slot index plus one; see _slot_pointer()
+        if not context_ptr:
+            return
+        context = self._get_streaming_context(context_ptr - 1)
+        if context is None:
             return
 
-        with context.lock:
-            if token is None:
-                # Stream completed
-                context.is_complete = True
-                context.completion_event.set()
-                try:
-                    context.callback(None)
-                except Exception:
-                    pass
-            else:
-                try:
-                    token_str = token.decode('utf-8')
-                    if token_str.startswith("Error:"):
-                        context.is_error = True
-                        context.completion_event.set()
-                    context.callback(token_str)
-                except Exception:
-                    context.is_error = True
-                    context.completion_event.set()
-                    try:
-                        context.callback(None)
-                    except:
-                        pass
+        context.deliver(token)
 
     def check_availability(self) -> Tuple[AIAvailabilityStatus, Optional[str]]:
         """Check if Apple Intelligence is available.
@@ -725,7 +1581,9 @@ class AIBridge:
                       enable_history: bool = True,
                       enable_structured_responses: bool = False,
                       default_schema: Optional[Dict[str, Any]] = None,
-                      prewarm: bool = True) -> AISession:
+                      prewarm: bool = True,
+                      tools: Optional[List[Tool]] = None,
+                      tool_executor: Optional[ToolExecutor] = None) -> AISession:
         """Create a new AI session with full configuration options.
 
         Args:
@@ -734,6 +1592,10 @@ class AIBridge:
             enable_structured_responses: Whether to enable structured responses
             default_schema: Default JSON schema for structured responses
             prewarm: Whether to prewarm for faster first response
+            tools: Python functions the model may call
+            tool_executor: Where tools run: a concurrent.futures.Executor or
+                           an asyncio event loop (default: a shared thread
+                           pool owned by the bridge)
 
         Returns:
             AISession object
@@ -747,6 +1609,10 @@ class AIBridge:
         if status != AIAvailabilityStatus.AVAILABLE:
             raise ModelUnavailableError(f"Apple Intelligence not available: {reason}")
 
+        dispatcher = self._tool_dispatcher
+        if tools and dispatcher is None:
+            raise AIBridgeError("Bridge has been cleaned up")
+
         # Check session limit
         with self._sessions_lock:
             if len(self._active_sessions) >= Limits.MAX_SESSIONS_PER_BRIDGE:
@@ -755,11 +1621,13 @@ class AIBridge:
         # Prepare parameters
         instructions_bytes = instructions.encode('utf-8') if instructions else None
         schema_json = json.dumps(default_schema).encode('utf-8') if default_schema else None
+        tools_json = (json.dumps([tool.definition() for tool in tools]).encode('utf-8')
+                      if tools else None)
 
         # Create session
         session_id = self._lib.ai_bridge_create_session(
             instructions_bytes,
-            None,  # no tools
+            tools_json,
             True,  # guardrails always enabled
             enable_history,
             enable_structured_responses,
@@ -770,6 +1638,14 @@ class AIBridge:
         if session_id == 0:
             raise AIBridgeError("Failed to create session")
 
+        for tool in tools or []:
+            dispatcher.register(session_id, tool, tool_executor)
+            if not self._lib.ai_bridge_register_queued_tool(
+                    session_id, tool.name.encode('utf-8')):
+                dispatcher.unregister_session(session_id)
+                self._lib.ai_bridge_destroy_session(session_id)
+                raise AIBridgeError(f"Failed to register tool '{tool.name}'")
+
         # Create and register session
         session = AISession(session_id, self)
         with self._sessions_lock:
@@ -777,6 +1653,211 @@ class AIBridge:
 
         return session
 
+    def session_pool(self,
+                     size: int,
+                     instructions: Optional[str] = None,
+                     enable_structured_responses: bool = False,
+                     default_schema: Optional[Dict[str, Any]] = None) -> SessionPool:
+        """Create a pool of up to ``size`` warm sessions with one configuration."""
+        return SessionPool(self, size, instructions,
+                           enable_structured_responses, default_schema)
+
+    def _map_pool(self,
+                  pool: Optional[SessionPool],
+                  concurrency: int,
+                  instructions: Optional[str],
+                  schema: Optional[Dict[str, Any]]) -> Tuple[SessionPool, int, bool]:
+        if concurrency < 1:
+            raise ValueError("concurrency must be at least 1")
+        if pool is not None:
+            return pool, min(concurrency, pool.size), False
+        concurrency = min(concurrency, Limits.MAX_SESSIONS_PER_BRIDGE)
+        pool = SessionPool(self, concurrency, instructions,
+                           enable_structured_responses=schema is not None)
+        return pool, concurrency, True
+
+    def map(self,
+            prompts: Iterable[str],
+            schema: Optional[Dict[str, Any]] = None,
+            concurrency: int = 4,
+            instructions: Optional[str] = None,
+            temperature: float = 1.0,
+            max_tokens: int = 1000,
+            pool: Optional[SessionPool] = None,
+            reset_sessions: bool = True) -> List[MapResult]:
+        """Run many independent prompts across a pool of sessions.
+
+        Each worker thread owns one session. The GIL is released while the
+        bridge generates, so workers overlap. Failures are recorded per item
+        and never abort the batch.
+
+        Args:
+            prompts: Prompts to run
+            schema: JSON schema for structured responses (None for text)
+            concurrency: Number of sessions used at once
+            instructions: System instructions for sessions created here
+                          (ignored when pool is given)
+            temperature: Controls randomness (0.0-2.0)
+            max_tokens: Maximum tokens to generate per prompt
+            pool: Existing SessionPool to draw sessions from
+            reset_sessions: Give every prompt a fresh session so earlier
+                            prompts don't accumulate in its transcript
+
+        Returns:
+            One MapResult per prompt, in input order
+        """
+        prompts = list(prompts)
+        results = [MapResult(index) for index in range(len(prompts))]
+        if not prompts:
+            return results
+
+        pool, concurrency, owns_pool = self._map_pool(
+            pool, min(concurrency, len(prompts)), instructions, schema)
+        next_index = iter(range(len(prompts)))
+        index_lock = threading.Lock()
+        session_errors: List[Exception] = []
+
+        def worker() -> None:
+            try:
+                session = pool.acquire()
+            except Exception as e:
+                # Leave the prompts to workers that did get a session
+                session_errors.append(e)
+                return
+
+            first = True
+            try:
+                while True:
+                    with index_lock:
+                        index = next(next_index, None)
+                    if index is None:
+                        return
+
+                    result = results[index]
+                    if reset_sessions and not first:
+                        try:
+                            session = pool.recycle(session)
+                        except Exception as e:
+                            session = None
+                            session_errors.append(e)
+                            result.error = e
+                            return
+                    first = False
+
+                    start = time.perf_counter()
+                    try:
+                        if schema is None:
+                            result.value = session.generate_response(
+                                prompts[index], temperature, max_tokens)
+                        else:
+                            result.value = session.generate_structured_response(
+                                prompts[index], schema, temperature, max_tokens)
+                    except Exception as e:
+                        result.error = e
+                    result.seconds = time.perf_counter() - start
+            finally:
+                if session is not None:
+                    pool.release(session)
+
+        threads = [threading.Thread(target=worker, name=f"ai-map-{i}", daemon=True)
+                   for i in range(concurrency)]
+        try:
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+        finally:
+            if owns_pool:
+                pool.close()
+
+        self._fail_unrun(results, next_index, session_errors)
+        return results
+
+    @staticmethod
+    def _fail_unrun(results: List[MapResult],
+                    remaining: Iterator[int],
+                    session_errors: List[Exception]) -> None:
+        """Mark prompts that no worker reached because sessions failed."""
+        for index in remaining:
+            results[index].error = (session_errors[0] if session_errors else
+                                    AIBridgeError("No session available"))
+
+    async def amap(self,
+                   prompts: Iterable[str],
+                   schema: Optional[Dict[str, Any]] = None,
+                   concurrency: int = 4,
+                   instructions: Optional[str] = None,
+                   temperature: float = 1.0,
+                   max_tokens: int = 1000,
+                   pool: Optional[SessionPool] = None,
+                   reset_sessions: bool = True) -> List[MapResult]:
+        """Asyncio version of map() built on AISession.agenerate().
+
+        Runs entirely on the calling event loop with one coroutine per
+        session and no helper threads.
+
+        Returns:
+            One MapResult per prompt, in input order
+        """
+        prompts = list(prompts)
+        results = [MapResult(index) for index in range(len(prompts))]
+        if not prompts:
+            return results
+
+        pool, concurrency, owns_pool = self._map_pool(
+            pool, min(concurrency, len(prompts)), instructions, schema)
+        next_index = iter(range(len(prompts)))
+
+        session_errors: List[Exception] = []
+
+        async def worker(session: Optional[AISession]) -> None:
+            first = True
+            try:
+                for index in next_index:
+                    result = results[index]
+                    if reset_sessions and not first:
+                        try:
+                            session = pool.recycle(session)
+                        except Exception as e:
+                            session = None
+                            session_errors.append(e)
+                            result.error = e
+                            return
+                    first = False
+
+                    start = time.perf_counter()
+                    try:
+                        result.value = await session.agenerate(
+                            prompts[index], temperature, max_tokens, schema)
+                    except Exception as e:
+                        result.error = e
+                    result.seconds = time.perf_counter() - start
+            finally:
+                if session is not None:
+                    pool.release(session)
+
+        try:
+            # Take what the pool can give now; wait (off-loop) only if empty
+            sessions = []
+            while len(sessions) < concurrency:
+                session = pool.acquire(timeout=0)
+                if session is None:
+                    break
+                sessions.append(session)
+            if not sessions:
+                loop = asyncio.get_running_loop()
+                sessions.append(await loop.run_in_executor(None, pool.acquire))
+
+            await asyncio.gather(*(worker(session) for session in sessions))
+        except Exception as e:
+            session_errors.append(e)
+        finally:
+            if owns_pool:
+                pool.close()
+
+        self._fail_unrun(results, next_index, session_errors)
+        return results
+
     def wait_for_stream(self, stream_id: int, timeout: float = 60.0) -> bool:
         """Wait for a stream to complete.
 
@@ -787,8 +1868,7 @@ class AIBridge:
         Returns:
             True if completed successfully, False if timed out or errored
         """
-        with self._streams_lock:
-            context = self._active_streams.get(stream_id)
+        context = self._lookup_stream(stream_id)
 
         if not context:
             return False
@@ -810,16 +1890,14 @@ class AIBridge:
         Returns:
             True if stream had an error
         """
-        with self._streams_lock:
-            context = self._active_streams.get(stream_id)
+        context = self._lookup_stream(stream_id)
 
         return context.is_error if context else False
 
     def cleanup(self) -> None:
         """Clean up all resources managed by this bridge."""
         # Cancel all active streams
-        with self._streams_lock:
-            stream_ids = list(self._active_streams.keys())
+        stream_ids = list(self._stream_table)
 
         for stream_id in stream_ids:
             try:
@@ -839,9 +1917,9 @@ class AIBridge:
             except:
                 pass
 
-        # Clear all contexts
-        with self._contexts_lock:
-            self._streaming_contexts.clear()
+        dispatcher, self._tool_dispatcher = self._tool_dispatcher, None
+        if dispatcher is not None:
+            dispatcher.release()
 
     def __del__(self):
         """Ensure cleanup on deletion."""
@@ -0,0 +1,127 @@
+/**
+ * @file ai_internal.h
+ * @brief Declarations shared between libai translation units
+ *
+ * Not installed and not part of the public API. Everything here may change
+ * without notice.
+ */
+
+#ifndef AI_INTERNAL_H
+#define AI_INTERNAL_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ai.h"
+
+/**
+ * @brief Request categories used to label metrics
+ */
+typedef enum {
+  AI_REQUEST_GENERATE = 0,
+  AI_REQUEST_STRUCTURED,
+  AI_REQUEST_STREAM,
+  AI_REQUEST_STRUCTURED_STREAM,
+  AI_REQUEST_KIND_COUNT
+} ai_request_kind_t;
+
+/** Number of finite histogram bucket bounds (an implicit +Inf follows) */
+#define AI_HISTOGRAM_BOUND_COUNT 12
+
+/** Upper bounds in seconds for every latency histogram */
+extern const double ai_histogram_bounds[AI_HISTOGRAM_BOUND_COUNT];
+
+/**
+ * @brief Lock-free latency histogram
+ *
+ * Buckets are stored non-cumulatively; the exporter accumulates them while
+ * rendering. The sum is kept in microseconds so it can be an atomic integer.
+ */
+typedef struct {
+  _Atomic(uint64_t) buckets[AI_HISTOGRAM_BOUND_COUNT + 1];
+  _Atomic(uint64_t) count;
+  _Atomic(uint64_t) sum_us;
+} ai_histogram_t;
+
+void ai_histogram_observe(ai_histogram_t *histogram, double seconds);
+
+/**
+ * @brief Counters behind one ai_op_stats_t
+ *
+ * Updated with relaxed atomics from callback threads and snapshotted
+ * without locking.
+ */
+typedef struct {
+  _Atomic(uint64_t) invocations;
+  _Atomic(uint64_t) errors;
+  _Atomic(uint64_t) bytes_in;
+  _Atomic(uint64_t) bytes_out;
+  ai_histogram_t latency;
+} ai_op_counters_t;
+
+void ai_op_counters_record(ai_op_counters_t *counters, bool success,
+                           double seconds, size_t bytes_in, size_t bytes_out);
+void ai_op_counters_snapshot(ai_op_counters_t *counters, ai_op_stats_t *stats);
+
+/** Opaque per-tool-name metrics slot, resolved once at registration */
+typedef struct ai_tool_metrics ai_tool_metrics_t;
+
+ai_tool_metrics_t *ai_metrics_tool(const char *tool_name);
+void ai_metrics_record_tool_call(ai_tool_metrics_t *tool, double seconds,
+                                 bool success);
+
+/** Rough average for English text; the model's tokenizer is not exposed */
+#define AI_BYTES_PER_TOKEN 4
+
+/** Estimated token cost of @p bytes of text, rounded up */
+size_t ai_estimate_tokens_for_bytes(size_t bytes);
+
+/** Records an error on a context as the public API functions do */
+void ai_set_error(ai_context_t *context, ai_result_t code, const char *fmt,
+                  ...);
+
+/** Repeats @p from's last error on @p context without counting it again */
+void ai_copy_error(ai_context_t *context, ai_context_t *from);
+
+/** Adds @p from's request counters to @p context's */
+void ai_add_stats(ai_context_t *context, ai_context_t *from);
+
+/**
+ * @brief Retryable failure classes; class c corresponds to AI_RETRY_ON_*
+ * bit (1u << c)
+ */
+typedef enum {
+  AI_RETRY_CLASS_NOT_READY = 0,
+  AI_RETRY_CLASS_RATE_LIMITED,
+  AI_RETRY_CLASS_TIMEOUT,
+  AI_RETRY_CLASS_GENERATION,
+  AI_RETRY_CLASS_COUNT
+} ai_retry_class_t;
+
+void ai_metrics_record_retry(ai_retry_class_t retry_class);
+void ai_metrics_record_retries_exhausted(void);
+void ai_metrics_set_circuit_state(ai_circuit_state_t state, bool opened);
+void ai_metrics_record_circuit_rejection(void);
+
+/** Number of models per-model metrics are kept for (the non-AUTO use cases) */
+#define AI_MODEL_COUNT 2
+
+void ai_metrics_record_request(ai_request_kind_t kind, bool success,
+                               double seconds);
+void ai_metrics_record_model_request(ai_use_case_t model, bool success,
+                                     double seconds, size_t bytes_in,
+                                     size_t bytes_out);
+void ai_metrics_record_first_chunk(double seconds);
+void ai_metrics_record_chunk_gap(double seconds);
+void ai_metrics_record_stall(bool cancelled);
+void ai_metrics_record_preflight_rejection(void);
+void ai_metrics_record_compaction(size_t tokens_saved);
+void ai_metrics_record_error(ai_result_t code);
+void ai_metrics_stream_started(void);
+void ai_metrics_stream_finished(void);
+void ai_metrics_session_created(void);
+void ai_metrics_session_destroyed(void);
+
+#endif
@@ -0,0 +1,267 @@
+/*
+ * Shared-memory ring and control framing for the libai IPC transport; see
+ * ai_ipc.h.
+ */
+
+#include "ai_ipc.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// macOS has no MSG_NOSIGNAL; its sockets set SO_NOSIGPIPE instead
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+#define RECORD_ALIGN 16
+#define MAX_PASSED_FDS 4
+
+static_assert(sizeof(ai_ipc_record_t) == RECORD_ALIGN,
+              "record headers keep payloads aligned");
+static_assert(sizeof(ai_ipc_ring_t) % 64 == 0,
+              "record data starts on a cache line");
+
+static char *ring_data(const ai_ipc_ring_t *ring) {
+  return (char *)ring + sizeof(ai_ipc_ring_t);
+}
+
+static uint64_t record_size(uint32_t length) {
+  uint64_t payload = (uint64_t)length + 1;
+  return sizeof(ai_ipc_record_t) +
+         (payload + RECORD_ALIGN - 1) / RECORD_ALIGN * RECORD_ALIGN;
+}
+
+size_t ai_ipc_ring_size(uint64_t capacity) {
+  return sizeof(ai_ipc_ring_t) + (size_t)capacity;
+}
+
+void ai_ipc_ring_init(ai_ipc_ring_t *ring, uint64_t capacity) {
+  ring->magic = AI_IPC_RING_MAGIC;
+  ring->version = AI_IPC_PROTOCOL_VERSION;
+  ring->capacity = capacity;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  atomic_init(&ring->reader_waiting, 0);
+}
+
+bool ai_ipc_ring_valid(const ai_ipc_ring_t *ring, size_t mapped_size) {
+  if (mapped_size < sizeof(ai_ipc_ring_t)) return false;
+  return ring->magic == AI_IPC_RING_MAGIC &&
+         ring->version == AI_IPC_PROTOCOL_VERSION &&
+         ring->capacity >= 4096 && ring->capacity % RECORD_ALIGN == 0 &&
+         ai_ipc_ring_size(ring->capacity) <= mapped_size;
+}
+
+bool ai_ipc_ring_write(ai_ipc_ring_t *ring, uint32_t tag, uint8_t kind,
+                       const char *data, uint32_t length, bool *corrupt) {
+  uint64_t capacity = ring->capacity;
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  *corrupt = false;
+
+  // The consumer lives in another process; never trust its counter
+  if (head - tail > capacity || head % RECORD_ALIGN != 0) {
+    *corrupt = true;
+    return false;
+  }
+
+  uint64_t size = record_size(length);
+  uint64_t offset = head % capacity;
+  uint64_t contiguous = capacity - offset;
+  uint64_t needed = size <= contiguous ? size : contiguous + size;
+  if (needed > capacity - (head - tail)) return false;
+
+  char *base = ring_data(ring);
+  if (size > contiguous) {
+    ai_ipc_record_t pad = {.length = (uint32_t)(contiguous -
+                                                sizeof(ai_ipc_record_t)),
+                           .kind = AI_IPC_RECORD_PAD};
+    memcpy(base + offset, &pad, sizeof(pad));
+    offset = 0;
+  }
+
+  ai_ipc_record_t record = {.length = length, .tag = tag, .kind = kind};
+  memcpy(base + offset, &record, sizeof(record));
+  if (length) memcpy(base + offset + sizeof(record), data, length);
+  base[offset + sizeof(record) + length] = '\0';
+
+  // Sequentially consistent so it orders against the waiter flag check
+  atomic_store(&ring->head, head + needed);
+  return true;
+}
+
+bool ai_ipc_ring_take_waiter(ai_ipc_ring_t *ring) {
+  // A plain load keeps the common, busy-reader case free of RMWs
+  if (!atomic_load(&ring->reader_waiting)) return false;
+  return atomic_exchange(&ring->reader_waiting, 0) != 0;
+}
+
+const ai_ipc_record_t *ai_ipc_ring_peek(ai_ipc_ring_t *ring) {
+  uint64_t capacity = ring->capacity;
+  char *base = ring_data(ring);
+
+  for (;;) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail == head) return NULL;
+
+    uint64_t offset = tail % capacity;
+    const ai_ipc_record_t *record = (const ai_ipc_record_t *)(base + offset);
+    // Pads run to the end of the buffer; other records keep their NUL inside
+    uint64_t end = offset + sizeof(*record) + (uint64_t)record->length;
+    if (record->kind == AI_IPC_RECORD_PAD ? end != capacity : end >= capacity) {
+      return NULL;  // Malformed; leave the ring stuck rather than overrun
+    }
+    if (record->kind != AI_IPC_RECORD_PAD) return record;
+
+    atomic_store_explicit(&ring->tail, tail + capacity - offset,
+                          memory_order_release);
+  }
+}
+
+void ai_ipc_ring_advance(ai_ipc_ring_t *ring, const ai_ipc_record_t *record) {
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  atomic_store_explicit(&ring->tail, tail + record_size(record->length),
+                        memory_order_release);
+}
+
+bool ai_ipc_ring_prepare_wait(ai_ipc_ring_t *ring) {
+  atomic_store(&ring->reader_waiting, 1);
+  uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  if (atomic_load(&ring->head) == tail) return true;
+
+  atomic_store(&ring->reader_waiting, 0);
+  return false;
+}
+
+void ai_ipc_ring_finish_wait(ai_ipc_ring_t *ring) {
+  atomic_store_explicit(&ring->reader_waiting, 0, memory_order_relaxed);
+}
+
+static bool send_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t n = send(fd, data, length, SEND_FLAGS);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    length -= (size_t)n;
+  }
+  return true;
+}
+
+static bool recv_all(int fd, char *data, size_t length) {
+  while (length > 0) {
+    ssize_t n = recv(fd, data, length, 0);
+    if (n == 0) return false;
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    length -= (size_t)n;
+  }
+  return true;
+}
+
+bool ai_ipc_send_frame(int fd, const char *json, size_t length,
+                       const int *fds, int fd_count) {
+  if (length > AI_IPC_MAX_FRAME || fd_count > MAX_PASSED_FDS) return false;
+
+  unsigned char header[4] = {length & 0xff, (length >> 8) & 0xff,
+                             (length >> 16) & 0xff, (length >> 24) & 0xff};
+  if (fd_count == 0) {
+    return send_all(fd, (const char *)header, sizeof(header)) &&
+           send_all(fd, json, length);
+  }
+
+  // Descriptors ride on the first byte of the header
+  union {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+  } control = {0};
+  struct iovec iov = {.iov_base = header, .iov_len = 1};
+  struct msghdr msg = {
+      .msg_iov = &iov,
+      .msg_iovlen = 1,
+      .msg_control = control.buffer,
+      .msg_controllen = CMSG_SPACE(sizeof(int) * (size_t)fd_count),
+  };
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * (size_t)fd_count);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * (size_t)fd_count);
+
+  ssize_t n;
+  do {
+    n = sendmsg(fd, &msg, SEND_FLAGS);
+  } while (n < 0 && errno == EINTR);
+  return n == 1 && send_all(fd, (const char *)header + 1, 3) &&
+         send_all(fd, json, length);
+}
+
+char *ai_ipc_recv_frame(int fd, int *fds, int max_fds, int *fd_count) {
+  if (fd_count) *fd_count = 0;
+
+  unsigned char header[4];
+  union {
+    struct cmsghdr align;
+    char buffer[CMSG_SPACE(sizeof(int) * MAX_PASSED_FDS)];
+  } control;
+  struct iovec iov = {.iov_base = header, .iov_len = 1};
+  struct msghdr msg = {
+      .msg_iov = &iov,
+      .msg_iovlen = 1,
+      .msg_control = control.buffer,
+      .msg_controllen = sizeof(control.buffer),
+  };
+
+  ssize_t n;
+  do {
+    n = recvmsg(fd, &msg, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n != 1) return NULL;
+
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    int count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+    for (int i = 0; i < count; i++) {
+      int passed;
+      memcpy(&passed, CMSG_DATA(cmsg) + sizeof(int) * (size_t)i,
+             sizeof(passed));
+      if (fds && fd_count && *fd_count < max_fds) {
+        fds[(*fd_count)++] = passed;
+      } else {
+        close(passed);
+      }
+    }
+  }
+
+  size_t length = 0;
+  char *json = NULL;
+  if (recv_all(fd, (char *)header + 1, 3)) {
+    length = (size_t)header[0] | (size_t)header[1] << 8 |
+             (size_t)header[2] << 16 | (size_t)header[3] << 24;
+    json = length <= AI_IPC_MAX_FRAME ? malloc(length + 1) : NULL;
+  }
+  if (!json || !recv_all(fd, json, length)) {
+    free(json);
+    for (int i = 0; fd_count && i < *fd_count; i++) close(fds[i]);
+    if (fd_count) *fd_count = 0;
+    return NULL;
+  }
+  json[length] = '\0';
+  return json;
+}
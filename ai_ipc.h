@@ -0,0 +1,152 @@
+/**
+ * @file ai_ipc.h
+ * @brief Wire protocol between libai-server and the IPC bridge
+ *
+ * Co-located processes reach a shared libai-server through two channels:
+ *
+ * - A Unix stream socket carries control frames: a 4-byte little-endian
+ *   length followed by a JSON object. Requests carry an "id" that the reply
+ *   echoes; tool calls flow the other way as {"event":"tool_call",...}.
+ * - A shared-memory ring carries stream output. The client creates it,
+ *   unlinks its name at once and hands the descriptor to the server in the
+ *   hello frame together with the write end of a doorbell pipe.
+ *
+ * The ring has one consumer (the client's reader thread) and producers that
+ * serialise on a server-side mutex. Records never wrap: one that does not fit
+ * before the end of the buffer is preceded by a pad record. Payloads are
+ * NUL-terminated in place so the client can hand them to stream callbacks
+ * without copying. The producer only rings the doorbell when the consumer has
+ * announced it is about to sleep, so a busy reader costs no syscalls.
+ *
+ * Not installed and not part of the public API.
+ */
+
+#ifndef AI_IPC_H
+#define AI_IPC_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bumped whenever frames or the ring layout change incompatibly */
+#define AI_IPC_PROTOCOL_VERSION 1
+
+/** Socket used when AI_IPC_SOCKET is not set in the environment */
+#define AI_IPC_DEFAULT_SOCKET "/tmp/libai-server.sock"
+
+/** Ring data capacity requested by clients */
+#define AI_IPC_RING_BYTES (1u << 20)
+
+/** Largest control frame either side accepts */
+#define AI_IPC_MAX_FRAME (16u << 20)
+
+#define AI_IPC_RING_MAGIC 0x4c414952u /* "RIAL" */
+
+/**
+ * @brief Ring record kinds
+ */
+typedef enum {
+  AI_IPC_RECORD_PAD = 0,   /**< Filler up to the end of the buffer */
+  AI_IPC_RECORD_CHUNK = 1, /**< A stream chunk; more follow */
+  AI_IPC_RECORD_PART = 2,  /**< Leading piece of a chunk too large to fit */
+  AI_IPC_RECORD_END = 4    /**< Terminal NULL chunk */
+} ai_ipc_record_kind_t;
+
+/**
+ * @brief Record header; the payload and its NUL follow, padded to 16 bytes
+ */
+typedef struct {
+  uint32_t length; /**< Payload bytes, excluding the NUL */
+  uint32_t tag;    /**< Client-chosen stream tag */
+  uint8_t kind;    /**< An ai_ipc_record_kind_t */
+  uint8_t reserved[7];
+} ai_ipc_record_t;
+
+/**
+ * @brief Shared ring header; capacity bytes of record data follow it
+ *
+ * head and tail are free-running byte counts. Each side only writes its own
+ * counter, on its own cache line.
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  alignas(64) _Atomic(uint64_t) head;           /**< Written by the producer */
+  alignas(64) _Atomic(uint64_t) tail;           /**< Written by the consumer */
+  alignas(64) _Atomic(uint32_t) reader_waiting; /**< Set before sleeping */
+} ai_ipc_ring_t;
+
+/** Largest payload one record carries; longer chunks are split into parts */
+#define AI_IPC_MAX_RECORD_PAYLOAD(capacity) ((capacity) / 4)
+
+/** Bytes to map for a ring with the given data capacity */
+size_t ai_ipc_ring_size(uint64_t capacity);
+
+/** Initialises a freshly mapped, zero-filled ring */
+void ai_ipc_ring_init(ai_ipc_ring_t *ring, uint64_t capacity);
+
+/** Checks a ring received from the peer against the size actually mapped */
+bool ai_ipc_ring_valid(const ai_ipc_ring_t *ring, size_t mapped_size);
+
+/**
+ * @brief Appends one record
+ *
+ * @return false if the ring has no room yet, or if the consumer's counter is
+ * corrupt (in which case @p corrupt is set)
+ * @note Callers must serialise producers and keep @p length within
+ * AI_IPC_MAX_RECORD_PAYLOAD.
+ */
+bool ai_ipc_ring_write(ai_ipc_ring_t *ring, uint32_t tag, uint8_t kind,
+                       const char *data, uint32_t length, bool *corrupt);
+
+/**
+ * @brief Whether the producer must ring the doorbell after writing
+ *
+ * Clears the consumer's waiting flag, so only one wake-up is sent per sleep.
+ */
+bool ai_ipc_ring_take_waiter(ai_ipc_ring_t *ring);
+
+/**
+ * @brief Returns the next record, skipping padding, or NULL if empty
+ *
+ * The record and its payload stay valid until ai_ipc_ring_advance().
+ */
+const ai_ipc_record_t *ai_ipc_ring_peek(ai_ipc_ring_t *ring);
+
+/** Releases the record returned by ai_ipc_ring_peek() */
+void ai_ipc_ring_advance(ai_ipc_ring_t *ring, const ai_ipc_record_t *record);
+
+/**
+ * @brief Announces that the consumer is about to sleep
+ *
+ * @return true if it may sleep on the doorbell; false if records arrived in
+ * the meantime (the announcement is withdrawn)
+ */
+bool ai_ipc_ring_prepare_wait(ai_ipc_ring_t *ring);
+
+/** Marks the consumer awake again after a doorbell wake-up */
+void ai_ipc_ring_finish_wait(ai_ipc_ring_t *ring);
+
+/**
+ * @brief Sends one control frame, optionally passing descriptors
+ *
+ * @note Writers sharing a socket must serialise their calls.
+ */
+bool ai_ipc_send_frame(int fd, const char *json, size_t length,
+                       const int *fds, int fd_count);
+
+/**
+ * @brief Receives one control frame
+ *
+ * @param fds Receives up to @p max_fds descriptors passed with the frame (may
+ * be NULL when none are expected; unexpected descriptors are closed)
+ * @param fd_count Receives the number of descriptors stored in @p fds
+ * @return The NUL-terminated JSON text (free with free()), or NULL on EOF,
+ * error or an oversized frame
+ */
+char *ai_ipc_recv_frame(int fd, int *fds, int max_fds, int *fd_count);
+
+#endif /* AI_IPC_H */
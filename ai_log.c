@@ -0,0 +1,760 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ai.h"
+
+#define LOG_DEFAULT_RING_RECORDS 128
+#define LOG_MAX_RING_RECORDS 65536
+// The writer is woken once a ring is an eighth full, leaving the rest as
+// headroom for a burst while it catches up
+#define LOG_RING_WAKE_DIVISOR 8
+#define LOG_PAYLOAD_SIZE 480
+#define LOG_MAX_KEY_LENGTH 63
+#define LOG_BATCH_BUFFER_SIZE (64 * 1024)
+// Worst case for one formatted line: every payload byte escaped as \u00XX
+// plus the fixed prefix, which stays well under this bound
+#define LOG_LINE_RESERVE 4096
+#define LOG_DEFAULT_DIR ".momo/logs"
+#define LOG_DEFAULT_PREFIX "libai"
+#define LOG_MAX_PATH 1024
+
+// One fixed-size slot per record. The payload is a compact binary encoding
+// of the event name followed by the fields so that producers only memcpy;
+// all text formatting happens on the writer thread.
+typedef struct {
+  uint64_t timestamp_ns;
+  uint8_t level;
+  uint8_t field_count;
+  uint16_t payload_length;
+  char payload[LOG_PAYLOAD_SIZE];
+} log_record_t;
+
+// Single-producer/single-consumer ring owned by one thread. The producer
+// only writes head, the writer thread only writes tail. orphaned and retired
+// change under rings_mutex; the owner also reads retired without it.
+typedef struct log_ring {
+  alignas(64) _Atomic(uint32_t) head;
+  alignas(64) _Atomic(uint32_t) tail;
+  alignas(64) _Atomic(bool) orphaned;
+  _Atomic(bool) retired;
+  uint32_t mask;
+  uint32_t wake_at;
+  uint64_t thread_id;
+  struct log_ring *next;
+  log_record_t records[];
+} log_ring_t;
+
+typedef struct {
+  _Atomic(int) level;
+  _Atomic(bool) running;
+
+  pthread_mutex_t rings_mutex;
+  log_ring_t *rings;
+  _Atomic(uint32_t) ring_records;
+
+  pthread_t writer_thread;
+  pthread_mutex_t wake_mutex;
+  pthread_cond_t wake_cond;
+  pthread_cond_t flushed_cond;
+  _Atomic(bool) wake_pending;
+  uint64_t flush_requested;
+  uint64_t flush_completed;
+
+  int fd;
+  size_t file_size;
+  char directory[LOG_MAX_PATH];
+  char prefix[128];
+  size_t max_file_bytes;
+  int max_files;
+  uint32_t flush_interval_ms;
+
+  char *batch;
+  size_t batch_length;
+
+  _Atomic(uint64_t) records_written;
+  _Atomic(uint64_t) records_dropped;
+  _Atomic(uint64_t) bytes_written;
+  _Atomic(uint64_t) files_rotated;
+  _Atomic(uint32_t) active_threads;
+} log_state_t;
+
+static log_state_t g_log = {
+    .level = AI_LOG_OFF,
+    .running = false,
+    .rings_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .wake_cond = PTHREAD_COND_INITIALIZER,
+    .flushed_cond = PTHREAD_COND_INITIALIZER,
+    .fd = -1,
+};
+
+static _Thread_local log_ring_t *t_ring = NULL;
+static pthread_key_t g_ring_key;
+static pthread_once_t g_ring_key_once = PTHREAD_ONCE_INIT;
+
+static const char *level_name(int level) {
+  switch (level) {
+    case AI_LOG_TRACE:
+      return "trace";
+    case AI_LOG_DEBUG:
+      return "debug";
+    case AI_LOG_INFO:
+      return "info";
+    case AI_LOG_WARN:
+      return "warn";
+    case AI_LOG_ERROR:
+      return "error";
+    default:
+      return "unknown";
+  }
+}
+
+static uint64_t current_thread_id(void) {
+#ifdef __APPLE__
+  uint64_t tid = 0;
+  pthread_threadid_np(NULL, &tid);
+  return tid;
+#else
+  return (uint64_t)(uintptr_t)pthread_self();
+#endif
+}
+
+// A listed ring is freed by the writer once it has drained the remaining
+// records. One retired by ai_log_shutdown() is no longer listed and is freed
+// here.
+static void ring_destructor(void *value) {
+  log_ring_t *ring = value;
+  if (!ring) return;
+
+  t_ring = NULL;
+  pthread_mutex_lock(&g_log.rings_mutex);
+  bool retired = atomic_load_explicit(&ring->retired, memory_order_relaxed);
+  if (!retired) {
+    atomic_store_explicit(&ring->orphaned, true, memory_order_release);
+  }
+  pthread_mutex_unlock(&g_log.rings_mutex);
+
+  if (retired) {
+    free(ring);
+  } else {
+    atomic_fetch_sub(&g_log.active_threads, 1);
+  }
+}
+
+static void create_ring_key(void) {
+  pthread_key_create(&g_ring_key, ring_destructor);
+}
+
+static log_ring_t *acquire_thread_ring(void) {
+  if (t_ring) {
+    if (!atomic_load_explicit(&t_ring->retired, memory_order_acquire))
+      return t_ring;
+
+    // Logging has been shut down since this thread last logged
+    free(t_ring);
+    t_ring = NULL;
+    pthread_setspecific(g_ring_key, NULL);
+  }
+
+  pthread_once(&g_ring_key_once, create_ring_key);
+
+  uint32_t capacity =
+      atomic_load_explicit(&g_log.ring_records, memory_order_relaxed);
+  log_ring_t *ring =
+      calloc(1, sizeof(log_ring_t) + capacity * sizeof(log_record_t));
+  if (!ring) return NULL;
+
+  ring->mask = capacity - 1;
+  ring->wake_at = capacity >= LOG_RING_WAKE_DIVISOR
+                      ? capacity / LOG_RING_WAKE_DIVISOR
+                      : 1;
+  ring->thread_id = current_thread_id();
+
+  // A ring made after shutdown retired the others would never be drained
+  pthread_mutex_lock(&g_log.rings_mutex);
+  bool running = atomic_load(&g_log.running);
+  if (running) {
+    ring->next = g_log.rings;
+    g_log.rings = ring;
+  }
+  pthread_mutex_unlock(&g_log.rings_mutex);
+
+  if (!running) {
+    free(ring);
+    return NULL;
+  }
+
+  pthread_setspecific(g_ring_key, ring);
+  atomic_fetch_add(&g_log.active_threads, 1);
+
+  t_ring = ring;
+  return ring;
+}
+
+static void wake_writer(void) {
+  if (atomic_exchange_explicit(&g_log.wake_pending, true,
+                               memory_order_acq_rel))
+    return;
+
+  pthread_mutex_lock(&g_log.wake_mutex);
+  pthread_cond_signal(&g_log.wake_cond);
+  pthread_mutex_unlock(&g_log.wake_mutex);
+}
+
+// Payload encoding: [u8 event_len][event] then per field
+// [u8 type][u8 key_len][key][value] where value is 8 raw bytes for numbers,
+// 1 byte for bools and [u16 len][bytes] for strings.
+static bool payload_put(log_record_t *record, const void *data, size_t length) {
+  if (record->payload_length + length > LOG_PAYLOAD_SIZE) return false;
+
+  memcpy(record->payload + record->payload_length, data, length);
+  record->payload_length += length;
+  return true;
+}
+
+static bool payload_put_short_string(log_record_t *record, const char *str) {
+  size_t length = str ? strnlen(str, LOG_MAX_KEY_LENGTH) : 0;
+  uint8_t encoded = (uint8_t)length;
+
+  return payload_put(record, &encoded, 1) && payload_put(record, str, length);
+}
+
+static bool encode_field(log_record_t *record, const ai_log_field_t *field) {
+  uint8_t type = (uint8_t)field->type;
+  if (!payload_put(record, &type, 1) ||
+      !payload_put_short_string(record, field->key))
+    return false;
+
+  switch (field->type) {
+    case AI_LOG_FIELD_INT:
+    case AI_LOG_FIELD_UINT:
+    case AI_LOG_FIELD_DOUBLE:
+      return payload_put(record, &field->value, sizeof(uint64_t));
+    case AI_LOG_FIELD_BOOL: {
+      uint8_t value = field->value.b ? 1 : 0;
+      return payload_put(record, &value, 1);
+    }
+    case AI_LOG_FIELD_STRING: {
+      const char *str = field->value.s ? field->value.s : "";
+      size_t available = LOG_PAYLOAD_SIZE - record->payload_length;
+      if (available < sizeof(uint16_t)) return false;
+
+      // Long strings are truncated to whatever space remains
+      size_t length = strnlen(str, available - sizeof(uint16_t));
+      uint16_t encoded = (uint16_t)length;
+      return payload_put(record, &encoded, sizeof(encoded)) &&
+             payload_put(record, str, length);
+    }
+  }
+
+  return false;
+}
+
+bool ai_log_enabled(ai_log_level_t level) {
+  int threshold = atomic_load_explicit(&g_log.level, memory_order_relaxed);
+  return (int)level >= threshold && level < AI_LOG_OFF;
+}
+
+void ai_log_write(ai_log_level_t level, const char *event,
+                  const ai_log_field_t *fields, size_t field_count) {
+  if (!ai_log_enabled(level) || !event) return;
+
+  log_ring_t *ring = acquire_thread_ring();
+  if (!ring) {
+    atomic_fetch_add_explicit(&g_log.records_dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  uint32_t used = head - tail;
+
+  if (used > ring->mask) {
+    atomic_fetch_add_explicit(&g_log.records_dropped, 1, memory_order_relaxed);
+    wake_writer();
+    return;
+  }
+
+  log_record_t *record = &ring->records[head & ring->mask];
+
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  record->timestamp_ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+  record->level = (uint8_t)level;
+  record->field_count = 0;
+  record->payload_length = 0;
+
+  if (!payload_put_short_string(record, event)) {
+    atomic_fetch_add_explicit(&g_log.records_dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  for (size_t i = 0; i < field_count && i < UINT8_MAX; i++) {
+    uint16_t mark = record->payload_length;
+    if (!encode_field(record, &fields[i])) {
+      // Keep the fields that fit; the rest are dropped with the partial one
+      record->payload_length = mark;
+      break;
+    }
+    record->field_count++;
+  }
+
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+  if (used + 1 == ring->wake_at) {
+    wake_writer();
+  }
+}
+
+static void append_json_string(char **out, const char *end, const char *str,
+                               size_t length) {
+  char *p = *out;
+  if (p < end) *p++ = '"';
+
+  for (size_t i = 0; i < length && p < end - 7; i++) {
+    unsigned char c = (unsigned char)str[i];
+    switch (c) {
+      case '"':
+        *p++ = '\\';
+        *p++ = '"';
+        break;
+      case '\\':
+        *p++ = '\\';
+        *p++ = '\\';
+        break;
+      case '\n':
+        *p++ = '\\';
+        *p++ = 'n';
+        break;
+      case '\r':
+        *p++ = '\\';
+        *p++ = 'r';
+        break;
+      case '\t':
+        *p++ = '\\';
+        *p++ = 't';
+        break;
+      default:
+        if (c < 0x20) {
+          p += snprintf(p, end - p, "\\u%04x", c);
+        } else {
+          *p++ = (char)c;
+        }
+    }
+  }
+
+  if (p < end) *p++ = '"';
+  *out = p;
+}
+
+static size_t format_record(const log_record_t *record, uint64_t thread_id,
+                            char *buffer, size_t size) {
+  char *p = buffer;
+  const char *end = buffer + size - 2;
+
+  time_t seconds = (time_t)(record->timestamp_ns / 1000000000ull);
+  unsigned millis = (unsigned)((record->timestamp_ns / 1000000ull) % 1000);
+  struct tm tm;
+  gmtime_r(&seconds, &tm);
+
+  p += snprintf(p, end - p,
+                "{\"ts\":\"%04d-%02d-%02dT%02d:%02d:%02d.%03uZ\","
+                "\"level\":\"%s\",\"tid\":%" PRIu64 ",\"event\":",
+                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                tm.tm_min, tm.tm_sec, millis, level_name(record->level),
+                thread_id);
+
+  const char *in = record->payload;
+  const char *in_end = record->payload + record->payload_length;
+
+  uint8_t event_length = (uint8_t)*in++;
+  append_json_string(&p, end, in, event_length);
+  in += event_length;
+
+  for (int i = 0; i < record->field_count && in < in_end && p < end; i++) {
+    uint8_t type = (uint8_t)*in++;
+    uint8_t key_length = (uint8_t)*in++;
+
+    if (p < end) *p++ = ',';
+    append_json_string(&p, end, in, key_length);
+    in += key_length;
+    if (p < end) *p++ = ':';
+
+    switch (type) {
+      case AI_LOG_FIELD_INT: {
+        int64_t value;
+        memcpy(&value, in, sizeof(value));
+        in += sizeof(value);
+        p += snprintf(p, end - p, "%" PRId64, value);
+        break;
+      }
+      case AI_LOG_FIELD_UINT: {
+        uint64_t value;
+        memcpy(&value, in, sizeof(value));
+        in += sizeof(value);
+        p += snprintf(p, end - p, "%" PRIu64, value);
+        break;
+      }
+      case AI_LOG_FIELD_DOUBLE: {
+        double value;
+        memcpy(&value, in, sizeof(value));
+        in += sizeof(value);
+        p += snprintf(p, end - p, "%.6g", value);
+        break;
+      }
+      case AI_LOG_FIELD_BOOL: {
+        bool value = *in++ != 0;
+        p += snprintf(p, end - p, "%s", value ? "true" : "false");
+        break;
+      }
+      case AI_LOG_FIELD_STRING: {
+        uint16_t length;
+        memcpy(&length, in, sizeof(length));
+        in += sizeof(length);
+        append_json_string(&p, end, in, length);
+        in += length;
+        break;
+      }
+      default:
+        p += snprintf(p, end - p, "null");
+        in = in_end;
+        break;
+    }
+  }
+
+  if (p > end) p = (char *)end;
+  *p++ = '}';
+  *p++ = '\n';
+  return p - buffer;
+}
+
+static void build_log_path(char *path, size_t size, int index) {
+  if (index == 0) {
+    snprintf(path, size, "%s/%s.log", g_log.directory, g_log.prefix);
+  } else {
+    snprintf(path, size, "%s/%s.%d.log", g_log.directory, g_log.prefix, index);
+  }
+}
+
+static bool open_log_file(void) {
+  char path[LOG_MAX_PATH + 160];
+  build_log_path(path, sizeof(path), 0);
+
+  g_log.fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (g_log.fd < 0) return false;
+
+  struct stat st;
+  g_log.file_size = fstat(g_log.fd, &st) == 0 ? (size_t)st.st_size : 0;
+  return true;
+}
+
+static void rotate_log_files(void) {
+  char from[LOG_MAX_PATH + 160];
+  char to[LOG_MAX_PATH + 160];
+
+  close(g_log.fd);
+  g_log.fd = -1;
+
+  build_log_path(to, sizeof(to), g_log.max_files);
+  unlink(to);
+
+  for (int i = g_log.max_files - 1; i >= 0; i--) {
+    build_log_path(from, sizeof(from), i);
+    build_log_path(to, sizeof(to), i + 1);
+    rename(from, to);
+  }
+
+  atomic_fetch_add_explicit(&g_log.files_rotated, 1, memory_order_relaxed);
+  open_log_file();
+}
+
+static void flush_batch(void) {
+  if (g_log.batch_length == 0) return;
+
+  if (g_log.fd >= 0 && g_log.max_files > 0 && g_log.file_size > 0 &&
+      g_log.file_size + g_log.batch_length > g_log.max_file_bytes) {
+    rotate_log_files();
+  }
+
+  if (g_log.fd >= 0) {
+    size_t offset = 0;
+    while (offset < g_log.batch_length) {
+      ssize_t n = write(g_log.fd, g_log.batch + offset,
+                        g_log.batch_length - offset);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        break;
+      }
+      offset += (size_t)n;
+    }
+    g_log.file_size += offset;
+    atomic_fetch_add_explicit(&g_log.bytes_written, offset,
+                              memory_order_relaxed);
+  }
+
+  g_log.batch_length = 0;
+}
+
+static void drain_ring(log_ring_t *ring) {
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  uint64_t written = 0;
+
+  while (tail != head) {
+    if (LOG_BATCH_BUFFER_SIZE - g_log.batch_length < LOG_LINE_RESERVE) {
+      flush_batch();
+    }
+
+    g_log.batch_length += format_record(
+        &ring->records[tail & ring->mask], ring->thread_id,
+        g_log.batch + g_log.batch_length, LOG_LINE_RESERVE);
+    tail++;
+    written++;
+  }
+
+  atomic_store_explicit(&ring->tail, tail, memory_order_release);
+  atomic_fetch_add_explicit(&g_log.records_written, written,
+                            memory_order_relaxed);
+}
+
+static void drain_all_rings(void) {
+  pthread_mutex_lock(&g_log.rings_mutex);
+
+  log_ring_t **link = &g_log.rings;
+  while (*link) {
+    log_ring_t *ring = *link;
+    bool orphaned = atomic_load_explicit(&ring->orphaned, memory_order_acquire);
+
+    drain_ring(ring);
+
+    if (orphaned) {
+      *link = ring->next;
+      free(ring);
+    } else {
+      link = &ring->next;
+    }
+  }
+
+  pthread_mutex_unlock(&g_log.rings_mutex);
+
+  flush_batch();
+}
+
+static void *log_writer_main(void *arg) {
+  (void)arg;
+
+  pthread_mutex_lock(&g_log.wake_mutex);
+  while (atomic_load(&g_log.running)) {
+    if (!atomic_load(&g_log.wake_pending) &&
+        g_log.flush_requested == g_log.flush_completed) {
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += (long)(g_log.flush_interval_ms % 1000) * 1000000L;
+      deadline.tv_sec += g_log.flush_interval_ms / 1000 +
+                         deadline.tv_nsec / 1000000000L;
+      deadline.tv_nsec %= 1000000000L;
+      pthread_cond_timedwait(&g_log.wake_cond, &g_log.wake_mutex, &deadline);
+    }
+
+    uint64_t flush_target = g_log.flush_requested;
+    atomic_store(&g_log.wake_pending, false);
+    pthread_mutex_unlock(&g_log.wake_mutex);
+
+    drain_all_rings();
+
+    pthread_mutex_lock(&g_log.wake_mutex);
+    if (flush_target > g_log.flush_completed) {
+      g_log.flush_completed = flush_target;
+      pthread_cond_broadcast(&g_log.flushed_cond);
+    }
+  }
+  pthread_mutex_unlock(&g_log.wake_mutex);
+
+  drain_all_rings();
+  return NULL;
+}
+
+static bool make_directories(const char *path) {
+  char partial[LOG_MAX_PATH];
+  size_t length = strlen(path);
+  if (length == 0 || length >= sizeof(partial)) return false;
+
+  memcpy(partial, path, length + 1);
+
+  for (size_t i = 1; i <= length; i++) {
+    if (partial[i] != '/' && partial[i] != '\0') continue;
+
+    char saved = partial[i];
+    partial[i] = '\0';
+    if (mkdir(partial, 0755) != 0 && errno != EEXIST) return false;
+    partial[i] = saved;
+  }
+
+  return true;
+}
+
+ai_result_t ai_log_init(const ai_log_config_t *config) {
+  ai_log_config_t default_config = AI_DEFAULT_LOG_CONFIG;
+  if (!config) config = &default_config;
+
+  if (atomic_load(&g_log.running)) {
+    ai_log_set_level(config->level);
+    return AI_SUCCESS;
+  }
+
+  if (config->directory) {
+    snprintf(g_log.directory, sizeof(g_log.directory), "%s", config->directory);
+  } else {
+    const char *home = getenv("HOME");
+    if (!home) return AI_ERROR_INIT_FAILED;
+    snprintf(g_log.directory, sizeof(g_log.directory), "%s/%s", home,
+             LOG_DEFAULT_DIR);
+  }
+
+  snprintf(g_log.prefix, sizeof(g_log.prefix), "%s",
+           config->file_prefix ? config->file_prefix : LOG_DEFAULT_PREFIX);
+
+  g_log.max_file_bytes =
+      config->max_file_bytes > 0 ? config->max_file_bytes : 8u << 20;
+  g_log.max_files = config->max_files > 0 ? config->max_files : 0;
+  g_log.flush_interval_ms =
+      config->flush_interval_ms > 0 ? config->flush_interval_ms : 200;
+
+  uint32_t ring_records = LOG_DEFAULT_RING_RECORDS;
+  if (config->ring_records > 0) {
+    ring_records = 2;
+    while (ring_records < config->ring_records &&
+           ring_records < LOG_MAX_RING_RECORDS) {
+      ring_records <<= 1;
+    }
+  }
+  atomic_store_explicit(&g_log.ring_records, ring_records,
+                        memory_order_relaxed);
+
+  if (!make_directories(g_log.directory) || !open_log_file()) {
+    return AI_ERROR_INIT_FAILED;
+  }
+
+  g_log.batch = malloc(LOG_BATCH_BUFFER_SIZE);
+  if (!g_log.batch) {
+    close(g_log.fd);
+    g_log.fd = -1;
+    return AI_ERROR_MEMORY;
+  }
+  g_log.batch_length = 0;
+
+  atomic_store(&g_log.running, true);
+
+  if (pthread_create(&g_log.writer_thread, NULL, log_writer_main, NULL) != 0) {
+    atomic_store(&g_log.running, false);
+    free(g_log.batch);
+    g_log.batch = NULL;
+    close(g_log.fd);
+    g_log.fd = -1;
+    return AI_ERROR_INIT_FAILED;
+  }
+
+  ai_log_set_level(config->level);
+  return AI_SUCCESS;
+}
+
+/*
+ * Frees the rings of threads that have exited and of the calling thread.
+ * Other live threads still hold a pointer to theirs, so those are retired
+ * instead: unlisted, and freed by their owner on its next record or when it
+ * exits.
+ */
+static void release_rings(void) {
+  pthread_mutex_lock(&g_log.rings_mutex);
+  log_ring_t *ring = g_log.rings;
+  g_log.rings = NULL;
+  while (ring) {
+    log_ring_t *next = ring->next;
+    if (atomic_load_explicit(&ring->orphaned, memory_order_acquire)) {
+      free(ring);
+    } else if (ring == t_ring) {
+      t_ring = NULL;
+      pthread_setspecific(g_ring_key, NULL);
+      atomic_fetch_sub(&g_log.active_threads, 1);
+      free(ring);
+    } else {
+      atomic_store_explicit(&ring->retired, true, memory_order_release);
+      atomic_fetch_sub(&g_log.active_threads, 1);
+    }
+    ring = next;
+  }
+  pthread_mutex_unlock(&g_log.rings_mutex);
+}
+
+void ai_log_shutdown(void) {
+  if (!atomic_load(&g_log.running)) return;
+
+  ai_log_set_level(AI_LOG_OFF);
+
+  pthread_mutex_lock(&g_log.wake_mutex);
+  atomic_store(&g_log.running, false);
+  pthread_cond_signal(&g_log.wake_cond);
+  pthread_cond_broadcast(&g_log.flushed_cond);
+  pthread_mutex_unlock(&g_log.wake_mutex);
+
+  pthread_join(g_log.writer_thread, NULL);
+  release_rings();
+
+  if (g_log.fd >= 0) {
+    close(g_log.fd);
+    g_log.fd = -1;
+  }
+
+  free(g_log.batch);
+  g_log.batch = NULL;
+  g_log.batch_length = 0;
+}
+
+void ai_log_set_level(ai_log_level_t level) {
+  if (level < AI_LOG_TRACE || level > AI_LOG_OFF) return;
+
+  // Without a running writer nothing would drain the rings
+  if (!atomic_load(&g_log.running)) level = AI_LOG_OFF;
+  atomic_store_explicit(&g_log.level, level, memory_order_relaxed);
+}
+
+ai_log_level_t ai_log_get_level(void) {
+  return (ai_log_level_t)atomic_load_explicit(&g_log.level,
+                                              memory_order_relaxed);
+}
+
+void ai_log_flush(void) {
+  if (!atomic_load(&g_log.running)) return;
+
+  pthread_mutex_lock(&g_log.wake_mutex);
+  uint64_t target = ++g_log.flush_requested;
+  pthread_cond_signal(&g_log.wake_cond);
+
+  while (g_log.flush_completed < target && atomic_load(&g_log.running)) {
+    pthread_cond_wait(&g_log.flushed_cond, &g_log.wake_mutex);
+  }
+  pthread_mutex_unlock(&g_log.wake_mutex);
+}
+
+ai_result_t ai_log_get_stats(ai_log_stats_t *stats) {
+  if (!stats) return AI_ERROR_INVALID_PARAMS;
+
+  stats->records_written = atomic_load(&g_log.records_written);
+  stats->records_dropped = atomic_load(&g_log.records_dropped);
+  stats->bytes_written = atomic_load(&g_log.bytes_written);
+  stats->files_rotated = atomic_load(&g_log.files_rotated);
+  stats->active_threads = atomic_load(&g_log.active_threads);
+
+  return AI_SUCCESS;
+}
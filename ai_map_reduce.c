@@ -0,0 +1,614 @@
+/*
+ * Map-reduce over inputs larger than the context window; see ai_map_reduce()
+ * in ai.h.
+ *
+ * Steps of one round run on a pool of sessions, one worker thread per
+ * session pulling the next step index from a shared counter. Sessions keep no
+ * history between steps, so every step sees only its own prompt. Each session
+ * lives in a context of its own, so concurrent failures never write the same
+ * error buffer; the first one is copied to the caller's context.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ai.h"
+#include "ai_internal.h"
+
+#define DEFAULT_CHUNK_TOKENS 2048
+#define DEFAULT_FAN_IN 8
+#define DEFAULT_PARALLELISM 4
+// Less room than this after the prompt leaves chunks too small to be useful
+#define MIN_INPUT_BYTES 256
+
+typedef struct {
+  const char *data;
+  size_t length;
+} span_t;
+
+typedef struct {
+  ai_context_t *context;
+  ai_session_id_t session;
+} member_t;
+
+typedef struct {
+  ai_context_t *context;
+  const ai_map_reduce_config_t *config;
+  const ai_generation_params_t *params;
+  const char *schema_json;
+  const char *instruction;
+  ai_map_reduce_stage_t stage;
+  int32_t level;
+  size_t chunks;
+
+  const span_t *inputs;
+  char **results;
+  size_t task_count;
+
+  pthread_mutex_t mutex;
+  size_t next_task;
+  size_t completed;
+  bool failed;
+  ai_context_t *failed_context; /* the member whose step failed first */
+} round_t;
+
+typedef struct {
+  round_t *round;
+  member_t member;
+  pthread_t thread;
+} worker_t;
+
+static double monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_sentence_end(const char *p, const char *end) {
+  if (*p != '.' && *p != '!' && *p != '?') return false;
+  return p + 1 == end || is_space(p[1]);
+}
+
+// Length of the prefix of [start, start + limit) that ends at the best
+// available boundary. Boundaries in the first quarter are ignored so that
+// chunks do not degenerate into a line each.
+static size_t cut_length(const char *start, size_t limit) {
+  const char *end = start + limit;
+  const char *floor = start + limit / 4;
+
+  for (const char *p = end - 1; p > floor; p--) {
+    if (p[0] == '\n' && p[-1] == '\n') return (size_t)(p + 1 - start);
+  }
+  for (const char *p = end - 1; p > floor; p--) {
+    if (*p == '\n' || is_sentence_end(p, end)) {
+      return (size_t)(p + 1 - start);
+    }
+  }
+  for (const char *p = end - 1; p > floor; p--) {
+    if (is_space(*p)) return (size_t)(p + 1 - start);
+  }
+
+  // No boundary at all; at least do not split a UTF-8 sequence
+  const char *p = end;
+  while (p > start + 1 && ((unsigned char)*p & 0xC0) == 0x80) p--;
+  return (size_t)(p - start);
+}
+
+static size_t split_chunks(const char *input, size_t length,
+                           size_t budget_bytes, span_t **chunks_out) {
+  size_t capacity = length / budget_bytes + 2;
+  span_t *chunks = malloc(capacity * sizeof(span_t));
+  if (!chunks) return 0;
+
+  size_t count = 0;
+  size_t offset = 0;
+  while (offset < length) {
+    while (offset < length && is_space(input[offset])) offset++;
+    if (offset == length) break;
+
+    size_t remaining = length - offset;
+    size_t take = remaining <= budget_bytes
+                      ? remaining
+                      : cut_length(input + offset, budget_bytes);
+
+    if (count == capacity) {
+      capacity *= 2;
+      span_t *grown = realloc(chunks, capacity * sizeof(span_t));
+      if (!grown) {
+        free(chunks);
+        return 0;
+      }
+      chunks = grown;
+    }
+    chunks[count++] = (span_t){input + offset, take};
+    offset += take;
+  }
+
+  *chunks_out = chunks;
+  return count;
+}
+
+static const char *skip_json_space(const char *p) {
+  while (is_space(*p)) p++;
+  return p;
+}
+
+static const char *skip_json_string(const char *p) {
+  for (p++; *p && *p != '"'; p++) {
+    if (*p == '\\' && p[1]) p++;
+  }
+  return *p ? p + 1 : NULL;
+}
+
+static const char *skip_json_value(const char *p) {
+  if (*p == '"') return skip_json_string(p);
+  if (*p != '{' && *p != '[') {
+    while (*p && *p != ',' && *p != '}' && *p != ']' && !is_space(*p)) p++;
+    return p;
+  }
+
+  int depth = 0;
+  while (*p) {
+    if (*p == '"') {
+      p = skip_json_string(p);
+      if (!p) return NULL;
+      continue;
+    }
+    if (*p == '{' || *p == '[') depth++;
+    if (*p == '}' || *p == ']') {
+      if (--depth == 0) return p + 1;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+// Finds the "object" member of a structured response without a full parser;
+// libai does not link one
+static bool find_object_member(const char *json, span_t *member) {
+  const char *p = skip_json_space(json);
+  if (*p++ != '{') return false;
+
+  for (;;) {
+    p = skip_json_space(p);
+    if (*p != '"') return false;
+    const char *key = p + 1;
+    p = skip_json_string(p);
+    if (!p) return false;
+    bool is_object = p - key - 1 == 6 && strncmp(key, "object", 6) == 0;
+
+    p = skip_json_space(p);
+    if (*p++ != ':') return false;
+    p = skip_json_space(p);
+    const char *value = p;
+    p = skip_json_value(p);
+    if (!p || p == value) return false;
+
+    if (is_object) {
+      *member = (span_t){value, (size_t)(p - value)};
+      return true;
+    }
+
+    p = skip_json_space(p);
+    if (*p++ != ',') return false;
+  }
+}
+
+static char *build_prompt(const char *instruction, span_t input) {
+  size_t instruction_length = strlen(instruction);
+  char *prompt = malloc(instruction_length + 2 + input.length + 1);
+  if (!prompt) return NULL;
+
+  memcpy(prompt, instruction, instruction_length);
+  memcpy(prompt + instruction_length, "\n\n", 2);
+  memcpy(prompt + instruction_length + 2, input.data, input.length);
+  prompt[instruction_length + 2 + input.length] = '\0';
+  return prompt;
+}
+
+static void *worker_main(void *arg) {
+  worker_t *worker = arg;
+  round_t *round = worker->round;
+  ai_context_t *context = worker->member.context;
+  ai_session_id_t session = worker->member.session;
+
+  for (;;) {
+    pthread_mutex_lock(&round->mutex);
+    bool done = round->failed || round->next_task == round->task_count;
+    size_t index = done ? 0 : round->next_task++;
+    pthread_mutex_unlock(&round->mutex);
+    if (done) break;
+
+    char *prompt = build_prompt(round->instruction, round->inputs[index]);
+    char *result = NULL;
+    if (!prompt) {
+      ai_set_error(context, AI_ERROR_MEMORY,
+                   "Failed to allocate map-reduce prompt");
+    } else if (round->schema_json) {
+      result = ai_generate_structured_response(context, session, prompt,
+                                               round->schema_json,
+                                               round->params);
+    } else {
+      result = ai_generate_response(context, session, prompt, round->params);
+    }
+    free(prompt);
+    ai_clear_session_history(context, session);
+
+    // Progress is reported under the lock so callbacks never overlap
+    pthread_mutex_lock(&round->mutex);
+    if (!result) {
+      if (!round->failed) round->failed_context = context;
+      round->failed = true;
+    } else {
+      round->results[index] = result;
+      round->completed++;
+      if (round->config->progress) {
+        ai_map_reduce_progress_t progress = {
+            .stage = round->stage,
+            .level = round->level,
+            .step = index,
+            .completed = round->completed,
+            .total = round->task_count,
+            .chunks = round->chunks,
+            .result = result,
+        };
+        round->config->progress(round->context, &progress,
+                                round->config->user_data);
+      }
+    }
+    pthread_mutex_unlock(&round->mutex);
+  }
+
+  return NULL;
+}
+
+// Runs one round across the pool; false once any step has failed, with the
+// first failure's error on the caller's context
+static bool run_round(round_t *round, const member_t *members,
+                      size_t member_count) {
+  pthread_mutex_init(&round->mutex, NULL);
+
+  size_t worker_count =
+      member_count < round->task_count ? member_count : round->task_count;
+  worker_t workers[worker_count];
+  size_t started = 0;
+  for (; started < worker_count; started++) {
+    workers[started] = (worker_t){.round = round, .member = members[started]};
+    if (pthread_create(&workers[started].thread, NULL, worker_main,
+                       &workers[started]) != 0) {
+      break;
+    }
+  }
+  // With no thread at all, the caller's thread does the work
+  if (started == 0) {
+    workers[0] = (worker_t){.round = round, .member = members[0]};
+    worker_main(&workers[0]);
+  }
+  for (size_t i = 0; i < started; i++) pthread_join(workers[i].thread, NULL);
+
+  pthread_mutex_destroy(&round->mutex);
+  if (round->failed_context) {
+    ai_copy_error(round->context, round->failed_context);
+  }
+  return !round->failed;
+}
+
+static void free_results(char **results, size_t count) {
+  for (size_t i = 0; i < count; i++) ai_free_string(results[i]);
+  free(results);
+}
+
+// Groups consecutive partial results into reduce inputs of at least two
+// results each. A last result that no group can take (with a fan-in of 2 and
+// an odd count) is not reduced on its own: *carried is set and the caller
+// passes it to the next round unchanged.
+static size_t build_groups(const span_t *partials, size_t count,
+                           size_t fan_in, size_t budget_bytes, bool as_json,
+                           span_t *groups, size_t *carried) {
+  size_t group_count = 0;
+  size_t index = 0;
+
+  *carried = 0;
+  while (index < count) {
+    if (index == count - 1) {
+      *carried = 1;
+      break;
+    }
+    size_t first = index;
+    size_t bytes = 2;
+    while (index < count && index - first < fan_in) {
+      size_t next = bytes + partials[index].length + 2;
+      if (index - first >= 2 && next > budget_bytes) break;
+      bytes = next;
+      index++;
+    }
+    // Never leave a lone result for a step of its own: take it along, or
+    // leave it a partner when the group is already full
+    if (index == count - 1) {
+      if (index - first < fan_in) {
+        bytes += partials[index++].length + 2;
+      } else if (index - first > 2) {
+        index--;
+      }
+    }
+
+    char *text = malloc(bytes + 1);
+    if (!text) {
+      for (size_t i = 0; i < group_count; i++) free((char *)groups[i].data);
+      return 0;
+    }
+
+    size_t length = 0;
+    if (as_json) text[length++] = '[';
+    for (size_t i = first; i < index; i++) {
+      if (i > first) {
+        memcpy(text + length, as_json ? ",\n" : "\n\n", 2);
+        length += 2;
+      }
+      memcpy(text + length, partials[i].data, partials[i].length);
+      length += partials[i].length;
+    }
+    if (as_json) text[length++] = ']';
+    text[length] = '\0';
+
+    groups[group_count++] = (span_t){text, length};
+  }
+
+  return group_count;
+}
+
+// Views results as reduce inputs: the "object" member of structured results,
+// or the whole text otherwise
+static bool view_partials(ai_context_t *context, char **results, size_t count,
+                          bool structured, span_t *partials) {
+  for (size_t i = 0; i < count; i++) {
+    if (!structured) {
+      partials[i] = (span_t){results[i], strlen(results[i])};
+    } else if (!find_object_member(results[i], &partials[i])) {
+      ai_set_error(context, AI_ERROR_JSON_PARSE,
+                   "Structured response has no \"object\" member");
+      return false;
+    }
+  }
+  return true;
+}
+
+static char *reduce_results(round_t *round, char **results, size_t count,
+                            size_t fan_in, size_t budget_bytes,
+                            const member_t *members, size_t member_count) {
+  bool structured = round->schema_json != NULL;
+
+  while (count > 1) {
+    span_t *partials = malloc(count * sizeof(span_t));
+    span_t *groups = malloc(count * sizeof(span_t));
+    size_t group_count = 0;
+    size_t carried = 0;
+    if (!partials || !groups) {
+      ai_set_error(round->context, AI_ERROR_MEMORY,
+                   "Failed to allocate reduce inputs");
+    } else if (view_partials(round->context, results, count, structured,
+                             partials)) {
+      group_count = build_groups(partials, count, fan_in, budget_bytes,
+                                 structured, groups, &carried);
+      if (group_count == 0) {
+        ai_set_error(round->context, AI_ERROR_MEMORY,
+                     "Failed to allocate reduce inputs");
+      }
+    }
+    free(partials);
+    char *carry = group_count && carried ? results[count - 1] : NULL;
+    if (carry) results[count - 1] = NULL;
+    free_results(results, count);
+
+    char **next =
+        group_count ? calloc(group_count + carried, sizeof(char *)) : NULL;
+    if (group_count && !next) {
+      ai_set_error(round->context, AI_ERROR_MEMORY,
+                   "Failed to allocate reduce results");
+    }
+
+    bool ok = false;
+    if (next) {
+      round->stage = AI_MAP_REDUCE_REDUCE;
+      round->level++;
+      round->inputs = groups;
+      round->results = next;
+      round->task_count = group_count;
+      round->next_task = 0;
+      round->completed = 0;
+      ok = run_round(round, members, member_count);
+    }
+
+    for (size_t i = 0; i < group_count; i++) free((char *)groups[i].data);
+    free(groups);
+
+    if (!ok) {
+      if (next) free_results(next, group_count);
+      ai_free_string(carry);
+      return NULL;
+    }
+    if (carry) next[group_count] = carry;
+    results = next;
+    count = group_count + (carry ? 1 : 0);
+  }
+
+  char *result = results[0];
+  free(results);
+  return result;
+}
+
+char *ai_map_reduce(ai_context_t *context,
+                    const ai_map_reduce_config_t *config, const char *input,
+                    size_t length, const ai_chunk_policy_t *policy,
+                    const char *map_prompt, const char *reduce_prompt,
+                    const char *schema_json) {
+  if (!context) return NULL;
+  if (!input || length == 0 || !map_prompt || !reduce_prompt) {
+    ai_set_error(context, AI_ERROR_INVALID_PARAMS,
+                 "Input and prompts are required for map-reduce");
+    return NULL;
+  }
+
+  ai_map_reduce_config_t default_config = AI_DEFAULT_MAP_REDUCE_CONFIG;
+  if (!config) config = &default_config;
+  ai_chunk_policy_t default_policy = AI_DEFAULT_CHUNK_POLICY;
+  if (!policy) policy = &default_policy;
+
+  size_t chunk_tokens = policy->max_chunk_tokens > 0
+                            ? (size_t)policy->max_chunk_tokens
+                            : DEFAULT_CHUNK_TOKENS;
+  size_t fan_in = policy->max_fan_in > 0 ? (size_t)policy->max_fan_in
+                                         : DEFAULT_FAN_IN;
+  if (fan_in < 2) fan_in = 2;
+
+  size_t map_tokens = ai_estimate_tokens_for_bytes(strlen(map_prompt) + 2);
+  size_t reduce_tokens =
+      ai_estimate_tokens_for_bytes(strlen(reduce_prompt) + 2);
+  size_t prompt_tokens =
+      map_tokens > reduce_tokens ? map_tokens : reduce_tokens;
+  if (prompt_tokens >= chunk_tokens ||
+      (chunk_tokens - prompt_tokens) * AI_BYTES_PER_TOKEN < MIN_INPUT_BYTES) {
+    ai_set_error(context, AI_ERROR_INVALID_PARAMS,
+                 "Prompts leave no room for input within %zu tokens",
+                 chunk_tokens);
+    return NULL;
+  }
+  size_t map_budget = (chunk_tokens - map_tokens) * AI_BYTES_PER_TOKEN;
+  size_t reduce_budget = (chunk_tokens - reduce_tokens) * AI_BYTES_PER_TOKEN;
+
+  double started_ms = monotonic_ms();
+
+  span_t *chunks = NULL;
+  size_t chunk_count = split_chunks(input, length, map_budget, &chunks);
+  if (!chunks) {
+    ai_set_error(context, AI_ERROR_MEMORY, "Failed to split input");
+    return NULL;
+  }
+  if (chunk_count == 0) {
+    free(chunks);
+    ai_set_error(context, AI_ERROR_INVALID_PARAMS, "Input is only whitespace");
+    return NULL;
+  }
+
+  size_t parallelism = config->parallelism > 0 ? (size_t)config->parallelism
+                                               : DEFAULT_PARALLELISM;
+  if (parallelism > chunk_count) parallelism = chunk_count;
+
+  member_t members[parallelism];
+  size_t session_count = 0;
+  while (session_count < parallelism) {
+    ai_context_t *member_context = ai_context_create();
+    if (!member_context) {
+      if (session_count == 0) {
+        ai_set_error(context, AI_ERROR_MEMORY,
+                     "Failed to allocate map-reduce context");
+      }
+      break;
+    }
+    ai_session_id_t session =
+        ai_create_session(member_context, config->session_config);
+    if (session == AI_INVALID_ID) {
+      // Without any session, the caller learns why
+      if (session_count == 0) ai_copy_error(context, member_context);
+      ai_context_free(member_context);
+      break;
+    }
+    members[session_count++] = (member_t){member_context, session};
+  }
+
+  char *result = NULL;
+  char **results = session_count ? calloc(chunk_count, sizeof(char *)) : NULL;
+  if (session_count && !results) {
+    ai_set_error(context, AI_ERROR_MEMORY, "Failed to allocate map results");
+  }
+
+  if (results) {
+    round_t round = {
+        .context = context,
+        .config = config,
+        .params = config->params,
+        .schema_json = schema_json,
+        .instruction = map_prompt,
+        .stage = AI_MAP_REDUCE_MAP,
+        .chunks = chunk_count,
+        .inputs = chunks,
+        .results = results,
+        .task_count = chunk_count,
+    };
+
+    if (run_round(&round, members, session_count)) {
+      round.instruction = reduce_prompt;
+      result = reduce_results(&round, results, chunk_count, fan_in,
+                              reduce_budget, members, session_count);
+    } else {
+      free_results(results, chunk_count);
+    }
+
+    AI_LOG(result ? AI_LOG_INFO : AI_LOG_WARN, "map_reduce.complete",
+           AI_LOG_UINT("bytes_in", length), AI_LOG_UINT("chunks", chunk_count),
+           AI_LOG_UINT("sessions", session_count),
+           AI_LOG_INT("levels", round.level),
+           AI_LOG_DOUBLE("latency_ms", monotonic_ms() - started_ms),
+           AI_LOG_BOOL("ok", result != NULL));
+  }
+
+  for (size_t i = 0; i < session_count; i++) {
+    ai_add_stats(context, members[i].context);
+    ai_context_free(members[i].context);
+  }
+  free(chunks);
+  return result;
+}
+
+char *ai_map_reduce_file(ai_context_t *context,
+                         const ai_map_reduce_config_t *config,
+                         const char *path, const ai_chunk_policy_t *policy,
+                         const char *map_prompt, const char *reduce_prompt,
+                         const char *schema_json) {
+  if (!context) return NULL;
+  if (!path) {
+    ai_set_error(context, AI_ERROR_INVALID_PARAMS, "Path cannot be NULL");
+    return NULL;
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ai_set_error(context, AI_ERROR_INVALID_PARAMS, "Cannot open %s", path);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    ai_set_error(context, AI_ERROR_INVALID_PARAMS,
+                 "%s is not a non-empty regular file", path);
+    return NULL;
+  }
+
+  size_t length = (size_t)st.st_size;
+  void *mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    ai_set_error(context, AI_ERROR_MEMORY, "Cannot map %s", path);
+    return NULL;
+  }
+  // Chunks are prompted roughly in order, so read ahead
+  madvise(mapped, length, MADV_SEQUENTIAL);
+
+  char *result = ai_map_reduce(context, config, mapped, length, policy,
+                               map_prompt, reduce_prompt, schema_json);
+  munmap(mapped, length);
+  return result;
+}
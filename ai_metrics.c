@@ -0,0 +1,774 @@
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ai.h"
+#include "ai_internal.h"
+
+#define MAX_TOOL_METRICS 64
+#define MAX_TOOL_NAME_LENGTH 64
+#define ERROR_CODE_SLOTS 16
+#define EXPORTER_REQUEST_TIMEOUT_MS 1000
+#define EXPORTER_MAX_REQUEST 2048
+
+static_assert(AI_HISTOGRAM_BOUND_COUNT + 1 == AI_STATS_HISTOGRAM_BUCKETS,
+              "public histogram must mirror the internal bucket layout");
+
+const double ai_histogram_bounds[AI_HISTOGRAM_BOUND_COUNT] = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0};
+
+struct ai_tool_metrics {
+  char name[MAX_TOOL_NAME_LENGTH];
+  _Atomic(uint64_t) successes;
+  _Atomic(uint64_t) failures;
+  ai_histogram_t latency;
+};
+
+typedef struct {
+  _Atomic(uint64_t) requests[AI_REQUEST_KIND_COUNT][2];
+  ai_histogram_t request_latency[AI_REQUEST_KIND_COUNT];
+  ai_histogram_t first_chunk_latency;
+  ai_histogram_t chunk_gap;
+  _Atomic(uint64_t) stalls;
+  _Atomic(uint64_t) stall_cancels;
+  _Atomic(uint64_t) preflight_rejections;
+  _Atomic(uint64_t) compactions;
+  _Atomic(uint64_t) compaction_tokens_saved;
+  ai_op_counters_t models[AI_MODEL_COUNT];
+  _Atomic(uint64_t) retries[AI_RETRY_CLASS_COUNT];
+  _Atomic(uint64_t) retries_exhausted;
+  _Atomic(int) circuit_state;
+  _Atomic(uint64_t) circuit_opened;
+  _Atomic(uint64_t) circuit_rejected;
+  _Atomic(uint64_t) errors[ERROR_CODE_SLOTS];
+  _Atomic(int64_t) streams_in_flight;
+  _Atomic(int64_t) sessions_active;
+
+  // Tool slots are appended under the mutex and never removed, so readers
+  // may walk [0, tool_count) without locking once the count is loaded
+  pthread_mutex_t tools_mutex;
+  ai_tool_metrics_t tools[MAX_TOOL_METRICS];
+  _Atomic(int) tool_count;
+  ai_tool_metrics_t tool_overflow;
+} metrics_state_t;
+
+static metrics_state_t g_metrics = {
+    .tools_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .tool_overflow = {.name = "_other"},
+};
+
+typedef struct {
+  _Atomic(bool) running;
+  pthread_t thread;
+  int listen_fd;
+  int wake_pipe[2];
+  char unix_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+} exporter_state_t;
+
+static exporter_state_t g_exporter = {
+    .running = false, .listen_fd = -1, .wake_pipe = {-1, -1}};
+
+static const char *request_kind_labels[AI_REQUEST_KIND_COUNT] = {
+    "generate", "structured", "stream", "structured_stream"};
+
+static const char *model_labels[AI_MODEL_COUNT] = {"general",
+                                                   "content_tagging"};
+
+static const char *retry_class_labels[AI_RETRY_CLASS_COUNT] = {
+    "not_ready", "rate_limited", "timeout", "generation"};
+
+void ai_histogram_observe(ai_histogram_t *histogram, double seconds) {
+  if (seconds < 0.0) seconds = 0.0;
+
+  int bucket = 0;
+  while (bucket < AI_HISTOGRAM_BOUND_COUNT &&
+         seconds > ai_histogram_bounds[bucket])
+    bucket++;
+
+  atomic_fetch_add_explicit(&histogram->buckets[bucket], 1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->sum_us, (uint64_t)(seconds * 1e6),
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+}
+
+void ai_op_counters_record(ai_op_counters_t *counters, bool success,
+                           double seconds, size_t bytes_in, size_t bytes_out) {
+  atomic_fetch_add_explicit(&counters->invocations, 1, memory_order_relaxed);
+  if (!success) {
+    atomic_fetch_add_explicit(&counters->errors, 1, memory_order_relaxed);
+  }
+  atomic_fetch_add_explicit(&counters->bytes_in, bytes_in,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&counters->bytes_out, bytes_out,
+                            memory_order_relaxed);
+  ai_histogram_observe(&counters->latency, seconds);
+}
+
+void ai_op_counters_snapshot(ai_op_counters_t *counters, ai_op_stats_t *stats) {
+  stats->invocations =
+      atomic_load_explicit(&counters->invocations, memory_order_relaxed);
+  stats->errors = atomic_load_explicit(&counters->errors, memory_order_relaxed);
+  stats->bytes_in =
+      atomic_load_explicit(&counters->bytes_in, memory_order_relaxed);
+  stats->bytes_out =
+      atomic_load_explicit(&counters->bytes_out, memory_order_relaxed);
+  stats->total_time =
+      atomic_load_explicit(&counters->latency.sum_us, memory_order_relaxed) /
+      1e6;
+
+  for (int i = 0; i < AI_STATS_HISTOGRAM_BUCKETS; i++) {
+    stats->latency_buckets[i] = atomic_load_explicit(
+        &counters->latency.buckets[i], memory_order_relaxed);
+  }
+}
+
+const double *ai_get_stats_histogram_bounds(size_t *count) {
+  if (count) *count = AI_HISTOGRAM_BOUND_COUNT;
+  return ai_histogram_bounds;
+}
+
+ai_tool_metrics_t *ai_metrics_tool(const char *tool_name) {
+  if (!tool_name) return &g_metrics.tool_overflow;
+
+  pthread_mutex_lock(&g_metrics.tools_mutex);
+
+  int count = atomic_load(&g_metrics.tool_count);
+  for (int i = 0; i < count; i++) {
+    if (strncmp(g_metrics.tools[i].name, tool_name, MAX_TOOL_NAME_LENGTH - 1) ==
+        0) {
+      pthread_mutex_unlock(&g_metrics.tools_mutex);
+      return &g_metrics.tools[i];
+    }
+  }
+
+  ai_tool_metrics_t *tool = &g_metrics.tool_overflow;
+  if (count < MAX_TOOL_METRICS) {
+    tool = &g_metrics.tools[count];
+    snprintf(tool->name, sizeof(tool->name), "%s", tool_name);
+    atomic_store(&g_metrics.tool_count, count + 1);
+  }
+
+  pthread_mutex_unlock(&g_metrics.tools_mutex);
+  return tool;
+}
+
+void ai_metrics_record_tool_call(ai_tool_metrics_t *tool, double seconds,
+                                 bool success) {
+  if (!tool) return;
+
+  atomic_fetch_add_explicit(success ? &tool->successes : &tool->failures, 1,
+                            memory_order_relaxed);
+  ai_histogram_observe(&tool->latency, seconds);
+}
+
+void ai_metrics_record_request(ai_request_kind_t kind, bool success,
+                               double seconds) {
+  if (kind < 0 || kind >= AI_REQUEST_KIND_COUNT) return;
+
+  atomic_fetch_add_explicit(&g_metrics.requests[kind][success ? 0 : 1], 1,
+                            memory_order_relaxed);
+  ai_histogram_observe(&g_metrics.request_latency[kind], seconds);
+}
+
+void ai_metrics_record_model_request(ai_use_case_t model, bool success,
+                                     double seconds, size_t bytes_in,
+                                     size_t bytes_out) {
+  if (model < 0 || model >= AI_MODEL_COUNT) return;
+
+  ai_op_counters_record(&g_metrics.models[model], success, seconds, bytes_in,
+                        bytes_out);
+}
+
+ai_result_t ai_get_model_stats(ai_use_case_t model, ai_op_stats_t *stats) {
+  if (!stats || model < 0 || model >= AI_MODEL_COUNT)
+    return AI_ERROR_INVALID_PARAMS;
+
+  ai_op_counters_snapshot(&g_metrics.models[model], stats);
+  return AI_SUCCESS;
+}
+
+void ai_metrics_record_retry(ai_retry_class_t retry_class) {
+  if (retry_class < 0 || retry_class >= AI_RETRY_CLASS_COUNT) return;
+
+  atomic_fetch_add_explicit(&g_metrics.retries[retry_class], 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_record_retries_exhausted(void) {
+  atomic_fetch_add_explicit(&g_metrics.retries_exhausted, 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_set_circuit_state(ai_circuit_state_t state, bool opened) {
+  atomic_store_explicit(&g_metrics.circuit_state, state, memory_order_relaxed);
+  if (opened) {
+    atomic_fetch_add_explicit(&g_metrics.circuit_opened, 1,
+                              memory_order_relaxed);
+  }
+}
+
+void ai_metrics_record_circuit_rejection(void) {
+  atomic_fetch_add_explicit(&g_metrics.circuit_rejected, 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_record_first_chunk(double seconds) {
+  ai_histogram_observe(&g_metrics.first_chunk_latency, seconds);
+}
+
+void ai_metrics_record_chunk_gap(double seconds) {
+  ai_histogram_observe(&g_metrics.chunk_gap, seconds);
+}
+
+void ai_metrics_record_stall(bool cancelled) {
+  atomic_fetch_add_explicit(&g_metrics.stalls, 1, memory_order_relaxed);
+  if (cancelled) {
+    atomic_fetch_add_explicit(&g_metrics.stall_cancels, 1,
+                              memory_order_relaxed);
+  }
+}
+
+void ai_metrics_record_preflight_rejection(void) {
+  atomic_fetch_add_explicit(&g_metrics.preflight_rejections, 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_record_compaction(size_t tokens_saved) {
+  atomic_fetch_add_explicit(&g_metrics.compactions, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&g_metrics.compaction_tokens_saved, tokens_saved,
+                            memory_order_relaxed);
+}
+
+static int error_code_slot(ai_result_t code) {
+  // Codes are small negatives; anything else shares the last slot
+  if (code < 0 && -code < ERROR_CODE_SLOTS - 1) return -code;
+  return ERROR_CODE_SLOTS - 1;
+}
+
+void ai_metrics_record_error(ai_result_t code) {
+  if (code == AI_SUCCESS) return;
+
+  atomic_fetch_add_explicit(&g_metrics.errors[error_code_slot(code)], 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_stream_started(void) {
+  atomic_fetch_add_explicit(&g_metrics.streams_in_flight, 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_stream_finished(void) {
+  atomic_fetch_sub_explicit(&g_metrics.streams_in_flight, 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_session_created(void) {
+  atomic_fetch_add_explicit(&g_metrics.sessions_active, 1,
+                            memory_order_relaxed);
+}
+
+void ai_metrics_session_destroyed(void) {
+  atomic_fetch_sub_explicit(&g_metrics.sessions_active, 1,
+                            memory_order_relaxed);
+}
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+  bool failed;
+} text_buffer_t;
+
+static void text_appendf(text_buffer_t *buf, const char *fmt, ...) {
+  if (buf->failed) return;
+
+  for (;;) {
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf->data + buf->length, buf->capacity - buf->length,
+                      fmt, args);
+    va_end(args);
+
+    if (n < 0) {
+      buf->failed = true;
+      return;
+    }
+
+    if ((size_t)n < buf->capacity - buf->length) {
+      buf->length += n;
+      return;
+    }
+
+    size_t capacity = buf->capacity * 2;
+    while (capacity - buf->length <= (size_t)n) capacity *= 2;
+
+    char *data = realloc(buf->data, capacity);
+    if (!data) {
+      buf->failed = true;
+      return;
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+  }
+}
+
+static void render_histogram(text_buffer_t *buf, const char *name,
+                             const char *label_key, const char *label_value,
+                             ai_histogram_t *histogram) {
+  char labels[128] = "";
+  if (label_key) {
+    snprintf(labels, sizeof(labels), "%s=\"%s\",", label_key, label_value);
+  }
+
+  uint64_t cumulative = 0;
+  for (int i = 0; i <= AI_HISTOGRAM_BOUND_COUNT; i++) {
+    cumulative += atomic_load_explicit(&histogram->buckets[i],
+                                       memory_order_relaxed);
+    if (i < AI_HISTOGRAM_BOUND_COUNT) {
+      text_appendf(buf, "%s_bucket{%sle=\"%g\"} %" PRIu64 "\n", name, labels,
+                   ai_histogram_bounds[i], cumulative);
+    } else {
+      text_appendf(buf, "%s_bucket{%sle=\"+Inf\"} %" PRIu64 "\n", name,
+                   labels, cumulative);
+    }
+  }
+
+  // Report the bucket total as the count so the +Inf bucket always agrees
+  // with it even when observations land mid-render
+  uint64_t sum_us = atomic_load_explicit(&histogram->sum_us,
+                                         memory_order_relaxed);
+  if (label_key) labels[strlen(labels) - 1] = '\0';
+  const char *open = label_key ? "{" : "";
+  const char *close = label_key ? "}" : "";
+  text_appendf(buf, "%s_sum%s%s%s %.6f\n", name, open, labels, close,
+               sum_us / 1e6);
+  text_appendf(buf, "%s_count%s%s%s %" PRIu64 "\n", name, open, labels, close,
+               cumulative);
+}
+
+static void render_label_value(char *out, size_t size, const char *value) {
+  size_t j = 0;
+  for (size_t i = 0; value[i] && j + 2 < size; i++) {
+    char c = value[i];
+    if (c == '"' || c == '\\') {
+      out[j++] = '\\';
+      out[j++] = c;
+    } else if (c == '\n') {
+      out[j++] = '\\';
+      out[j++] = 'n';
+    } else {
+      out[j++] = c;
+    }
+  }
+  out[j] = '\0';
+}
+
+char *ai_metrics_render(void) {
+  text_buffer_t buf = {.data = malloc(8192), .capacity = 8192};
+  if (!buf.data) return NULL;
+  buf.data[0] = '\0';
+
+  text_appendf(&buf, "# TYPE ai_requests counter\n"
+                     "# HELP ai_requests Generation requests by kind and "
+                     "outcome.\n");
+  for (int kind = 0; kind < AI_REQUEST_KIND_COUNT; kind++) {
+    for (int outcome = 0; outcome < 2; outcome++) {
+      text_appendf(
+          &buf, "ai_requests_total{kind=\"%s\",outcome=\"%s\"} %" PRIu64 "\n",
+          request_kind_labels[kind], outcome == 0 ? "success" : "error",
+          atomic_load_explicit(&g_metrics.requests[kind][outcome],
+                               memory_order_relaxed));
+    }
+  }
+
+  text_appendf(&buf, "# TYPE ai_errors counter\n"
+                     "# HELP ai_errors Errors reported by libai by result "
+                     "code.\n");
+  for (int slot = 1; slot < ERROR_CODE_SLOTS; slot++) {
+    uint64_t count =
+        atomic_load_explicit(&g_metrics.errors[slot], memory_order_relaxed);
+    if (count == 0) continue;
+
+    if (slot == ERROR_CODE_SLOTS - 1) {
+      text_appendf(&buf, "ai_errors_total{code=\"other\"} %" PRIu64 "\n",
+                   count);
+    } else {
+      text_appendf(&buf, "ai_errors_total{code=\"%d\"} %" PRIu64 "\n", -slot,
+                   count);
+    }
+  }
+
+  text_appendf(&buf, "# TYPE ai_request_duration_seconds histogram\n"
+                     "# HELP ai_request_duration_seconds Time from request to "
+                     "final response or chunk.\n");
+  for (int kind = 0; kind < AI_REQUEST_KIND_COUNT; kind++) {
+    render_histogram(&buf, "ai_request_duration_seconds", "kind",
+                     request_kind_labels[kind],
+                     &g_metrics.request_latency[kind]);
+  }
+
+  text_appendf(&buf, "# TYPE ai_retries counter\n"
+                     "# HELP ai_retries Generation attempts retried by "
+                     "failure class.\n");
+  for (int retry_class = 0; retry_class < AI_RETRY_CLASS_COUNT;
+       retry_class++) {
+    text_appendf(&buf, "ai_retries_total{class=\"%s\"} %" PRIu64 "\n",
+                 retry_class_labels[retry_class],
+                 atomic_load_explicit(&g_metrics.retries[retry_class],
+                                      memory_order_relaxed));
+  }
+
+  text_appendf(&buf,
+               "# TYPE ai_retries_exhausted counter\n"
+               "# HELP ai_retries_exhausted Requests that still failed after "
+               "their last allowed retry.\n"
+               "ai_retries_exhausted_total %" PRIu64 "\n"
+               "# TYPE ai_circuit_breaker_state gauge\n"
+               "# HELP ai_circuit_breaker_state 0 closed, 1 open, 2 "
+               "half-open.\n"
+               "ai_circuit_breaker_state %d\n"
+               "# TYPE ai_circuit_breaker_opened counter\n"
+               "# HELP ai_circuit_breaker_opened Times the circuit breaker "
+               "opened.\n"
+               "ai_circuit_breaker_opened_total %" PRIu64 "\n"
+               "# TYPE ai_circuit_breaker_rejected counter\n"
+               "# HELP ai_circuit_breaker_rejected Requests failed fast "
+               "while the breaker was open.\n"
+               "ai_circuit_breaker_rejected_total %" PRIu64 "\n",
+               atomic_load_explicit(&g_metrics.retries_exhausted,
+                                    memory_order_relaxed),
+               atomic_load_explicit(&g_metrics.circuit_state,
+                                    memory_order_relaxed),
+               atomic_load_explicit(&g_metrics.circuit_opened,
+                                    memory_order_relaxed),
+               atomic_load_explicit(&g_metrics.circuit_rejected,
+                                    memory_order_relaxed));
+
+  text_appendf(&buf, "# TYPE ai_model_request_duration_seconds histogram\n"
+                     "# HELP ai_model_request_duration_seconds Request time "
+                     "by the system model that served it.\n");
+  for (int model = 0; model < AI_MODEL_COUNT; model++) {
+    render_histogram(&buf, "ai_model_request_duration_seconds", "model",
+                     model_labels[model], &g_metrics.models[model].latency);
+  }
+
+  text_appendf(&buf, "# TYPE ai_stream_first_chunk_seconds histogram\n"
+                     "# HELP ai_stream_first_chunk_seconds Time from stream "
+                     "start to first chunk.\n");
+  render_histogram(&buf, "ai_stream_first_chunk_seconds", NULL, NULL,
+                   &g_metrics.first_chunk_latency);
+
+  text_appendf(&buf, "# TYPE ai_stream_chunk_gap_seconds histogram\n"
+                     "# HELP ai_stream_chunk_gap_seconds Time between "
+                     "consecutive chunks of a stream.\n");
+  render_histogram(&buf, "ai_stream_chunk_gap_seconds", NULL, NULL,
+                   &g_metrics.chunk_gap);
+
+  text_appendf(&buf,
+               "# TYPE ai_stream_stalls counter\n"
+               "# HELP ai_stream_stalls Streams that went longer than the "
+               "stall threshold without a chunk.\n"
+               "ai_stream_stalls_total %" PRIu64 "\n"
+               "# TYPE ai_stream_stall_cancels counter\n"
+               "# HELP ai_stream_stall_cancels Stalled streams the watchdog "
+               "cancelled.\n"
+               "ai_stream_stall_cancels_total %" PRIu64 "\n",
+               atomic_load_explicit(&g_metrics.stalls, memory_order_relaxed),
+               atomic_load_explicit(&g_metrics.stall_cancels,
+                                    memory_order_relaxed));
+
+  text_appendf(&buf,
+               "# TYPE ai_preflight_rejections counter\n"
+               "# HELP ai_preflight_rejections Requests refused before "
+               "generation because they would not fit the context window.\n"
+               "ai_preflight_rejections_total %" PRIu64 "\n"
+               "# TYPE ai_prompt_compactions counter\n"
+               "# HELP ai_prompt_compactions Prompts compacted before "
+               "generation.\n"
+               "ai_prompt_compactions_total %" PRIu64 "\n"
+               "# TYPE ai_prompt_compaction_tokens_saved counter\n"
+               "# HELP ai_prompt_compaction_tokens_saved Estimated tokens "
+               "removed by prompt compaction.\n"
+               "ai_prompt_compaction_tokens_saved_total %" PRIu64 "\n",
+               atomic_load_explicit(&g_metrics.preflight_rejections,
+                                    memory_order_relaxed),
+               atomic_load_explicit(&g_metrics.compactions,
+                                    memory_order_relaxed),
+               atomic_load_explicit(&g_metrics.compaction_tokens_saved,
+                                    memory_order_relaxed));
+
+  text_appendf(&buf,
+               "# TYPE ai_streams_in_flight gauge\n"
+               "# HELP ai_streams_in_flight Streams started but not yet "
+               "finished.\n"
+               "ai_streams_in_flight %" PRId64 "\n",
+               atomic_load_explicit(&g_metrics.streams_in_flight,
+                                    memory_order_relaxed));
+
+  text_appendf(&buf,
+               "# TYPE ai_sessions_active gauge\n"
+               "# HELP ai_sessions_active Sessions currently open across "
+               "all contexts.\n"
+               "ai_sessions_active %" PRId64 "\n",
+               atomic_load_explicit(&g_metrics.sessions_active,
+                                    memory_order_relaxed));
+
+  int tool_count = atomic_load(&g_metrics.tool_count);
+  text_appendf(&buf, "# TYPE ai_tool_calls counter\n"
+                     "# HELP ai_tool_calls Tool callback invocations by tool "
+                     "and outcome.\n");
+  for (int i = 0; i <= tool_count; i++) {
+    ai_tool_metrics_t *tool =
+        i < tool_count ? &g_metrics.tools[i] : &g_metrics.tool_overflow;
+    if (i == tool_count && atomic_load(&tool->latency.count) == 0) continue;
+
+    char name[MAX_TOOL_NAME_LENGTH * 2];
+    render_label_value(name, sizeof(name), tool->name);
+    text_appendf(&buf,
+                 "ai_tool_calls_total{tool=\"%s\",outcome=\"success\"} "
+                 "%" PRIu64 "\n"
+                 "ai_tool_calls_total{tool=\"%s\",outcome=\"error\"} "
+                 "%" PRIu64 "\n",
+                 name, atomic_load(&tool->successes), name,
+                 atomic_load(&tool->failures));
+  }
+
+  text_appendf(&buf, "# TYPE ai_tool_call_duration_seconds histogram\n"
+                     "# HELP ai_tool_call_duration_seconds Tool callback "
+                     "execution time.\n");
+  for (int i = 0; i <= tool_count; i++) {
+    ai_tool_metrics_t *tool =
+        i < tool_count ? &g_metrics.tools[i] : &g_metrics.tool_overflow;
+    if (i == tool_count && atomic_load(&tool->latency.count) == 0) continue;
+
+    char name[MAX_TOOL_NAME_LENGTH * 2];
+    render_label_value(name, sizeof(name), tool->name);
+    render_histogram(&buf, "ai_tool_call_duration_seconds", "tool", name,
+                     &tool->latency);
+  }
+
+  ai_log_stats_t log_stats;
+  ai_log_get_stats(&log_stats);
+  text_appendf(&buf,
+               "# TYPE ai_log_records counter\n"
+               "# HELP ai_log_records Structured log records by outcome.\n"
+               "ai_log_records_total{outcome=\"written\"} %" PRIu64 "\n"
+               "ai_log_records_total{outcome=\"dropped\"} %" PRIu64 "\n",
+               log_stats.records_written, log_stats.records_dropped);
+
+  text_appendf(&buf, "# EOF\n");
+
+  if (buf.failed) {
+    free(buf.data);
+    return NULL;
+  }
+
+  return buf.data;
+}
+
+static bool write_all(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t n = write(fd, data, length);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    length -= (size_t)n;
+  }
+  return true;
+}
+
+static void serve_connection(int fd) {
+  char request[EXPORTER_MAX_REQUEST];
+  size_t length = 0;
+
+  // Read until the end of the request headers; scrapers send small GETs
+  while (length < sizeof(request) - 1) {
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    if (poll(&pfd, 1, EXPORTER_REQUEST_TIMEOUT_MS) <= 0) return;
+
+    ssize_t n = read(fd, request + length, sizeof(request) - 1 - length);
+    if (n <= 0) return;
+    length += (size_t)n;
+    request[length] = '\0';
+
+    if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) break;
+  }
+
+  bool is_metrics = strncmp(request, "GET /metrics", 12) == 0 &&
+                    (request[12] == ' ' || request[12] == '?');
+
+  if (!is_metrics) {
+    const char *not_found = "HTTP/1.1 404 Not Found\r\n"
+                            "Content-Length: 0\r\n"
+                            "Connection: close\r\n\r\n";
+    write_all(fd, not_found, strlen(not_found));
+    return;
+  }
+
+  char *body = ai_metrics_render();
+  if (!body) {
+    const char *error = "HTTP/1.1 500 Internal Server Error\r\n"
+                        "Content-Length: 0\r\n"
+                        "Connection: close\r\n\r\n";
+    write_all(fd, error, strlen(error));
+    return;
+  }
+
+  char header[256];
+  size_t body_length = strlen(body);
+  int header_length = snprintf(
+      header, sizeof(header),
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: application/openmetrics-text; version=1.0.0; "
+      "charset=utf-8\r\n"
+      "Content-Length: %zu\r\n"
+      "Connection: close\r\n\r\n",
+      body_length);
+
+  if (write_all(fd, header, header_length)) {
+    write_all(fd, body, body_length);
+  }
+
+  free(body);
+}
+
+static void *exporter_main(void *arg) {
+  (void)arg;
+
+  struct pollfd fds[2] = {
+      {.fd = g_exporter.listen_fd, .events = POLLIN},
+      {.fd = g_exporter.wake_pipe[0], .events = POLLIN},
+  };
+
+  while (atomic_load(&g_exporter.running)) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (fds[1].revents) break;
+
+    if (fds[0].revents & POLLIN) {
+      int client = accept(g_exporter.listen_fd, NULL, NULL);
+      if (client < 0) continue;
+
+      serve_connection(client);
+      close(client);
+    }
+  }
+
+  return NULL;
+}
+
+static int open_unix_listener(const char *path) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 8) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  snprintf(g_exporter.unix_path, sizeof(g_exporter.unix_path), "%s", path);
+  return fd;
+}
+
+static int open_tcp_listener(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+
+  int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in addr = {
+      .sin_family = AF_INET,
+      .sin_port = htons(port),
+      .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+      listen(fd, 8) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+ai_result_t ai_metrics_exporter_start(
+    const ai_metrics_exporter_config_t *config) {
+  if (!config || (!config->unix_socket_path && config->port == 0)) {
+    return AI_ERROR_INVALID_PARAMS;
+  }
+
+  if (atomic_load(&g_exporter.running)) return AI_SUCCESS;
+
+  g_exporter.unix_path[0] = '\0';
+  g_exporter.listen_fd = config->unix_socket_path
+                             ? open_unix_listener(config->unix_socket_path)
+                             : open_tcp_listener(config->port);
+  if (g_exporter.listen_fd < 0) return AI_ERROR_INIT_FAILED;
+
+  fcntl(g_exporter.listen_fd, F_SETFD, FD_CLOEXEC);
+
+  if (pipe(g_exporter.wake_pipe) != 0) {
+    close(g_exporter.listen_fd);
+    g_exporter.listen_fd = -1;
+    return AI_ERROR_INIT_FAILED;
+  }
+
+  atomic_store(&g_exporter.running, true);
+
+  if (pthread_create(&g_exporter.thread, NULL, exporter_main, NULL) != 0) {
+    atomic_store(&g_exporter.running, false);
+    close(g_exporter.listen_fd);
+    close(g_exporter.wake_pipe[0]);
+    close(g_exporter.wake_pipe[1]);
+    g_exporter.listen_fd = -1;
+    return AI_ERROR_INIT_FAILED;
+  }
+
+  return AI_SUCCESS;
+}
+
+void ai_metrics_exporter_stop(void) {
+  if (!atomic_exchange(&g_exporter.running, false)) return;
+
+  char byte = 0;
+  write_all(g_exporter.wake_pipe[1], &byte, 1);
+  pthread_join(g_exporter.thread, NULL);
+
+  close(g_exporter.listen_fd);
+  close(g_exporter.wake_pipe[0]);
+  close(g_exporter.wake_pipe[1]);
+  g_exporter.listen_fd = -1;
+  g_exporter.wake_pipe[0] = g_exporter.wake_pipe[1] = -1;
+
+  if (g_exporter.unix_path[0]) {
+    unlink(g_exporter.unix_path);
+    g_exporter.unix_path[0] = '\0';
+  }
+}
@@ -0,0 +1,318 @@
+/*
+ * Token estimates and prompt compaction; see the budget group in ai.h.
+ *
+ * Each compaction pass copies its input into a buffer of the same size and
+ * only ever shrinks it: every marker it writes replaces more bytes than the
+ * marker itself takes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ai.h"
+#include "ai_internal.h"
+
+// Runs of log lines shorter than this are kept whole
+#define LOG_MIN_LINES 50
+#define LOG_HEAD_LINES 20
+#define LOG_TAIL_LINES 20
+// Short paragraphs such as "}" or "---" repeat legitimately
+#define DUPLICATE_MIN_BYTES 64
+#define DUPLICATE_MARKER "[repeated paragraph omitted]"
+
+typedef struct {
+  char *data;
+  size_t length;
+} text_t;
+
+typedef struct {
+  uint64_t hash;
+  size_t offset;
+  size_t length;  // 0 marks an empty slot
+} paragraph_slot_t;
+
+size_t ai_estimate_tokens_for_bytes(size_t bytes) {
+  return (bytes + AI_BYTES_PER_TOKEN - 1) / AI_BYTES_PER_TOKEN;
+}
+
+int32_t ai_estimate_tokens(const char *text) {
+  if (!text) return 0;
+
+  size_t tokens = ai_estimate_tokens_for_bytes(strlen(text));
+  return tokens > INT32_MAX ? INT32_MAX : (int32_t)tokens;
+}
+
+static size_t line_end(const char *data, size_t length, size_t start) {
+  const char *newline = memchr(data + start, '\n', length - start);
+  return newline ? (size_t)(newline - data) + 1 : length;
+}
+
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static bool starts_with_word(const char *line, size_t length,
+                             const char *word) {
+  size_t word_length = strlen(word);
+  if (length < word_length || memcmp(line, word, word_length) != 0) {
+    return false;
+  }
+  // "INFO:" and "ERROR " count, "INFORMATION" does not
+  return length == word_length || !((line[word_length] >= 'A' &&
+                                      line[word_length] <= 'Z') ||
+                                     (line[word_length] >= 'a' &&
+                                      line[word_length] <= 'z'));
+}
+
+// A timestamp ("2024-05-01", "12:03:44"), a level tag, or a stack frame.
+// Numbered list items ("1. ", "12. ") do not match.
+static bool is_log_line(const char *line, size_t length) {
+  size_t i = 0;
+  while (i < length && (line[i] == ' ' || line[i] == '\t')) i++;
+  bool indented = i > 0;
+  line += i;
+  length -= i;
+
+  if (length > 0 && line[0] == '[') {
+    line++;
+    length--;
+  }
+
+  if (length >= 4 && is_digit(line[0]) && is_digit(line[1])) {
+    size_t j = 2;
+    while (j < length && is_digit(line[j])) j++;
+    if (j + 1 < length &&
+        (line[j] == '-' || line[j] == ':' || line[j] == '/' ||
+         line[j] == '.') &&
+        is_digit(line[j + 1]))
+      return true;
+  }
+
+  static const char *levels[] = {"TRACE", "DEBUG", "INFO",  "WARN",
+                                 "WARNING", "ERROR", "FATAL", "CRITICAL"};
+  for (size_t k = 0; k < sizeof(levels) / sizeof(levels[0]); k++) {
+    if (starts_with_word(line, length, levels[k])) return true;
+  }
+
+  return indented && length >= 3 && memcmp(line, "at ", 3) == 0;
+}
+
+static void append(text_t *out, const char *data, size_t length) {
+  memcpy(out->data + out->length, data, length);
+  out->length += length;
+}
+
+static void flush_log_run(text_t *out, const char *data, size_t start,
+                          size_t end, size_t lines) {
+  if (lines < LOG_MIN_LINES) {
+    append(out, data + start, end - start);
+    return;
+  }
+
+  size_t head_end = start;
+  for (size_t i = 0; i < LOG_HEAD_LINES; i++) {
+    head_end = line_end(data, end, head_end);
+  }
+  size_t tail_start = head_end;
+  for (size_t i = 0; i < lines - LOG_HEAD_LINES - LOG_TAIL_LINES; i++) {
+    tail_start = line_end(data, end, tail_start);
+  }
+
+  char marker[64];
+  int marker_length =
+      snprintf(marker, sizeof(marker), "[... %zu log lines omitted ...]\n",
+               lines - LOG_HEAD_LINES - LOG_TAIL_LINES);
+  if ((size_t)marker_length >= tail_start - head_end) {
+    append(out, data + start, end - start);
+    return;
+  }
+
+  append(out, data + start, head_end - start);
+  append(out, marker, (size_t)marker_length);
+  append(out, data + tail_start, end - tail_start);
+}
+
+static void compact_logs(const text_t *in, text_t *out) {
+  size_t run_start = 0;
+  size_t run_lines = 0;
+
+  for (size_t start = 0; start < in->length;) {
+    size_t end = line_end(in->data, in->length, start);
+    if (is_log_line(in->data + start, end - start)) {
+      if (run_lines == 0) run_start = start;
+      run_lines++;
+    } else {
+      if (run_lines > 0) {
+        flush_log_run(out, in->data, run_start, start, run_lines);
+        run_lines = 0;
+      }
+      append(out, in->data + start, end - start);
+    }
+    start = end;
+  }
+  if (run_lines > 0) {
+    flush_log_run(out, in->data, run_start, in->length, run_lines);
+  }
+}
+
+static bool is_blank(const char *line, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    char c = line[i];
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') return false;
+  }
+  return true;
+}
+
+static uint64_t hash_bytes(const char *data, size_t length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Returns false if an equal paragraph was seen before, inserting it otherwise
+static bool remember_paragraph(paragraph_slot_t *slots, size_t mask,
+                               const char *data, size_t offset,
+                               size_t length) {
+  uint64_t hash = hash_bytes(data + offset, length);
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    paragraph_slot_t *slot = &slots[i];
+    if (slot->length == 0) {
+      *slot = (paragraph_slot_t){
+          .hash = hash, .offset = offset, .length = length};
+      return true;
+    }
+    if (slot->hash == hash && slot->length == length &&
+        memcmp(data + slot->offset, data + offset, length) == 0)
+      return false;
+  }
+}
+
+static bool compact_duplicates(const text_t *in, text_t *out) {
+  // Only paragraphs of DUPLICATE_MIN_BYTES or more are stored
+  size_t capacity = 16;
+  while (capacity < 2 * (in->length / DUPLICATE_MIN_BYTES + 1)) capacity *= 2;
+  paragraph_slot_t *slots = calloc(capacity, sizeof(paragraph_slot_t));
+  if (!slots) return false;
+
+  size_t start = 0;
+  while (start < in->length) {
+    size_t end = line_end(in->data, in->length, start);
+    if (is_blank(in->data + start, end - start)) {
+      append(out, in->data + start, end - start);
+      start = end;
+      continue;
+    }
+
+    size_t paragraph_end = end;
+    while (paragraph_end < in->length) {
+      size_t next = line_end(in->data, in->length, paragraph_end);
+      if (is_blank(in->data + paragraph_end, next - paragraph_end)) break;
+      paragraph_end = next;
+    }
+
+    // Compare without the final newline so a paragraph at the very end
+    // still matches its earlier copies
+    size_t length = paragraph_end - start;
+    bool newline = in->data[paragraph_end - 1] == '\n';
+    size_t body = newline ? length - 1 : length;
+    if (body >= DUPLICATE_MIN_BYTES &&
+        !remember_paragraph(slots, capacity - 1, in->data, start, body)) {
+      append(out, DUPLICATE_MARKER, strlen(DUPLICATE_MARKER));
+      if (newline) append(out, "\n", 1);
+    } else {
+      append(out, in->data + start, length);
+    }
+    start = paragraph_end;
+  }
+
+  free(slots);
+  return true;
+}
+
+static void compact_whitespace(const text_t *in, text_t *out) {
+  int blank_lines = 0;
+  bool wrote_text = false;
+
+  for (size_t start = 0; start < in->length;) {
+    size_t end = line_end(in->data, in->length, start);
+    const char *line = in->data + start;
+    size_t length = end - start;
+    start = end;
+
+    if (is_blank(line, length)) {
+      blank_lines++;
+      continue;
+    }
+    // Keep a single blank line between paragraphs, none at the start
+    if (wrote_text) {
+      append(out, "\n", 1);
+      if (blank_lines > 0) append(out, "\n", 1);
+    }
+    blank_lines = 0;
+    wrote_text = true;
+
+    size_t i = 0;
+    while (i < length && (line[i] == ' ' || line[i] == '\t')) i++;
+    append(out, line, i);
+
+    bool pending_space = false;
+    for (; i < length; i++) {
+      char c = line[i];
+      if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        pending_space = true;
+        continue;
+      }
+      if (pending_space) append(out, " ", 1);
+      pending_space = false;
+      out->data[out->length++] = c;
+    }
+  }
+}
+
+char *ai_compact_prompt(const char *prompt, uint32_t passes,
+                        int32_t *tokens_saved) {
+  if (tokens_saved) *tokens_saved = 0;
+  if (!prompt) return NULL;
+
+  size_t length = strlen(prompt);
+  text_t current = {.data = malloc(length + 1), .length = length};
+  text_t next = {.data = malloc(length + 1), .length = 0};
+  if (!current.data || !next.data) {
+    free(current.data);
+    free(next.data);
+    return NULL;
+  }
+  memcpy(current.data, prompt, length);
+
+  for (uint32_t pass = AI_COMPACT_LOGS; pass; pass >>= 1) {
+    if (!(passes & pass)) continue;
+
+    next.length = 0;
+    if (pass == AI_COMPACT_LOGS) {
+      compact_logs(&current, &next);
+    } else if (pass == AI_COMPACT_DUPLICATES) {
+      if (!compact_duplicates(&current, &next)) {
+        free(current.data);
+        free(next.data);
+        return NULL;
+      }
+    } else {
+      compact_whitespace(&current, &next);
+    }
+
+    text_t swap = current;
+    current = next;
+    next = swap;
+  }
+  free(next.data);
+
+  current.data[current.length] = '\0';
+  if (tokens_saved) {
+    *tokens_saved = (int32_t)(ai_estimate_tokens_for_bytes(length) -
+                              ai_estimate_tokens_for_bytes(current.length));
+  }
+  return current.data;
+}
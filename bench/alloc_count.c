@@ -0,0 +1,68 @@
+/*
+ * Counting allocator wrappers; see alloc_count.h.
+ *
+ * Sizes come from the allocator itself (malloc_size() on macOS,
+ * malloc_usable_size() elsewhere), so memory allocated outside the wrappers
+ * can still be freed through them.
+ */
+
+#define BENCH_ALLOC_COUNT_IMPL
+#include "alloc_count.h"
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#define usable_size(ptr) malloc_size(ptr)
+#else
+#include <malloc.h>
+#define usable_size(ptr) malloc_usable_size(ptr)
+#endif
+
+alloc_stats_t alloc_stats;
+
+void alloc_stats_mark(void) { alloc_stats.peak_bytes = alloc_stats.live_bytes; }
+
+static void *track(void *ptr) {
+  if (ptr) {
+    alloc_stats.allocations++;
+    alloc_stats.live_bytes += (int64_t)usable_size(ptr);
+    if (alloc_stats.live_bytes > alloc_stats.peak_bytes) {
+      alloc_stats.peak_bytes = alloc_stats.live_bytes;
+    }
+  }
+  return ptr;
+}
+
+void *bench_malloc(size_t size) { return track(malloc(size)); }
+
+void *bench_calloc(size_t count, size_t size) {
+  return track(calloc(count, size));
+}
+
+void *bench_realloc(void *ptr, size_t size) {
+  size_t old_size = ptr ? usable_size(ptr) : 0;
+  void *grown = realloc(ptr, size);
+  if (!grown) {
+    return NULL;
+  }
+  alloc_stats.live_bytes -= (int64_t)old_size;
+  if (!ptr || usable_size(grown) > old_size) {
+    // Count reallocs that had to grow: those are what amortised buffers
+    // are meant to avoid
+    return track(grown);
+  }
+  alloc_stats.live_bytes += (int64_t)usable_size(grown);
+  return grown;
+}
+
+void bench_free(void *ptr) {
+  if (ptr) {
+    alloc_stats.live_bytes -= (int64_t)usable_size(ptr);
+    free(ptr);
+  }
+}
+
+char *bench_strdup(const char *str) { return track(strdup(str)); }
+
+char *bench_strndup(const char *str, size_t size) {
+  return track(strndup(str, size));
+}
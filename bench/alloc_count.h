@@ -0,0 +1,49 @@
+/*
+ * Counting allocator for benchmarks.
+ *
+ * Force-included (-include bench/alloc_count.h) into every translation unit
+ * whose allocations should be counted. The standard headers are pulled in
+ * first so their declarations stay untouched; afterwards malloc() and friends
+ * are redirected to the counting wrappers in alloc_count.c. Only direct calls
+ * are redirected, so function pointers such as cJSON's default hooks still
+ * reach the system allocator.
+ *
+ * Counters are plain integers: measured code must run on one thread.
+ */
+
+#ifndef BENCH_ALLOC_COUNT_H
+#define BENCH_ALLOC_COUNT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  uint64_t allocations; /* malloc/calloc/strdup calls and growing reallocs */
+  int64_t live_bytes;   /* usable bytes currently allocated */
+  int64_t peak_bytes;   /* high-water mark of live_bytes since last mark */
+} alloc_stats_t;
+
+extern alloc_stats_t alloc_stats;
+
+/* Restarts the peak at the current live size */
+void alloc_stats_mark(void);
+
+void *bench_malloc(size_t size);
+void *bench_calloc(size_t count, size_t size);
+void *bench_realloc(void *ptr, size_t size);
+void bench_free(void *ptr);
+char *bench_strdup(const char *str);
+char *bench_strndup(const char *str, size_t size);
+
+#ifndef BENCH_ALLOC_COUNT_IMPL
+#define malloc(size) bench_malloc(size)
+#define calloc(count, size) bench_calloc(count, size)
+#define realloc(ptr, size) bench_realloc(ptr, size)
+#define free(ptr) bench_free(ptr)
+#define strdup(str) bench_strdup(str)
+#define strndup(str, size) bench_strndup(str, size)
+#endif
+
+#endif
@@ -0,0 +1,675 @@
+/*
+ * Concurrency sweep for libai's own overhead.
+ *
+ * Links ai.c directly against the synthetic bridge, so everything measured
+ * is libai plus the bridge glue: no model, no FoundationModels. Each workload
+ * (sync, stream, structured) runs at concurrency 1, 2, 4, ... up to
+ * --max-concurrency, one context and session per worker thread, and records
+ * throughput, p50/p99 latency and process CPU time per request. Every level
+ * is repeated and the median of each metric kept.
+ *
+ * Results are compared against a checked-in baseline with per-metric
+ * tolerances; any regression makes the run exit non-zero. Baselines are
+ * machine-specific: refresh them on the reference machine with
+ * `make bench-baseline`.
+ *
+ * Usage:
+ *   ai-bench [--baseline FILE] [--update-baseline] [--output FILE]
+ *            [--workloads sync,stream,structured] [--max-concurrency N]
+ *            [--requests N] [--repeat N]
+ *            [--latency-us N] [--chunks N] [--chunk-delay-us N]
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "../ai.h"
+#include "../third-party/cJSON.h"
+
+#define MAX_REPEAT 15
+
+static const char *const STRUCTURED_SCHEMA =
+    "{\"type\":\"object\",\"properties\":{\"answer\":{\"type\":\"string\"}},"
+    "\"required\":[\"answer\"]}";
+
+typedef enum { WORKLOAD_SYNC, WORKLOAD_STREAM, WORKLOAD_STRUCTURED } workload_t;
+
+static const char *const workload_names[] = {"sync", "stream", "structured"};
+#define WORKLOAD_COUNT 3
+
+typedef struct {
+  double throughput_rps;
+  double p50_us;
+  double p99_us;
+  double cpu_us_per_request;
+  size_t errors;
+} level_result_t;
+
+/* Default tolerances, overridden by the baseline's "tolerance" object */
+typedef struct {
+  double throughput; /* allowed fractional drop */
+  double p50;        /* allowed fractional increase */
+  double p99;
+  double cpu;
+  double slack_us; /* absolute headroom for sub-microsecond timings */
+} tolerance_t;
+
+static struct {
+  const char *baseline_path;
+  const char *output_path;
+  bool update_baseline;
+  bool workloads[WORKLOAD_COUNT];
+  int max_concurrency;
+  int requests;
+  int repeat;
+  int latency_us;
+  int chunks;
+  int chunk_delay_us;
+} options = {
+    .workloads = {true, true, true},
+    .max_concurrency = 64,
+    .requests = 5000,
+    .repeat = 3,
+    .chunks = 16,
+};
+
+/* Holds workers until every session exists (no pthread_barrier on macOS) */
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool open;
+} start_gate_t;
+
+typedef struct {
+  workload_t workload;
+  int requests;
+  double *latencies_us;
+  size_t errors;
+  double started_us;
+  double finished_us;
+  start_gate_t *start;
+  ai_context_t *context;
+  ai_session_id_t session;
+  bool stream_done;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} worker_t;
+
+static double monotonic_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double cpu_us(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e6 +
+         usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, size_t count, double p) {
+  if (count == 0) {
+    return 0;
+  }
+  size_t rank = (size_t)ceil(p / 100.0 * (double)count);
+  return sorted[rank ? rank - 1 : 0];
+}
+
+static double median(double *values, size_t count) {
+  qsort(values, count, sizeof(double), compare_doubles);
+  return count % 2 ? values[count / 2]
+                   : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+static void stream_callback(ai_context_t *context, const char *chunk,
+                            void *user_data) {
+  (void)context;
+  worker_t *worker = user_data;
+  if (chunk && strncmp(chunk, "Error:", 6) != 0) {
+    return;
+  }
+  pthread_mutex_lock(&worker->mutex);
+  if (chunk) {
+    worker->errors++;
+  }
+  worker->stream_done = true;
+  pthread_cond_signal(&worker->cond);
+  pthread_mutex_unlock(&worker->mutex);
+}
+
+static bool run_one(worker_t *worker) {
+  char *response = NULL;
+  switch (worker->workload) {
+  case WORKLOAD_SYNC:
+    response = ai_generate_response(worker->context, worker->session,
+                                    "ping", NULL);
+    break;
+  case WORKLOAD_STRUCTURED:
+    response = ai_generate_structured_response(
+        worker->context, worker->session, "ping", STRUCTURED_SCHEMA, NULL);
+    break;
+  case WORKLOAD_STREAM:
+    worker->stream_done = false;
+    if (ai_generate_response_stream(worker->context, worker->session, "ping",
+                                    NULL, stream_callback,
+                                    worker) == AI_INVALID_ID) {
+      return false;
+    }
+    pthread_mutex_lock(&worker->mutex);
+    while (!worker->stream_done) {
+      pthread_cond_wait(&worker->cond, &worker->mutex);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return true;
+  }
+  if (!response) {
+    return false;
+  }
+  ai_free_string(response);
+  return true;
+}
+
+static void *worker_main(void *arg) {
+  worker_t *worker = arg;
+  pthread_mutex_lock(&worker->start->mutex);
+  while (!worker->start->open) {
+    pthread_cond_wait(&worker->start->cond, &worker->start->mutex);
+  }
+  pthread_mutex_unlock(&worker->start->mutex);
+
+  worker->started_us = monotonic_us();
+  for (int i = 0; i < worker->requests; i++) {
+    double started = monotonic_us();
+    if (!run_one(worker)) {
+      worker->errors++;
+    }
+    worker->latencies_us[i] = monotonic_us() - started;
+  }
+  worker->finished_us = monotonic_us();
+  return NULL;
+}
+
+/* Runs one workload at one concurrency level once */
+static bool run_level(workload_t workload, int concurrency,
+                      level_result_t *result) {
+  int per_worker = (options.requests + concurrency - 1) / concurrency;
+  size_t total = (size_t)per_worker * (size_t)concurrency;
+
+  worker_t *workers = calloc((size_t)concurrency, sizeof(*workers));
+  pthread_t *threads = calloc((size_t)concurrency, sizeof(*threads));
+  double *latencies = malloc(total * sizeof(*latencies));
+  if (!workers || !threads || !latencies) {
+    free(workers);
+    free(threads);
+    free(latencies);
+    return false;
+  }
+
+  start_gate_t start = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+                        .cond = PTHREAD_COND_INITIALIZER};
+
+  bool ok = true;
+  int started = 0;
+  for (; started < concurrency; started++) {
+    worker_t *worker = &workers[started];
+    worker->workload = workload;
+    worker->requests = per_worker;
+    worker->latencies_us = latencies + (size_t)started * (size_t)per_worker;
+    worker->start = &start;
+    worker->context = ai_context_create();
+    worker->session = worker->context
+                          ? ai_create_session(worker->context, NULL)
+                          : AI_INVALID_ID;
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    if (worker->session == AI_INVALID_ID ||
+        pthread_create(&threads[started], NULL, worker_main, worker) != 0) {
+      fprintf(stderr, "ai-bench: failed to start worker %d\n", started);
+      ai_context_free(worker->context);
+      ok = false;
+      break;
+    }
+  }
+
+  double cpu_before = cpu_us();
+  pthread_mutex_lock(&start.mutex);
+  start.open = true;
+  pthread_cond_broadcast(&start.cond);
+  pthread_mutex_unlock(&start.mutex);
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  double cpu_spent = cpu_us() - cpu_before;
+
+  // Wall time spans the first worker starting to the last one finishing
+  size_t errors = 0;
+  double first_start = INFINITY, last_finish = 0;
+  for (int i = 0; i < started; i++) {
+    errors += workers[i].errors;
+    first_start = fmin(first_start, workers[i].started_us);
+    last_finish = fmax(last_finish, workers[i].finished_us);
+    ai_context_free(workers[i].context);
+    pthread_mutex_destroy(&workers[i].mutex);
+    pthread_cond_destroy(&workers[i].cond);
+  }
+  if (!ok) {
+    free(workers);
+    free(threads);
+    free(latencies);
+    return false;
+  }
+
+  qsort(latencies, total, sizeof(double), compare_doubles);
+  *result = (level_result_t){
+      .throughput_rps = (double)total / ((last_finish - first_start) / 1e6),
+      .p50_us = percentile(latencies, total, 50),
+      .p99_us = percentile(latencies, total, 99),
+      .cpu_us_per_request = cpu_spent / (double)total,
+      .errors = errors,
+  };
+
+  free(workers);
+  free(threads);
+  free(latencies);
+  return true;
+}
+
+/* Repeats a level and keeps the median of every metric */
+static bool measure_level(workload_t workload, int concurrency,
+                          level_result_t *result) {
+  double throughput[MAX_REPEAT], p50[MAX_REPEAT], p99[MAX_REPEAT],
+      cpu[MAX_REPEAT];
+  size_t errors = 0;
+  for (int r = 0; r < options.repeat; r++) {
+    level_result_t run;
+    if (!run_level(workload, concurrency, &run)) {
+      return false;
+    }
+    throughput[r] = run.throughput_rps;
+    p50[r] = run.p50_us;
+    p99[r] = run.p99_us;
+    cpu[r] = run.cpu_us_per_request;
+    errors += run.errors;
+  }
+  size_t n = (size_t)options.repeat;
+  *result = (level_result_t){
+      .throughput_rps = median(throughput, n),
+      .p50_us = median(p50, n),
+      .p99_us = median(p99, n),
+      .cpu_us_per_request = median(cpu, n),
+      .errors = errors,
+  };
+  return true;
+}
+
+static cJSON *backend_json(void) {
+  cJSON *backend = cJSON_CreateObject();
+  cJSON_AddNumberToObject(backend, "latency_us", options.latency_us);
+  cJSON_AddNumberToObject(backend, "chunks", options.chunks);
+  cJSON_AddNumberToObject(backend, "chunk_delay_us", options.chunk_delay_us);
+  return backend;
+}
+
+static cJSON *level_json(int concurrency, const level_result_t *result) {
+  cJSON *level = cJSON_CreateObject();
+  cJSON_AddNumberToObject(level, "concurrency", concurrency);
+  cJSON_AddNumberToObject(level, "throughput_rps",
+                          round(result->throughput_rps));
+  cJSON_AddNumberToObject(level, "p50_us", round(result->p50_us * 10) / 10);
+  cJSON_AddNumberToObject(level, "p99_us", round(result->p99_us * 10) / 10);
+  cJSON_AddNumberToObject(level, "cpu_us_per_request",
+                          round(result->cpu_us_per_request * 10) / 10);
+  return level;
+}
+
+static cJSON *read_json_file(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *text = size >= 0 ? malloc((size_t)size + 1) : NULL;
+  cJSON *json = NULL;
+  if (text && fread(text, 1, (size_t)size, file) == (size_t)size) {
+    text[size] = '\0';
+    json = cJSON_Parse(text);
+  }
+  free(text);
+  fclose(file);
+  return json;
+}
+
+static bool write_json_file(const char *path, const cJSON *json) {
+  char *text = cJSON_Print(json);
+  FILE *file = text ? fopen(path, "w") : NULL;
+  bool ok = file && fputs(text, file) >= 0 && fputc('\n', file) != EOF;
+  if (file) {
+    ok = fclose(file) == 0 && ok;
+  }
+  free(text);
+  if (!ok) {
+    fprintf(stderr, "ai-bench: cannot write %s: %s\n", path,
+            strerror(errno));
+  }
+  return ok;
+}
+
+static double number_or(const cJSON *object, const char *name,
+                        double fallback) {
+  const cJSON *item = cJSON_GetObjectItemCaseSensitive(object, name);
+  return cJSON_IsNumber(item) ? item->valuedouble : fallback;
+}
+
+static tolerance_t baseline_tolerance(const cJSON *baseline) {
+  const cJSON *t = cJSON_GetObjectItemCaseSensitive(baseline, "tolerance");
+  return (tolerance_t){
+      .throughput = number_or(t, "throughput", 0.30),
+      .p50 = number_or(t, "p50", 0.50),
+      .p99 = number_or(t, "p99", 2.00),
+      .cpu = number_or(t, "cpu", 0.50),
+      .slack_us = number_or(t, "slack_us", 1.0),
+  };
+}
+
+static const cJSON *find_level(const cJSON *baseline, const char *workload,
+                               int concurrency) {
+  const cJSON *results =
+      cJSON_GetObjectItemCaseSensitive(baseline, "results");
+  const cJSON *levels = cJSON_GetObjectItemCaseSensitive(results, workload);
+  const cJSON *level;
+  cJSON_ArrayForEach(level, levels) {
+    if ((int)number_or(level, "concurrency", -1) == concurrency) {
+      return level;
+    }
+  }
+  return NULL;
+}
+
+/* Prints every metric outside tolerance; returns the number of regressions */
+static int check_level(const cJSON *expected, const tolerance_t *tolerance,
+                       const char *workload, int concurrency,
+                       const level_result_t *result) {
+  struct {
+    const char *name;
+    double actual;
+    double allowed;
+    bool higher_is_better;
+  } checks[] = {
+      {"throughput_rps", result->throughput_rps,
+       number_or(expected, "throughput_rps", 0) * (1 - tolerance->throughput),
+       true},
+      {"p50_us", result->p50_us,
+       number_or(expected, "p50_us", INFINITY) * (1 + tolerance->p50) +
+           tolerance->slack_us,
+       false},
+      {"p99_us", result->p99_us,
+       number_or(expected, "p99_us", INFINITY) * (1 + tolerance->p99) +
+           tolerance->slack_us,
+       false},
+      {"cpu_us_per_request", result->cpu_us_per_request,
+       number_or(expected, "cpu_us_per_request", INFINITY) *
+               (1 + tolerance->cpu) +
+           tolerance->slack_us,
+       false},
+  };
+
+  int regressions = 0;
+  for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+    bool regressed = checks[i].higher_is_better
+                         ? checks[i].actual < checks[i].allowed
+                         : checks[i].actual > checks[i].allowed;
+    if (regressed) {
+      fprintf(stderr,
+              "REGRESSION %s c=%d %s: %.1f (limit %.1f, baseline %.1f)\n",
+              workload, concurrency, checks[i].name, checks[i].actual,
+              checks[i].allowed, number_or(expected, checks[i].name, 0));
+      regressions++;
+    }
+  }
+  return regressions;
+}
+
+static bool parse_workloads(const char *list) {
+  for (int w = 0; w < WORKLOAD_COUNT; w++) {
+    options.workloads[w] = false;
+  }
+  char *copy = strdup(list);
+  char *save = NULL;
+  for (char *name = strtok_r(copy, ",", &save); name;
+       name = strtok_r(NULL, ",", &save)) {
+    int w = 0;
+    while (w < WORKLOAD_COUNT && strcmp(name, workload_names[w]) != 0) {
+      w++;
+    }
+    if (w == WORKLOAD_COUNT) {
+      fprintf(stderr, "ai-bench: unknown workload '%s'\n", name);
+      free(copy);
+      return false;
+    }
+    options.workloads[w] = true;
+  }
+  free(copy);
+  return true;
+}
+
+static void usage(FILE *out) {
+  fprintf(out,
+          "Usage: ai-bench [options]\n"
+          "  -b, --baseline FILE      compare against FILE\n"
+          "  -u, --update-baseline    rewrite the baseline with this run\n"
+          "  -o, --output FILE        write results as JSON\n"
+          "  -w, --workloads LIST     sync,stream,structured (default all)\n"
+          "  -c, --max-concurrency N  highest level, doubling from 1 "
+          "(default 64)\n"
+          "  -n, --requests N         requests per level (default 5000)\n"
+          "  -r, --repeat N           runs per level, median kept "
+          "(default 3)\n"
+          "      --latency-us N       synthetic response latency\n"
+          "      --chunks N           synthetic chunks per stream "
+          "(default 16)\n"
+          "      --chunk-delay-us N   synthetic delay between chunks\n");
+}
+
+enum { OPT_LATENCY = 256, OPT_CHUNKS, OPT_CHUNK_DELAY };
+
+static bool parse_options(int argc, char **argv) {
+  static const struct option long_options[] = {
+      {"baseline", required_argument, NULL, 'b'},
+      {"update-baseline", no_argument, NULL, 'u'},
+      {"output", required_argument, NULL, 'o'},
+      {"workloads", required_argument, NULL, 'w'},
+      {"max-concurrency", required_argument, NULL, 'c'},
+      {"requests", required_argument, NULL, 'n'},
+      {"repeat", required_argument, NULL, 'r'},
+      {"latency-us", required_argument, NULL, OPT_LATENCY},
+      {"chunks", required_argument, NULL, OPT_CHUNKS},
+      {"chunk-delay-us", required_argument, NULL, OPT_CHUNK_DELAY},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "b:uo:w:c:n:r:h", long_options,
+                            NULL)) != -1) {
+    switch (opt) {
+    case 'b':
+      options.baseline_path = optarg;
+      break;
+    case 'u':
+      options.update_baseline = true;
+      break;
+    case 'o':
+      options.output_path = optarg;
+      break;
+    case 'w':
+      if (!parse_workloads(optarg)) {
+        return false;
+      }
+      break;
+    case 'c':
+      options.max_concurrency = atoi(optarg);
+      break;
+    case 'n':
+      options.requests = atoi(optarg);
+      break;
+    case 'r':
+      options.repeat = atoi(optarg);
+      break;
+    case OPT_LATENCY:
+      options.latency_us = atoi(optarg);
+      break;
+    case OPT_CHUNKS:
+      options.chunks = atoi(optarg);
+      break;
+    case OPT_CHUNK_DELAY:
+      options.chunk_delay_us = atoi(optarg);
+      break;
+    case 'h':
+      usage(stdout);
+      exit(0);
+    default:
+      usage(stderr);
+      return false;
+    }
+  }
+
+  if (options.max_concurrency < 1 || options.requests < 1 ||
+      options.repeat < 1 || options.repeat > MAX_REPEAT) {
+    fprintf(stderr, "ai-bench: concurrency and requests must be positive, "
+                    "repeat between 1 and %d\n",
+            MAX_REPEAT);
+    return false;
+  }
+  if (options.update_baseline && !options.baseline_path) {
+    fprintf(stderr, "ai-bench: --update-baseline needs --baseline\n");
+    return false;
+  }
+  return true;
+}
+
+/* The synthetic bridge reads its configuration once, on first use */
+static void configure_backend(void) {
+  char value[32];
+  snprintf(value, sizeof(value), "%d", options.latency_us);
+  setenv("AI_SYNTH_LATENCY_US", value, 1);
+  snprintf(value, sizeof(value), "%d", options.chunks);
+  setenv("AI_SYNTH_CHUNKS", value, 1);
+  snprintf(value, sizeof(value), "%d", options.chunk_delay_us);
+  setenv("AI_SYNTH_CHUNK_DELAY_US", value, 1);
+}
+
+int main(int argc, char **argv) {
+  if (!parse_options(argc, argv)) {
+    return 1;
+  }
+  configure_backend();
+  if (ai_init() != AI_SUCCESS) {
+    fprintf(stderr, "ai-bench: ai_init failed\n");
+    return 1;
+  }
+
+  cJSON *baseline = NULL;
+  if (options.baseline_path && !options.update_baseline) {
+    baseline = read_json_file(options.baseline_path);
+    if (!baseline) {
+      fprintf(stderr, "ai-bench: cannot read baseline %s\n",
+              options.baseline_path);
+      return 1;
+    }
+    cJSON *backend = backend_json();
+    bool same_backend = cJSON_Compare(
+        backend, cJSON_GetObjectItemCaseSensitive(baseline, "backend"), true);
+    cJSON_Delete(backend);
+    if (!same_backend) {
+      fprintf(stderr, "ai-bench: baseline was recorded with different "
+                      "synthetic backend settings\n");
+      return 1;
+    }
+  }
+  tolerance_t tolerance = baseline_tolerance(baseline);
+
+  cJSON *report = cJSON_CreateObject();
+  cJSON_AddItemToObject(report, "backend", backend_json());
+  cJSON_AddNumberToObject(report, "requests_per_level", options.requests);
+  cJSON *tolerance_json = cJSON_AddObjectToObject(report, "tolerance");
+  cJSON_AddNumberToObject(tolerance_json, "throughput", tolerance.throughput);
+  cJSON_AddNumberToObject(tolerance_json, "p50", tolerance.p50);
+  cJSON_AddNumberToObject(tolerance_json, "p99", tolerance.p99);
+  cJSON_AddNumberToObject(tolerance_json, "cpu", tolerance.cpu);
+  cJSON_AddNumberToObject(tolerance_json, "slack_us", tolerance.slack_us);
+  cJSON *results = cJSON_AddObjectToObject(report, "results");
+
+  printf("%-11s %5s %12s %10s %10s %10s\n", "workload", "conc", "req/s",
+         "p50 us", "p99 us", "cpu us/req");
+
+  int regressions = 0;
+  size_t errors = 0;
+  for (int w = 0; w < WORKLOAD_COUNT; w++) {
+    if (!options.workloads[w]) {
+      continue;
+    }
+    cJSON *levels = cJSON_AddArrayToObject(results, workload_names[w]);
+    for (int c = 1; c <= options.max_concurrency; c *= 2) {
+      level_result_t result;
+      if (!measure_level((workload_t)w, c, &result)) {
+        fprintf(stderr, "ai-bench: %s at concurrency %d failed to run\n",
+                workload_names[w], c);
+        return 1;
+      }
+      errors += result.errors;
+      printf("%-11s %5d %12.0f %10.1f %10.1f %10.1f\n", workload_names[w], c,
+             result.throughput_rps, result.p50_us, result.p99_us,
+             result.cpu_us_per_request);
+      fflush(stdout);
+      cJSON_AddItemToArray(levels, level_json(c, &result));
+
+      const cJSON *expected =
+          baseline ? find_level(baseline, workload_names[w], c) : NULL;
+      if (expected) {
+        regressions +=
+            check_level(expected, &tolerance, workload_names[w], c, &result);
+      }
+    }
+  }
+
+  bool ok = true;
+  if (options.output_path) {
+    ok = write_json_file(options.output_path, report);
+  }
+  if (options.update_baseline) {
+    ok = write_json_file(options.baseline_path, report) && ok;
+    if (ok) {
+      printf("baseline written to %s\n", options.baseline_path);
+    }
+  }
+  cJSON_Delete(report);
+  cJSON_Delete(baseline);
+
+  if (errors) {
+    fprintf(stderr, "ai-bench: %zu requests failed\n", errors);
+    ok = false;
+  }
+  if (regressions) {
+    fprintf(stderr, "ai-bench: %d metrics regressed beyond tolerance\n",
+            regressions);
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,407 @@
+/*
+ * History-clearing benchmark for libai.
+ *
+ * Companion to the concurrency sweep for callers that reuse one session per
+ * worker and clear its history before every request, which is what keeps a
+ * long-lived session inside the context window once preflight is on. Links
+ * ai.c directly against the synthetic bridge with preflight left enabled.
+ * Each workload (sync, stream, structured) runs at concurrency 1, 2, 4, ...
+ * up to --max-concurrency, and records throughput plus p50/p99 latency of
+ * the clear and of the request that follows it.
+ *
+ * Any failed clear or request makes the run exit non-zero.
+ *
+ * Usage:
+ *   ai-history-bench [--workloads sync,stream,structured]
+ *                    [--max-concurrency N] [--requests N]
+ *                    [--latency-us N] [--chunks N] [--chunk-delay-us N]
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../ai.h"
+
+static const char *const STRUCTURED_SCHEMA =
+    "{\"type\":\"object\",\"properties\":{\"answer\":{\"type\":\"string\"}},"
+    "\"required\":[\"answer\"]}";
+
+typedef enum { WORKLOAD_SYNC, WORKLOAD_STREAM, WORKLOAD_STRUCTURED } workload_t;
+
+static const char *const workload_names[] = {"sync", "stream", "structured"};
+#define WORKLOAD_COUNT 3
+
+typedef struct {
+  double throughput_rps;
+  double clear_p50_us;
+  double clear_p99_us;
+  double request_p50_us;
+  double request_p99_us;
+  size_t errors;
+} level_result_t;
+
+static struct {
+  bool workloads[WORKLOAD_COUNT];
+  int max_concurrency;
+  int requests;
+  int latency_us;
+  int chunks;
+  int chunk_delay_us;
+} options = {
+    .workloads = {true, true, true},
+    .max_concurrency = 16,
+    .requests = 5000,
+    .chunks = 16,
+};
+
+/* Holds workers until every session exists (no pthread_barrier on macOS) */
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool open;
+} start_gate_t;
+
+typedef struct {
+  workload_t workload;
+  int requests;
+  double *clear_us;
+  double *request_us;
+  size_t errors;
+  double started_us;
+  double finished_us;
+  start_gate_t *start;
+  ai_context_t *context;
+  ai_session_id_t session;
+  bool stream_done;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} worker_t;
+
+static double monotonic_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, size_t count, double p) {
+  if (count == 0) {
+    return 0;
+  }
+  size_t rank = (size_t)ceil(p / 100.0 * (double)count);
+  return sorted[rank ? rank - 1 : 0];
+}
+
+static void stream_callback(ai_context_t *context, const char *chunk,
+                            void *user_data) {
+  (void)context;
+  worker_t *worker = user_data;
+  if (chunk && strncmp(chunk, "Error:", 6) != 0) {
+    return;
+  }
+  pthread_mutex_lock(&worker->mutex);
+  if (chunk) {
+    worker->errors++;
+  }
+  worker->stream_done = true;
+  pthread_cond_signal(&worker->cond);
+  pthread_mutex_unlock(&worker->mutex);
+}
+
+static bool run_one(worker_t *worker) {
+  char *response = NULL;
+  switch (worker->workload) {
+  case WORKLOAD_SYNC:
+    response = ai_generate_response(worker->context, worker->session,
+                                    "ping", NULL);
+    break;
+  case WORKLOAD_STRUCTURED:
+    response = ai_generate_structured_response(
+        worker->context, worker->session, "ping", STRUCTURED_SCHEMA, NULL);
+    break;
+  case WORKLOAD_STREAM:
+    worker->stream_done = false;
+    if (ai_generate_response_stream(worker->context, worker->session, "ping",
+                                    NULL, stream_callback,
+                                    worker) == AI_INVALID_ID) {
+      return false;
+    }
+    pthread_mutex_lock(&worker->mutex);
+    while (!worker->stream_done) {
+      pthread_cond_wait(&worker->cond, &worker->mutex);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return true;
+  }
+  if (!response) {
+    return false;
+  }
+  ai_free_string(response);
+  return true;
+}
+
+static void *worker_main(void *arg) {
+  worker_t *worker = arg;
+  pthread_mutex_lock(&worker->start->mutex);
+  while (!worker->start->open) {
+    pthread_cond_wait(&worker->start->cond, &worker->start->mutex);
+  }
+  pthread_mutex_unlock(&worker->start->mutex);
+
+  worker->started_us = monotonic_us();
+  for (int i = 0; i < worker->requests; i++) {
+    double started = monotonic_us();
+    if (ai_clear_session_history(worker->context, worker->session) !=
+        AI_SUCCESS) {
+      worker->errors++;
+    }
+    double cleared = monotonic_us();
+    if (!run_one(worker)) {
+      worker->errors++;
+    }
+    worker->clear_us[i] = cleared - started;
+    worker->request_us[i] = monotonic_us() - cleared;
+  }
+  worker->finished_us = monotonic_us();
+  return NULL;
+}
+
+/* Runs one workload at one concurrency level */
+static bool run_level(workload_t workload, int concurrency,
+                      level_result_t *result) {
+  int per_worker = (options.requests + concurrency - 1) / concurrency;
+  size_t total = (size_t)per_worker * (size_t)concurrency;
+
+  worker_t *workers = calloc((size_t)concurrency, sizeof(*workers));
+  pthread_t *threads = calloc((size_t)concurrency, sizeof(*threads));
+  double *clear_us = malloc(total * sizeof(*clear_us));
+  double *request_us = malloc(total * sizeof(*request_us));
+  if (!workers || !threads || !clear_us || !request_us) {
+    free(workers);
+    free(threads);
+    free(clear_us);
+    free(request_us);
+    return false;
+  }
+
+  start_gate_t start = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+                        .cond = PTHREAD_COND_INITIALIZER};
+
+  bool ok = true;
+  int started = 0;
+  for (; started < concurrency; started++) {
+    worker_t *worker = &workers[started];
+    size_t offset = (size_t)started * (size_t)per_worker;
+    worker->workload = workload;
+    worker->requests = per_worker;
+    worker->clear_us = clear_us + offset;
+    worker->request_us = request_us + offset;
+    worker->start = &start;
+    worker->context = ai_context_create();
+    worker->session = worker->context
+                          ? ai_create_session(worker->context, NULL)
+                          : AI_INVALID_ID;
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    if (worker->session == AI_INVALID_ID ||
+        pthread_create(&threads[started], NULL, worker_main, worker) != 0) {
+      fprintf(stderr, "ai-history-bench: failed to start worker %d\n",
+              started);
+      ai_context_free(worker->context);
+      ok = false;
+      break;
+    }
+  }
+
+  pthread_mutex_lock(&start.mutex);
+  start.open = true;
+  pthread_cond_broadcast(&start.cond);
+  pthread_mutex_unlock(&start.mutex);
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  // Wall time spans the first worker starting to the last one finishing
+  size_t errors = 0;
+  double first_start = INFINITY, last_finish = 0;
+  for (int i = 0; i < started; i++) {
+    errors += workers[i].errors;
+    first_start = fmin(first_start, workers[i].started_us);
+    last_finish = fmax(last_finish, workers[i].finished_us);
+    ai_context_free(workers[i].context);
+    pthread_mutex_destroy(&workers[i].mutex);
+    pthread_cond_destroy(&workers[i].cond);
+  }
+  if (ok) {
+    qsort(clear_us, total, sizeof(double), compare_doubles);
+    qsort(request_us, total, sizeof(double), compare_doubles);
+    *result = (level_result_t){
+        .throughput_rps = (double)total / ((last_finish - first_start) / 1e6),
+        .clear_p50_us = percentile(clear_us, total, 50),
+        .clear_p99_us = percentile(clear_us, total, 99),
+        .request_p50_us = percentile(request_us, total, 50),
+        .request_p99_us = percentile(request_us, total, 99),
+        .errors = errors,
+    };
+  }
+
+  free(workers);
+  free(threads);
+  free(clear_us);
+  free(request_us);
+  return ok;
+}
+
+static void usage(FILE *out) {
+  fprintf(out,
+          "Usage: ai-history-bench [options]\n"
+          "  -w, --workloads LIST     sync,stream,structured (default all)\n"
+          "  -c, --max-concurrency N  highest concurrency level (default 16)\n"
+          "  -n, --requests N         requests per level (default 5000)\n"
+          "      --latency-us N       synthetic time to first chunk\n"
+          "      --chunks N           synthetic chunks per response\n"
+          "      --chunk-delay-us N   synthetic delay between chunks\n");
+}
+
+static bool parse_workloads(const char *list) {
+  for (int w = 0; w < WORKLOAD_COUNT; w++) {
+    options.workloads[w] = false;
+  }
+  char *copy = strdup(list);
+  char *save = NULL;
+  for (char *name = strtok_r(copy, ",", &save); name;
+       name = strtok_r(NULL, ",", &save)) {
+    int w = 0;
+    while (w < WORKLOAD_COUNT && strcmp(name, workload_names[w]) != 0) {
+      w++;
+    }
+    if (w == WORKLOAD_COUNT) {
+      fprintf(stderr, "ai-history-bench: unknown workload '%s'\n", name);
+      free(copy);
+      return false;
+    }
+    options.workloads[w] = true;
+  }
+  free(copy);
+  return true;
+}
+
+enum { OPT_LATENCY = 256, OPT_CHUNKS, OPT_CHUNK_DELAY };
+
+static bool parse_options(int argc, char **argv) {
+  static const struct option long_options[] = {
+      {"workloads", required_argument, NULL, 'w'},
+      {"max-concurrency", required_argument, NULL, 'c'},
+      {"requests", required_argument, NULL, 'n'},
+      {"latency-us", required_argument, NULL, OPT_LATENCY},
+      {"chunks", required_argument, NULL, OPT_CHUNKS},
+      {"chunk-delay-us", required_argument, NULL, OPT_CHUNK_DELAY},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "w:c:n:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 'w':
+      if (!parse_workloads(optarg)) {
+        return false;
+      }
+      break;
+    case 'c':
+      options.max_concurrency = atoi(optarg);
+      break;
+    case 'n':
+      options.requests = atoi(optarg);
+      break;
+    case OPT_LATENCY:
+      options.latency_us = atoi(optarg);
+      break;
+    case OPT_CHUNKS:
+      options.chunks = atoi(optarg);
+      break;
+    case OPT_CHUNK_DELAY:
+      options.chunk_delay_us = atoi(optarg);
+      break;
+    case 'h':
+      usage(stdout);
+      exit(0);
+    default:
+      usage(stderr);
+      return false;
+    }
+  }
+
+  if (options.max_concurrency < 1 || options.requests < 1) {
+    fprintf(stderr,
+            "ai-history-bench: concurrency and requests must be positive\n");
+    return false;
+  }
+  return true;
+}
+
+static void configure_backend(void) {
+  char value[32];
+  snprintf(value, sizeof(value), "%d", options.latency_us);
+  setenv("AI_SYNTH_LATENCY_US", value, 1);
+  snprintf(value, sizeof(value), "%d", options.chunks);
+  setenv("AI_SYNTH_CHUNKS", value, 1);
+  snprintf(value, sizeof(value), "%d", options.chunk_delay_us);
+  setenv("AI_SYNTH_CHUNK_DELAY_US", value, 1);
+  // The point of clearing is to stay inside the window; measure it that way
+  unsetenv("AI_PREFLIGHT");
+}
+
+int main(int argc, char **argv) {
+  if (!parse_options(argc, argv)) {
+    return 1;
+  }
+  configure_backend();
+  if (ai_init() != AI_SUCCESS) {
+    fprintf(stderr, "ai-history-bench: ai_init failed\n");
+    return 1;
+  }
+
+  printf("%-11s %5s %12s %10s %10s %10s %10s\n", "workload", "conc", "req/s",
+         "clear p50", "clear p99", "req p50", "req p99");
+
+  size_t errors = 0;
+  for (int w = 0; w < WORKLOAD_COUNT; w++) {
+    if (!options.workloads[w]) {
+      continue;
+    }
+    for (int c = 1; c <= options.max_concurrency; c *= 2) {
+      level_result_t result;
+      if (!run_level((workload_t)w, c, &result)) {
+        fprintf(stderr, "ai-history-bench: %s at concurrency %d failed to "
+                        "run\n",
+                workload_names[w], c);
+        return 1;
+      }
+      errors += result.errors;
+      printf("%-11s %5d %12.0f %10.1f %10.1f %10.1f %10.1f\n",
+             workload_names[w], c, result.throughput_rps,
+             result.clear_p50_us, result.clear_p99_us, result.request_p50_us,
+             result.request_p99_us);
+      fflush(stdout);
+    }
+  }
+
+  if (errors) {
+    fprintf(stderr, "ai-history-bench: %zu requests failed\n", errors);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,1005 @@
+/*
+ * ai-loadgen: open-loop load generator for the bridge library.
+ *
+ * Grown out of chat.c: the bridge is loaded with dlopen() and responses are
+ * streamed through the callback API, but instead of one interactive prompt at
+ * a time requests arrive on a schedule (fixed-rate or Poisson) regardless of
+ * how fast earlier ones complete. Latencies are measured from the scheduled
+ * arrival time, so time spent waiting for a free stream shows up in the
+ * numbers instead of silently lowering the offered load.
+ *
+ * Reports time to first chunk, inter-chunk gaps, end-to-end latency
+ * percentiles and achieved throughput as text, CSV or JSON. Point --library
+ * at the synthetic bridge (make synthetic-bridge) to measure everything but
+ * the model.
+ *
+ * Usage:
+ *   ai-loadgen [--rate R] [--arrival fixed|poisson] [--requests N]
+ *              [--duration S] [--sessions N] [--concurrency N]
+ *              [--prompts FILE] [--format text|csv|json] ...
+ */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../ai_bridge.h"
+
+#ifndef LOADGEN_DEFAULT_LIBRARY
+#define LOADGEN_DEFAULT_LIBRARY "build/dynamic/arm64/release/libaibridge.dylib"
+#endif
+
+#ifndef LOADGEN_SYNTHETIC_LIBRARY
+#define LOADGEN_SYNTHETIC_LIBRARY "build/bench/libsynthbridge.dylib"
+#endif
+
+#define DEFAULT_PROMPT "Write one short paragraph about the ocean."
+#define CANCEL_GRACE_MS 5000
+
+typedef enum { ARRIVAL_FIXED, ARRIVAL_POISSON } arrival_t;
+typedef enum { FORMAT_TEXT, FORMAT_CSV, FORMAT_JSON } format_t;
+
+typedef struct {
+  const char *library;
+  const char *prompts_path;
+  const char *instructions;
+  const char *per_request_path;
+  arrival_t arrival;
+  format_t format;
+  double rate;
+  double duration_s;
+  double timeout_s;
+  double temperature;
+  int requests;
+  int sessions;
+  int concurrency;
+  int max_tokens;
+  unsigned seed;
+  bool history;
+  bool csv_header;
+} loadgen_options_t;
+
+/* Bridge entry points, resolved with dlsym() like chat.c does */
+static struct {
+  void *handle;
+  typeof(ai_bridge_init) *init;
+  typeof(ai_bridge_check_availability) *check_availability;
+  typeof(ai_bridge_get_availability_reason) *get_availability_reason;
+  typeof(ai_bridge_create_session) *create_session;
+  typeof(ai_bridge_destroy_session) *destroy_session;
+  typeof(ai_bridge_generate_response_stream) *generate_response_stream;
+  typeof(ai_bridge_cancel_stream) *cancel_stream;
+  typeof(ai_bridge_free_string) *free_string;
+} bridge;
+
+typedef struct {
+  double *values;
+  size_t count;
+  size_t capacity;
+} samples_t;
+
+/* One request from arrival to its terminal chunk */
+typedef struct {
+  int index;
+  const char *prompt;
+  double scheduled_ms;
+  double start_ms;
+  double first_chunk_ms;
+  double last_chunk_ms;
+  double end_ms;
+  size_t chunks;
+  size_t bytes;
+  samples_t gaps;
+  bool done;
+  bool failed;
+  bool timed_out;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} request_t;
+
+/* Arrived requests waiting for a worker, in arrival order */
+static struct {
+  request_t **items;
+  size_t head;
+  size_t count;
+  size_t capacity;
+  bool closed;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} queue = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+           .cond = PTHREAD_COND_INITIALIZER};
+
+/* Idle sessions, handed out round-robin */
+static struct {
+  ai_bridge_session_id_t *ids;
+  size_t head;
+  size_t count;
+  size_t capacity;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} session_pool = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+                  .cond = PTHREAD_COND_INITIALIZER};
+
+static loadgen_options_t options;
+static char **prompts;
+static size_t prompt_count;
+
+// Monotonic time in milliseconds (chat.c's get_time_ms() uses wall time,
+// which can jump during a long run)
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void sleep_until_ms(double deadline_ms) {
+  double remaining = deadline_ms - now_ms();
+  if (remaining <= 0) {
+    return;
+  }
+  struct timespec ts = {
+      .tv_sec = (time_t)(remaining / 1000.0),
+      .tv_nsec = (long)(fmod(remaining, 1000.0) * 1e6),
+  };
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+  }
+}
+
+static void deadline_after(struct timespec *deadline, double timeout_ms) {
+  clock_gettime(CLOCK_REALTIME, deadline);
+  long long ns = deadline->tv_nsec + (long long)(timeout_ms * 1e6);
+  deadline->tv_sec += (time_t)(ns / 1000000000LL);
+  deadline->tv_nsec = (long)(ns % 1000000000LL);
+}
+
+// Same estimate as chat.c: roughly 4 characters per token
+static size_t estimate_tokens(size_t bytes) { return (bytes + 3) / 4; }
+
+static bool samples_push(samples_t *samples, double value) {
+  if (samples->count == samples->capacity) {
+    size_t capacity = samples->capacity ? samples->capacity * 2 : 64;
+    double *values = realloc(samples->values, capacity * sizeof(*values));
+    if (!values) {
+      return false;
+    }
+    samples->values = values;
+    samples->capacity = capacity;
+  }
+  samples->values[samples->count++] = value;
+  return true;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+typedef struct {
+  size_t count;
+  double mean;
+  double p50;
+  double p90;
+  double p95;
+  double p99;
+  double max;
+} summary_t;
+
+// Nearest-rank percentile of sorted values
+static double percentile(const samples_t *sorted, double p) {
+  size_t rank = (size_t)ceil(p / 100.0 * (double)sorted->count);
+  return sorted->values[rank ? rank - 1 : 0];
+}
+
+static summary_t summarize(samples_t *samples) {
+  summary_t summary = {.count = samples->count};
+  if (samples->count == 0) {
+    return summary;
+  }
+  qsort(samples->values, samples->count, sizeof(double), compare_doubles);
+  double sum = 0;
+  for (size_t i = 0; i < samples->count; i++) {
+    sum += samples->values[i];
+  }
+  summary.mean = sum / (double)samples->count;
+  summary.p50 = percentile(samples, 50);
+  summary.p90 = percentile(samples, 90);
+  summary.p95 = percentile(samples, 95);
+  summary.p99 = percentile(samples, 99);
+  summary.max = samples->values[samples->count - 1];
+  return summary;
+}
+
+// Remove leading/trailing whitespace
+static char *trim(char *str) {
+  while (*str == ' ' || *str == '\t' || *str == '\n' || *str == '\r') {
+    str++;
+  }
+  char *end = str + strlen(str);
+  while (end > str && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' ||
+                       end[-1] == '\r')) {
+    end--;
+  }
+  *end = '\0';
+  return str;
+}
+
+/* Loads one prompt per line; blank lines and lines starting with # skipped */
+static bool load_prompts(const char *path) {
+  if (!path) {
+    static char *fallback[] = {DEFAULT_PROMPT};
+    prompts = fallback;
+    prompt_count = 1;
+    return true;
+  }
+
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "ai-loadgen: cannot open %s: %s\n", path, strerror(errno));
+    return false;
+  }
+
+  size_t capacity = 0;
+  char *line = NULL;
+  size_t line_capacity = 0;
+  while (getline(&line, &line_capacity, file) >= 0) {
+    char *prompt = trim(line);
+    if (*prompt == '\0' || *prompt == '#') {
+      continue;
+    }
+    if (prompt_count == capacity) {
+      capacity = capacity ? capacity * 2 : 16;
+      char **grown = realloc(prompts, capacity * sizeof(*prompts));
+      if (!grown) {
+        break;
+      }
+      prompts = grown;
+    }
+    prompts[prompt_count] = strdup(prompt);
+    if (prompts[prompt_count]) {
+      prompt_count++;
+    }
+  }
+  free(line);
+  fclose(file);
+
+  if (prompt_count == 0) {
+    fprintf(stderr, "ai-loadgen: no prompts in %s\n", path);
+    return false;
+  }
+  return true;
+}
+
+static bool load_bridge(const char *path) {
+  bridge.handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (!bridge.handle) {
+    fprintf(stderr, "ai-loadgen: failed to load library: %s\n", dlerror());
+    return false;
+  }
+
+  struct {
+    const char *name;
+    void **slot;
+  } symbols[] = {
+      {"ai_bridge_init", (void **)&bridge.init},
+      {"ai_bridge_check_availability", (void **)&bridge.check_availability},
+      {"ai_bridge_get_availability_reason",
+       (void **)&bridge.get_availability_reason},
+      {"ai_bridge_create_session", (void **)&bridge.create_session},
+      {"ai_bridge_destroy_session", (void **)&bridge.destroy_session},
+      {"ai_bridge_generate_response_stream",
+       (void **)&bridge.generate_response_stream},
+      {"ai_bridge_cancel_stream", (void **)&bridge.cancel_stream},
+      {"ai_bridge_free_string", (void **)&bridge.free_string},
+  };
+
+  for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+    *symbols[i].slot = dlsym(bridge.handle, symbols[i].name);
+    if (!*symbols[i].slot) {
+      fprintf(stderr, "ai-loadgen: missing symbol %s\n", symbols[i].name);
+      return false;
+    }
+  }
+
+  if (!bridge.init()) {
+    fprintf(stderr, "ai-loadgen: failed to initialize the bridge\n");
+    return false;
+  }
+
+  ai_availability_status_t availability = bridge.check_availability();
+  if (availability != AI_BRIDGE_AVAILABLE) {
+    char *reason = bridge.get_availability_reason();
+    fprintf(stderr, "ai-loadgen: Apple Intelligence not available: %s\n",
+            reason ? reason : "unknown reason");
+    if (reason) {
+      bridge.free_string(reason);
+    }
+    return false;
+  }
+  return true;
+}
+
+static bool create_sessions(void) {
+  session_pool.capacity = (size_t)options.sessions;
+  session_pool.ids =
+      calloc(session_pool.capacity, sizeof(*session_pool.ids));
+  if (!session_pool.ids) {
+    return false;
+  }
+
+  for (int i = 0; i < options.sessions; i++) {
+    ai_bridge_session_id_t session_id = bridge.create_session(
+        options.instructions, NULL, true, options.history, false, NULL, true);
+    if (session_id == AI_BRIDGE_INVALID_ID) {
+      fprintf(stderr, "ai-loadgen: failed to create session %d\n", i + 1);
+      return false;
+    }
+    session_pool.ids[session_pool.count++] = session_id;
+  }
+  return true;
+}
+
+static ai_bridge_session_id_t acquire_session(void) {
+  pthread_mutex_lock(&session_pool.mutex);
+  while (session_pool.count == 0) {
+    pthread_cond_wait(&session_pool.cond, &session_pool.mutex);
+  }
+  ai_bridge_session_id_t session_id = session_pool.ids[session_pool.head];
+  session_pool.head = (session_pool.head + 1) % session_pool.capacity;
+  session_pool.count--;
+  pthread_mutex_unlock(&session_pool.mutex);
+  return session_id;
+}
+
+static void release_session(ai_bridge_session_id_t session_id) {
+  pthread_mutex_lock(&session_pool.mutex);
+  size_t tail =
+      (session_pool.head + session_pool.count) % session_pool.capacity;
+  session_pool.ids[tail] = session_id;
+  session_pool.count++;
+  pthread_cond_signal(&session_pool.cond);
+  pthread_mutex_unlock(&session_pool.mutex);
+}
+
+static bool enqueue(request_t *request) {
+  pthread_mutex_lock(&queue.mutex);
+  if (queue.head + queue.count == queue.capacity) {
+    size_t capacity = queue.capacity ? queue.capacity * 2 : 256;
+    request_t **items = realloc(queue.items, capacity * sizeof(*items));
+    if (!items) {
+      pthread_mutex_unlock(&queue.mutex);
+      return false;
+    }
+    queue.items = items;
+    queue.capacity = capacity;
+  }
+  queue.items[queue.head + queue.count++] = request;
+  pthread_cond_signal(&queue.cond);
+  pthread_mutex_unlock(&queue.mutex);
+  return true;
+}
+
+static request_t *dequeue(void) {
+  pthread_mutex_lock(&queue.mutex);
+  while (queue.count == 0 && !queue.closed) {
+    pthread_cond_wait(&queue.cond, &queue.mutex);
+  }
+  request_t *request = NULL;
+  if (queue.count > 0) {
+    request = queue.items[queue.head++];
+    queue.count--;
+  }
+  pthread_mutex_unlock(&queue.mutex);
+  return request;
+}
+
+static void close_queue(void) {
+  pthread_mutex_lock(&queue.mutex);
+  queue.closed = true;
+  pthread_cond_broadcast(&queue.cond);
+  pthread_mutex_unlock(&queue.mutex);
+}
+
+// Streaming callback: timestamps chunks, no output
+static void stream_callback(void *context, const char *chunk,
+                            void *user_data) {
+  (void)user_data;
+  request_t *request = context;
+  double now = now_ms();
+
+  pthread_mutex_lock(&request->mutex);
+  if (chunk && strncmp(chunk, "Error:", 6) == 0) {
+    // The terminal NULL follows
+    request->failed = true;
+  } else if (chunk == NULL) {
+    request->end_ms = now;
+    request->done = true;
+    pthread_cond_signal(&request->cond);
+  } else {
+    if (request->chunks == 0) {
+      request->first_chunk_ms = now;
+    } else {
+      samples_push(&request->gaps, now - request->last_chunk_ms);
+    }
+    request->last_chunk_ms = now;
+    request->chunks++;
+    request->bytes += strlen(chunk);
+  }
+  pthread_mutex_unlock(&request->mutex);
+}
+
+/* Waits for the terminal chunk; returns false if it never arrived */
+static bool wait_for_request(request_t *request,
+                             ai_bridge_stream_id_t stream_id) {
+  pthread_mutex_lock(&request->mutex);
+  if (options.timeout_s > 0) {
+    struct timespec deadline;
+    deadline_after(&deadline, options.timeout_s * 1000.0);
+    while (!request->done) {
+      if (pthread_cond_timedwait(&request->cond, &request->mutex,
+                                 &deadline) == ETIMEDOUT) {
+        break;
+      }
+    }
+    if (!request->done) {
+      request->timed_out = true;
+      pthread_mutex_unlock(&request->mutex);
+      bridge.cancel_stream(stream_id);
+      pthread_mutex_lock(&request->mutex);
+      deadline_after(&deadline, CANCEL_GRACE_MS);
+      while (!request->done) {
+        if (pthread_cond_timedwait(&request->cond, &request->mutex,
+                                   &deadline) == ETIMEDOUT) {
+          break;
+        }
+      }
+    }
+  } else {
+    while (!request->done) {
+      pthread_cond_wait(&request->cond, &request->mutex);
+    }
+  }
+  bool done = request->done;
+  pthread_mutex_unlock(&request->mutex);
+  return done;
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  request_t *request;
+  while ((request = dequeue())) {
+    ai_bridge_session_id_t session_id = acquire_session();
+    request->start_ms = now_ms();
+
+    ai_bridge_stream_id_t stream_id = bridge.generate_response_stream(
+        session_id, request->prompt, options.temperature, options.max_tokens,
+        request, stream_callback, NULL);
+
+    if (stream_id == AI_BRIDGE_INVALID_ID) {
+      pthread_mutex_lock(&request->mutex);
+      request->failed = true;
+      request->end_ms = now_ms();
+      request->done = true;
+      pthread_mutex_unlock(&request->mutex);
+      release_session(session_id);
+      continue;
+    }
+
+    if (!wait_for_request(request, stream_id)) {
+      // The bridge still holds the context; leak it and retire the session
+      // rather than risk a late callback into freed or reused memory
+      fprintf(stderr, "ai-loadgen: request %d did not finish after cancel\n",
+              request->index);
+      continue;
+    }
+    release_session(session_id);
+  }
+  return NULL;
+}
+
+static double next_interarrival_ms(unsigned short state[3]) {
+  double mean_ms = 1000.0 / options.rate;
+  if (options.arrival == ARRIVAL_FIXED) {
+    return mean_ms;
+  }
+  // Exponential gaps give Poisson arrivals; 1 - U keeps log() finite
+  return -log(1.0 - erand48(state)) * mean_ms;
+}
+
+static request_t *new_request(int index, double scheduled_ms) {
+  request_t *request = calloc(1, sizeof(*request));
+  if (!request) {
+    return NULL;
+  }
+  request->index = index;
+  request->prompt = prompts[(size_t)index % prompt_count];
+  request->scheduled_ms = scheduled_ms;
+  pthread_mutex_init(&request->mutex, NULL);
+  pthread_cond_init(&request->cond, NULL);
+  return request;
+}
+
+typedef struct {
+  request_t **items;
+  size_t count;
+  double started_ms;
+  double finished_ms;
+} run_t;
+
+/* Issues requests on the arrival schedule until --requests or --duration */
+static bool generate_load(run_t *run) {
+  unsigned short state[3] = {0x330e, (unsigned short)options.seed,
+                             (unsigned short)(options.seed >> 16)};
+  size_t capacity = 0;
+  double end_ms = options.duration_s > 0
+                      ? now_ms() + options.duration_s * 1000.0
+                      : INFINITY;
+
+  run->started_ms = now_ms();
+  double scheduled_ms = run->started_ms;
+  for (int i = 0; options.requests <= 0 || i < options.requests; i++) {
+    if (i > 0) {
+      scheduled_ms += next_interarrival_ms(state);
+    }
+    if (scheduled_ms >= end_ms) {
+      break;
+    }
+    sleep_until_ms(scheduled_ms);
+
+    if (run->count == capacity) {
+      capacity = capacity ? capacity * 2 : 256;
+      request_t **items = realloc(run->items, capacity * sizeof(*items));
+      if (!items) {
+        return false;
+      }
+      run->items = items;
+    }
+    request_t *request = new_request(i, scheduled_ms);
+    if (!request || !enqueue(request)) {
+      free(request);
+      return false;
+    }
+    run->items[run->count++] = request;
+  }
+  return true;
+}
+
+typedef struct {
+  size_t completed;
+  size_t failed;
+  size_t timed_out;
+  size_t chunks;
+  size_t tokens;
+  double elapsed_s;
+  summary_t ttft;
+  summary_t gap;
+  summary_t e2e;
+  summary_t queue;
+} report_t;
+
+static report_t build_report(run_t *run) {
+  report_t report = {0};
+  samples_t ttft = {0}, gaps = {0}, e2e = {0}, wait = {0};
+
+  for (size_t i = 0; i < run->count; i++) {
+    request_t *request = run->items[i];
+    if (!request->done) {
+      report.failed++;
+      report.timed_out++;
+      continue;
+    }
+    if (request->end_ms > run->finished_ms) {
+      run->finished_ms = request->end_ms;
+    }
+    report.timed_out += request->timed_out;
+    if (request->failed || request->timed_out) {
+      report.failed++;
+      continue;
+    }
+    report.completed++;
+    report.chunks += request->chunks;
+    report.tokens += estimate_tokens(request->bytes);
+    samples_push(&wait, request->start_ms - request->scheduled_ms);
+    samples_push(&e2e, request->end_ms - request->scheduled_ms);
+    if (request->chunks > 0) {
+      samples_push(&ttft, request->first_chunk_ms - request->scheduled_ms);
+    }
+    for (size_t g = 0; g < request->gaps.count; g++) {
+      samples_push(&gaps, request->gaps.values[g]);
+    }
+  }
+
+  if (run->finished_ms < run->started_ms) {
+    run->finished_ms = now_ms();
+  }
+  report.elapsed_s = (run->finished_ms - run->started_ms) / 1000.0;
+  report.ttft = summarize(&ttft);
+  report.gap = summarize(&gaps);
+  report.e2e = summarize(&e2e);
+  report.queue = summarize(&wait);
+  free(ttft.values);
+  free(gaps.values);
+  free(e2e.values);
+  free(wait.values);
+  return report;
+}
+
+static double per_second(double value, double seconds) {
+  return seconds > 0 ? value / seconds : 0;
+}
+
+static const char *arrival_name(void) {
+  return options.arrival == ARRIVAL_POISSON ? "poisson" : "fixed";
+}
+
+static void print_text_summary(FILE *out, const char *name,
+                               const summary_t *s) {
+  fprintf(out,
+          "  %-14s n=%-7zu mean %8.2f  p50 %8.2f  p90 %8.2f  p95 %8.2f  "
+          "p99 %8.2f  max %8.2f\n",
+          name, s->count, s->mean, s->p50, s->p90, s->p95, s->p99, s->max);
+}
+
+static void print_text(FILE *out, const report_t *r, size_t offered) {
+  fprintf(out, "ai-loadgen: %s arrivals at %.2f req/s, %d sessions, "
+               "%d concurrent streams\n",
+          arrival_name(), options.rate, options.sessions,
+          options.concurrency);
+  fprintf(out, "requests: %zu offered, %zu completed, %zu failed "
+               "(%zu timed out) in %.2fs\n",
+          offered, r->completed, r->failed, r->timed_out, r->elapsed_s);
+  fprintf(out, "throughput: %.2f req/s, ~%.1f tokens/s, %.1f chunks/s\n",
+          per_second((double)r->completed, r->elapsed_s),
+          per_second((double)r->tokens, r->elapsed_s),
+          per_second((double)r->chunks, r->elapsed_s));
+  fprintf(out, "latency (ms):\n");
+  print_text_summary(out, "ttft", &r->ttft);
+  print_text_summary(out, "inter-chunk", &r->gap);
+  print_text_summary(out, "end-to-end", &r->e2e);
+  print_text_summary(out, "queue wait", &r->queue);
+}
+
+static const char *summary_columns[] = {"ttft", "gap", "e2e", "queue"};
+
+static void print_csv(FILE *out, const report_t *r, size_t offered) {
+  const summary_t *summaries[] = {&r->ttft, &r->gap, &r->e2e, &r->queue};
+
+  if (options.csv_header) {
+    fprintf(out, "arrival,rate,sessions,concurrency,offered,completed,"
+                 "failed,timed_out,elapsed_s,requests_per_s,tokens_per_s,"
+                 "chunks_per_s");
+    for (size_t i = 0; i < 4; i++) {
+      const char *m = summary_columns[i];
+      fprintf(out, ",%s_mean_ms,%s_p50_ms,%s_p90_ms,%s_p95_ms,%s_p99_ms,"
+                   "%s_max_ms",
+              m, m, m, m, m, m);
+    }
+    fputc('\n', out);
+  }
+
+  fprintf(out, "%s,%.3f,%d,%d,%zu,%zu,%zu,%zu,%.3f,%.3f,%.3f,%.3f",
+          arrival_name(), options.rate, options.sessions, options.concurrency,
+          offered, r->completed, r->failed, r->timed_out, r->elapsed_s,
+          per_second((double)r->completed, r->elapsed_s),
+          per_second((double)r->tokens, r->elapsed_s),
+          per_second((double)r->chunks, r->elapsed_s));
+  for (size_t i = 0; i < 4; i++) {
+    const summary_t *s = summaries[i];
+    fprintf(out, ",%.3f,%.3f,%.3f,%.3f,%.3f,%.3f", s->mean, s->p50, s->p90,
+            s->p95, s->p99, s->max);
+  }
+  fputc('\n', out);
+}
+
+static void print_json_summary(FILE *out, const char *name,
+                               const summary_t *s, bool last) {
+  fprintf(out,
+          "  \"%s\": {\"count\": %zu, \"mean\": %.3f, \"p50\": %.3f, "
+          "\"p90\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f}%s\n",
+          name, s->count, s->mean, s->p50, s->p90, s->p95, s->p99, s->max,
+          last ? "" : ",");
+}
+
+static void print_json(FILE *out, const report_t *r, size_t offered) {
+  fprintf(out, "{\n");
+  fprintf(out,
+          "  \"config\": {\"arrival\": \"%s\", \"rate\": %.3f, "
+          "\"sessions\": %d, \"concurrency\": %d, \"max_tokens\": %d, "
+          "\"temperature\": %.3f, \"prompts\": %zu, \"seed\": %u},\n",
+          arrival_name(), options.rate, options.sessions, options.concurrency,
+          options.max_tokens, options.temperature, prompt_count,
+          options.seed);
+  fprintf(out,
+          "  \"requests\": {\"offered\": %zu, \"completed\": %zu, "
+          "\"failed\": %zu, \"timed_out\": %zu},\n",
+          offered, r->completed, r->failed, r->timed_out);
+  fprintf(out, "  \"elapsed_s\": %.3f,\n", r->elapsed_s);
+  fprintf(out,
+          "  \"throughput\": {\"requests_per_s\": %.3f, "
+          "\"tokens_per_s\": %.3f, \"chunks_per_s\": %.3f},\n",
+          per_second((double)r->completed, r->elapsed_s),
+          per_second((double)r->tokens, r->elapsed_s),
+          per_second((double)r->chunks, r->elapsed_s));
+  print_json_summary(out, "ttft_ms", &r->ttft, false);
+  print_json_summary(out, "inter_chunk_ms", &r->gap, false);
+  print_json_summary(out, "e2e_ms", &r->e2e, false);
+  print_json_summary(out, "queue_ms", &r->queue, true);
+  fprintf(out, "}\n");
+}
+
+/* One CSV row per request, times relative to the start of the run */
+static bool write_per_request(const char *path, const run_t *run) {
+  FILE *out = fopen(path, "w");
+  if (!out) {
+    fprintf(stderr, "ai-loadgen: cannot write %s: %s\n", path,
+            strerror(errno));
+    return false;
+  }
+  fprintf(out, "index,scheduled_ms,queue_ms,ttft_ms,e2e_ms,chunks,bytes,"
+               "max_gap_ms,status\n");
+  for (size_t i = 0; i < run->count; i++) {
+    const request_t *q = run->items[i];
+    double max_gap = 0;
+    for (size_t g = 0; g < q->gaps.count; g++) {
+      max_gap = fmax(max_gap, q->gaps.values[g]);
+    }
+    const char *status = !q->done       ? "abandoned"
+                         : q->timed_out ? "timeout"
+                         : q->failed    ? "error"
+                                        : "ok";
+    fprintf(out, "%d,%.3f,%.3f,%.3f,%.3f,%zu,%zu,%.3f,%s\n", q->index,
+            q->scheduled_ms - run->started_ms,
+            q->done ? q->start_ms - q->scheduled_ms : 0,
+            q->chunks ? q->first_chunk_ms - q->scheduled_ms : 0,
+            q->done ? q->end_ms - q->scheduled_ms : 0, q->chunks, q->bytes,
+            max_gap, status);
+  }
+  fclose(out);
+  return true;
+}
+
+static void usage(FILE *out) {
+  fprintf(out,
+          "Usage: ai-loadgen [options]\n"
+          "\n"
+          "Load:\n"
+          "  -r, --rate R           arrivals per second (default 1)\n"
+          "  -a, --arrival KIND     fixed or poisson (default poisson)\n"
+          "  -n, --requests N       stop after N arrivals (default 100, "
+          "0 = no limit)\n"
+          "  -d, --duration S       stop arriving after S seconds\n"
+          "  -s, --sessions N       sessions to create (default 1)\n"
+          "  -c, --concurrency N    concurrent streams, at most one per "
+          "session\n"
+          "                         (default: sessions)\n"
+          "  -p, --prompts FILE     prompt corpus, one prompt per line\n"
+          "      --seed N           Poisson arrival seed (default 1)\n"
+          "\n"
+          "Generation:\n"
+          "  -t, --temperature T    sampling temperature (default 0.7)\n"
+          "  -m, --max-tokens N     maximum tokens per response "
+          "(default 1000)\n"
+          "      --instructions S   session instructions\n"
+          "      --history          keep conversation history per session\n"
+          "      --timeout S        cancel requests after S seconds\n"
+          "\n"
+          "Bridge:\n"
+          "  -l, --library PATH     bridge library (default %s,\n"
+          "                         or $AI_LOADGEN_LIBRARY)\n"
+          "      --synthetic        use %s\n"
+          "\n"
+          "Output:\n"
+          "  -f, --format FMT       text, csv or json (default text)\n"
+          "      --no-header        omit the CSV header row\n"
+          "      --per-request FILE write one CSV row per request\n"
+          "  -h, --help             show this help\n",
+          LOADGEN_DEFAULT_LIBRARY, LOADGEN_SYNTHETIC_LIBRARY);
+}
+
+enum {
+  OPT_SEED = 256,
+  OPT_INSTRUCTIONS,
+  OPT_HISTORY,
+  OPT_TIMEOUT,
+  OPT_SYNTHETIC,
+  OPT_NO_HEADER,
+  OPT_PER_REQUEST,
+};
+
+static bool parse_options(int argc, char **argv) {
+  const char *env_library = getenv("AI_LOADGEN_LIBRARY");
+  options = (loadgen_options_t){
+      .library = env_library && *env_library ? env_library
+                                             : LOADGEN_DEFAULT_LIBRARY,
+      .instructions = "You are a helpful assistant that provides "
+                      "thoughtful and concise answers.",
+      .arrival = ARRIVAL_POISSON,
+      .format = FORMAT_TEXT,
+      .rate = 1.0,
+      .temperature = 0.7,
+      .requests = 100,
+      .sessions = 1,
+      .max_tokens = 1000,
+      .seed = 1,
+      .csv_header = true,
+  };
+
+  static const struct option long_options[] = {
+      {"rate", required_argument, NULL, 'r'},
+      {"arrival", required_argument, NULL, 'a'},
+      {"requests", required_argument, NULL, 'n'},
+      {"duration", required_argument, NULL, 'd'},
+      {"sessions", required_argument, NULL, 's'},
+      {"concurrency", required_argument, NULL, 'c'},
+      {"prompts", required_argument, NULL, 'p'},
+      {"temperature", required_argument, NULL, 't'},
+      {"max-tokens", required_argument, NULL, 'm'},
+      {"library", required_argument, NULL, 'l'},
+      {"format", required_argument, NULL, 'f'},
+      {"help", no_argument, NULL, 'h'},
+      {"seed", required_argument, NULL, OPT_SEED},
+      {"instructions", required_argument, NULL, OPT_INSTRUCTIONS},
+      {"history", no_argument, NULL, OPT_HISTORY},
+      {"timeout", required_argument, NULL, OPT_TIMEOUT},
+      {"synthetic", no_argument, NULL, OPT_SYNTHETIC},
+      {"no-header", no_argument, NULL, OPT_NO_HEADER},
+      {"per-request", required_argument, NULL, OPT_PER_REQUEST},
+      {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "r:a:n:d:s:c:p:t:m:l:f:h",
+                            long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'r':
+      options.rate = atof(optarg);
+      break;
+    case 'a':
+      if (strcmp(optarg, "fixed") == 0) {
+        options.arrival = ARRIVAL_FIXED;
+      } else if (strcmp(optarg, "poisson") == 0) {
+        options.arrival = ARRIVAL_POISSON;
+      } else {
+        fprintf(stderr, "ai-loadgen: unknown arrival process '%s'\n", optarg);
+        return false;
+      }
+      break;
+    case 'n':
+      options.requests = atoi(optarg);
+      break;
+    case 'd':
+      options.duration_s = atof(optarg);
+      break;
+    case 's':
+      options.sessions = atoi(optarg);
+      break;
+    case 'c':
+      options.concurrency = atoi(optarg);
+      break;
+    case 'p':
+      options.prompts_path = optarg;
+      break;
+    case 't':
+      options.temperature = atof(optarg);
+      break;
+    case 'm':
+      options.max_tokens = atoi(optarg);
+      break;
+    case 'l':
+      options.library = optarg;
+      break;
+    case 'f':
+      if (strcmp(optarg, "text") == 0) {
+        options.format = FORMAT_TEXT;
+      } else if (strcmp(optarg, "csv") == 0) {
+        options.format = FORMAT_CSV;
+      } else if (strcmp(optarg, "json") == 0) {
+        options.format = FORMAT_JSON;
+      } else {
+        fprintf(stderr, "ai-loadgen: unknown format '%s'\n", optarg);
+        return false;
+      }
+      break;
+    case 'h':
+      usage(stdout);
+      exit(0);
+    case OPT_SEED:
+      options.seed = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case OPT_INSTRUCTIONS:
+      options.instructions = optarg;
+      break;
+    case OPT_HISTORY:
+      options.history = true;
+      break;
+    case OPT_TIMEOUT:
+      options.timeout_s = atof(optarg);
+      break;
+    case OPT_SYNTHETIC:
+      options.library = LOADGEN_SYNTHETIC_LIBRARY;
+      break;
+    case OPT_NO_HEADER:
+      options.csv_header = false;
+      break;
+    case OPT_PER_REQUEST:
+      options.per_request_path = optarg;
+      break;
+    default:
+      usage(stderr);
+      return false;
+    }
+  }
+
+  // A session answers one request at a time, so extra streams would only
+  // queue for a session
+  if (options.concurrency <= 0 || options.concurrency > options.sessions) {
+    options.concurrency = options.sessions;
+  }
+  if (options.rate <= 0 || options.sessions <= 0 || options.max_tokens <= 0) {
+    fprintf(stderr, "ai-loadgen: rate, sessions and max tokens must be "
+                    "positive\n");
+    return false;
+  }
+  if (options.requests <= 0 && options.duration_s <= 0) {
+    fprintf(stderr, "ai-loadgen: --requests 0 needs a --duration\n");
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (!parse_options(argc, argv) || !load_prompts(options.prompts_path) ||
+      !load_bridge(options.library) || !create_sessions()) {
+    return 1;
+  }
+
+  pthread_t *workers = calloc((size_t)options.concurrency, sizeof(*workers));
+  if (!workers) {
+    return 1;
+  }
+  int started = 0;
+  for (; started < options.concurrency; started++) {
+    if (pthread_create(&workers[started], NULL, worker_main, NULL) != 0) {
+      fprintf(stderr, "ai-loadgen: failed to start worker %d\n", started);
+      break;
+    }
+  }
+
+  run_t run = {0};
+  bool generated = started > 0 && generate_load(&run);
+  close_queue();
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+  if (!generated) {
+    fprintf(stderr, "ai-loadgen: load generation aborted\n");
+  }
+
+  report_t report = build_report(&run);
+  switch (options.format) {
+  case FORMAT_TEXT:
+    print_text(stdout, &report, run.count);
+    break;
+  case FORMAT_CSV:
+    print_csv(stdout, &report, run.count);
+    break;
+  case FORMAT_JSON:
+    print_json(stdout, &report, run.count);
+    break;
+  }
+  if (options.per_request_path &&
+      !write_per_request(options.per_request_path, &run)) {
+    return 1;
+  }
+
+  // Sessions are left to the process exit: an abandoned request may still be
+  // streaming on one, and its context must outlive it
+  return generated && report.completed > 0 ? 0 : 1;
+}
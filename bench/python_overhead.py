@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""
+Measure ai_bridge.py binding overhead against the synthetic bridge.
+
+Compares the compiled _libai fast paths with the ctypes fallback for the
+per-call cost of generate_response() and the per-chunk cost of callback
+streaming and stream_iter(). The synthetic bridge answers instantly, so the
+numbers are pure binding and transport overhead.
+
+Usage:
+    make python-ext synthetic-bridge
+    python3 bench/python_overhead.py [--calls N] [--streams N]
+"""
+
+import argparse
+import os
+import sys
+import threading
+import time
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(REPO_ROOT))
+
+import ai_bridge  # noqa: E402
+
+
+def find_synthetic_bridge() -> Path:
+    if env_path := os.environ.get('AI_SYNTH_LIBRARY'):
+        return Path(env_path)
+    for name in ('libsynthbridge.dylib', 'libsynthbridge.so'):
+        for candidate in REPO_ROOT.glob(f'build/**/{name}'):
+            return candidate
+    sys.exit("synthetic bridge not found; run `make synthetic-bridge` "
+             "or set AI_SYNTH_LIBRARY")
+
+
+def bench_generate(session: ai_bridge.AISession, calls: int) -> float:
+    """Nanoseconds per generate_response() call."""
+    session.generate_response("warm up")
+    start = time.perf_counter_ns()
+    for _ in range(calls):
+        session.generate_response("ping")
+    return (time.perf_counter_ns() - start) / calls
+
+
+def bench_callback_stream(bridge: ai_bridge.AIBridge,
+                          session: ai_bridge.AISession,
+                          streams: int) -> float:
+    """Nanoseconds per chunk delivered through stream_response()."""
+    chunks = 0
+    lock = threading.Lock()
+
+    def on_token(token):
+        nonlocal chunks
+        if token is not None:
+            with lock:
+                chunks += 1
+
+    start = time.perf_counter_ns()
+    for _ in range(streams):
+        done = threading.Event()
+
+        def on_chunk(token, done=done):
+            on_token(token)
+            if token is None:
+                done.set()
+
+        stream_id = session.stream_response("stream", on_chunk)
+        if stream_id is None or not done.wait(30):
+            sys.exit("callback stream did not complete")
+        bridge._unregister_stream(stream_id)
+    elapsed = time.perf_counter_ns() - start
+    return elapsed / max(chunks, 1)
+
+
+def bench_stream_iter(session: ai_bridge.AISession, streams: int,
+                      chunks_per_stream: int) -> float:
+    """Nanoseconds per chunk delivered through stream_iter()."""
+    start = time.perf_counter_ns()
+    for _ in range(streams):
+        for _ in session.stream_iter("stream"):
+            pass
+    elapsed = time.perf_counter_ns() - start
+    return elapsed / max(streams * chunks_per_stream, 1)
+
+
+def run(library: Path, native: bool, calls: int, streams: int,
+        chunks_per_stream: int) -> dict:
+    bridge = ai_bridge.AIBridge(library)
+    if not native:
+        bridge._native = None
+    elif bridge._native is None:
+        return {}
+
+    session = bridge.create_session()
+    try:
+        return {
+            'generate ns/call': bench_generate(session, calls),
+            'stream_response ns/chunk':
+                bench_callback_stream(bridge, session, streams),
+            'stream_iter ns/chunk':
+                bench_stream_iter(session, streams, chunks_per_stream),
+        }
+    finally:
+        session.destroy()
+        bridge.cleanup()
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument('--calls', type=int, default=20000)
+    parser.add_argument('--streams', type=int, default=50)
+    args = parser.parse_args()
+
+    library = find_synthetic_bridge()
+    chunks_per_stream = int(os.environ.setdefault('AI_SYNTH_CHUNKS', '2000'))
+
+    results = {
+        'ctypes': run(library, False, args.calls, args.streams,
+                      chunks_per_stream),
+        '_libai': run(library, True, args.calls, args.streams,
+                      chunks_per_stream),
+    }
+    if not results['_libai']:
+        print("_libai is not built; showing ctypes only "
+              "(run `make python-ext`)\n")
+
+    print(f"{'metric':<28}{'ctypes':>12}{'_libai':>12}{'speedup':>10}")
+    for metric, ctypes_ns in results['ctypes'].items():
+        native_ns = results['_libai'].get(metric)
+        if native_ns is None:
+            print(f"{metric:<28}{ctypes_ns:>12.0f}{'-':>12}{'-':>10}")
+        else:
+            print(f"{metric:<28}{ctypes_ns:>12.0f}{native_ns:>12.0f}"
+                  f"{ctypes_ns / native_ns:>9.1f}x")
+
+
+if __name__ == '__main__':
+    main()
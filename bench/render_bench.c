@@ -0,0 +1,564 @@
+/*
+ * Render-pipeline microbenchmark for momo.
+ *
+ * Builds main.c into this translation unit (its main() renamed) so the
+ * static rendering functions can be driven directly, without a terminal or a
+ * model. termbox is initialised on /dev/null and its back buffer resized to
+ * the requested width, giving an off-screen cell buffer for the draw stage.
+ *
+ * Each corpus document goes through the same stages as an assistant message:
+ *
+ *   markdown  process_markdown_to_ansi()      markdown -> ANSI text
+ *   lines     render_markdown_lines()         ANSI text -> rendered_line_t list
+ *   wrap      wrap_text_to_lines()            raw content wrapped at a width
+ *   draw      render_chat_line_with_ansi()    every line into the cell buffer
+ *
+ * For each stage and width it reports ns per input byte, allocations per run
+ * and the peak heap growth during a run (from the counting allocator in
+ * alloc_count.c, force-included into main.c, md4c and termbox).
+ *
+ * Usage:
+ *   render-bench [--widths 40,80,120,200] [--min-time-ms N] [--scale N]
+ *                [--format text|csv] [extra.md ...]
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <time.h>
+
+// main.c provides its own main(); keep it out of the way
+#define main momo_main
+#include "../main.c"
+#undef main
+
+#define MAX_WIDTHS 16
+#define OFFSCREEN_HEIGHT 512
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+} text_t;
+
+typedef struct {
+  char *name;
+  char *markdown;
+  size_t markdown_bytes;
+  char *ansi;
+  size_t ansi_bytes;
+  message_t message;
+  size_t line_bytes;
+} corpus_doc_t;
+
+typedef struct {
+  const char *stage;
+  int width;
+  size_t bytes;
+  double ns_per_byte;
+  double allocations;
+  int64_t peak_bytes;
+  uint64_t runs;
+} stage_result_t;
+
+static struct {
+  int widths[MAX_WIDTHS];
+  int width_count;
+  double min_time_ms;
+  int scale;
+  bool csv;
+} options = {
+    .widths = {40, 80, 120, 200},
+    .width_count = 4,
+    .min_time_ms = 200,
+    .scale = 1,
+};
+
+static void text_append(text_t *text, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int needed = vsnprintf(NULL, 0, fmt, args);
+  va_end(args);
+  if (needed < 0) {
+    return;
+  }
+  if (text->length + (size_t)needed + 1 > text->capacity) {
+    size_t capacity = text->capacity ? text->capacity : 4096;
+    while (capacity < text->length + (size_t)needed + 1) {
+      capacity *= 2;
+    }
+    char *data = realloc(text->data, capacity);
+    if (!data) {
+      return;
+    }
+    text->data = data;
+    text->capacity = capacity;
+  }
+  va_start(args, fmt);
+  vsnprintf(text->data + text->length, (size_t)needed + 1, fmt, args);
+  va_end(args);
+  text->length += (size_t)needed;
+}
+
+/* ---- Corpus ------------------------------------------------------------ */
+
+static const char *const prose_sentences[] = {
+    "The **streaming renderer** has to keep up with the model, so every "
+    "stage is measured in isolation.",
+    "Markdown arrives in small chunks and is re-rendered *many* times per "
+    "second while a response is in flight.",
+    "Inline `code spans`, [links](https://example.com/docs/render) and "
+    "~~strikethrough~~ all produce escape sequences.",
+    "Long paragraphs are the common case: most answers are several hundred "
+    "words of plain prose with light emphasis.",
+    "Wrapping must respect word boundaries, so the scanner looks at every "
+    "code point rather than every byte.",
+};
+
+static void build_prose(text_t *text, size_t target) {
+  for (int paragraph = 0; text->length < target; paragraph++) {
+    if (paragraph % 6 == 0) {
+      text_append(text, "## Section %d\n\n", paragraph / 6 + 1);
+    }
+    for (int i = 0; i < 7; i++) {
+      text_append(text, "%s ", prose_sentences[(paragraph + i) % 5]);
+    }
+    text_append(text, "\n\n");
+  }
+}
+
+static void build_nested_lists(text_t *text, size_t target) {
+  for (int group = 0; text->length < target; group++) {
+    text_append(text, "### Checklist %d\n\n", group + 1);
+    for (int a = 1; a <= 3; a++) {
+      text_append(text, "%d. Top-level step with **emphasis** %d.%d\n", a,
+                  group, a);
+      for (int b = 0; b < 3; b++) {
+        text_append(text, "   - Nested detail `item_%d` about the step\n", b);
+        for (int c = 0; c < 2; c++) {
+          text_append(text, "     - [%c] Third level task with a "
+                            "[reference](https://example.com/%d)\n",
+                      c ? 'x' : ' ', c);
+          text_append(text, "       - Fourth level note, *quite* deep "
+                            "inside the list\n");
+        }
+      }
+    }
+    text_append(text, "\n");
+  }
+}
+
+static void build_tables(text_t *text, size_t target) {
+  for (int table = 0; text->length < target; table++) {
+    text_append(text, "| Region | Requests | p50 ms | p99 ms | Errors | "
+                      "Owner | Status | Notes |\n");
+    text_append(text, "|:-------|---------:|-------:|-------:|-------:|"
+                      ":------|:------:|:------|\n");
+    for (int row = 0; row < 40; row++) {
+      text_append(text,
+                  "| eu-west-%d | %d | %d.%d | %d.%d | %d | team-%c | "
+                  "%s | **%s** `cfg-%d` |\n",
+                  row % 4, 1000 + row * 37, 10 + row % 9, row % 10,
+                  90 + row % 31, row % 10, row % 5, 'a' + row % 26,
+                  row % 3 ? "ok" : "degraded",
+                  row % 2 ? "stable" : "needs review", row);
+    }
+    text_append(text, "\n");
+  }
+}
+
+static void build_code(text_t *text, size_t target) {
+  static const char *const blocks[] = {
+      "```c\n"
+      "static size_t utf8_width(const char *text) {\n"
+      "  size_t width = 0;\n"
+      "  while (*text) {\n"
+      "    uint32_t cp;\n"
+      "    int len = tb_utf8_char_to_unicode(&cp, text);\n"
+      "    width += len > 0 ? tb_wcwidth(cp) : 1;\n"
+      "    text += len > 0 ? len : 1;\n"
+      "  }\n"
+      "  return width;\n"
+      "}\n"
+      "```\n\n",
+      "```python\n"
+      "async def stream(session, prompt: str) -> list[str]:\n"
+      "    chunks = []\n"
+      "    async for chunk in session.astream(prompt, temperature=0.7):\n"
+      "        chunks.append(chunk)  # keep order\n"
+      "    return chunks\n"
+      "```\n\n",
+      "```rust\n"
+      "fn percentile(sorted: &[f64], p: f64) -> f64 {\n"
+      "    let rank = ((p / 100.0) * sorted.len() as f64).ceil() as usize;\n"
+      "    sorted[rank.saturating_sub(1)]\n"
+      "}\n"
+      "```\n\n",
+      "```javascript\n"
+      "const lines = text.split('\\n').map((line, i) => `${i + 1}: "
+      "${line}`);\n"
+      "console.log(lines.filter(Boolean).join('\\n'));\n"
+      "```\n\n",
+      "```bash\n"
+      "for width in 40 80 120; do\n"
+      "  ./render-bench --widths \"$width\" --format csv >> results.csv\n"
+      "done\n"
+      "```\n\n",
+  };
+  for (int i = 0; text->length < target; i++) {
+    text_append(text, "Example %d:\n\n%s", i + 1, blocks[i % 5]);
+  }
+}
+
+static void build_json(text_t *text, size_t target) {
+  text_append(text, "```json\n{\n  \"results\": [\n");
+  for (int i = 0; text->length < target; i++) {
+    text_append(text,
+                "%s    {\"id\": %d, \"name\": \"item-%d\", \"score\": %d.%02d, "
+                "\"tags\": [\"alpha\", \"beta\", \"gamma\"], \"active\": %s, "
+                "\"owner\": {\"team\": \"render\", \"oncall\": null}}",
+                i ? ",\n" : "", i, i, i % 100, i % 97,
+                i % 2 ? "true" : "false");
+  }
+  text_append(text, "\n  ]\n}\n```\n");
+}
+
+static void build_cjk_emoji(text_t *text, size_t target) {
+  static const char *const lines[] = {
+      "流式渲染需要在模型生成文本的同时保持流畅，每个阶段都要单独测量。",
+      "日本語の文章は単語の間に空白がないため、折り返しは文字単位で行う"
+      "必要があります。",
+      "한국어 문장은 띄어쓰기가 있지만 글자 폭이 두 칸이라서 계산이 "
+      "달라집니다.",
+      "Emoji mix 🎉🚀✨ with ZWJ sequences 👩‍💻👨‍👩‍👧‍👦 and flags 🇯🇵🇰🇷🇨🇳 "
+      "inside **bold** text.",
+      "混合 English and 中文 with `コード` spans and 😀 faces 😎.",
+  };
+  for (int i = 0; text->length < target; i++) {
+    if (i % 8 == 0) {
+      text_append(text, "### 第%d節 🌏\n\n", i / 8 + 1);
+    }
+    text_append(text, "%s %s\n\n", lines[i % 5], lines[(i + 2) % 5]);
+  }
+}
+
+static bool add_doc(corpus_doc_t **docs, size_t *count, const char *name,
+                    char *markdown, size_t length) {
+  corpus_doc_t *grown = realloc(*docs, (*count + 1) * sizeof(**docs));
+  if (!grown) {
+    return false;
+  }
+  *docs = grown;
+  corpus_doc_t *doc = &grown[(*count)++];
+  memset(doc, 0, sizeof(*doc));
+  doc->name = strdup(name);
+  doc->markdown = markdown;
+  doc->markdown_bytes = length;
+  doc->message.type = MSG_ASSISTANT;
+  return doc->name != NULL;
+}
+
+static char *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return NULL;
+  }
+  text_t text = {0};
+  char chunk[8192];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    text_append(&text, "%.*s", (int)n, chunk);
+  }
+  fclose(file);
+  *length = text.length;
+  return text.data;
+}
+
+static bool build_corpus(corpus_doc_t **docs, size_t *count, int argc,
+                         char **argv) {
+  static const struct {
+    const char *name;
+    void (*build)(text_t *, size_t);
+  } generated[] = {
+      {"prose", build_prose},
+      {"nested-lists", build_nested_lists},
+      {"tables", build_tables},
+      {"code", build_code},
+      {"json", build_json},
+      {"cjk-emoji", build_cjk_emoji},
+  };
+
+  size_t target = (size_t)options.scale * 32 * 1024;
+  for (size_t i = 0; i < sizeof(generated) / sizeof(generated[0]); i++) {
+    text_t text = {0};
+    generated[i].build(&text, target);
+    if (!text.data ||
+        !add_doc(docs, count, generated[i].name, text.data, text.length)) {
+      return false;
+    }
+  }
+
+  for (int i = 0; i < argc; i++) {
+    size_t length = 0;
+    char *markdown = read_file(argv[i], &length);
+    if (!markdown) {
+      fprintf(stderr, "render-bench: cannot read %s\n", argv[i]);
+      return false;
+    }
+    const char *slash = strrchr(argv[i], '/');
+    if (!add_doc(docs, count, slash ? slash + 1 : argv[i], markdown,
+                 length)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ---- Off-screen cell buffer -------------------------------------------- */
+
+static bool init_offscreen(void) {
+  setlocale(LC_CTYPE, "C.UTF-8");
+  // Built-in capabilities only; the output goes nowhere anyway
+  setenv("TERM", "xterm-256color", 1);
+  int rfd = open("/dev/null", O_RDONLY);
+  int wfd = open("/dev/null", O_WRONLY);
+  if (rfd < 0 || wfd < 0 || tb_init_rwfd(rfd, wfd) != TB_OK) {
+    fprintf(stderr, "render-bench: cannot initialise termbox off-screen\n");
+    return false;
+  }
+  tb_set_output_mode(TB_OUTPUT_TRUECOLOR);
+  return true;
+}
+
+static bool resize_offscreen(int width) {
+  global.width = width;
+  global.height = OFFSCREEN_HEIGHT;
+  return cellbuf_resize(&global.back, width, OFFSCREEN_HEIGHT) == TB_OK &&
+         cellbuf_resize(&global.front, width, OFFSCREEN_HEIGHT) == TB_OK;
+}
+
+/* ---- Stages ------------------------------------------------------------ */
+
+typedef void (*stage_fn)(corpus_doc_t *doc, int width);
+
+static void stage_markdown(corpus_doc_t *doc, int width) {
+  (void)width;
+  free(process_markdown_to_ansi(doc->markdown));
+}
+
+static void stage_lines(corpus_doc_t *doc, int width) {
+  (void)width;
+  render_markdown_lines(&doc->message, doc->ansi);
+}
+
+static void stage_wrap(corpus_doc_t *doc, int width) {
+  char **lines;
+  int line_count;
+  wrap_text_to_lines(doc->markdown, width, &lines, &line_count);
+  for (int i = 0; i < line_count; i++) {
+    free(lines[i]);
+  }
+  free(lines);
+}
+
+static void stage_draw(corpus_doc_t *doc, int width) {
+  for (rendered_line_t *line = doc->message.lines; line; line = line->next) {
+    render_chat_line_with_ansi(line->text, 0, 0, width, COLOR_FG, COLOR_BG);
+  }
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Runs a stage long enough for a stable reading */
+static stage_result_t measure(const char *stage, stage_fn fn,
+                              corpus_doc_t *doc, int width, size_t bytes) {
+  // One untimed run warms caches and measures allocations and peak
+  alloc_stats_mark();
+  int64_t live_before = alloc_stats.live_bytes;
+  uint64_t allocations_before = alloc_stats.allocations;
+  double once_started = now_ns();
+  fn(doc, width);
+  double once_ns = now_ns() - once_started;
+
+  stage_result_t result = {
+      .stage = stage,
+      .width = width,
+      .bytes = bytes,
+      .allocations = (double)(alloc_stats.allocations - allocations_before),
+      .peak_bytes = alloc_stats.peak_bytes - live_before,
+  };
+
+  uint64_t runs = 1;
+  double min_ns = options.min_time_ms * 1e6;
+  if (once_ns < min_ns) {
+    runs = (uint64_t)(min_ns / (once_ns > 1 ? once_ns : 1)) + 1;
+  }
+  double started = now_ns();
+  for (uint64_t i = 0; i < runs; i++) {
+    fn(doc, width);
+  }
+  double elapsed = now_ns() - started;
+
+  result.runs = runs;
+  result.ns_per_byte = bytes ? elapsed / (double)runs / (double)bytes : 0;
+  return result;
+}
+
+static void print_header(void) {
+  if (options.csv) {
+    printf("document,stage,width,bytes,ns_per_byte,allocations,peak_bytes,"
+           "runs\n");
+  } else {
+    printf("%-14s %-9s %6s %10s %10s %12s %12s\n", "document", "stage",
+           "width", "bytes", "ns/byte", "allocs/run", "peak KiB");
+  }
+}
+
+static void print_result(const corpus_doc_t *doc,
+                         const stage_result_t *result) {
+  if (options.csv) {
+    printf("%s,%s,%d,%zu,%.3f,%.0f,%" PRId64 ",%" PRIu64 "\n", doc->name,
+           result->stage, result->width, result->bytes, result->ns_per_byte,
+           result->allocations, result->peak_bytes, result->runs);
+    return;
+  }
+  char width[16] = "-";
+  if (result->width > 0) {
+    snprintf(width, sizeof(width), "%d", result->width);
+  }
+  printf("%-14s %-9s %6s %10zu %10.2f %12.0f %12.1f\n", doc->name,
+         result->stage, width, result->bytes, result->ns_per_byte,
+         result->allocations, (double)result->peak_bytes / 1024.0);
+  fflush(stdout);
+}
+
+static bool run_doc(corpus_doc_t *doc) {
+  doc->ansi = process_markdown_to_ansi(doc->markdown);
+  if (!doc->ansi) {
+    fprintf(stderr, "render-bench: markdown failed for %s\n", doc->name);
+    return false;
+  }
+  doc->ansi_bytes = strlen(doc->ansi);
+
+  stage_result_t result =
+      measure("markdown", stage_markdown, doc, 0, doc->markdown_bytes);
+  print_result(doc, &result);
+  result = measure("lines", stage_lines, doc, 0, doc->ansi_bytes);
+  print_result(doc, &result);
+
+  // stage_lines leaves the rendered lines on the message for drawing
+  doc->line_bytes = 0;
+  for (rendered_line_t *line = doc->message.lines; line; line = line->next) {
+    doc->line_bytes += strlen(line->text);
+  }
+
+  for (int w = 0; w < options.width_count; w++) {
+    int width = options.widths[w];
+    result = measure("wrap", stage_wrap, doc, width, doc->markdown_bytes);
+    print_result(doc, &result);
+    if (!resize_offscreen(width)) {
+      fprintf(stderr, "render-bench: cannot resize cell buffer\n");
+      return false;
+    }
+    result = measure("draw", stage_draw, doc, width, doc->line_bytes);
+    print_result(doc, &result);
+  }
+
+  free_message_lines(&doc->message);
+  free(doc->ansi);
+  doc->ansi = NULL;
+  return true;
+}
+
+static bool parse_widths(const char *list) {
+  options.width_count = 0;
+  char *copy = strdup(list);
+  char *save = NULL;
+  for (char *item = strtok_r(copy, ",", &save); item;
+       item = strtok_r(NULL, ",", &save)) {
+    int width = atoi(item);
+    if (width < 5 || options.width_count == MAX_WIDTHS) {
+      fprintf(stderr, "render-bench: bad width list '%s'\n", list);
+      free(copy);
+      return false;
+    }
+    options.widths[options.width_count++] = width;
+  }
+  free(copy);
+  return options.width_count > 0;
+}
+
+static void usage(FILE *out) {
+  fprintf(out,
+          "Usage: render-bench [options] [extra.md ...]\n"
+          "  -w, --widths LIST      cell buffer widths (default "
+          "40,80,120,200)\n"
+          "  -t, --min-time-ms N    minimum timed run per stage "
+          "(default 200)\n"
+          "  -s, --scale N          generated document size, x32 KiB "
+          "(default 1)\n"
+          "  -f, --format FMT       text or csv (default text)\n");
+}
+
+int main(int argc, char **argv) {
+  static const struct option long_options[] = {
+      {"widths", required_argument, NULL, 'w'},
+      {"min-time-ms", required_argument, NULL, 't'},
+      {"scale", required_argument, NULL, 's'},
+      {"format", required_argument, NULL, 'f'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "w:t:s:f:h", long_options, NULL)) !=
+         -1) {
+    switch (opt) {
+    case 'w':
+      if (!parse_widths(optarg)) {
+        return 1;
+      }
+      break;
+    case 't':
+      options.min_time_ms = atof(optarg);
+      break;
+    case 's':
+      options.scale = atoi(optarg) > 0 ? atoi(optarg) : 1;
+      break;
+    case 'f':
+      options.csv = strcmp(optarg, "csv") == 0;
+      break;
+    case 'h':
+      usage(stdout);
+      return 0;
+    default:
+      usage(stderr);
+      return 1;
+    }
+  }
+
+  corpus_doc_t *docs = NULL;
+  size_t doc_count = 0;
+  if (!build_corpus(&docs, &doc_count, argc - optind, argv + optind) ||
+      !init_offscreen()) {
+    return 1;
+  }
+
+  print_header();
+  bool ok = true;
+  for (size_t i = 0; i < doc_count && ok; i++) {
+    ok = run_doc(&docs[i]);
+  }
+
+  tb_shutdown();
+  for (size_t i = 0; i < doc_count; i++) {
+    free(docs[i].name);
+    free(docs[i].markdown);
+  }
+  free(docs);
+  return ok ? 0 : 1;
+}
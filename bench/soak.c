@@ -0,0 +1,810 @@
+/*
+ * Soak test for libai and the bridge glue.
+ *
+ * Links ai.c directly against the synthetic bridge and runs tens of thousands
+ * of turns across worker threads: sync and structured calls, streams, streams
+ * cancelled straight after they start, tool calls and history edits. Sessions
+ * are destroyed and recreated every few turns and whole contexts every few
+ * session churns.
+ *
+ * While it runs, the process is sampled for resident set size, allocator bytes
+ * in use, open descriptors, threads, streams the bridge still tracks and the
+ * in-flight stream and active session gauges from the metrics exporter. Once
+ * the warm-up share of turns is done, a least-squares slope of RSS and heap
+ * against completed turns must stay under the configured limits, and after
+ * everything is freed no stream, session, descriptor or thread may be left
+ * over. Either failure makes the run exit non-zero.
+ *
+ * Usage:
+ *   ai-soak [--turns N] [--duration SECONDS] [--workers N] [--mix LIST]
+ *           [--churn N] [--context-churn N] [--sample-ms N] [--warmup F]
+ *           [--max-rss-slope KIB] [--max-heap-slope KIB] [--samples FILE]
+ *           [--latency-us N] [--chunks N] [--chunk-delay-us N] [--quiet]
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __APPLE__
+#include <libproc.h>
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+#include "../ai.h"
+#include "../ai_bridge.h"
+
+#define STREAM_TIMEOUT_S 30
+#define SETTLE_TIMEOUT_MS 5000
+
+static const char *const STRUCTURED_SCHEMA =
+    "{\"type\":\"object\",\"properties\":{\"answer\":{\"type\":\"string\"}},"
+    "\"required\":[\"answer\"]}";
+
+static const char *const TOOLS_JSON =
+    "[{\"name\":\"echo\",\"description\":\"Echo the prompt back\","
+    "\"parameters\":{\"type\":\"object\",\"properties\":{\"prompt\":"
+    "{\"type\":\"string\"}},\"required\":[\"prompt\"]}}]";
+
+typedef enum {
+  OP_SYNC,
+  OP_STREAM,
+  OP_STRUCTURED,
+  OP_CANCEL,
+  OP_TOOL,
+  OP_HISTORY,
+  OP_COUNT
+} op_t;
+
+static const char *const op_names[] = {"sync",   "stream", "structured",
+                                       "cancel", "tool",   "history"};
+
+typedef struct {
+  double elapsed_s;
+  uint64_t turns;
+  int64_t rss_bytes;
+  int64_t heap_bytes;
+  int fds;
+  int threads;
+  int bridge_streams;
+  int64_t streams_in_flight;
+  int64_t sessions_active;
+} sample_t;
+
+static struct {
+  uint64_t turns;
+  double duration_s;
+  int workers;
+  int mix[OP_COUNT];
+  int churn;
+  int context_churn;
+  int sample_ms;
+  double warmup;
+  double max_rss_slope_kib;
+  double max_heap_slope_kib;
+  const char *samples_path;
+  int latency_us;
+  int chunks;
+  int chunk_delay_us;
+  bool quiet;
+} options = {
+    .turns = 50000,
+    .workers = 4,
+    .mix = {30, 25, 10, 15, 10, 10},
+    .churn = 25,
+    .context_churn = 8,
+    .sample_ms = 500,
+    .warmup = 0.25,
+    .max_rss_slope_kib = 64,
+    .max_heap_slope_kib = 8,
+    .chunks = 16,
+    .chunk_delay_us = 20,
+};
+
+typedef struct {
+  int index;
+  unsigned short rng[3];
+  ai_context_t *context;
+  ai_session_id_t session;
+  ai_session_id_t tool_session;
+  int session_churns;
+  uint64_t ops[OP_COUNT];
+  uint64_t errors;
+  bool stuck;
+  bool stream_done;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} worker_t;
+
+static _Atomic(uint64_t) turns_claimed;
+static _Atomic(uint64_t) turns_done;
+static _Atomic(bool) stop_requested;
+
+static double monotonic_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ---- Process sampling -------------------------------------------------- */
+
+static int64_t heap_in_use(void) {
+#ifdef __APPLE__
+  malloc_statistics_t stats;
+  malloc_zone_statistics(NULL, &stats);
+  return (int64_t)stats.size_in_use;
+#else
+  struct mallinfo2 info = mallinfo2();
+  return (int64_t)(info.uordblks + info.hblkhd);
+#endif
+}
+
+static void process_usage(int64_t *rss_bytes, int *threads) {
+  *rss_bytes = 0;
+  *threads = 0;
+#ifdef __APPLE__
+  struct proc_taskinfo info;
+  if (proc_pidinfo(getpid(), PROC_PIDTASKINFO, 0, &info, sizeof(info)) ==
+      (int)sizeof(info)) {
+    *rss_bytes = (int64_t)info.pti_resident_size;
+    *threads = info.pti_threadnum;
+  }
+#else
+  FILE *status = fopen("/proc/self/status", "r");
+  if (!status) {
+    return;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), status)) {
+    long long value;
+    if (sscanf(line, "VmRSS: %lld kB", &value) == 1) {
+      *rss_bytes = value * 1024;
+    } else if (sscanf(line, "Threads: %lld", &value) == 1) {
+      *threads = (int)value;
+    }
+  }
+  fclose(status);
+#endif
+}
+
+static int open_fds(void) {
+  DIR *dir = opendir("/dev/fd");
+  if (!dir) {
+    return -1;
+  }
+  int count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir))) {
+    if (entry->d_name[0] != '.') {
+      count++;
+    }
+  }
+  closedir(dir);
+  // The directory stream held one descriptor of its own
+  return count - 1;
+}
+
+static int64_t metric_value(const char *text, const char *name) {
+  size_t length = strlen(name);
+  for (const char *line = text; line && *line;) {
+    if (strncmp(line, name, length) == 0 && line[length] == ' ') {
+      return strtoll(line + length + 1, NULL, 10);
+    }
+    line = strchr(line, '\n');
+    line = line ? line + 1 : NULL;
+  }
+  return -1;
+}
+
+static sample_t take_sample(double started_s) {
+  sample_t sample = {
+      .elapsed_s = monotonic_s() - started_s,
+      .turns = atomic_load(&turns_done),
+      .heap_bytes = heap_in_use(),
+      .fds = open_fds(),
+      .bridge_streams = ai_bridge_get_active_stream_count(),
+      .streams_in_flight = -1,
+      .sessions_active = -1,
+  };
+  process_usage(&sample.rss_bytes, &sample.threads);
+
+  char *metrics = ai_metrics_render();
+  if (metrics) {
+    sample.streams_in_flight = metric_value(metrics, "ai_streams_in_flight");
+    sample.sessions_active = metric_value(metrics, "ai_sessions_active");
+    ai_free_string(metrics);
+  }
+  return sample;
+}
+
+static void print_sample(const sample_t *sample) {
+  printf("%8.1fs %9" PRIu64 " turns  rss %8.1f MiB  heap %8.1f MiB  "
+         "fds %3d  threads %3d  streams %3d/%3" PRId64 "  sessions %3" PRId64
+         "\n",
+         sample->elapsed_s, sample->turns,
+         (double)sample->rss_bytes / (1024.0 * 1024.0),
+         (double)sample->heap_bytes / (1024.0 * 1024.0), sample->fds,
+         sample->threads, sample->bridge_streams, sample->streams_in_flight,
+         sample->sessions_active);
+  fflush(stdout);
+}
+
+/* Least-squares slope of bytes against turns, in KiB per 1000 turns */
+static double growth_slope(const sample_t *samples, size_t count,
+                           uint64_t from_turn, bool heap) {
+  double sum_x = 0, sum_y = 0;
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (samples[i].turns >= from_turn) {
+      sum_x += (double)samples[i].turns;
+      sum_y += (double)(heap ? samples[i].heap_bytes : samples[i].rss_bytes);
+      n++;
+    }
+  }
+  if (n < 3) {
+    return 0;
+  }
+  double mean_x = sum_x / (double)n, mean_y = sum_y / (double)n;
+  double covariance = 0, variance = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (samples[i].turns >= from_turn) {
+      double dx = (double)samples[i].turns - mean_x;
+      double y =
+          (double)(heap ? samples[i].heap_bytes : samples[i].rss_bytes);
+      covariance += dx * (y - mean_y);
+      variance += dx * dx;
+    }
+  }
+  return variance > 0 ? covariance / variance * 1000.0 / 1024.0 : 0;
+}
+
+/* ---- Workload ---------------------------------------------------------- */
+
+static char *echo_tool(const char *parameters_json, void *user_data) {
+  (void)user_data;
+  return strdup(parameters_json);
+}
+
+static void stream_callback(ai_context_t *context, const char *chunk,
+                            void *user_data) {
+  (void)context;
+  worker_t *worker = user_data;
+  if (chunk && strncmp(chunk, "Error:", 6) != 0) {
+    return;
+  }
+  pthread_mutex_lock(&worker->mutex);
+  worker->stream_done = true;
+  pthread_cond_signal(&worker->cond);
+  pthread_mutex_unlock(&worker->mutex);
+}
+
+/* Waits for the terminal chunk; false if the stream never finished */
+static bool wait_for_stream(worker_t *worker) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += STREAM_TIMEOUT_S;
+
+  pthread_mutex_lock(&worker->mutex);
+  int rc = 0;
+  while (!worker->stream_done && rc != ETIMEDOUT) {
+    rc = pthread_cond_timedwait(&worker->cond, &worker->mutex, &deadline);
+  }
+  bool done = worker->stream_done;
+  pthread_mutex_unlock(&worker->mutex);
+  return done;
+}
+
+static bool open_sessions(worker_t *worker) {
+  ai_session_config_t tool_config = AI_DEFAULT_SESSION_CONFIG;
+  tool_config.tools_json = TOOLS_JSON;
+
+  worker->session = ai_create_session(worker->context, NULL);
+  worker->tool_session = ai_create_session(worker->context, &tool_config);
+  return worker->session != AI_INVALID_ID &&
+         worker->tool_session != AI_INVALID_ID &&
+         ai_register_tool(worker->context, worker->tool_session, "echo",
+                          echo_tool, NULL) == AI_SUCCESS;
+}
+
+/* Replaces the sessions, and every few churns the whole context */
+static bool churn_sessions(worker_t *worker) {
+  if (++worker->session_churns % options.context_churn == 0) {
+    ai_context_free(worker->context);
+    worker->context = ai_context_create();
+    if (!worker->context) {
+      return false;
+    }
+  } else {
+    ai_destroy_session(worker->context, worker->session);
+    ai_destroy_session(worker->context, worker->tool_session);
+  }
+  return open_sessions(worker);
+}
+
+static op_t pick_op(worker_t *worker) {
+  int total = 0;
+  for (int op = 0; op < OP_COUNT; op++) {
+    total += options.mix[op];
+  }
+  int roll = (int)(erand48(worker->rng) * total);
+  for (int op = 0; op < OP_COUNT; op++) {
+    if (roll < options.mix[op]) {
+      return (op_t)op;
+    }
+    roll -= options.mix[op];
+  }
+  return OP_SYNC;
+}
+
+static bool run_turn(worker_t *worker, op_t op) {
+  char *response = NULL;
+  switch (op) {
+  case OP_SYNC:
+    response =
+        ai_generate_response(worker->context, worker->session, "ping", NULL);
+    break;
+  case OP_STRUCTURED:
+    response = ai_generate_structured_response(
+        worker->context, worker->session, "ping", STRUCTURED_SCHEMA, NULL);
+    break;
+  case OP_TOOL:
+    response = ai_generate_response(worker->context, worker->tool_session,
+                                    "ping", NULL);
+    break;
+  case OP_HISTORY: {
+    if (ai_add_message_to_history(worker->context, worker->session, "user",
+                                  "ping") != AI_SUCCESS) {
+      return false;
+    }
+    response = ai_get_session_history(worker->context, worker->session);
+    if (worker->ops[OP_HISTORY] % 16 == 15) {
+      ai_clear_session_history(worker->context, worker->session);
+    }
+    break;
+  }
+  case OP_STREAM:
+  case OP_CANCEL: {
+    worker->stream_done = false;
+    ai_stream_id_t stream =
+        ai_generate_response_stream(worker->context, worker->session, "ping",
+                                    NULL, stream_callback, worker);
+    if (stream == AI_INVALID_ID) {
+      return false;
+    }
+    // A stream that already finished reports STREAM_NOT_FOUND; both races
+    // are part of the soak
+    if (op == OP_CANCEL) {
+      ai_cancel_stream(worker->context, stream);
+    }
+    if (!wait_for_stream(worker)) {
+      worker->stuck = true;
+      return false;
+    }
+    return true;
+  }
+  case OP_COUNT:
+    break;
+  }
+  if (!response) {
+    return false;
+  }
+  ai_free_string(response);
+  return true;
+}
+
+static void *worker_main(void *arg) {
+  worker_t *worker = arg;
+  for (uint64_t turn = 1; !atomic_load(&stop_requested); turn++) {
+    if (atomic_fetch_add(&turns_claimed, 1) >= options.turns) {
+      break;
+    }
+    op_t op = pick_op(worker);
+    if (!run_turn(worker, op)) {
+      worker->errors++;
+    }
+    worker->ops[op]++;
+    atomic_fetch_add(&turns_done, 1);
+
+    if (worker->stuck) {
+      fprintf(stderr, "ai-soak: worker %d: stream did not finish within %ds\n",
+              worker->index, STREAM_TIMEOUT_S);
+      atomic_store(&stop_requested, true);
+      break;
+    }
+    if (turn % (uint64_t)options.churn == 0 && !churn_sessions(worker)) {
+      fprintf(stderr, "ai-soak: worker %d: cannot recreate sessions\n",
+              worker->index);
+      worker->errors++;
+      atomic_store(&stop_requested, true);
+      break;
+    }
+  }
+  return NULL;
+}
+
+/* ---- Driver ------------------------------------------------------------ */
+
+static bool parse_mix(const char *list) {
+  for (int op = 0; op < OP_COUNT; op++) {
+    options.mix[op] = 0;
+  }
+  char *copy = strdup(list);
+  char *save = NULL;
+  for (char *item = strtok_r(copy, ",", &save); item;
+       item = strtok_r(NULL, ",", &save)) {
+    char *equals = strchr(item, '=');
+    if (equals) {
+      *equals = '\0';
+    }
+    int op = 0;
+    while (op < OP_COUNT && strcmp(item, op_names[op]) != 0) {
+      op++;
+    }
+    if (op == OP_COUNT) {
+      fprintf(stderr, "ai-soak: unknown operation '%s'\n", item);
+      free(copy);
+      return false;
+    }
+    options.mix[op] = equals ? atoi(equals + 1) : 1;
+  }
+  free(copy);
+
+  int total = 0;
+  for (int op = 0; op < OP_COUNT; op++) {
+    total += options.mix[op] > 0 ? options.mix[op] : 0;
+  }
+  if (total == 0) {
+    fprintf(stderr, "ai-soak: --mix needs at least one positive weight\n");
+    return false;
+  }
+  return true;
+}
+
+static void usage(FILE *out) {
+  fprintf(out,
+          "Usage: ai-soak [options]\n"
+          "  -n, --turns N              total turns (default 50000)\n"
+          "  -d, --duration SECONDS     stop early after this long\n"
+          "  -w, --workers N            worker threads (default 4)\n"
+          "  -m, --mix LIST             op=weight for sync, stream, "
+          "structured,\n"
+          "                             cancel, tool, history (default "
+          "30,25,10,15,10,10)\n"
+          "      --churn N              recreate sessions every N turns "
+          "(default 25)\n"
+          "      --context-churn N      recreate the context every N churns "
+          "(default 8)\n"
+          "  -s, --sample-ms N          sampling interval (default 500)\n"
+          "      --warmup F             share of turns excluded from the "
+          "slope (default 0.25)\n"
+          "      --max-rss-slope KIB    RSS growth limit per 1000 turns "
+          "(default 64)\n"
+          "      --max-heap-slope KIB   heap growth limit per 1000 turns "
+          "(default 8)\n"
+          "  -o, --samples FILE         write every sample as CSV\n"
+          "      --latency-us N         synthetic response latency\n"
+          "      --chunks N             synthetic chunks per stream "
+          "(default 16)\n"
+          "      --chunk-delay-us N     synthetic delay between chunks "
+          "(default 20)\n"
+          "  -q, --quiet                only print the summary\n");
+}
+
+enum {
+  OPT_CHURN = 256,
+  OPT_CONTEXT_CHURN,
+  OPT_WARMUP,
+  OPT_MAX_RSS_SLOPE,
+  OPT_MAX_HEAP_SLOPE,
+  OPT_LATENCY,
+  OPT_CHUNKS,
+  OPT_CHUNK_DELAY
+};
+
+static bool parse_options(int argc, char **argv) {
+  static const struct option long_options[] = {
+      {"turns", required_argument, NULL, 'n'},
+      {"duration", required_argument, NULL, 'd'},
+      {"workers", required_argument, NULL, 'w'},
+      {"mix", required_argument, NULL, 'm'},
+      {"churn", required_argument, NULL, OPT_CHURN},
+      {"context-churn", required_argument, NULL, OPT_CONTEXT_CHURN},
+      {"sample-ms", required_argument, NULL, 's'},
+      {"warmup", required_argument, NULL, OPT_WARMUP},
+      {"max-rss-slope", required_argument, NULL, OPT_MAX_RSS_SLOPE},
+      {"max-heap-slope", required_argument, NULL, OPT_MAX_HEAP_SLOPE},
+      {"samples", required_argument, NULL, 'o'},
+      {"latency-us", required_argument, NULL, OPT_LATENCY},
+      {"chunks", required_argument, NULL, OPT_CHUNKS},
+      {"chunk-delay-us", required_argument, NULL, OPT_CHUNK_DELAY},
+      {"quiet", no_argument, NULL, 'q'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "n:d:w:m:s:o:qh", long_options,
+                            NULL)) != -1) {
+    switch (opt) {
+    case 'n':
+      options.turns = strtoull(optarg, NULL, 10);
+      break;
+    case 'd':
+      options.duration_s = atof(optarg);
+      break;
+    case 'w':
+      options.workers = atoi(optarg);
+      break;
+    case 'm':
+      if (!parse_mix(optarg)) {
+        return false;
+      }
+      break;
+    case OPT_CHURN:
+      options.churn = atoi(optarg);
+      break;
+    case OPT_CONTEXT_CHURN:
+      options.context_churn = atoi(optarg);
+      break;
+    case 's':
+      options.sample_ms = atoi(optarg);
+      break;
+    case OPT_WARMUP:
+      options.warmup = atof(optarg);
+      break;
+    case OPT_MAX_RSS_SLOPE:
+      options.max_rss_slope_kib = atof(optarg);
+      break;
+    case OPT_MAX_HEAP_SLOPE:
+      options.max_heap_slope_kib = atof(optarg);
+      break;
+    case 'o':
+      options.samples_path = optarg;
+      break;
+    case OPT_LATENCY:
+      options.latency_us = atoi(optarg);
+      break;
+    case OPT_CHUNKS:
+      options.chunks = atoi(optarg);
+      break;
+    case OPT_CHUNK_DELAY:
+      options.chunk_delay_us = atoi(optarg);
+      break;
+    case 'q':
+      options.quiet = true;
+      break;
+    case 'h':
+      usage(stdout);
+      exit(0);
+    default:
+      usage(stderr);
+      return false;
+    }
+  }
+
+  if (options.turns < 1 || options.workers < 1 || options.churn < 1 ||
+      options.context_churn < 1 || options.sample_ms < 1 ||
+      options.warmup < 0 || options.warmup >= 1) {
+    fprintf(stderr, "ai-soak: turns, workers, churn and sample interval "
+                    "must be positive, warmup in [0, 1)\n");
+    return false;
+  }
+  return true;
+}
+
+/* The synthetic bridge reads its configuration once, on first use */
+static void configure_backend(void) {
+  char value[32];
+  snprintf(value, sizeof(value), "%d", options.latency_us);
+  setenv("AI_SYNTH_LATENCY_US", value, 1);
+  snprintf(value, sizeof(value), "%d", options.chunks);
+  setenv("AI_SYNTH_CHUNKS", value, 1);
+  snprintf(value, sizeof(value), "%d", options.chunk_delay_us);
+  setenv("AI_SYNTH_CHUNK_DELAY_US", value, 1);
+}
+
+static bool append_sample(sample_t **samples, size_t *count,
+                          size_t *capacity, sample_t sample) {
+  if (*count == *capacity) {
+    size_t grown = *capacity ? *capacity * 2 : 256;
+    sample_t *resized = realloc(*samples, grown * sizeof(**samples));
+    if (!resized) {
+      return false;
+    }
+    *samples = resized;
+    *capacity = grown;
+  }
+  (*samples)[(*count)++] = sample;
+  return true;
+}
+
+static bool write_samples(const sample_t *samples, size_t count) {
+  FILE *file = fopen(options.samples_path, "w");
+  if (!file) {
+    fprintf(stderr, "ai-soak: cannot write %s\n", options.samples_path);
+    return false;
+  }
+  fprintf(file, "elapsed_s,turns,rss_bytes,heap_bytes,fds,threads,"
+                "bridge_streams,streams_in_flight,sessions_active\n");
+  for (size_t i = 0; i < count; i++) {
+    const sample_t *s = &samples[i];
+    fprintf(file,
+            "%.3f,%" PRIu64 ",%" PRId64 ",%" PRId64 ",%d,%d,%d,%" PRId64
+            ",%" PRId64 "\n",
+            s->elapsed_s, s->turns, s->rss_bytes, s->heap_bytes, s->fds,
+            s->threads, s->bridge_streams, s->streams_in_flight,
+            s->sessions_active);
+  }
+  fclose(file);
+  return true;
+}
+
+/* Waits for detached stream threads to exit after the last terminal chunk */
+static sample_t settle(const sample_t *baseline, double started_s) {
+  sample_t sample = take_sample(started_s);
+  for (int waited = 0; waited < SETTLE_TIMEOUT_MS; waited += 10) {
+    if (sample.bridge_streams == 0 && sample.streams_in_flight == 0 &&
+        sample.threads <= baseline->threads) {
+      break;
+    }
+    usleep(10000);
+    sample = take_sample(started_s);
+  }
+  return sample;
+}
+
+int main(int argc, char **argv) {
+  if (!parse_options(argc, argv)) {
+    return 1;
+  }
+  configure_backend();
+  if (ai_init() != AI_SUCCESS) {
+    fprintf(stderr, "ai-soak: ai_init failed\n");
+    return 1;
+  }
+
+  worker_t *workers = calloc((size_t)options.workers, sizeof(*workers));
+  pthread_t *threads = calloc((size_t)options.workers, sizeof(*threads));
+  sample_t *samples = NULL;
+  size_t sample_count = 0, sample_capacity = 0;
+  if (!workers || !threads) {
+    fprintf(stderr, "ai-soak: out of memory\n");
+    return 1;
+  }
+
+  double started_s = monotonic_s();
+  sample_t baseline = take_sample(started_s);
+
+  int started = 0;
+  for (; started < options.workers; started++) {
+    worker_t *worker = &workers[started];
+    worker->index = started;
+    worker->rng[0] = (unsigned short)(0x5eed + started);
+    worker->rng[1] = (unsigned short)(started * 7919);
+    worker->rng[2] = 0x330e;
+    worker->context = ai_context_create();
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    if (!worker->context || !open_sessions(worker) ||
+        pthread_create(&threads[started], NULL, worker_main, worker) != 0) {
+      fprintf(stderr, "ai-soak: failed to start worker %d\n", started);
+      ai_context_free(worker->context);
+      atomic_store(&stop_requested, true);
+      break;
+    }
+  }
+
+  // Sample until every claimed turn is done
+  bool sampling_ok = true;
+  while (atomic_load(&turns_done) < options.turns &&
+         !atomic_load(&stop_requested)) {
+    usleep((useconds_t)options.sample_ms * 1000);
+    sample_t sample = take_sample(started_s);
+    sampling_ok &= append_sample(&samples, &sample_count, &sample_capacity,
+                                 sample);
+    if (!options.quiet) {
+      print_sample(&sample);
+    }
+    if (options.duration_s > 0 && sample.elapsed_s >= options.duration_s) {
+      atomic_store(&stop_requested, true);
+    }
+  }
+  for (int i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  uint64_t ops[OP_COUNT] = {0};
+  uint64_t errors = 0;
+  bool stuck = false;
+  for (int i = 0; i < started; i++) {
+    for (int op = 0; op < OP_COUNT; op++) {
+      ops[op] += workers[i].ops[op];
+    }
+    errors += workers[i].errors;
+    stuck |= workers[i].stuck;
+    // A stuck stream may still call back into its context
+    if (!workers[i].stuck) {
+      ai_context_free(workers[i].context);
+      pthread_mutex_destroy(&workers[i].mutex);
+      pthread_cond_destroy(&workers[i].cond);
+    }
+  }
+
+  sample_t final = settle(&baseline, started_s);
+  sampling_ok &=
+      append_sample(&samples, &sample_count, &sample_capacity, final);
+  if (options.samples_path && !write_samples(samples, sample_count)) {
+    sampling_ok = false;
+  }
+
+  uint64_t from_turn = (uint64_t)((double)final.turns * options.warmup);
+  double rss_slope = growth_slope(samples, sample_count, from_turn, false);
+  double heap_slope = growth_slope(samples, sample_count, from_turn, true);
+
+  printf("\n%" PRIu64 " turns in %.1fs, %" PRIu64 " errors\n", final.turns,
+         final.elapsed_s, errors);
+  for (int op = 0; op < OP_COUNT; op++) {
+    printf("  %-10s %" PRIu64 "\n", op_names[op], ops[op]);
+  }
+  printf("rss slope   %8.2f KiB/1k turns (limit %.2f)\n", rss_slope,
+         options.max_rss_slope_kib);
+  printf("heap slope  %8.2f KiB/1k turns (limit %.2f)\n", heap_slope,
+         options.max_heap_slope_kib);
+  printf("left over   streams %d/%" PRId64 ", sessions %" PRId64
+         ", fds %+d, threads %+d\n",
+         final.bridge_streams, final.streams_in_flight, final.sessions_active,
+         final.fds - baseline.fds, final.threads - baseline.threads);
+
+  int failures = 0;
+  if (started < options.workers || stuck || !sampling_ok) {
+    printf("FAIL run did not complete cleanly\n");
+    failures++;
+  }
+  if (sample_count < 4) {
+    printf("FAIL too few samples for a slope; lower --sample-ms or raise "
+           "--turns\n");
+    failures++;
+  }
+  if (rss_slope > options.max_rss_slope_kib) {
+    printf("FAIL rss grows %.2f KiB per 1000 turns\n", rss_slope);
+    failures++;
+  }
+  if (heap_slope > options.max_heap_slope_kib) {
+    printf("FAIL heap grows %.2f KiB per 1000 turns\n", heap_slope);
+    failures++;
+  }
+  if (final.bridge_streams != 0 || final.streams_in_flight != 0) {
+    printf("FAIL %d bridge streams and %" PRId64
+           " libai streams never finished\n",
+           final.bridge_streams, final.streams_in_flight);
+    failures++;
+  }
+  if (final.sessions_active != 0) {
+    printf("FAIL %" PRId64 " sessions still active\n", final.sessions_active);
+    failures++;
+  }
+  if (final.fds > baseline.fds || final.threads > baseline.threads) {
+    printf("FAIL %d descriptors and %d threads leaked\n",
+           final.fds - baseline.fds, final.threads - baseline.threads);
+    failures++;
+  }
+  if (failures == 0) {
+    printf("PASS\n");
+  }
+
+  free(samples);
+  free(workers);
+  free(threads);
+  ai_cleanup();
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,740 @@
+/*
+ * Synthetic implementation of ai_bridge.h for benchmarks.
+ *
+ * Answers instantly (or after a configurable delay) without a model so that
+ * binding and transport overhead can be measured on any machine. Behaviour is
+ * controlled through the environment:
+ *
+ *   AI_SYNTH_CHUNKS          chunks per streamed response (default 256)
+ *   AI_SYNTH_CHUNK_TEXT      text of each chunk (default "token ")
+ *   AI_SYNTH_CHUNK_DELAY_US  delay between chunks (default 0)
+ *   AI_SYNTH_LATENCY_US      delay before any response (default 0)
+ *
+ * A session with a registered tool answers generate requests by calling that
+ * tool once with {"prompt": <prompt>} and returning its result. Queued tools
+ * take precedence over callback tools.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../ai_bridge.h"
+
+#define MAX_STREAMS 4096 /* slots; IDs are mapped onto them modulo */
+#define MAX_SESSIONS 256
+#define MAX_TOOL_NAME 64
+
+typedef struct {
+  int chunks;
+  const char *chunk_text;
+  useconds_t chunk_delay_us;
+  useconds_t latency_us;
+} synth_config_t;
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  ai_bridge_stream_id_t stream_id;
+  bool in_use;
+  bool finished;
+  bool cancelled;
+  unsigned generation;
+  char *pending;
+  size_t pending_length;
+  size_t pending_capacity;
+  int notify_fd;
+} buffered_stream_t;
+
+typedef struct {
+  ai_bridge_stream_id_t stream_id;
+  unsigned generation;
+  bool structured;
+  void *context;
+  ai_bridge_stream_callback_t callback;
+  void *user_data;
+} stream_job_t;
+
+typedef struct tool_call {
+  uint64_t call_id;
+  ai_bridge_session_id_t session_id;
+  char *tool_name;
+  char *arguments_json;
+  char *result;
+  bool taken;
+  bool done;
+  bool is_error;
+  struct tool_call *next;
+} tool_call_t;
+
+static synth_config_t config;
+static pthread_once_t config_once = PTHREAD_ONCE_INIT;
+static _Atomic(unsigned) next_session_id = 1;
+static _Atomic(unsigned) next_stream_id = 1;
+static _Atomic(bool) cancelled[MAX_STREAMS];
+static buffered_stream_t buffered[MAX_STREAMS];
+static pthread_mutex_t buffered_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+  ai_bridge_tool_callback_t callback;
+  void *user_data;
+} callback_tool_t;
+
+static _Atomic(int) active_callback_streams;
+
+static char queued_tools[MAX_SESSIONS][MAX_TOOL_NAME];
+static callback_tool_t callback_tools[MAX_SESSIONS];
+static tool_call_t *tool_calls;
+static uint64_t next_call_id = 1;
+static pthread_mutex_t tool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tool_cond = PTHREAD_COND_INITIALIZER;
+
+static void deadline_after(struct timespec *deadline, int32_t timeout_ms) {
+  clock_gettime(CLOCK_REALTIME, deadline);
+  deadline->tv_sec += timeout_ms / 1000;
+  deadline->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+  if (deadline->tv_nsec >= 1000000000L) {
+    deadline->tv_sec++;
+    deadline->tv_nsec -= 1000000000L;
+  }
+}
+
+static int env_int(const char *name, int fallback) {
+  const char *value = getenv(name);
+  return value && *value ? atoi(value) : fallback;
+}
+
+static void load_config(void) {
+  config.chunks = env_int("AI_SYNTH_CHUNKS", 256);
+  config.chunk_text = getenv("AI_SYNTH_CHUNK_TEXT");
+  if (!config.chunk_text || !*config.chunk_text) {
+    config.chunk_text = "token ";
+  }
+  config.chunk_delay_us = (useconds_t)env_int("AI_SYNTH_CHUNK_DELAY_US", 0);
+  config.latency_us = (useconds_t)env_int("AI_SYNTH_LATENCY_US", 0);
+
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    pthread_mutex_init(&buffered[i].mutex, NULL);
+    pthread_cond_init(&buffered[i].cond, NULL);
+    buffered[i].notify_fd = -1;
+  }
+}
+
+static const synth_config_t *get_config(void) {
+  pthread_once(&config_once, load_config);
+  return &config;
+}
+
+static ai_bridge_stream_id_t allocate_stream_id(void) {
+  unsigned id;
+  do {
+    id = atomic_fetch_add(&next_stream_id, 1);
+  } while (id == AI_BRIDGE_INVALID_ID);
+  atomic_store(&cancelled[id % MAX_STREAMS], false);
+  return (ai_bridge_stream_id_t)id;
+}
+
+/* Slot of an open buffered stream, locked; NULL if the ID is not open */
+static buffered_stream_t *buffered_lock(ai_bridge_stream_id_t stream_id) {
+  buffered_stream_t *stream = &buffered[stream_id % MAX_STREAMS];
+  pthread_mutex_lock(&stream->mutex);
+  if (!stream->in_use || stream->stream_id != stream_id) {
+    pthread_mutex_unlock(&stream->mutex);
+    return NULL;
+  }
+  return stream;
+}
+
+static const char *structured_response(void) {
+  return "{\"text\":\"synthetic\",\"object\":{\"value\":\"synthetic\"}}";
+}
+
+bool ai_bridge_init(void) {
+  get_config();
+  return true;
+}
+
+ai_availability_status_t ai_bridge_check_availability(void) {
+  return AI_BRIDGE_AVAILABLE;
+}
+
+char *ai_bridge_get_availability_reason(void) {
+  return strdup("Synthetic bridge is always available");
+}
+
+bool ai_bridge_observe_availability(ai_bridge_availability_observer_t observer,
+                                    void *user_data) {
+  (void)observer;
+  (void)user_data;
+  return false;
+}
+
+int32_t ai_bridge_get_supported_languages_count(void) { return 1; }
+
+char *ai_bridge_get_supported_language(int32_t index) {
+  return index == 0 ? strdup("English") : NULL;
+}
+
+char *ai_bridge_get_supported_languages(void) {
+  return strdup("en-Latn-US\tEnglish\n");
+}
+
+ai_bridge_session_id_t ai_bridge_create_session(
+    const char *instructions, const char *tools_json, bool enable_guardrails,
+    bool enable_history, bool enable_structured_responses,
+    const char *default_schema_json, bool prewarm) {
+  return ai_bridge_create_session_with_use_case(
+      instructions, tools_json, enable_guardrails, enable_history,
+      enable_structured_responses, default_schema_json, prewarm,
+      AI_BRIDGE_USE_CASE_GENERAL);
+}
+
+ai_bridge_session_id_t ai_bridge_create_session_with_use_case(
+    const char *instructions, const char *tools_json, bool enable_guardrails,
+    bool enable_history, bool enable_structured_responses,
+    const char *default_schema_json, bool prewarm, int32_t use_case) {
+  (void)instructions;
+  (void)tools_json;
+  (void)enable_guardrails;
+  (void)enable_history;
+  (void)enable_structured_responses;
+  (void)default_schema_json;
+  (void)prewarm;
+  if (use_case != AI_BRIDGE_USE_CASE_GENERAL &&
+      use_case != AI_BRIDGE_USE_CASE_CONTENT_TAGGING) {
+    return AI_BRIDGE_INVALID_ID;
+  }
+  unsigned id;
+  do {
+    id = atomic_fetch_add(&next_session_id, 1) & 0xFF;
+  } while (id == AI_BRIDGE_INVALID_ID);
+  return (ai_bridge_session_id_t)id;
+}
+
+bool ai_bridge_register_tool(ai_bridge_session_id_t session_id,
+                             const char *tool_name,
+                             ai_bridge_tool_callback_t callback,
+                             void *user_data) {
+  (void)tool_name;
+  pthread_mutex_lock(&tool_mutex);
+  callback_tools[session_id] =
+      (callback_tool_t){.callback = callback, .user_data = user_data};
+  pthread_mutex_unlock(&tool_mutex);
+  return true;
+}
+
+void ai_bridge_destroy_session(ai_bridge_session_id_t session_id) {
+  pthread_mutex_lock(&tool_mutex);
+  queued_tools[session_id][0] = '\0';
+  callback_tools[session_id] = (callback_tool_t){0};
+  pthread_mutex_unlock(&tool_mutex);
+}
+
+bool ai_bridge_register_queued_tool(ai_bridge_session_id_t session_id,
+                                    const char *tool_name) {
+  pthread_mutex_lock(&tool_mutex);
+  snprintf(queued_tools[session_id], MAX_TOOL_NAME, "%s", tool_name);
+  pthread_mutex_unlock(&tool_mutex);
+  return true;
+}
+
+/* Benchmark prompts are plain text; no JSON escaping is attempted. */
+static char *tool_arguments(const char *prompt) {
+  size_t length = strlen(prompt) + 16;
+  char *arguments = malloc(length);
+  if (arguments) {
+    snprintf(arguments, length, "{\"prompt\":\"%s\"}", prompt);
+  }
+  return arguments;
+}
+
+/* Calls the session's callback tool; NULL if none is registered. */
+static char *call_callback_tool(ai_bridge_session_id_t session_id,
+                                const char *prompt) {
+  pthread_mutex_lock(&tool_mutex);
+  callback_tool_t tool = callback_tools[session_id];
+  pthread_mutex_unlock(&tool_mutex);
+  if (!tool.callback) {
+    return NULL;
+  }
+
+  char *arguments = tool_arguments(prompt);
+  if (!arguments) {
+    return NULL;
+  }
+  char *result = tool.callback(arguments, tool.user_data);
+  free(arguments);
+  return result ? result : strdup("Error: tool failed");
+}
+
+/* Runs one queued tool call and waits for its result; NULL if none set. */
+static char *call_queued_tool(ai_bridge_session_id_t session_id,
+                              const char *prompt) {
+  pthread_mutex_lock(&tool_mutex);
+  if (!queued_tools[session_id][0]) {
+    pthread_mutex_unlock(&tool_mutex);
+    return call_callback_tool(session_id, prompt);
+  }
+
+  tool_call_t call = {
+      .call_id = next_call_id++,
+      .session_id = session_id,
+      .tool_name = queued_tools[session_id],
+  };
+  call.arguments_json = tool_arguments(prompt);
+  if (!call.arguments_json) {
+    pthread_mutex_unlock(&tool_mutex);
+    return NULL;
+  }
+
+  tool_call_t **tail = &tool_calls;
+  while (*tail) {
+    tail = &(*tail)->next;
+  }
+  *tail = &call;
+  pthread_cond_broadcast(&tool_cond);
+
+  while (!call.done) {
+    pthread_cond_wait(&tool_cond, &tool_mutex);
+  }
+
+  for (tail = &tool_calls; *tail; tail = &(*tail)->next) {
+    if (*tail == &call) {
+      *tail = call.next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&tool_mutex);
+
+  free(call.arguments_json);
+  if (call.is_error) {
+    size_t size = strlen(call.result) + 8;
+    char *message = malloc(size);
+    if (message) {
+      snprintf(message, size, "Error: %s", call.result);
+    }
+    free(call.result);
+    return message;
+  }
+  return call.result;
+}
+
+bool ai_bridge_tool_queue_next(int32_t timeout_ms, uint64_t *call_id,
+                               ai_bridge_session_id_t *session_id,
+                               char **tool_name, char **arguments_json) {
+  struct timespec deadline;
+  deadline_after(&deadline, timeout_ms < 0 ? 0 : timeout_ms);
+
+  pthread_mutex_lock(&tool_mutex);
+  for (;;) {
+    for (tool_call_t *call = tool_calls; call; call = call->next) {
+      if (!call->taken) {
+        call->taken = true;
+        *call_id = call->call_id;
+        *session_id = call->session_id;
+        *tool_name = strdup(call->tool_name);
+        *arguments_json = strdup(call->arguments_json);
+        pthread_mutex_unlock(&tool_mutex);
+        return true;
+      }
+    }
+    int rc = timeout_ms < 0
+                 ? pthread_cond_wait(&tool_cond, &tool_mutex)
+                 : pthread_cond_timedwait(&tool_cond, &tool_mutex, &deadline);
+    if (rc == ETIMEDOUT) {
+      pthread_mutex_unlock(&tool_mutex);
+      return false;
+    }
+  }
+}
+
+bool ai_bridge_tool_call_complete(uint64_t call_id, const char *result,
+                                  bool is_error) {
+  pthread_mutex_lock(&tool_mutex);
+  for (tool_call_t *call = tool_calls; call; call = call->next) {
+    if (call->call_id == call_id && !call->done) {
+      call->result = strdup(result);
+      call->is_error = is_error;
+      call->done = true;
+      pthread_cond_broadcast(&tool_cond);
+      pthread_mutex_unlock(&tool_mutex);
+      return true;
+    }
+  }
+  pthread_mutex_unlock(&tool_mutex);
+  return false;
+}
+
+char *ai_bridge_generate_response(ai_bridge_session_id_t session_id,
+                                  const char *prompt, double temperature,
+                                  int32_t max_tokens) {
+  (void)temperature;
+  (void)max_tokens;
+  const synth_config_t *cfg = get_config();
+  if (cfg->latency_us) {
+    usleep(cfg->latency_us);
+  }
+  char *tool_result = call_queued_tool(session_id, prompt);
+  return tool_result ? tool_result : strdup(prompt);
+}
+
+char *ai_bridge_generate_structured_response(ai_bridge_session_id_t session_id,
+                                             const char *prompt,
+                                             const char *schema_json,
+                                             double temperature,
+                                             int32_t max_tokens) {
+  (void)session_id;
+  (void)prompt;
+  (void)schema_json;
+  (void)temperature;
+  (void)max_tokens;
+  const synth_config_t *cfg = get_config();
+  if (cfg->latency_us) {
+    usleep(cfg->latency_us);
+  }
+  return strdup(structured_response());
+}
+
+// Like the Swift bridge, keeps "Error:" at the start of a chunk for errors
+static void emit_text(const stream_job_t *job, const char *text) {
+  if (strncmp(text, "Error:", 6) == 0) {
+    job->callback(job->context, "E", job->user_data);
+    text++;
+  }
+  job->callback(job->context, text, job->user_data);
+}
+
+static void *callback_stream_thread(void *arg) {
+  stream_job_t *job = arg;
+  const synth_config_t *cfg = get_config();
+
+  if (cfg->latency_us) {
+    usleep(cfg->latency_us);
+  }
+
+  if (job->structured) {
+    job->callback(job->context, structured_response(), job->user_data);
+  } else {
+    for (int i = 0; i < cfg->chunks; i++) {
+      if (atomic_load(&cancelled[job->stream_id % MAX_STREAMS])) {
+        job->callback(job->context, "Error: cancelled", job->user_data);
+        break;
+      }
+      emit_text(job, cfg->chunk_text);
+      if (cfg->chunk_delay_us) {
+        usleep(cfg->chunk_delay_us);
+      }
+    }
+  }
+
+  job->callback(job->context, NULL, job->user_data);
+  free(job);
+  atomic_fetch_sub(&active_callback_streams, 1);
+  return NULL;
+}
+
+static ai_bridge_stream_id_t start_callback_stream(
+    bool structured, void *context, ai_bridge_stream_callback_t callback,
+    void *user_data) {
+  stream_job_t *job = malloc(sizeof(*job));
+  if (!job) {
+    return AI_BRIDGE_INVALID_ID;
+  }
+  job->stream_id = allocate_stream_id();
+  job->structured = structured;
+  job->context = context;
+  job->callback = callback;
+  job->user_data = user_data;
+
+  ai_bridge_stream_id_t stream_id = job->stream_id;
+  atomic_fetch_add(&active_callback_streams, 1);
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, callback_stream_thread, job) != 0) {
+    free(job);
+    atomic_fetch_sub(&active_callback_streams, 1);
+    return AI_BRIDGE_INVALID_ID;
+  }
+  pthread_detach(thread);
+  return stream_id;
+}
+
+ai_bridge_stream_id_t ai_bridge_generate_response_stream(
+    ai_bridge_session_id_t session_id, const char *prompt, double temperature,
+    int32_t max_tokens, void *context, ai_bridge_stream_callback_t callback,
+    void *user_data) {
+  (void)session_id;
+  (void)prompt;
+  (void)temperature;
+  (void)max_tokens;
+  return start_callback_stream(false, context, callback, user_data);
+}
+
+ai_bridge_stream_id_t ai_bridge_generate_structured_response_stream(
+    ai_bridge_session_id_t session_id, const char *prompt,
+    const char *schema_json, double temperature, int32_t max_tokens,
+    void *context, ai_bridge_stream_callback_t callback, void *user_data) {
+  (void)session_id;
+  (void)prompt;
+  (void)schema_json;
+  (void)temperature;
+  (void)max_tokens;
+  return start_callback_stream(true, context, callback, user_data);
+}
+
+bool ai_bridge_cancel_stream(ai_bridge_stream_id_t stream_id) {
+  atomic_store(&cancelled[stream_id % MAX_STREAMS], true);
+  return true;
+}
+
+static void buffered_notify_locked(buffered_stream_t *stream) {
+  if (stream->notify_fd >= 0) {
+    ssize_t written = write(stream->notify_fd, &stream->stream_id,
+                            sizeof(stream->stream_id));
+    (void)written;
+  }
+}
+
+/* Appends to a buffered stream; returns false once it has been closed. */
+static bool buffered_append(ai_bridge_stream_id_t stream_id,
+                            unsigned generation, const char *text,
+                            bool finish) {
+  buffered_stream_t *stream = &buffered[stream_id % MAX_STREAMS];
+  size_t length = text ? strlen(text) : 0;
+
+  pthread_mutex_lock(&stream->mutex);
+  if (stream->cancelled || stream->generation != generation) {
+    pthread_mutex_unlock(&stream->mutex);
+    return false;
+  }
+
+  bool was_empty = stream->pending_length == 0;
+  if (stream->pending_length + length > stream->pending_capacity) {
+    size_t capacity =
+        stream->pending_capacity ? stream->pending_capacity : 4096;
+    while (capacity < stream->pending_length + length) {
+      capacity *= 2;
+    }
+    char *grown = realloc(stream->pending, capacity);
+    if (!grown) {
+      pthread_mutex_unlock(&stream->mutex);
+      return false;
+    }
+    stream->pending = grown;
+    stream->pending_capacity = capacity;
+  }
+  memcpy(stream->pending + stream->pending_length, text, length);
+  stream->pending_length += length;
+
+  if (finish) {
+    stream->finished = true;
+  }
+  if ((was_empty && length) || finish) {
+    buffered_notify_locked(stream);
+  }
+  pthread_cond_broadcast(&stream->cond);
+  pthread_mutex_unlock(&stream->mutex);
+  return true;
+}
+
+static void *buffered_stream_thread(void *arg) {
+  stream_job_t *job = arg;
+  ai_bridge_stream_id_t stream_id = job->stream_id;
+  unsigned generation = job->generation;
+  bool structured = job->structured;
+  free(job);
+
+  const synth_config_t *cfg = get_config();
+  if (cfg->latency_us) {
+    usleep(cfg->latency_us);
+  }
+
+  if (structured) {
+    buffered_append(stream_id, generation, structured_response(), true);
+    return NULL;
+  }
+
+  for (int i = 0; i < cfg->chunks; i++) {
+    if (!buffered_append(stream_id, generation, cfg->chunk_text, false)) {
+      return NULL;
+    }
+    if (cfg->chunk_delay_us) {
+      usleep(cfg->chunk_delay_us);
+    }
+  }
+  buffered_append(stream_id, generation, "", true);
+  return NULL;
+}
+
+ai_bridge_stream_id_t ai_bridge_stream_open(ai_bridge_session_id_t session_id,
+                                            const char *prompt,
+                                            const char *schema_json,
+                                            double temperature,
+                                            int32_t max_tokens) {
+  (void)session_id;
+  (void)prompt;
+  (void)temperature;
+  (void)max_tokens;
+  get_config();
+
+  stream_job_t *job = malloc(sizeof(*job));
+  if (!job) {
+    return AI_BRIDGE_INVALID_ID;
+  }
+
+  pthread_mutex_lock(&buffered_mutex);
+  ai_bridge_stream_id_t stream_id = AI_BRIDGE_INVALID_ID;
+  unsigned generation = 0;
+  for (int attempt = 0; attempt < MAX_STREAMS; attempt++) {
+    ai_bridge_stream_id_t candidate = allocate_stream_id();
+    buffered_stream_t *stream = &buffered[candidate % MAX_STREAMS];
+    pthread_mutex_lock(&stream->mutex);
+    if (!stream->in_use) {
+      stream->stream_id = candidate;
+      stream->in_use = true;
+      stream->finished = false;
+      stream->cancelled = false;
+      stream->pending_length = 0;
+      stream->notify_fd = -1;
+      generation = ++stream->generation;
+      stream_id = candidate;
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    if (stream_id != AI_BRIDGE_INVALID_ID) {
+      break;
+    }
+  }
+  pthread_mutex_unlock(&buffered_mutex);
+
+  if (stream_id == AI_BRIDGE_INVALID_ID) {
+    free(job);
+    return AI_BRIDGE_INVALID_ID;
+  }
+
+  job->stream_id = stream_id;
+  job->generation = generation;
+  job->structured = schema_json != NULL;
+
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, buffered_stream_thread, job) != 0) {
+    free(job);
+    ai_bridge_stream_close(stream_id);
+    return AI_BRIDGE_INVALID_ID;
+  }
+  pthread_detach(thread);
+  return stream_id;
+}
+
+int32_t ai_bridge_stream_read(ai_bridge_stream_id_t stream_id, char *buffer,
+                              int32_t capacity, int32_t timeout_ms,
+                              int32_t *status) {
+  buffered_stream_t *stream = buffered_lock(stream_id);
+  int32_t result_status = AI_BRIDGE_STREAM_OPEN;
+  int32_t count = 0;
+
+  if (!stream || stream->cancelled || capacity <= 0) {
+    if (stream) {
+      pthread_mutex_unlock(&stream->mutex);
+    }
+    if (status) {
+      *status = AI_BRIDGE_STREAM_UNKNOWN;
+    }
+    return 0;
+  }
+
+  if (stream->pending_length == 0 && !stream->finished && timeout_ms != 0) {
+    struct timespec deadline;
+    deadline_after(&deadline, timeout_ms < 0 ? 0 : timeout_ms);
+    while (stream->pending_length == 0 && !stream->finished &&
+           !stream->cancelled) {
+      int rc = timeout_ms < 0
+                   ? pthread_cond_wait(&stream->cond, &stream->mutex)
+                   : pthread_cond_timedwait(&stream->cond, &stream->mutex,
+                                            &deadline);
+      if (rc == ETIMEDOUT) {
+        break;
+      }
+    }
+  }
+
+  size_t available = stream->pending_length;
+  count = available < (size_t)capacity ? (int32_t)available : capacity;
+  if (count > 0) {
+    memcpy(buffer, stream->pending, (size_t)count);
+    memmove(stream->pending, stream->pending + count, available - count);
+    stream->pending_length -= (size_t)count;
+  }
+  if (stream->pending_length == 0 && stream->finished) {
+    result_status = AI_BRIDGE_STREAM_FINISHED;
+  }
+  pthread_mutex_unlock(&stream->mutex);
+
+  if (status) {
+    *status = result_status;
+  }
+  return count;
+}
+
+bool ai_bridge_stream_set_notify_fd(ai_bridge_stream_id_t stream_id, int fd) {
+  buffered_stream_t *stream = buffered_lock(stream_id);
+  if (!stream) {
+    return false;
+  }
+  bool found = !stream->cancelled;
+  if (found) {
+    stream->notify_fd = fd;
+    if (stream->pending_length || stream->finished) {
+      buffered_notify_locked(stream);
+    }
+  }
+  pthread_mutex_unlock(&stream->mutex);
+  return found;
+}
+
+bool ai_bridge_stream_close(ai_bridge_stream_id_t stream_id) {
+  buffered_stream_t *stream = buffered_lock(stream_id);
+  if (!stream) {
+    return false;
+  }
+  stream->in_use = false;
+  stream->cancelled = true;
+  stream->notify_fd = -1;
+  pthread_cond_broadcast(&stream->cond);
+  pthread_mutex_unlock(&stream->mutex);
+  return true;
+}
+
+int32_t ai_bridge_get_active_stream_count(void) {
+  get_config();
+  int32_t count = atomic_load(&active_callback_streams);
+  for (int i = 0; i < MAX_STREAMS; i++) {
+    pthread_mutex_lock(&buffered[i].mutex);
+    count += buffered[i].in_use;
+    pthread_mutex_unlock(&buffered[i].mutex);
+  }
+  return count;
+}
+
+char *ai_bridge_get_session_history(ai_bridge_session_id_t session_id) {
+  (void)session_id;
+  return strdup("[]");
+}
+
+bool ai_bridge_clear_session_history(ai_bridge_session_id_t session_id) {
+  (void)session_id;
+  return true;
+}
+
+bool ai_bridge_add_message_to_history(ai_bridge_session_id_t session_id,
+                                      const char *role, const char *content) {
+  (void)session_id;
+  (void)role;
+  (void)content;
+  return true;
+}
+
+void ai_bridge_free_string(char *ptr) { free(ptr); }
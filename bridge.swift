@@ -1,5 +1,6 @@
 import Foundation
 import FoundationModels
+import Observation
 
 // MARK: - Error Codes
 
@@ -44,6 +45,7 @@ private class SessionInfo {
     let bridgeSession: LanguageModelSession
     let config: SessionConfig
     var toolCallbacks: [String: ToolCallback]
+    var queuedTools: Set<String> = []
 
     struct ToolCallback {
         let callback:
@@ -87,9 +89,10 @@ private class SessionInfo {
 private class SessionManager {
     static let shared = SessionManager()
     private var sessions: [UInt8: SessionInfo] = [:]
-    private var streams: [UInt8: Task<Void, Never>] = [:]
+    private var streams: [UInt32: Task<Void, Never>] = [:]
+    private var bufferedStreams: [UInt32: BufferedStream] = [:]
     private var nextSessionId: UInt8 = 1
-    private var nextStreamId: UInt8 = 1
+    private var nextStreamId: UInt32 = 1
     private let lock = NSLock()
 
     private init() {}
@@ -177,6 +180,33 @@ private class SessionManager {
         }
     }
 
+    /// Routes calls to the specified tool through the tool call queue.
+    ///
+    /// - Parameters:
+    ///   - sessionId: The session identifier.
+    ///   - toolName: The name of the tool.
+    /// - Returns: `true` if the session exists, `false` otherwise.
+    func registerQueuedTool(sessionId: UInt8, toolName: String) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let sessionInfo = sessions[sessionId] else { return false }
+        sessionInfo.queuedTools.insert(toolName)
+        return true
+    }
+
+    /// Reports whether calls to the specified tool go through the tool call queue.
+    ///
+    /// - Parameters:
+    ///   - sessionId: The session identifier.
+    ///   - toolName: The name of the tool.
+    /// - Returns: `true` if the tool was registered with `registerQueuedTool`.
+    func isQueuedTool(sessionId: UInt8, toolName: String) -> Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return sessions[sessionId]?.queuedTools.contains(toolName) ?? false
+    }
+
     /// Retrieves the tool callback for the specified session and tool.
     ///
     /// - Parameters:
@@ -194,33 +224,61 @@ private class SessionManager {
     /// - Parameter sessionId: The session identifier to destroy.
     func destroySession(_ sessionId: UInt8) {
         lock.lock()
-        defer { lock.unlock() }
         sessions.removeValue(forKey: sessionId)
+        lock.unlock()
+
+        ToolCallQueue.shared.failCalls(sessionId: sessionId)
     }
 
     /// Creates a new stream task and returns its identifier.
     ///
-    /// - Parameter task: The async task to manage.
-    /// - Returns: Unique stream identifier.
-    func createStream(_ task: Task<Void, Never>) -> UInt8 {
+    /// The task is built while the identifier is reserved so that it can remove
+    /// itself with `removeStream` when it finishes. Zero and identifiers still
+    /// held by a running or open stream of either kind are skipped.
+    ///
+    /// - Parameter makeTask: Builds the task for the reserved identifier.
+    /// - Returns: Unique stream identifier, or 0 if every identifier is in use.
+    func createStream(_ makeTask: (UInt32) -> Task<Void, Never>) -> UInt32 {
         lock.lock()
         defer { lock.unlock() }
 
-        let streamId = nextStreamId
-        nextStreamId = nextStreamId &+ 1
-        streams[streamId] = task
+        guard let streamId = freeStreamIdLocked() else { return 0 }
+        streams[streamId] = makeTask(streamId)
         return streamId
     }
 
+    /// Takes the next identifier held by neither a callback nor a buffered stream.
+    ///
+    /// Both kinds of stream share one identifier space, so a buffered stream's
+    /// notification token never names a running callback stream. Must be called with
+    /// `lock` held.
+    ///
+    /// - Returns: A free identifier, or `nil` if every identifier is in use.
+    private func freeStreamIdLocked() -> UInt32? {
+        // Of this many consecutive candidates at most `count` are taken and one is 0
+        let candidates = streams.count + bufferedStreams.count + 2
+        for _ in 0..<candidates {
+            let streamId = nextStreamId
+            nextStreamId = nextStreamId &+ 1
+            if streamId != 0 && streams[streamId] == nil && bufferedStreams[streamId] == nil {
+                return streamId
+            }
+        }
+        return nil
+    }
+
     /// Cancels the specified stream.
     ///
+    /// The entry stays registered until the task finishes, so its identifier is
+    /// not handed out again while the task is still delivering its final chunk.
+    ///
     /// - Parameter streamId: The stream identifier to cancel.
     /// - Returns: `true` if the stream was found and cancelled, `false` otherwise.
-    func cancelStream(_ streamId: UInt8) -> Bool {
+    func cancelStream(_ streamId: UInt32) -> Bool {
         lock.lock()
         defer { lock.unlock() }
 
-        if let task = streams.removeValue(forKey: streamId) {
+        if let task = streams[streamId] {
             task.cancel()
             return true
         }
@@ -229,12 +287,205 @@ private class SessionManager {
 
     /// Removes the specified stream from management.
     ///
+    /// Called by each stream task once it has delivered its final chunk.
+    ///
     /// - Parameter streamId: The stream identifier to remove.
-    func removeStream(_ streamId: UInt8) {
+    func removeStream(_ streamId: UInt32) {
         lock.lock()
         defer { lock.unlock() }
         streams.removeValue(forKey: streamId)
     }
+
+    /// Number of callback streams still running plus buffered streams not yet closed.
+    var activeStreamCount: Int {
+        lock.lock()
+        defer { lock.unlock() }
+        return streams.count + bufferedStreams.count
+    }
+
+    /// Registers a buffered stream and returns its identifier.
+    ///
+    /// Buffered streams share the identifier space with callback streams. Zero and
+    /// identifiers still held by a running or open stream of either kind are skipped.
+    ///
+    /// - Parameter stream: The buffered stream to manage.
+    /// - Returns: Unique stream identifier, or 0 if every identifier is in use.
+    func createBufferedStream(_ stream: BufferedStream) -> UInt32 {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let streamId = freeStreamIdLocked() else { return 0 }
+        bufferedStreams[streamId] = stream
+        return streamId
+    }
+
+    /// Retrieves the buffered stream with the given identifier.
+    ///
+    /// - Parameter streamId: The stream identifier.
+    /// - Returns: The buffered stream, or `nil` if it doesn't exist.
+    func getBufferedStream(_ streamId: UInt32) -> BufferedStream? {
+        lock.lock()
+        defer { lock.unlock() }
+        return bufferedStreams[streamId]
+    }
+
+    /// Removes the buffered stream with the given identifier from management.
+    ///
+    /// - Parameter streamId: The stream identifier to remove.
+    /// - Returns: The removed stream, or `nil` if it doesn't exist.
+    func removeBufferedStream(_ streamId: UInt32) -> BufferedStream? {
+        lock.lock()
+        defer { lock.unlock() }
+        return bufferedStreams.removeValue(forKey: streamId)
+    }
+}
+
+// MARK: - Buffered Streams
+
+/// Accumulates stream output until the consumer pulls it.
+///
+/// The generation task appends UTF-8 bytes as they arrive and the reader drains
+/// everything that is pending in one call, so a consumer crossing a language boundary
+/// (e.g. Python holding the GIL) pays that cost once per batch rather than once per
+/// chunk. Event-loop consumers can instead attach a notification descriptor and read
+/// with a zero timeout when it becomes readable.
+@available(macOS 26.0, *)
+private final class BufferedStream {
+    /// Outcome of a read, as reported to C callers.
+    enum ReadStatus: Int32 {
+        case open = 0
+        case finished = 1
+        case failed = 2
+    }
+
+    private let condition = NSCondition()
+    private var pending = Data()
+    private var finished = false
+    private var errorMessage: String?
+    private var task: Task<Void, Never>?
+    private var notifyFd: Int32 = -1
+    private var notifyToken: UInt32 = 0
+
+    /// Attaches the generation task so that `cancel()` can stop it.
+    func attach(_ task: Task<Void, Never>) {
+        condition.lock()
+        self.task = task
+        condition.unlock()
+    }
+
+    /// Writes `token` to `fd` whenever the stream becomes readable.
+    ///
+    /// Only the transition from empty to non-empty is signalled, plus completion, so a
+    /// consumer that drains the stream on each notification sees at most one pending
+    /// token per stream. If output is already waiting the descriptor is signalled
+    /// immediately.
+    ///
+    /// - Parameters:
+    ///   - fd: Non-blocking descriptor to write to, or -1 to stop notifying.
+    ///   - token: Value written, in native byte order, on each notification.
+    func setNotify(fd: Int32, token: UInt32) {
+        condition.lock()
+        defer { condition.unlock() }
+        notifyFd = fd
+        notifyToken = token
+        if !pending.isEmpty || finished {
+            notifyLocked()
+        }
+    }
+
+    /// Appends generated text and wakes a waiting reader.
+    func append(_ text: String) {
+        condition.lock()
+        let wasEmpty = pending.isEmpty
+        pending.append(contentsOf: text.utf8)
+        condition.signal()
+        if wasEmpty {
+            notifyLocked()
+        }
+        condition.unlock()
+    }
+
+    /// Marks the stream as complete, optionally with an error message.
+    func finish(error: String? = nil) {
+        condition.lock()
+        if !finished {
+            finished = true
+            errorMessage = error
+            task = nil
+            notifyLocked()
+        }
+        condition.broadcast()
+        condition.unlock()
+    }
+
+    /// Cancels the generation task if it is still running and stops notifications.
+    func cancel() {
+        condition.lock()
+        let running = task
+        task = nil
+        notifyFd = -1
+        condition.unlock()
+        running?.cancel()
+    }
+
+    private func notifyLocked() {
+        guard notifyFd >= 0 else { return }
+        var token = notifyToken
+        // Pipe writes of up to PIPE_BUF bytes are atomic, so tokens never interleave.
+        // A full pipe already guarantees a wakeup, so EAGAIN is ignored.
+        _ = write(notifyFd, &token, MemoryLayout<UInt32>.size)
+    }
+
+    /// Copies pending output into `buffer`, waiting up to `timeoutMs` for some to arrive.
+    ///
+    /// Data is always drained before the error message is reported, so a failed stream
+    /// returns its partial output first and the message on the final read.
+    ///
+    /// - Parameters:
+    ///   - buffer: Destination buffer. Not NUL-terminated.
+    ///   - capacity: Size of `buffer` in bytes.
+    ///   - timeoutMs: Milliseconds to wait for data (-1 = forever, 0 = don't wait).
+    /// - Returns: Number of bytes copied and the stream state after this read.
+    func read(
+        into buffer: UnsafeMutablePointer<CChar>, capacity: Int, timeoutMs: Int32
+    ) -> (Int32, ReadStatus) {
+        condition.lock()
+        defer { condition.unlock() }
+
+        if pending.isEmpty && !finished && timeoutMs != 0 {
+            let deadline =
+                timeoutMs > 0
+                ? Date(timeIntervalSinceNow: Double(timeoutMs) / 1000.0) : Date.distantFuture
+            while pending.isEmpty && !finished {
+                if !condition.wait(until: deadline) {
+                    break
+                }
+            }
+        }
+
+        if pending.isEmpty {
+            guard finished else { return (0, .open) }
+            guard let message = errorMessage else { return (0, .finished) }
+            let bytes = Array(message.utf8.prefix(capacity))
+            bytes.withUnsafeBufferPointer { source in
+                buffer.withMemoryRebound(to: UInt8.self, capacity: capacity) { destination in
+                    destination.update(from: source.baseAddress!, count: source.count)
+                }
+            }
+            return (Int32(bytes.count), .failed)
+        }
+
+        let count = min(capacity, pending.count)
+        pending.withUnsafeBytes { source in
+            UnsafeMutableRawPointer(buffer).copyMemory(
+                from: source.baseAddress!, byteCount: count)
+        }
+        pending.removeSubrange(pending.startIndex..<(pending.startIndex + count))
+
+        let status: ReadStatus =
+            pending.isEmpty && finished && errorMessage == nil ? .finished : .open
+        return (Int32(count), status)
+    }
 }
 
 // MARK: - Tool Support
@@ -325,6 +576,16 @@ private struct BridgeTool: Tool {
     /// - Returns: Tool output containing the execution result.
     /// - Throws: `AIBridgeError` if tool execution fails.
     func call(arguments: Arguments) async throws -> BridgeToolOutput {
+        if SessionManager.shared.isQueuedTool(sessionId: sessionId, toolName: toolName) {
+            // Suspends without holding a thread until a consumer completes the call.
+            let argumentsJsonObject = convertGeneratedContentToJSON(arguments.content)
+            let jsonData = try JSONSerialization.data(withJSONObject: argumentsJsonObject)
+            let jsonString = String(data: jsonData, encoding: .utf8) ?? "{}"
+            let result = try await ToolCallQueue.shared.submit(
+                sessionId: sessionId, toolName: toolName, argumentsJson: jsonString)
+            return BridgeToolOutput(content: result)
+        }
+
         return try await withCheckedThrowingContinuation { continuation in
             Task.detached {
                 do {
@@ -366,6 +627,111 @@ private struct BridgeTool: Tool {
     }
 }
 
+// MARK: - Queued Tool Calls
+
+/// Hands tool calls to a consumer that pulls them, instead of invoking a C callback.
+///
+/// The calling generation task suspends on a continuation until the consumer reports a
+/// result, so slow tools never occupy a thread of the cooperative pool and the consumer
+/// decides which thread (or event loop) runs them.
+@available(macOS 26.0, *)
+private final class ToolCallQueue {
+    struct PendingCall {
+        let callId: UInt64
+        let sessionId: UInt8
+        let toolName: String
+        let argumentsJson: String
+    }
+
+    static let shared = ToolCallQueue()
+
+    private let condition = NSCondition()
+    private var nextCallId: UInt64 = 1
+    private var ready: [PendingCall] = []
+    private var waiting: [UInt64: (sessionId: UInt8, continuation: CheckedContinuation<String, Error>)] = [:]
+    private var cancelled: Set<UInt64> = []
+
+    private init() {}
+
+    /// Queues a call and suspends until it is completed, failed or cancelled.
+    func submit(sessionId: UInt8, toolName: String, argumentsJson: String) async throws
+        -> String
+    {
+        condition.lock()
+        let callId = nextCallId
+        nextCallId &+= 1
+        condition.unlock()
+
+        return try await withTaskCancellationHandler {
+            try await withCheckedThrowingContinuation { continuation in
+                condition.lock()
+                defer { condition.unlock() }
+
+                if cancelled.remove(callId) != nil {
+                    continuation.resume(throwing: CancellationError())
+                    return
+                }
+                waiting[callId] = (sessionId, continuation)
+                ready.append(
+                    PendingCall(
+                        callId: callId, sessionId: sessionId, toolName: toolName,
+                        argumentsJson: argumentsJson))
+                condition.signal()
+            }
+        } onCancel: {
+            if !self.resolve(callId, result: .failure(CancellationError())) {
+                self.condition.lock()
+                self.cancelled.insert(callId)
+                self.condition.unlock()
+            }
+        }
+    }
+
+    /// Takes the oldest queued call, waiting up to `timeoutMs` (-1 = forever).
+    func next(timeoutMs: Int32) -> PendingCall? {
+        condition.lock()
+        defer { condition.unlock() }
+
+        if ready.isEmpty && timeoutMs != 0 {
+            let deadline =
+                timeoutMs > 0
+                ? Date(timeIntervalSinceNow: Double(timeoutMs) / 1000.0) : Date.distantFuture
+            while ready.isEmpty {
+                if !condition.wait(until: deadline) {
+                    break
+                }
+            }
+        }
+        return ready.isEmpty ? nil : ready.removeFirst()
+    }
+
+    /// Resumes the caller waiting on `callId`.
+    ///
+    /// - Returns: `true` if the call was still waiting.
+    @discardableResult
+    func resolve(_ callId: UInt64, result: Result<String, Error>) -> Bool {
+        condition.lock()
+        let entry = waiting.removeValue(forKey: callId)
+        ready.removeAll { $0.callId == callId }
+        condition.unlock()
+
+        guard let entry else { return false }
+        entry.continuation.resume(with: result)
+        return true
+    }
+
+    /// Fails every outstanding call made by the specified session.
+    func failCalls(sessionId: UInt8) {
+        condition.lock()
+        let callIds = waiting.filter { $0.value.sessionId == sessionId }.map { $0.key }
+        condition.unlock()
+
+        for callId in callIds {
+            resolve(callId, result: .failure(AIBridgeError.sessionNotFound))
+        }
+    }
+}
+
 // MARK: - Core Library Functions
 
 /// Initializes the AI Bridge library.
@@ -443,6 +809,45 @@ public func bridgeGetAvailabilityReason() -> UnsafeMutablePointer<CChar>? {
     return strdup(reasonString)
 }
 
+/// Carries the C observer into the observation change handler.
+private struct AvailabilityObserver: @unchecked Sendable {
+    let callback: @convention(c) (UnsafeMutableRawPointer?) -> Void
+    let userData: UnsafeMutableRawPointer?
+}
+
+/// Tracks `SystemLanguageModel.default.availability` and calls the observer
+/// after each change.
+///
+/// `onChange` fires once, before the new value is stored, so the handler
+/// re-registers and notifies from a task that runs after the update.
+@available(macOS 26.0, *)
+private func trackAvailability(_ observer: AvailabilityObserver) {
+    withObservationTracking {
+        _ = SystemLanguageModel.default.availability
+    } onChange: {
+        Task.detached {
+            trackAvailability(observer)
+            observer.callback(observer.userData)
+        }
+    }
+}
+
+/// Registers an observer for model availability changes.
+///
+/// - Parameters:
+///   - observer: Function called on a background thread after availability changes.
+///   - userData: Optional user data passed to the observer.
+/// - Returns: `true`; `SystemLanguageModel` is observable.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_observe_availability")
+public func bridgeObserveAvailability(
+    observer: @escaping @convention(c) (UnsafeMutableRawPointer?) -> Void,
+    userData: UnsafeMutableRawPointer?
+) -> Bool {
+    trackAvailability(AvailabilityObserver(callback: observer, userData: userData))
+    return true
+}
+
 // MARK: - Session Management Functions
 
 /// Creates a new AI session with the specified configuration.
@@ -466,9 +871,49 @@ public func bridgeCreateSession(
     enableStructuredResponses: Bool,
     defaultSchemaJson: UnsafePointer<CChar>?,
     prewarm: Bool
+) -> UInt8 {
+    return bridgeCreateSessionWithUseCase(
+        instructions: instructions,
+        toolsJson: toolsJson,
+        enableGuardrails: enableGuardrails,
+        enableHistory: enableHistory,
+        enableStructuredResponses: enableStructuredResponses,
+        defaultSchemaJson: defaultSchemaJson,
+        prewarm: prewarm,
+        useCase: 0
+    )
+}
+
+/// Creates a new AI session backed by the system model for a use case.
+///
+/// - Parameters:
+///   - useCase: `0` for `SystemLanguageModel.default`, `1` for the content-tagging
+///     model. Other values fail.
+///   - The remaining parameters are as for `ai_bridge_create_session`.
+/// - Returns: Session identifier (non-zero on success, 0 on failure or when the
+///   use case's model is unavailable).
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_create_session_with_use_case")
+public func bridgeCreateSessionWithUseCase(
+    instructions: UnsafePointer<CChar>?,
+    toolsJson: UnsafePointer<CChar>?,
+    enableGuardrails: Bool,
+    enableHistory: Bool,
+    enableStructuredResponses: Bool,
+    defaultSchemaJson: UnsafePointer<CChar>?,
+    prewarm: Bool,
+    useCase: Int32
 ) -> UInt8 {
     do {
-        let model = SystemLanguageModel.default
+        let model: SystemLanguageModel
+        switch useCase {
+        case 0:
+            model = SystemLanguageModel.default
+        case 1:
+            model = SystemLanguageModel(useCase: .contentTagging)
+        default:
+            return 0
+        }
         guard case .available = model.availability else {
             return 0
         }
@@ -531,6 +976,77 @@ public func bridgeRegisterTool(
     return true
 }
 
+/// Routes calls to a tool through the tool call queue instead of a callback.
+///
+/// Queued calls are taken with `ai_bridge_tool_queue_next` and answered with
+/// `ai_bridge_tool_call_complete`. Generation waits for the answer without holding a
+/// thread.
+///
+/// - Parameters:
+///   - sessionId: The session identifier.
+///   - toolName: The name of the tool as defined in the session's tools JSON.
+/// - Returns: `true` if registration was successful, `false` otherwise.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_register_queued_tool")
+public func bridgeRegisterQueuedTool(sessionId: UInt8, toolName: UnsafePointer<CChar>) -> Bool
+{
+    return SessionManager.shared.registerQueuedTool(
+        sessionId: sessionId, toolName: String(cString: toolName))
+}
+
+/// Takes the next queued tool call.
+///
+/// - Parameters:
+///   - timeoutMs: Milliseconds to wait for a call (-1 = forever, 0 = poll).
+///   - callId: Receives the identifier to pass to `ai_bridge_tool_call_complete`.
+///   - sessionId: Receives the session that made the call.
+///   - toolName: Receives the tool name.
+///     **Memory ownership**: Caller must call `ai_bridge_free_string` to release.
+///   - argumentsJson: Receives the arguments as a JSON object.
+///     **Memory ownership**: Caller must call `ai_bridge_free_string` to release.
+/// - Returns: `true` if a call was taken, `false` on timeout.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_tool_queue_next")
+public func bridgeToolQueueNext(
+    timeoutMs: Int32,
+    callId: UnsafeMutablePointer<UInt64>,
+    sessionId: UnsafeMutablePointer<UInt8>,
+    toolName: UnsafeMutablePointer<UnsafeMutablePointer<CChar>?>,
+    argumentsJson: UnsafeMutablePointer<UnsafeMutablePointer<CChar>?>
+) -> Bool {
+    guard let call = ToolCallQueue.shared.next(timeoutMs: timeoutMs) else {
+        return false
+    }
+
+    callId.pointee = call.callId
+    sessionId.pointee = call.sessionId
+    toolName.pointee = strdup(call.toolName)
+    argumentsJson.pointee = strdup(call.argumentsJson)
+    return true
+}
+
+/// Answers a queued tool call.
+///
+/// - Parameters:
+///   - callId: Identifier returned by `ai_bridge_tool_queue_next`.
+///   - result: Tool result, or an error message when `isError` is `true`.
+///   - isError: Whether the tool failed.
+/// - Returns: `true` if the call was still waiting, `false` if it was cancelled or unknown.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_tool_call_complete")
+public func bridgeToolCallComplete(
+    callId: UInt64,
+    result: UnsafePointer<CChar>,
+    isError: Bool
+) -> Bool {
+    let resultString = String(cString: result)
+    if isError {
+        return ToolCallQueue.shared.resolve(
+            callId, result: .failure(AIBridgeError.toolExecutionError(resultString)))
+    }
+    return ToolCallQueue.shared.resolve(callId, result: .success(resultString))
+}
+
 /// Destroys the specified session and releases all associated resources.
 ///
 /// - Parameter sessionId: The session identifier to destroy.
@@ -688,52 +1204,34 @@ public func bridgeGenerateResponseStream(
     callback: @escaping @convention(c) (UnsafeRawPointer, UnsafePointer<CChar>?, UnsafeRawPointer?)
         -> Void,
     userData: UnsafeRawPointer?
-) -> UInt8 {
+) -> UInt32 {
     let promptString = String(cString: prompt)
 
-    let task = Task.detached {
-        do {
-            guard let sessionInfo = SessionManager.shared.getSession(sessionId) else {
-                emitError(
-                    "Session not found", context: context, callback: callback, userData: userData)
-                return
-            }
-
-            let options = createGenerationOptions(temperature: temperature, maxTokens: maxTokens)
-            let session = sessionInfo.bridgeSession
-
-            var previousContent = ""
-
-            for try await snapshot in session.streamResponse(
-                to: promptString, options: options)
-            {
-                // snapshot.content is already a String (PartiallyGenerated String)
-                let cumulativeContent = snapshot.content
-
-                let deltaContent = String(cumulativeContent.dropFirst(previousContent.count))
-                previousContent = cumulativeContent
-
-                guard !deltaContent.isEmpty else { continue }
-
-                deltaContent.withCString { cString in
-                    callback(context, cString, userData)
+    return SessionManager.shared.createStream { streamId in
+        Task.detached {
+            defer { SessionManager.shared.removeStream(streamId) }
+            do {
+                try await streamTextDeltas(
+                    sessionId: sessionId, prompt: promptString, temperature: temperature,
+                    maxTokens: maxTokens
+                ) { deltaContent in
+                    emitText(
+                        deltaContent, context: context, callback: callback, userData: userData)
                 }
-            }
 
-            callback(context, nil, userData)
+                callback(context, nil, userData)
 
-        } catch LanguageModelSession.GenerationError.guardrailViolation {
-            emitError(
-                "Guardrail violation: Content blocked by safety filters", context: context,
-                callback: callback, userData: userData)
-        } catch {
-            emitError(
-                error.localizedDescription, context: context, callback: callback, userData: userData
-            )
+            } catch LanguageModelSession.GenerationError.guardrailViolation {
+                emitError(
+                    "Guardrail violation: Content blocked by safety filters", context: context,
+                    callback: callback, userData: userData)
+            } catch {
+                emitError(
+                    describeError(error), context: context, callback: callback, userData: userData
+                )
+            }
         }
     }
-
-    return SessionManager.shared.createStream(task)
 }
 
 /// Starts streaming structured response generation for the given prompt.
@@ -760,84 +1258,205 @@ public func bridgeGenerateStructuredResponseStream(
     callback: @escaping @convention(c) (UnsafeRawPointer, UnsafePointer<CChar>?, UnsafeRawPointer?)
         -> Void,
     userData: UnsafeRawPointer?
-) -> UInt8 {
+) -> UInt32 {
     let promptString = String(cString: prompt)
     let schemaJsonString = schemaJson.map { String(cString: $0) }
 
-    let task = Task.detached {
-        do {
-            guard let sessionInfo = SessionManager.shared.getSession(sessionId) else {
-                emitError(
-                    "Session not found", context: context, callback: callback, userData: userData)
-                return
-            }
+    return SessionManager.shared.createStream { streamId in
+        Task.detached {
+            defer { SessionManager.shared.removeStream(streamId) }
+            do {
+                guard let sessionInfo = SessionManager.shared.getSession(sessionId) else {
+                    emitError(
+                        "Session not found", context: context, callback: callback, userData: userData)
+                    return
+                }
 
-            let finalSchemaJson: String
-            if let providedSchema = schemaJsonString {
-                finalSchemaJson = providedSchema
-            } else {
-                emitError(
-                    "No schema provided and session not configured for structured responses",
-                    context: context, callback: callback, userData: userData)
-                return
-            }
+                let finalSchemaJson: String
+                if let providedSchema = schemaJsonString {
+                    finalSchemaJson = providedSchema
+                } else {
+                    emitError(
+                        "No schema provided and session not configured for structured responses",
+                        context: context, callback: callback, userData: userData)
+                    return
+                }
 
-            guard let schemaData = finalSchemaJson.data(using: .utf8),
-                let jsonObject = try JSONSerialization.jsonObject(with: schemaData)
-                    as? [String: Any]
-            else {
-                emitError(
-                    "Invalid JSON Schema", context: context, callback: callback, userData: userData)
-                return
-            }
+                guard let schemaData = finalSchemaJson.data(using: .utf8),
+                    let jsonObject = try JSONSerialization.jsonObject(with: schemaData)
+                        as? [String: Any]
+                else {
+                    emitError(
+                        "Invalid JSON Schema", context: context, callback: callback, userData: userData)
+                    return
+                }
 
-            let (rootSchema, dependencies) = buildSchemasFromJSON(jsonObject)
-            let generationSchema = try GenerationSchema(
-                root: rootSchema, dependencies: dependencies)
-            let options = createGenerationOptions(temperature: temperature, maxTokens: maxTokens)
-            let session = sessionInfo.bridgeSession
-
-            let response = try await session.respond(
-                to: promptString,
-                schema: generationSchema,
-                includeSchemaInPrompt: true,
-                options: options
-            )
+                let (rootSchema, dependencies) = buildSchemasFromJSON(jsonObject)
+                let generationSchema = try GenerationSchema(
+                    root: rootSchema, dependencies: dependencies)
+                let options = createGenerationOptions(temperature: temperature, maxTokens: maxTokens)
+                let session = sessionInfo.bridgeSession
+
+                let response = try await session.respond(
+                    to: promptString,
+                    schema: generationSchema,
+                    includeSchemaInPrompt: true,
+                    options: options
+                )
+
+                let objectJSON = convertGeneratedContentToJSON(response.content)
+                let textRepresentation = String(describing: response.content)
+
+                let responseJSON: [String: Any] = [
+                    "text": textRepresentation,
+                    "object": objectJSON,
+                ]
+
+                let jsonData = try JSONSerialization.data(withJSONObject: responseJSON, options: [])
+                guard let jsonString = String(data: jsonData, encoding: .utf8) else {
+                    emitError(
+                        "Failed to encode response as JSON", context: context, callback: callback,
+                        userData: userData)
+                    return
+                }
 
-            let objectJSON = convertGeneratedContentToJSON(response.content)
-            let textRepresentation = String(describing: response.content)
+                jsonString.withCString { cString in
+                    callback(context, cString, userData)
+                }
 
-            let responseJSON: [String: Any] = [
-                "text": textRepresentation,
-                "object": objectJSON,
-            ]
+                callback(context, nil, userData)
 
-            let jsonData = try JSONSerialization.data(withJSONObject: responseJSON, options: [])
-            guard let jsonString = String(data: jsonData, encoding: .utf8) else {
+            } catch LanguageModelSession.GenerationError.guardrailViolation {
+                emitError(
+                    "Guardrail violation: Content blocked by safety filters", context: context,
+                    callback: callback, userData: userData)
+            } catch {
                 emitError(
-                    "Failed to encode response as JSON", context: context, callback: callback,
-                    userData: userData)
-                return
+                    describeError(error), context: context, callback: callback, userData: userData
+                )
             }
+        }
+    }
+}
 
-            jsonString.withCString { cString in
-                callback(context, cString, userData)
-            }
+// MARK: - Buffered Stream Functions
+
+/// Starts a pull-based stream whose output is drained with `ai_bridge_stream_read`.
+///
+/// - Parameters:
+///   - sessionId: The session identifier.
+///   - prompt: The input prompt text.
+///   - schemaJson: JSON schema for a structured response, or `NULL` for text streaming.
+///   - temperature: Controls randomness in generation (0.0 = deterministic, 1.0 = very random).
+///   - maxTokens: Maximum number of tokens to generate (0 = no limit).
+/// - Returns: Stream identifier (0 if failed to start). Release with `ai_bridge_stream_close`.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_stream_open")
+public func bridgeStreamOpen(
+    sessionId: UInt8,
+    prompt: UnsafePointer<CChar>,
+    schemaJson: UnsafePointer<CChar>?,
+    temperature: Double,
+    maxTokens: Int32
+) -> UInt32 {
+    let promptString = String(cString: prompt)
+    let schemaJsonString = schemaJson.map { String(cString: $0) }
 
-            callback(context, nil, userData)
+    let stream = BufferedStream()
+    let streamId = SessionManager.shared.createBufferedStream(stream)
+    guard streamId != 0 else { return 0 }
 
+    let task = Task.detached {
+        do {
+            if let schemaJsonString {
+                let jsonString = try await generateStructuredResponse(
+                    sessionId: sessionId, prompt: promptString, schemaJson: schemaJsonString,
+                    temperature: temperature, maxTokens: maxTokens)
+                stream.append(jsonString)
+            } else {
+                try await streamTextDeltas(
+                    sessionId: sessionId, prompt: promptString, temperature: temperature,
+                    maxTokens: maxTokens
+                ) { deltaContent in
+                    stream.append(deltaContent)
+                }
+            }
+            stream.finish()
         } catch LanguageModelSession.GenerationError.guardrailViolation {
-            emitError(
-                "Guardrail violation: Content blocked by safety filters", context: context,
-                callback: callback, userData: userData)
+            stream.finish(error: "Guardrail violation: Content blocked by safety filters")
         } catch {
-            emitError(
-                error.localizedDescription, context: context, callback: callback, userData: userData
-            )
+            stream.finish(error: describeError(error))
         }
     }
+    stream.attach(task)
+
+    return streamId
+}
+
+/// Drains pending output from a buffered stream.
+///
+/// - Parameters:
+///   - streamId: Identifier returned by `ai_bridge_stream_open`.
+///   - buffer: Destination buffer. The data is not NUL-terminated.
+///   - capacity: Size of `buffer` in bytes.
+///   - timeoutMs: Milliseconds to wait when nothing is pending (-1 = forever, 0 = poll).
+///   - status: Receives 0 (open), 1 (finished), 2 (failed; `buffer` holds the error
+///     message) or -1 (unknown stream). May be `NULL`.
+/// - Returns: Number of bytes written to `buffer`.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_stream_read")
+public func bridgeStreamRead(
+    streamId: UInt32,
+    buffer: UnsafeMutablePointer<CChar>,
+    capacity: Int32,
+    timeoutMs: Int32,
+    status: UnsafeMutablePointer<Int32>?
+) -> Int32 {
+    guard let stream = SessionManager.shared.getBufferedStream(streamId), capacity > 0 else {
+        status?.pointee = -1
+        return 0
+    }
+
+    let (count, readStatus) = stream.read(
+        into: buffer, capacity: Int(capacity), timeoutMs: timeoutMs)
+    status?.pointee = readStatus.rawValue
+    return count
+}
+
+/// Requests a notification on `fd` whenever a buffered stream becomes readable.
+///
+/// Each notification is the stream identifier as a native-endian `uint32_t`, so one
+/// descriptor can serve many streams.
+/// Notifications stop when the stream is closed; the caller must not close `fd` before
+/// closing every stream attached to it.
+///
+/// - Parameters:
+///   - streamId: Identifier returned by `ai_bridge_stream_open`.
+///   - fd: Non-blocking descriptor to write to, or -1 to stop notifying.
+/// - Returns: `true` if the stream was found, `false` otherwise.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_stream_set_notify_fd")
+public func bridgeStreamSetNotifyFd(streamId: UInt32, fd: Int32) -> Bool {
+    guard let stream = SessionManager.shared.getBufferedStream(streamId) else {
+        return false
+    }
+    stream.setNotify(fd: fd, token: streamId)
+    return true
+}
 
-    return SessionManager.shared.createStream(task)
+/// Closes a buffered stream, cancelling generation if it is still running.
+///
+/// - Parameter streamId: Identifier returned by `ai_bridge_stream_open`.
+/// - Returns: `true` if the stream was found, `false` otherwise.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_stream_close")
+public func bridgeStreamClose(streamId: UInt32) -> Bool {
+    guard let stream = SessionManager.shared.removeBufferedStream(streamId) else {
+        return false
+    }
+    stream.cancel()
+    stream.finish(error: "Stream closed")
+    return true
 }
 
 // MARK: - Stream Control Functions
@@ -848,10 +1467,19 @@ public func bridgeGenerateStructuredResponseStream(
 /// - Returns: `true` if the stream was found and cancelled, `false` otherwise.
 @available(macOS 26.0, *)
 @_cdecl("ai_bridge_cancel_stream")
-public func bridgeCancelStream(streamId: UInt8) -> Bool {
+public func bridgeCancelStream(streamId: UInt32) -> Bool {
     return SessionManager.shared.cancelStream(streamId)
 }
 
+/// Returns the number of streams the bridge is still tracking.
+///
+/// - Returns: Running callback streams plus buffered streams that have not been closed.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_get_active_stream_count")
+public func bridgeGetActiveStreamCount() -> Int32 {
+    return Int32(SessionManager.shared.activeStreamCount)
+}
+
 // MARK: - Language Support Functions
 
 /// Returns the number of supported languages.
@@ -872,25 +1500,47 @@ public func bridgeGetSupportedLanguagesCount() -> Int32 {
 @available(macOS 26.0, *)
 @_cdecl("ai_bridge_get_supported_language")
 public func bridgeGetSupportedLanguage(index: Int32) -> UnsafeMutablePointer<CChar>? {
-    let model = SystemLanguageModel.default
-    let languagesArray = Array(model.supportedLanguages)
+    let languages = sortedSupportedLanguages()
 
-    guard index >= 0 && index < Int32(languagesArray.count) else {
+    guard index >= 0 && index < Int32(languages.count) else {
         return nil
     }
 
-    let language = languagesArray[Int(index)]
-    let locale = Locale(identifier: language.maximalIdentifier)
+    return strdup(languageDisplayName(languages[Int(index)]))
+}
 
-    if let displayName = locale.localizedString(forIdentifier: language.maximalIdentifier) {
-        return strdup(displayName)
+/// Returns every supported language with its display name in one call.
+///
+/// - Returns: One `identifier<TAB>display name` line per language, sorted by identifier.
+///   **Memory ownership**: Caller must call `ai_bridge_free_string` to release.
+@available(macOS 26.0, *)
+@_cdecl("ai_bridge_get_supported_languages")
+public func bridgeGetSupportedLanguages() -> UnsafeMutablePointer<CChar>? {
+    let lines = sortedSupportedLanguages().map { language in
+        "\(language.maximalIdentifier)\t\(languageDisplayName(language))\n"
     }
+    return strdup(lines.joined())
+}
 
-    if let languageCode = language.languageCode?.identifier {
-        return strdup(languageCode)
+/// The model's languages in a stable order, since `supportedLanguages` is a set.
+@available(macOS 26.0, *)
+private func sortedSupportedLanguages() -> [Locale.Language] {
+    return SystemLanguageModel.default.supportedLanguages.sorted {
+        $0.maximalIdentifier < $1.maximalIdentifier
     }
+}
 
-    return strdup("Unknown Language")
+/// Name of a language in that language, falling back to its language code.
+private func languageDisplayName(_ language: Locale.Language) -> String {
+    let identifier = language.maximalIdentifier
+    let locale = Locale(identifier: identifier)
+    if let displayName = locale.localizedString(forIdentifier: identifier) {
+        return displayName
+    }
+    if let languageCode = language.languageCode?.identifier {
+        return languageCode
+    }
+    return "Unknown Language"
 }
 
 // MARK: - Memory Management
@@ -982,6 +1632,37 @@ private func generateStructuredResponse(
     return jsonString
 }
 
+/// Streams a text response, passing each newly generated suffix to `onDelta`.
+@available(macOS 26.0, *)
+private func streamTextDeltas(
+    sessionId: UInt8,
+    prompt: String,
+    temperature: Double,
+    maxTokens: Int32,
+    onDelta: (String) -> Void
+) async throws {
+    guard let sessionInfo = SessionManager.shared.getSession(sessionId) else {
+        throw AIBridgeError.sessionNotFound
+    }
+
+    let options = createGenerationOptions(temperature: temperature, maxTokens: maxTokens)
+    let session = sessionInfo.bridgeSession
+
+    var previousContent = ""
+
+    for try await snapshot in session.streamResponse(to: prompt, options: options) {
+        // snapshot.content is already a String (PartiallyGenerated String)
+        let cumulativeContent = snapshot.content
+
+        let deltaContent = String(cumulativeContent.dropFirst(previousContent.count))
+        previousContent = cumulativeContent
+
+        guard !deltaContent.isEmpty else { continue }
+
+        onDelta(deltaContent)
+    }
+}
+
 // MARK: - Helper Functions
 
 @available(macOS 26.0, *)
@@ -1021,7 +1702,7 @@ private func performSynchronousTask<T>(_ operation: @escaping () async throws ->
         } catch AIBridgeError.toolNotFound(let message) {
             result = "Error: \(message)"
         } catch {
-            result = "Error: \(error.localizedDescription)"
+            result = "Error: \(describeError(error))"
         }
         semaphore.signal()
     }
@@ -1030,6 +1711,26 @@ private func performSynchronousTask<T>(_ operation: @escaping () async throws ->
     return strdup(result)
 }
 
+/// Describes an error, tagging transient generation failures with a stable prefix
+/// ("Model not ready:", "Rate limited:", "Concurrent requests:") so that C callers
+/// can decide whether to retry without parsing localized text.
+@available(macOS 26.0, *)
+private func describeError(_ error: Error) -> String {
+    guard let generationError = error as? LanguageModelSession.GenerationError else {
+        return error.localizedDescription
+    }
+    switch generationError {
+    case .assetsUnavailable:
+        return "Model not ready: \(error.localizedDescription)"
+    case .rateLimited:
+        return "Rate limited: \(error.localizedDescription)"
+    case .concurrentRequests:
+        return "Concurrent requests: \(error.localizedDescription)"
+    default:
+        return error.localizedDescription
+    }
+}
+
 @available(macOS 26.0, *)
 private func emitError(
     _ message: String,
@@ -1042,6 +1743,29 @@ private func emitError(
     errorMessage.withCString { cString in
         callback(context, cString, userData)
     }
+    callback(context, nil, userData)
+}
+
+/// Delivers a text delta. The "Error:" prefix is reserved for `emitError`, so a
+/// delta that happens to start with it goes out in two chunks; the concatenated
+/// text is unchanged.
+@available(macOS 26.0, *)
+private func emitText(
+    _ text: String,
+    context: UnsafeRawPointer,
+    callback: @escaping @convention(c) (UnsafeRawPointer, UnsafePointer<CChar>?, UnsafeRawPointer?)
+        -> Void,
+    userData: UnsafeRawPointer?
+) {
+    var pieces = [text]
+    if text.hasPrefix("Error:") {
+        pieces = [String(text.prefix(1)), String(text.dropFirst())]
+    }
+    for piece in pieces {
+        piece.withCString { cString in
+            callback(context, cString, userData)
+        }
+    }
 }
 
 // MARK: - Transcript Conversion Helper
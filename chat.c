@@ -365,8 +365,8 @@ int main() {
             continue;
         }
 
-        // Wait for stream to complete
-        while (!ctx.is_complete && !ctx.is_error) {
+        // Wait for stream to complete; errors are followed by NULL too
+        while (!ctx.is_complete) {
             usleep(10000); // Sleep for 10ms
         }
 
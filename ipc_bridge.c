@@ -0,0 +1,849 @@
+/*
+ * Implementation of ai_bridge.h that forwards to a shared libai-server.
+ *
+ * Linking libai against this file instead of the Swift bridge gives
+ * libai-client: the same ai.h API, but sessions live in the server, so many
+ * co-located processes share one warmed model. The server is found at
+ * $AI_IPC_SOCKET (default AI_IPC_DEFAULT_SOCKET).
+ *
+ * Calls are request/reply frames on a Unix socket. Stream output arrives in a
+ * shared-memory ring that a reader thread drains, invoking stream callbacks
+ * directly on the ring's memory; the reader only sleeps (and the server only
+ * writes the doorbell) once the ring is empty. Stream and tool callbacks run
+ * on that reader thread and on per-call threads respectively, mirroring the
+ * Swift bridge's background delivery.
+ *
+ * If the server goes away, running streams end with an "Error:" chunk and the
+ * terminal NULL, and later calls reconnect. Pull-based streams and queued
+ * tools are not offered over IPC; libai does not use them.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ai_bridge.h"
+#include "ai_ipc.h"
+#include "third-party/cJSON.h"
+
+#define LOST_CONNECTION "Error: libai-server connection lost"
+#define NO_SERVER "Error: libai-server is not reachable"
+
+typedef struct client_stream {
+  uint32_t tag;
+  bool started; /* the server confirmed it; reader-owned from then on */
+  void *context;
+  ai_bridge_stream_callback_t callback;
+  void *user_data;
+  char *assembly; /* pieces of an oversized chunk */
+  size_t assembly_length;
+  struct client_stream *next;
+} client_stream_t;
+
+typedef struct pending_call {
+  uint64_t id;
+  cJSON *reply;
+  bool done;
+  client_stream_t *stream;
+  struct pending_call *next;
+} pending_call_t;
+
+typedef struct client_tool {
+  ai_bridge_session_id_t session_id;
+  char *name;
+  ai_bridge_tool_callback_t callback;
+  void *user_data;
+  struct client_tool *next;
+} client_tool_t;
+
+typedef struct {
+  int fd;
+  _Atomic(int) refs;
+  pthread_t reader;
+  ai_ipc_ring_t *ring;
+  size_t ring_size;
+  int doorbell; /* read end; the server holds the write end */
+  pthread_mutex_t send_mutex;
+
+  // Guards the fields below
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool dead;
+  uint64_t next_id;
+  uint32_t next_tag;
+  pending_call_t *calls;
+  client_stream_t *streams;
+  int stream_count;
+  client_tool_t *tools;
+} connection_t;
+
+typedef struct {
+  connection_t *conn;
+  uint64_t call_id;
+  ai_bridge_session_id_t session_id;
+  char *name;
+  char *arguments;
+} tool_task_t;
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static connection_t *g_conn;
+
+static void connection_release(connection_t *conn) {
+  if (atomic_fetch_sub(&conn->refs, 1) != 1) return;
+
+  while (conn->tools) {
+    client_tool_t *tool = conn->tools;
+    conn->tools = tool->next;
+    free(tool->name);
+    free(tool);
+  }
+  munmap(conn->ring, conn->ring_size);
+  close(conn->doorbell);
+  close(conn->fd);
+  pthread_mutex_destroy(&conn->send_mutex);
+  pthread_mutex_destroy(&conn->mutex);
+  pthread_cond_destroy(&conn->cond);
+  free(conn);
+}
+
+static bool send_json(connection_t *conn, const cJSON *message) {
+  char *json = cJSON_PrintUnformatted(message);
+  if (!json) return false;
+  pthread_mutex_lock(&conn->send_mutex);
+  bool sent = ai_ipc_send_frame(conn->fd, json, strlen(json), NULL, 0);
+  pthread_mutex_unlock(&conn->send_mutex);
+  free(json);
+  if (!sent) shutdown(conn->fd, SHUT_RDWR);  // The reader cleans up
+  return sent;
+}
+
+/* ---- Reader ------------------------------------------------------------ */
+
+static client_stream_t *find_stream(connection_t *conn, uint32_t tag) {
+  pthread_mutex_lock(&conn->mutex);
+  client_stream_t *stream = conn->streams;
+  while (stream && stream->tag != tag) stream = stream->next;
+  pthread_mutex_unlock(&conn->mutex);
+  return stream;
+}
+
+static void remove_stream(connection_t *conn, client_stream_t *stream) {
+  pthread_mutex_lock(&conn->mutex);
+  for (client_stream_t **link = &conn->streams; *link;
+       link = &(*link)->next) {
+    if (*link == stream) {
+      *link = stream->next;
+      conn->stream_count--;
+      break;
+    }
+  }
+  // A start call still waiting for its reply must not touch it again
+  for (pending_call_t *call = conn->calls; call; call = call->next) {
+    if (call->stream == stream) call->stream = NULL;
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  free(stream->assembly);
+  free(stream);
+}
+
+static bool assemble(client_stream_t *stream, const char *data,
+                     size_t length) {
+  char *grown = realloc(stream->assembly, stream->assembly_length + length + 1);
+  if (!grown) return false;
+  memcpy(grown + stream->assembly_length, data, length);
+  stream->assembly = grown;
+  stream->assembly_length += length;
+  grown[stream->assembly_length] = '\0';
+  return true;
+}
+
+/* Delivers every record in the ring */
+static void drain_ring(connection_t *conn) {
+  const ai_ipc_record_t *record;
+  while ((record = ai_ipc_ring_peek(conn->ring))) {
+    client_stream_t *stream = find_stream(conn, record->tag);
+    const char *payload = (const char *)(record + 1);
+    uint8_t kind = record->kind;
+
+    if (stream && kind == AI_IPC_RECORD_PART) {
+      // On allocation failure the chunk is delivered truncated
+      assemble(stream, payload, record->length);
+    } else if (stream) {
+      // Normal chunks are passed straight from the shared mapping
+      const char *chunk = kind == AI_IPC_RECORD_END ? NULL : payload;
+      if (chunk && stream->assembly &&
+          assemble(stream, payload, record->length)) {
+        chunk = stream->assembly;
+      }
+      stream->callback(stream->context, chunk, stream->user_data);
+      free(stream->assembly);
+      stream->assembly = NULL;
+      stream->assembly_length = 0;
+    }
+    ai_ipc_ring_advance(conn->ring, record);
+
+    if (stream && kind == AI_IPC_RECORD_END) remove_stream(conn, stream);
+  }
+}
+
+static void send_tool_result(connection_t *conn, uint64_t call_id,
+                             const char *result) {
+  cJSON *message = cJSON_CreateObject();
+  cJSON_AddStringToObject(message, "op", "tool_result");
+  cJSON_AddNumberToObject(message, "call", (double)call_id);
+  if (result) {
+    cJSON_AddStringToObject(message, "result", result);
+  } else {
+    cJSON_AddNullToObject(message, "result");
+  }
+  send_json(conn, message);
+  cJSON_Delete(message);
+}
+
+static void *tool_main(void *arg) {
+  tool_task_t *task = arg;
+  connection_t *conn = task->conn;
+
+  ai_bridge_tool_callback_t callback = NULL;
+  void *user_data = NULL;
+  pthread_mutex_lock(&conn->mutex);
+  for (client_tool_t *tool = conn->tools; tool; tool = tool->next) {
+    if (tool->session_id == task->session_id &&
+        strcmp(tool->name, task->name) == 0) {
+      callback = tool->callback;
+      user_data = tool->user_data;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+
+  char *result = callback ? callback(task->arguments, user_data) : NULL;
+  send_tool_result(conn, task->call_id, result);
+
+  free(result);
+  free(task->name);
+  free(task->arguments);
+  free(task);
+  connection_release(conn);
+  return NULL;
+}
+
+static void handle_tool_call(connection_t *conn, const cJSON *event) {
+  const cJSON *call = cJSON_GetObjectItem(event, "call");
+  const cJSON *session = cJSON_GetObjectItem(event, "session");
+  const cJSON *name = cJSON_GetObjectItem(event, "name");
+  const cJSON *arguments = cJSON_GetObjectItem(event, "arguments");
+  if (!cJSON_IsNumber(call)) return;
+
+  tool_task_t *task = calloc(1, sizeof(*task));
+  if (task) {
+    task->conn = conn;
+    task->call_id = (uint64_t)call->valuedouble;
+    task->session_id = (ai_bridge_session_id_t)cJSON_GetNumberValue(session);
+    task->name = strdup(cJSON_IsString(name) ? name->valuestring : "");
+    task->arguments =
+        strdup(cJSON_IsString(arguments) ? arguments->valuestring : "{}");
+  }
+
+  // Tools may block or call back into libai, so never on the reader
+  pthread_t thread;
+  atomic_fetch_add(&conn->refs, 1);
+  if (task && task->name && task->arguments &&
+      pthread_create(&thread, NULL, tool_main, task) == 0) {
+    pthread_detach(thread);
+    return;
+  }
+  atomic_fetch_sub(&conn->refs, 1);
+  if (task) {
+    free(task->name);
+    free(task->arguments);
+    free(task);
+  }
+  send_tool_result(conn, (uint64_t)call->valuedouble, NULL);
+}
+
+/* Handles one control frame; false once the connection is unusable */
+static bool handle_frame(connection_t *conn, char *json) {
+  cJSON *frame = json ? cJSON_Parse(json) : NULL;
+  free(json);
+  if (!frame) return false;
+
+  const cJSON *event = cJSON_GetObjectItem(frame, "event");
+  if (cJSON_IsString(event)) {
+    if (strcmp(event->valuestring, "tool_call") == 0) {
+      handle_tool_call(conn, frame);
+    }
+    cJSON_Delete(frame);
+    return true;
+  }
+
+  uint64_t id = (uint64_t)cJSON_GetNumberValue(cJSON_GetObjectItem(frame,
+                                                                   "id"));
+  pthread_mutex_lock(&conn->mutex);
+  pending_call_t *call = conn->calls;
+  while (call && call->id != id) call = call->next;
+  if (call) {
+    call->reply = frame;
+    call->done = true;
+    if (call->stream) {
+      call->stream->started =
+          cJSON_GetNumberValue(cJSON_GetObjectItem(frame, "stream")) > 0;
+    }
+    pthread_cond_broadcast(&conn->cond);
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  if (!call) cJSON_Delete(frame);
+  return true;
+}
+
+/* Fails everything still waiting on a connection that is gone */
+static void connection_lost(connection_t *conn) {
+  drain_ring(conn);
+
+  pthread_mutex_lock(&conn->mutex);
+  conn->dead = true;
+  for (pending_call_t *call = conn->calls; call; call = call->next) {
+    call->done = true;
+  }
+  pthread_cond_broadcast(&conn->cond);
+  client_stream_t *orphans = NULL;
+  for (client_stream_t **link = &conn->streams; *link;) {
+    client_stream_t *stream = *link;
+    if (stream->started) {
+      *link = stream->next;
+      conn->stream_count--;
+      stream->next = orphans;
+      orphans = stream;
+    } else {
+      link = &stream->next;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+
+  while (orphans) {
+    client_stream_t *stream = orphans;
+    orphans = stream->next;
+    stream->callback(stream->context, LOST_CONNECTION, stream->user_data);
+    stream->callback(stream->context, NULL, stream->user_data);
+    free(stream->assembly);
+    free(stream);
+  }
+}
+
+static void *reader_main(void *arg) {
+  connection_t *conn = arg;
+  struct pollfd fds[2] = {
+      {.fd = conn->fd, .events = POLLIN},
+      {.fd = conn->doorbell, .events = POLLIN},
+  };
+
+  for (;;) {
+    drain_ring(conn);
+    if (!ai_ipc_ring_prepare_wait(conn->ring)) continue;
+
+    int ready = poll(fds, 2, -1);
+    ai_ipc_ring_finish_wait(conn->ring);
+    if (ready < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (fds[1].revents & POLLIN) {
+      char drain[64];
+      while (read(conn->doorbell, drain, sizeof(drain)) > 0) {
+      }
+    }
+    if (fds[0].revents &&
+        !handle_frame(conn, ai_ipc_recv_frame(conn->fd, NULL, 0, NULL))) {
+      break;
+    }
+  }
+
+  connection_lost(conn);
+  connection_release(conn);
+  return NULL;
+}
+
+/* ---- Connection -------------------------------------------------------- */
+
+static int create_ring(void) {
+  // Named only until the server has it; memfd would avoid the name on Linux
+  static _Atomic(unsigned) counter;
+  char name[32];
+  snprintf(name, sizeof(name), "/libai-%d-%u", (int)getpid(),
+           atomic_fetch_add(&counter, 1));
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return -1;
+  shm_unlink(name);
+  if (ftruncate(fd, (off_t)ai_ipc_ring_size(AI_IPC_RING_BYTES)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static connection_t *connect_server(void) {
+  const char *path = getenv("AI_IPC_SOCKET");
+  if (!path || !*path) path = AI_IPC_DEFAULT_SOCKET;
+
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(addr.sun_path)) return NULL;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+  connection_t *conn = calloc(1, sizeof(*conn));
+  if (!conn) return NULL;
+  conn->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  conn->doorbell = -1;
+  int ring_fd = -1;
+  int doorbell[2] = {-1, -1};
+  if (conn->fd < 0 ||
+      connect(conn->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    goto fail;
+  }
+  fcntl(conn->fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+  setsockopt(conn->fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+  ring_fd = create_ring();
+  if (ring_fd < 0 || pipe(doorbell) != 0) goto fail;
+  conn->ring_size = ai_ipc_ring_size(AI_IPC_RING_BYTES);
+  void *mapped = mmap(NULL, conn->ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, ring_fd, 0);
+  if (mapped == MAP_FAILED) goto fail;
+  conn->ring = mapped;
+  ai_ipc_ring_init(conn->ring, AI_IPC_RING_BYTES);
+  conn->doorbell = doorbell[0];
+  fcntl(doorbell[0], F_SETFL, fcntl(doorbell[0], F_GETFL) | O_NONBLOCK);
+  fcntl(doorbell[0], F_SETFD, FD_CLOEXEC);
+
+  char hello[64];
+  int length = snprintf(hello, sizeof(hello),
+                        "{\"op\":\"hello\",\"id\":0,\"version\":%d}",
+                        AI_IPC_PROTOCOL_VERSION);
+  int passed[2] = {ring_fd, doorbell[1]};
+  bool sent = ai_ipc_send_frame(conn->fd, hello, (size_t)length, passed, 2);
+  close(ring_fd);
+  close(doorbell[1]);
+  ring_fd = doorbell[1] = -1;
+
+  cJSON *reply = NULL;
+  if (sent) {
+    char *json = ai_ipc_recv_frame(conn->fd, NULL, 0, NULL);
+    reply = json ? cJSON_Parse(json) : NULL;
+    free(json);
+  }
+  bool accepted = cJSON_IsTrue(cJSON_GetObjectItem(reply, "ok"));
+  cJSON_Delete(reply);
+  if (!accepted) goto fail;
+
+  pthread_mutex_init(&conn->send_mutex, NULL);
+  pthread_mutex_init(&conn->mutex, NULL);
+  pthread_cond_init(&conn->cond, NULL);
+  conn->refs = 2;  // g_conn and the reader
+  if (pthread_create(&conn->reader, NULL, reader_main, conn) != 0) {
+    conn->refs = 1;
+    connection_release(conn);
+    return NULL;
+  }
+  pthread_detach(conn->reader);
+  return conn;
+
+fail:
+  if (ring_fd >= 0) close(ring_fd);
+  if (doorbell[1] >= 0) close(doorbell[1]);
+  if (conn->doorbell >= 0) close(conn->doorbell);
+  if (conn->ring) munmap(conn->ring, conn->ring_size);
+  if (conn->fd >= 0) close(conn->fd);
+  free(conn);
+  return NULL;
+}
+
+/* Returns a referenced live connection, reconnecting if the last one died */
+static connection_t *get_connection(void) {
+  pthread_mutex_lock(&g_mutex);
+  if (g_conn) {
+    pthread_mutex_lock(&g_conn->mutex);
+    bool dead = g_conn->dead;
+    pthread_mutex_unlock(&g_conn->mutex);
+    if (dead) {
+      connection_release(g_conn);
+      g_conn = NULL;
+    }
+  }
+  if (!g_conn) g_conn = connect_server();
+  connection_t *conn = g_conn;
+  if (conn) atomic_fetch_add(&conn->refs, 1);
+  pthread_mutex_unlock(&g_mutex);
+  return conn;
+}
+
+/*
+ * Sends @p request (consumed) and waits for its reply. Returns NULL if the
+ * server is unreachable or the connection dropped.
+ */
+static cJSON *call_with(connection_t *conn, cJSON *request,
+                        client_stream_t *stream) {
+  pending_call_t call = {.stream = stream};
+  pthread_mutex_lock(&conn->mutex);
+  bool dead = conn->dead;
+  if (!dead) {
+    call.id = ++conn->next_id;
+    call.next = conn->calls;
+    conn->calls = &call;
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  if (dead || !request) {
+    cJSON_Delete(request);
+    return NULL;
+  }
+
+  cJSON_AddNumberToObject(request, "id", (double)call.id);
+  bool sent = send_json(conn, request);
+  cJSON_Delete(request);
+
+  if (sent && pthread_equal(pthread_self(), conn->reader)) {
+    // Called from a stream callback: nobody else will read the reply
+    while (!call.done) {
+      if (!handle_frame(conn, ai_ipc_recv_frame(conn->fd, NULL, 0, NULL))) {
+        shutdown(conn->fd, SHUT_RDWR);
+        sent = false;
+        break;
+      }
+    }
+  }
+
+  pthread_mutex_lock(&conn->mutex);
+  while (sent && !call.done && !conn->dead) {
+    pthread_cond_wait(&conn->cond, &conn->mutex);
+  }
+  for (pending_call_t **link = &conn->calls; *link; link = &(*link)->next) {
+    if (*link == &call) {
+      *link = call.next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  return call.reply;
+}
+
+static cJSON *call(cJSON *request) {
+  connection_t *conn = get_connection();
+  if (!conn) {
+    cJSON_Delete(request);
+    return NULL;
+  }
+  cJSON *reply = call_with(conn, request, NULL);
+  connection_release(conn);
+  return reply;
+}
+
+static cJSON *request_for(const char *op) {
+  cJSON *request = cJSON_CreateObject();
+  if (request) cJSON_AddStringToObject(request, "op", op);
+  return request;
+}
+
+static cJSON *session_request(const char *op,
+                              ai_bridge_session_id_t session_id) {
+  cJSON *request = request_for(op);
+  if (request) cJSON_AddNumberToObject(request, "session", session_id);
+  return request;
+}
+
+static void add_optional_string(cJSON *request, const char *key,
+                                const char *value) {
+  if (request && value) cJSON_AddStringToObject(request, key, value);
+}
+
+static double reply_number(const cJSON *reply, const char *key) {
+  const cJSON *item = cJSON_GetObjectItem(reply, key);
+  return cJSON_IsNumber(item) ? item->valuedouble : 0;
+}
+
+static bool reply_ok(cJSON *reply) {
+  bool ok = cJSON_IsTrue(cJSON_GetObjectItem(reply, "ok"));
+  cJSON_Delete(reply);
+  return ok;
+}
+
+/* Takes the reply's "text", or @p fallback when there is none */
+static char *reply_text(cJSON *reply, const char *fallback) {
+  const cJSON *text = cJSON_GetObjectItem(reply, "text");
+  char *result = cJSON_IsString(text) ? strdup(text->valuestring)
+                 : fallback && !reply ? strdup(fallback)
+                                      : NULL;
+  cJSON_Delete(reply);
+  return result;
+}
+
+/* ---- ai_bridge.h ------------------------------------------------------- */
+
+bool ai_bridge_init(void) {
+  connection_t *conn = get_connection();
+  if (!conn) return false;
+  connection_release(conn);
+  return true;
+}
+
+ai_availability_status_t ai_bridge_check_availability(void) {
+  cJSON *reply = call(request_for("availability"));
+  ai_availability_status_t status =
+      reply ? (ai_availability_status_t)reply_number(reply, "status")
+            : AI_BRIDGE_UNKNOWN_ERROR;
+  cJSON_Delete(reply);
+  return status;
+}
+
+char *ai_bridge_get_availability_reason(void) {
+  return reply_text(call(request_for("availability_reason")),
+                    "libai-server is not running");
+}
+
+// The server does not push availability changes; libai polls instead
+bool ai_bridge_observe_availability(ai_bridge_availability_observer_t observer,
+                                    void *user_data) {
+  (void)observer;
+  (void)user_data;
+  return false;
+}
+
+int32_t ai_bridge_get_supported_languages_count(void) {
+  cJSON *reply = call(request_for("languages_count"));
+  int32_t count = (int32_t)reply_number(reply, "count");
+  cJSON_Delete(reply);
+  return count;
+}
+
+char *ai_bridge_get_supported_language(int32_t index) {
+  cJSON *request = request_for("language");
+  if (request) cJSON_AddNumberToObject(request, "index", index);
+  return reply_text(call(request), NULL);
+}
+
+char *ai_bridge_get_supported_languages(void) {
+  return reply_text(call(request_for("languages")), NULL);
+}
+
+ai_bridge_session_id_t ai_bridge_create_session(
+    const char *instructions, const char *tools_json, bool enable_guardrails,
+    bool enable_history, bool enable_structured_responses,
+    const char *default_schema_json, bool prewarm) {
+  return ai_bridge_create_session_with_use_case(
+      instructions, tools_json, enable_guardrails, enable_history,
+      enable_structured_responses, default_schema_json, prewarm,
+      AI_BRIDGE_USE_CASE_GENERAL);
+}
+
+ai_bridge_session_id_t ai_bridge_create_session_with_use_case(
+    const char *instructions, const char *tools_json, bool enable_guardrails,
+    bool enable_history, bool enable_structured_responses,
+    const char *default_schema_json, bool prewarm, int32_t use_case) {
+  cJSON *request = request_for("create_session");
+  add_optional_string(request, "instructions", instructions);
+  add_optional_string(request, "tools_json", tools_json);
+  add_optional_string(request, "default_schema", default_schema_json);
+  if (request) {
+    cJSON_AddBoolToObject(request, "guardrails", enable_guardrails);
+    cJSON_AddBoolToObject(request, "history", enable_history);
+    cJSON_AddBoolToObject(request, "structured", enable_structured_responses);
+    cJSON_AddBoolToObject(request, "prewarm", prewarm);
+    cJSON_AddNumberToObject(request, "use_case", use_case);
+  }
+  cJSON *reply = call(request);
+  ai_bridge_session_id_t session_id =
+      (ai_bridge_session_id_t)reply_number(reply, "session");
+  cJSON_Delete(reply);
+  return session_id;
+}
+
+bool ai_bridge_register_tool(ai_bridge_session_id_t session_id,
+                             const char *tool_name,
+                             ai_bridge_tool_callback_t callback,
+                             void *user_data) {
+  connection_t *conn = get_connection();
+  if (!conn) return false;
+
+  client_tool_t *tool = calloc(1, sizeof(*tool));
+  if (!tool || !(tool->name = strdup(tool_name))) {
+    free(tool);
+    connection_release(conn);
+    return false;
+  }
+  tool->session_id = session_id;
+  tool->callback = callback;
+  tool->user_data = user_data;
+  pthread_mutex_lock(&conn->mutex);
+  tool->next = conn->tools;
+  conn->tools = tool;
+  pthread_mutex_unlock(&conn->mutex);
+
+  cJSON *request = session_request("register_tool", session_id);
+  add_optional_string(request, "name", tool_name);
+  bool ok = reply_ok(call_with(conn, request, NULL));
+  connection_release(conn);
+  return ok;
+}
+
+void ai_bridge_destroy_session(ai_bridge_session_id_t session_id) {
+  connection_t *conn = get_connection();
+  if (!conn) return;
+
+  cJSON_Delete(call_with(conn, session_request("destroy_session", session_id),
+                         NULL));
+  pthread_mutex_lock(&conn->mutex);
+  for (client_tool_t **link = &conn->tools; *link;) {
+    client_tool_t *tool = *link;
+    if (tool->session_id == session_id) {
+      *link = tool->next;
+      free(tool->name);
+      free(tool);
+    } else {
+      link = &tool->next;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  connection_release(conn);
+}
+
+static cJSON *generate_request(const char *op,
+                               ai_bridge_session_id_t session_id,
+                               const char *prompt, const char *schema_json,
+                               double temperature, int32_t max_tokens) {
+  cJSON *request = session_request(op, session_id);
+  add_optional_string(request, "prompt", prompt);
+  add_optional_string(request, "schema", schema_json);
+  if (request) {
+    cJSON_AddNumberToObject(request, "temperature", temperature);
+    cJSON_AddNumberToObject(request, "max_tokens", max_tokens);
+  }
+  return request;
+}
+
+char *ai_bridge_generate_response(ai_bridge_session_id_t session_id,
+                                  const char *prompt, double temperature,
+                                  int32_t max_tokens) {
+  return reply_text(call(generate_request("generate", session_id, prompt,
+                                          NULL, temperature, max_tokens)),
+                    NO_SERVER);
+}
+
+char *ai_bridge_generate_structured_response(ai_bridge_session_id_t session_id,
+                                             const char *prompt,
+                                             const char *schema_json,
+                                             double temperature,
+                                             int32_t max_tokens) {
+  return reply_text(call(generate_request("generate_structured", session_id,
+                                          prompt, schema_json, temperature,
+                                          max_tokens)),
+                    NO_SERVER);
+}
+
+static ai_bridge_stream_id_t start_stream(
+    ai_bridge_session_id_t session_id, const char *prompt,
+    const char *schema_json, bool structured, double temperature,
+    int32_t max_tokens, void *context, ai_bridge_stream_callback_t callback,
+    void *user_data) {
+  connection_t *conn = get_connection();
+  client_stream_t *stream = conn ? calloc(1, sizeof(*stream)) : NULL;
+  if (!stream) {
+    if (conn) connection_release(conn);
+    return AI_BRIDGE_INVALID_ID;
+  }
+  stream->context = context;
+  stream->callback = callback;
+  stream->user_data = user_data;
+
+  // Registered before the request so early output finds it
+  pthread_mutex_lock(&conn->mutex);
+  stream->tag = ++conn->next_tag;
+  stream->next = conn->streams;
+  conn->streams = stream;
+  conn->stream_count++;
+  pthread_mutex_unlock(&conn->mutex);
+
+  cJSON *request = generate_request("stream", session_id, prompt, schema_json,
+                                    temperature, max_tokens);
+  if (request) {
+    cJSON_AddNumberToObject(request, "tag", stream->tag);
+    cJSON_AddBoolToObject(request, "structured", structured);
+  }
+  cJSON *reply = call_with(conn, request, stream);
+  ai_bridge_stream_id_t stream_id =
+      (ai_bridge_stream_id_t)reply_number(reply, "stream");
+  cJSON_Delete(reply);
+
+  if (stream_id == AI_BRIDGE_INVALID_ID) {
+    // Never started, so the reader will not deliver or free it
+    pthread_mutex_lock(&conn->mutex);
+    bool present = false;
+    for (client_stream_t *s = conn->streams; s; s = s->next) {
+      present |= s == stream;
+    }
+    pthread_mutex_unlock(&conn->mutex);
+    if (present) remove_stream(conn, stream);
+  }
+  connection_release(conn);
+  return stream_id;
+}
+
+ai_bridge_stream_id_t ai_bridge_generate_response_stream(
+    ai_bridge_session_id_t session_id, const char *prompt, double temperature,
+    int32_t max_tokens, void *context, ai_bridge_stream_callback_t callback,
+    void *user_data) {
+  return start_stream(session_id, prompt, NULL, false, temperature,
+                      max_tokens, context, callback, user_data);
+}
+
+ai_bridge_stream_id_t ai_bridge_generate_structured_response_stream(
+    ai_bridge_session_id_t session_id, const char *prompt,
+    const char *schema_json, double temperature, int32_t max_tokens,
+    void *context, ai_bridge_stream_callback_t callback, void *user_data) {
+  return start_stream(session_id, prompt, schema_json, true, temperature,
+                      max_tokens, context, callback, user_data);
+}
+
+bool ai_bridge_cancel_stream(ai_bridge_stream_id_t stream_id) {
+  cJSON *request = request_for("cancel");
+  if (request) cJSON_AddNumberToObject(request, "stream", stream_id);
+  return reply_ok(call(request));
+}
+
+int32_t ai_bridge_get_active_stream_count(void) {
+  pthread_mutex_lock(&g_mutex);
+  int32_t count = 0;
+  if (g_conn) {
+    pthread_mutex_lock(&g_conn->mutex);
+    count = g_conn->stream_count;
+    pthread_mutex_unlock(&g_conn->mutex);
+  }
+  pthread_mutex_unlock(&g_mutex);
+  return count;
+}
+
+char *ai_bridge_get_session_history(ai_bridge_session_id_t session_id) {
+  return reply_text(call(session_request("history", session_id)), NULL);
+}
+
+bool ai_bridge_clear_session_history(ai_bridge_session_id_t session_id) {
+  return reply_ok(call(session_request("clear_history", session_id)));
+}
+
+bool ai_bridge_add_message_to_history(ai_bridge_session_id_t session_id,
+                                      const char *role, const char *content) {
+  cJSON *request = session_request("add_message", session_id);
+  add_optional_string(request, "role", role);
+  add_optional_string(request, "content", content);
+  return reply_ok(call(request));
+}
+
+void ai_bridge_free_string(char *ptr) { free(ptr); }
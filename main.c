@@ -45,6 +45,10 @@
 #define TARGET_FPS 60
 #define FRAME_TIME_US (1000000 / TARGET_FPS)
 #define MAX_FRAME_TIME_US (1000000 / 30)
+#define MAX_SCROLL_DETECT_LINES 32
+#define SCROLL_REGION_OVERHEAD_CELLS 16
+#define SYNC_OUTPUT_BEGIN "\x1b[?2026h"
+#define SYNC_OUTPUT_END "\x1b[?2026l"
 #define UTF8_PLAIN_TEXT_TYPE CFSTR("public.utf8-plain-text")
 #define PLAIN_TEXT_TYPE CFSTR("public.plain-text")
 
@@ -82,6 +86,8 @@
 #define COLOR_LOGO_DARK 0x4A5568
 #define COLOR_LOGO_LIGHT 0x8BB9E8
 
+#define PERF_WINDOW_SIZE 10
+
 #define MESSAGE_PADDING 2
 #define MESSAGE_SEPARATOR_HEIGHT 1
 #define HEADER_SPACING 2
@@ -166,6 +172,25 @@ typedef struct {
   int max_tokens;
 } session_config_t;
 
+typedef struct {
+  double started_at;
+  double first_chunk_at;
+  double last_chunk_at;
+  double finished_at;
+  size_t output_bytes;
+  int chunk_count;
+} generation_timing_t;
+
+typedef struct {
+  int responses;
+  uint64_t total_tokens;
+  double total_generation_time;
+  double ttft_window[PERF_WINDOW_SIZE];
+  double tps_window[PERF_WINDOW_SIZE];
+  int window_count;
+  int window_next;
+} session_perf_t;
+
 typedef struct rendered_line {
   char *text;
   uintattr_t color;
@@ -182,6 +207,15 @@ typedef struct message {
   rendered_line_t *lines;
   int line_count;
   bool needs_rerender;
+  generation_timing_t timing;
+  bool has_timing;
+  bool timing_recorded;
+  // Header text, reformatted only when what it shows changes so an
+  // unchanged header draws the same cells every frame
+  char header_left[256];
+  char header_right[192];
+  bool header_dirty;
+  int header_wait_s;
   struct message *next;
 } message_t;
 
@@ -191,6 +225,8 @@ typedef struct message_update {
   bool is_streaming;
   tool_execution_t *new_tool_executions;
   bool process_markdown;
+  generation_timing_t timing;
+  bool has_timing;
   struct message_update *next;
 } message_update_t;
 
@@ -207,6 +243,7 @@ typedef struct {
   char *accumulated_text;
   size_t accumulated_length;
   bool waiting_for_stream;
+  generation_timing_t timing;
   pthread_mutex_t mutex;
 } streaming_context_t;
 
@@ -225,6 +262,16 @@ typedef struct {
   int visible_lines;
 } chat_display_t;
 
+typedef struct {
+  bool sync_output;
+  bool scroll_regions;
+  size_t last_frame_bytes;
+  float smooth_frame_bytes;
+  uint64_t total_bytes;
+  uint64_t scrolled_frames;
+  int last_scroll_lines;
+} output_state_t;
+
 static struct {
   int term_width;
   int term_height;
@@ -232,6 +279,7 @@ static struct {
   bool needs_resize;
   frame_timing_t timing;
   animation_state_t animation;
+  output_state_t output;
   ai_context_t *ai_context;
   ai_session_id_t ai_session;
   ai_availability_t ai_availability;
@@ -256,6 +304,7 @@ static struct {
   int input_pos;
   int input_scroll;
   streaming_context_t streaming;
+  session_perf_t perf;
   ai_stats_t stats;
 } app;
 
@@ -264,6 +313,8 @@ static void cleanup_app(void);
 static bool init_ai_session(void);
 static void cleanup_ai_session(void);
 static bool init_app_directory(void);
+static void init_logging(void);
+static void init_metrics_exporter(void);
 static char *load_schema_from_file(const char *filepath) {
   FILE *file = fopen(filepath, "r");
   if (!file) {
@@ -456,6 +507,9 @@ static void cleanup_update_queue(void);
 static void queue_message_update(message_t *msg, const char *content,
                                  bool is_streaming,
                                  tool_execution_t *tool_executions);
+static void queue_stream_update(message_t *msg, const char *content,
+                                bool is_streaming,
+                                const generation_timing_t *timing);
 static void process_message_updates(void);
 static message_update_t *create_message_update(
     message_t *msg, const char *content, bool is_streaming,
@@ -473,6 +527,16 @@ static void init_frame_timing(void);
 static void update_frame_timing(void);
 static void wait_for_next_frame(void);
 
+static void init_output_optimization(void);
+static void present_frame(void);
+
+static double get_monotonic_seconds(void);
+static void format_timing_metadata(const generation_timing_t *timing,
+                                   bool is_streaming, char *buffer,
+                                   size_t size);
+static void record_session_perf(const generation_timing_t *timing);
+static void reset_session_perf(void);
+
 static void update_animations(long delta_us);
 static void init_animations(void);
 
@@ -816,6 +880,8 @@ static message_update_t *create_message_update(
   update->is_streaming = is_streaming;
   update->new_tool_executions = clone_tool_executions(tool_executions);
   update->process_markdown = (content != NULL);
+  memset(&update->timing, 0, sizeof(generation_timing_t));
+  update->has_timing = false;
   update->next = NULL;
 
   return update;
@@ -830,13 +896,7 @@ static void free_message_update(message_update_t *update) {
   free(update);
 }
 
-static void queue_message_update(message_t *msg, const char *content,
-                                 bool is_streaming,
-                                 tool_execution_t *tool_executions) {
-  message_update_t *update =
-      create_message_update(msg, content, is_streaming, tool_executions);
-  if (!update) return;
-
+static void enqueue_message_update(message_update_t *update) {
   pthread_mutex_lock(&app.update_queue.mutex);
 
   if (app.update_queue.tail) {
@@ -850,6 +910,31 @@ static void queue_message_update(message_t *msg, const char *content,
   pthread_mutex_unlock(&app.update_queue.mutex);
 }
 
+static void queue_message_update(message_t *msg, const char *content,
+                                 bool is_streaming,
+                                 tool_execution_t *tool_executions) {
+  message_update_t *update =
+      create_message_update(msg, content, is_streaming, tool_executions);
+  if (!update) return;
+
+  enqueue_message_update(update);
+}
+
+static void queue_stream_update(message_t *msg, const char *content,
+                                bool is_streaming,
+                                const generation_timing_t *timing) {
+  message_update_t *update =
+      create_message_update(msg, content, is_streaming, NULL);
+  if (!update) return;
+
+  if (timing) {
+    update->timing = *timing;
+    update->has_timing = true;
+  }
+
+  enqueue_message_update(update);
+}
+
 static void render_markdown_lines(message_t *msg, const char *ansi_content) {
   if (!msg || !ansi_content) return;
 
@@ -936,6 +1021,18 @@ static void process_message_updates(void) {
       }
 
       current->target_message->is_streaming = current->is_streaming;
+      current->target_message->header_dirty = true;
+
+      if (current->has_timing) {
+        current->target_message->timing = current->timing;
+        current->target_message->has_timing = true;
+
+        if (!current->is_streaming &&
+            !current->target_message->timing_recorded) {
+          record_session_perf(&current->timing);
+          current->target_message->timing_recorded = true;
+        }
+      }
 
       if (current->new_tool_executions) {
         free_tool_executions(current->target_message->tool_executions);
@@ -1121,6 +1218,104 @@ static void wait_for_next_frame(void) {
   }
 }
 
+static double get_monotonic_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int estimate_output_tokens(size_t bytes) {
+  // Rough estimate: 1 token is about 4 characters of English text
+  return (int)((bytes + 3) / 4);
+}
+
+static double timing_tokens_per_second(const generation_timing_t *timing,
+                                       double end) {
+  if (timing->chunk_count == 0) return 0.0;
+
+  // Decode rate: tokens after the first chunk over the time they took.
+  // Single-chunk responses (structured output) fall back to total duration.
+  double window = end - timing->first_chunk_at;
+  if (timing->chunk_count < 2 || window <= 0.0) {
+    window = end - timing->started_at;
+  }
+  if (window <= 0.0) return 0.0;
+
+  return estimate_output_tokens(timing->output_bytes) / window;
+}
+
+static void format_timing_metadata(const generation_timing_t *timing,
+                                   bool is_streaming, char *buffer,
+                                   size_t size) {
+  buffer[0] = '\0';
+  if (!timing || timing->started_at <= 0.0) return;
+
+  // Live figures run to the latest chunk, so they only change with one;
+  // before the first, the wait is counted in whole seconds
+  if (timing->chunk_count == 0) {
+    if (is_streaming) {
+      snprintf(buffer, size, "waiting %ds",
+               (int)(get_monotonic_seconds() - timing->started_at));
+    } else if (timing->finished_at > 0.0) {
+      snprintf(buffer, size, "%.1fs",
+               timing->finished_at - timing->started_at);
+    }
+    return;
+  }
+
+  double end = is_streaming ? timing->last_chunk_at : timing->finished_at;
+  if (end <= 0.0) return;
+
+  double ttft = timing->first_chunk_at - timing->started_at;
+  int tokens = estimate_output_tokens(timing->output_bytes);
+  double tps = timing_tokens_per_second(timing, end);
+
+  if (is_streaming) {
+    snprintf(buffer, size, "TTFT %.2fs | ~%d tok | %.1f tok/s", ttft, tokens,
+             tps);
+  } else {
+    snprintf(buffer, size, "TTFT %.2fs | %.1fs | ~%d tok | %.1f tok/s", ttft,
+             end - timing->started_at, tokens, tps);
+  }
+}
+
+static void record_session_perf(const generation_timing_t *timing) {
+  if (!timing || timing->chunk_count == 0 || timing->finished_at <= 0.0)
+    return;
+
+  session_perf_t *perf = &app.perf;
+  double ttft = timing->first_chunk_at - timing->started_at;
+  double tps = timing_tokens_per_second(timing, timing->finished_at);
+
+  perf->responses++;
+  perf->total_tokens += estimate_output_tokens(timing->output_bytes);
+  perf->total_generation_time += timing->finished_at - timing->started_at;
+
+  AI_LOG(AI_LOG_INFO, "momo.response", AI_LOG_DOUBLE("ttft_ms", ttft * 1000.0),
+         AI_LOG_DOUBLE("duration_ms",
+                       (timing->finished_at - timing->started_at) * 1000.0),
+         AI_LOG_UINT("bytes_out", timing->output_bytes),
+         AI_LOG_INT("chunks", timing->chunk_count),
+         AI_LOG_DOUBLE("tokens_per_second", tps));
+
+  perf->ttft_window[perf->window_next] = ttft;
+  perf->tps_window[perf->window_next] = tps;
+  perf->window_next = (perf->window_next + 1) % PERF_WINDOW_SIZE;
+  if (perf->window_count < PERF_WINDOW_SIZE) perf->window_count++;
+}
+
+static void reset_session_perf(void) {
+  memset(&app.perf, 0, sizeof(session_perf_t));
+}
+
+static double window_average(const double *values, int count) {
+  if (count == 0) return 0.0;
+
+  double sum = 0.0;
+  for (int i = 0; i < count; i++) sum += values[i];
+  return sum / count;
+}
+
 static void init_animations(void) {
   memset(&app.animation, 0, sizeof(animation_state_t));
   app.animation.show_cursor = true;
@@ -2098,46 +2293,70 @@ static int render_chat_line_with_ansi(const char *text, int x, int y,
   return current_y - y + 1;
 }
 
-static void render_message_header(message_t *msg, int x, int y, int max_width) {
-  if (!msg) return;
-
-  uintattr_t label_color = get_message_label_color(msg->type);
+static void format_message_header(message_t *msg, char *left,
+                                  size_t left_size, char *right,
+                                  size_t right_size) {
   const char *label_text = get_message_label_text(msg->type);
   const char *label_icon = get_message_label_icon(msg->type);
 
+  if (msg->tool_name) {
+    snprintf(left, left_size, "%s %s (%s)", label_icon, label_text,
+             msg->tool_name);
+  } else {
+    snprintf(left, left_size, "%s %s", label_icon, label_text);
+  }
+
   char *time_str = format_time(msg->timestamp);
-  char header_left[256];
 
-  if (msg->tool_name) {
-    snprintf(header_left, sizeof(header_left), "%s %s (%s)", label_icon,
-             label_text, msg->tool_name);
+  if (msg->type == MSG_ASSISTANT && msg->has_timing) {
+    char metadata[128];
+    format_timing_metadata(&msg->timing, msg->is_streaming, metadata,
+                           sizeof(metadata));
+    snprintf(right, right_size, "%s%s%s", metadata, metadata[0] ? "  " : "",
+             time_str);
   } else {
-    snprintf(header_left, sizeof(header_left), "%s %s", label_icon, label_text);
+    snprintf(right, right_size, "%s", time_str);
   }
 
-  int time_len = strlen(time_str);
+  free(time_str);
+}
+
+static void update_message_header(message_t *msg) {
+  int wait_s = -1;
+  if (msg->is_streaming && msg->has_timing && msg->timing.chunk_count == 0) {
+    wait_s = (int)(get_monotonic_seconds() - msg->timing.started_at);
+  }
+  if (!msg->header_dirty && wait_s == msg->header_wait_s) return;
+
+  format_message_header(msg, msg->header_left, sizeof(msg->header_left),
+                        msg->header_right, sizeof(msg->header_right));
+  msg->header_wait_s = wait_s;
+  msg->header_dirty = false;
+}
+
+static void render_message_header(message_t *msg, int x, int y, int max_width) {
+  if (!msg) return;
+
+  uintattr_t label_color = get_message_label_color(msg->type);
+
+  const char *header_left = msg->header_left;
+  const char *header_right = msg->header_right;
+
+  int right_len = strlen(header_right);
   int header_len = strlen(header_left);
 
-  if (max_width > header_len + time_len + 5) {
-    char full_header[512];
-    int padding = max_width - header_len - time_len;
-    snprintf(full_header, sizeof(full_header), "%s%*s%s", header_left, padding,
-             "", time_str);
+  render_chat_line_with_ansi(header_left, x, y, max_width,
+                             label_color | TB_BOLD, COLOR_BG);
 
-    render_chat_line_with_ansi(full_header, x, y, max_width,
-                               label_color | TB_BOLD, COLOR_BG);
+  if (max_width > header_len + right_len + 5) {
+    render_chat_line_with_ansi(header_right, x + max_width - right_len, y,
+                               right_len, COLOR_METADATA, COLOR_BG);
   } else {
-    render_chat_line_with_ansi(header_left, x, y, max_width,
-                               label_color | TB_BOLD, COLOR_BG);
-
-    char timestamp_line[64];
-    snprintf(timestamp_line, sizeof(timestamp_line), "%*s%s",
-             max_width - time_len, "", time_str);
-    render_chat_line_with_ansi(timestamp_line, x, y + 1, max_width,
-                               COLOR_TIMESTAMP, COLOR_BG);
+    int right_x = max_width > right_len ? x + max_width - right_len : x;
+    render_chat_line_with_ansi(header_right, right_x, y + 1,
+                               max_width - (right_x - x), COLOR_TIMESTAMP,
+                               COLOR_BG);
   }
-
-  free(time_str);
 }
 
 static void draw_chat_messages(void) {
@@ -2171,29 +2390,14 @@ static void draw_chat_messages(void) {
   while (msg) {
     total_items++;
 
-    const char *label_text = get_message_label_text(msg->type);
-    const char *label_icon = get_message_label_icon(msg->type);
-    char *time_str = format_time(msg->timestamp);
-    char header_left[256];
-
-    if (msg->tool_name) {
-      snprintf(header_left, sizeof(header_left), "%s %s (%s)", label_icon,
-               label_text, msg->tool_name);
-    } else {
-      snprintf(header_left, sizeof(header_left), "%s %s", label_icon,
-               label_text);
-    }
-
     int available_width = app.chat_width - 4;
-    int time_len = strlen(time_str);
-    int header_len = strlen(header_left);
+    int right_len = strlen(msg->header_right);
+    int header_len = strlen(msg->header_left);
 
-    if (available_width <= header_len + time_len + 5) {
+    if (available_width <= header_len + right_len + 5) {
       total_items++;
     }
 
-    free(time_str);
-
     total_items += msg->line_count;
 
     total_items++;
@@ -2217,24 +2421,11 @@ static void draw_chat_messages(void) {
     header_item->is_separator = false;
     header_item->line = NULL;
 
-    const char *label_text = get_message_label_text(msg->type);
-    const char *label_icon = get_message_label_icon(msg->type);
-    char *time_str = format_time(msg->timestamp);
-    char header_left[256];
-
-    if (msg->tool_name) {
-      snprintf(header_left, sizeof(header_left), "%s %s (%s)", label_icon,
-               label_text, msg->tool_name);
-    } else {
-      snprintf(header_left, sizeof(header_left), "%s %s", label_icon,
-               label_text);
-    }
-
     int available_width = app.chat_width - 4;
-    int time_len = strlen(time_str);
-    int header_len = strlen(header_left);
+    int right_len = strlen(msg->header_right);
+    int header_len = strlen(msg->header_left);
 
-    if (available_width > header_len + time_len + 5) {
+    if (available_width > header_len + right_len + 5) {
       header_item->header_lines = 1;
     } else {
       header_item->header_lines = 2;
@@ -2248,8 +2439,6 @@ static void draw_chat_messages(void) {
       }
     }
 
-    free(time_str);
-
     rendered_line_t *line = msg->lines;
     while (line && item_index < total_items) {
       display_item_t *content_item = &all_items[item_index++];
@@ -2375,6 +2564,55 @@ static bool init_app_directory(void) {
   return true;
 }
 
+static ai_log_level_t parse_log_level(const char *value) {
+  if (strcasecmp(value, "trace") == 0) return AI_LOG_TRACE;
+  if (strcasecmp(value, "debug") == 0) return AI_LOG_DEBUG;
+  if (strcasecmp(value, "info") == 0) return AI_LOG_INFO;
+  if (strcasecmp(value, "warn") == 0) return AI_LOG_WARN;
+  if (strcasecmp(value, "error") == 0) return AI_LOG_ERROR;
+  return AI_LOG_OFF;
+}
+
+static void init_logging(void) {
+  if (!app.app_dir) return;
+
+  const char *level_env = getenv("MOMO_LOG_LEVEL");
+  ai_log_level_t level = level_env ? parse_log_level(level_env) : AI_LOG_INFO;
+  if (level == AI_LOG_OFF) return;
+
+  size_t path_len = strlen(app.app_dir) + strlen("/logs") + 1;
+  char *log_dir = malloc(path_len);
+  if (!log_dir) return;
+  snprintf(log_dir, path_len, "%s/logs", app.app_dir);
+
+  ai_log_config_t config = AI_DEFAULT_LOG_CONFIG;
+  config.directory = log_dir;
+  config.file_prefix = "momo";
+  config.level = level;
+
+  if (ai_log_init(&config) == AI_SUCCESS) {
+    AI_LOG(AI_LOG_INFO, "momo.start", AI_LOG_STR("version", MOMO_VERSION),
+           AI_LOG_STR("libai", ai_get_version()));
+  }
+
+  free(log_dir);
+}
+
+static void init_metrics_exporter(void) {
+  ai_metrics_exporter_config_t config = {0};
+  config.unix_socket_path = getenv("MOMO_METRICS_SOCKET");
+
+  const char *port = getenv("MOMO_METRICS_PORT");
+  if (port) config.port = (uint16_t)atoi(port);
+
+  if (!config.unix_socket_path && config.port == 0) return;
+
+  ai_result_t result = ai_metrics_exporter_start(&config);
+  if (result != AI_SUCCESS) {
+    show_error_with_code(result, "Failed to start metrics exporter");
+  }
+}
+
 static bool load_tools_config(void) {
   if (!app.app_dir) {
     return false;
@@ -3180,6 +3418,7 @@ static void init_app(void) {
 
   init_frame_timing();
   init_animations();
+  init_output_optimization();
 
   update_dimensions();
 
@@ -3187,6 +3426,9 @@ static void init_app(void) {
     add_message(MSG_SYSTEM, "Failed to initialize application directory");
   }
 
+  init_logging();
+  init_metrics_exporter();
+
   if (!load_tools_config()) {
     add_message(MSG_SYSTEM, "Failed to load tools configuration");
   }
@@ -3205,6 +3447,13 @@ static bool init_ai_session(void) {
     return false;
   }
 
+  // Give up on a stream that stops producing chunks rather than showing
+  // "Generating response..." forever
+  ai_stall_watchdog_config_t watchdog = AI_DEFAULT_STALL_WATCHDOG_CONFIG;
+  watchdog.stall_ms = 60000;
+  watchdog.auto_cancel = true;
+  ai_set_stall_watchdog(&watchdog);
+
   app.ai_availability = ai_check_availability();
   app.availability_reason = ai_get_availability_reason();
 
@@ -3336,6 +3585,255 @@ static void update_dimensions(void) {
   }
 }
 
+static bool env_flag(const char *name, bool *value) {
+  const char *env = getenv(name);
+  if (!env || !*env) return false;
+
+  *value = !(strcmp(env, "0") == 0 || strcasecmp(env, "off") == 0 ||
+             strcasecmp(env, "false") == 0);
+  return true;
+}
+
+static bool terminal_supports_sync_output(void) {
+  const char *term_program = getenv("TERM_PROGRAM");
+  const char *term = getenv("TERM");
+
+  if (term_program) {
+    const char *known[] = {"iTerm.app", "WezTerm", "ghostty", "vscode",
+                           "contour"};
+    for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+      if (strcmp(term_program, known[i]) == 0) return true;
+    }
+  }
+
+  if (term) {
+    const char *known[] = {"kitty", "foot", "alacritty", "ghostty", "wezterm",
+                           "contour"};
+    for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+      if (strstr(term, known[i])) return true;
+    }
+  }
+
+  return false;
+}
+
+static void init_output_optimization(void) {
+  memset(&app.output, 0, sizeof(output_state_t));
+
+  if (!env_flag("MOMO_SYNC_OUTPUT", &app.output.sync_output)) {
+    app.output.sync_output = terminal_supports_sync_output();
+  }
+
+  if (!env_flag("MOMO_SCROLL_REGIONS", &app.output.scroll_regions)) {
+    app.output.scroll_regions = true;
+  }
+}
+
+static uint64_t hash_cell_row(struct cellbuf_t *buf, int y, int x0, int x1) {
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (int x = x0; x < x1; x++) {
+    struct tb_cell *cell = &buf->cells[y * buf->width + x];
+    uint64_t parts[3] = {cell->ch, (uint64_t)cell->fg, (uint64_t)cell->bg};
+    for (int i = 0; i < 3; i++) {
+      hash ^= parts[i];
+      hash *= 1099511628211ULL;
+    }
+    for (size_t i = 0; i < cell->nech; i++) {
+      hash ^= cell->ech[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  return hash;
+}
+
+static int count_row_diff(int back_y, int front_y, int width,
+                          struct tb_cell *blank) {
+  int diff = 0;
+
+  for (int x = 0; x < width; x++) {
+    struct tb_cell *back = &global.back.cells[back_y * width + x];
+    struct tb_cell *front =
+        front_y >= 0 ? &global.front.cells[front_y * width + x] : blank;
+    if (cell_cmp(back, front) != 0) diff++;
+  }
+
+  return diff;
+}
+
+/*
+ * Streaming usually pushes the whole chat pane up by a line or two, which
+ * termbox sees as every cell changing. Compare the new chat rows against the
+ * rows termbox believes are on screen, shifted by 1..N lines, and pick the
+ * shift that leaves the fewest cells to repaint. Returns 0 when scrolling
+ * the terminal would not save anything.
+ */
+static int detect_chat_scroll(int top, int bottom) {
+  int width = global.front.width;
+  int rows = bottom - top + 1;
+  int chat_x1 = app.chat_width < width ? app.chat_width : width;
+
+  if (rows < 4 || chat_x1 <= 0) return 0;
+
+  int max_shift = rows / 2;
+  if (max_shift > MAX_SCROLL_DETECT_LINES) max_shift = MAX_SCROLL_DETECT_LINES;
+
+  uint64_t back_hash[rows];
+  uint64_t front_hash[rows];
+  for (int i = 0; i < rows; i++) {
+    back_hash[i] = hash_cell_row(&global.back, top + i, 0, chat_x1);
+    front_hash[i] = hash_cell_row(&global.front, top + i, 0, chat_x1);
+  }
+
+  int unchanged = 0;
+  for (int i = 0; i < rows; i++) {
+    if (back_hash[i] == front_hash[i]) unchanged++;
+  }
+
+  int best_shift = 0;
+  int best_matches = unchanged;
+  for (int shift = 1; shift <= max_shift; shift++) {
+    int matches = 0;
+    for (int i = 0; i + shift < rows; i++) {
+      if (back_hash[i] == front_hash[i + shift]) matches++;
+    }
+    if (matches > best_matches) {
+      best_matches = matches;
+      best_shift = shift;
+    }
+  }
+
+  if (best_shift == 0 || best_matches < rows / 2) return 0;
+
+  // DECSTBM moves whole lines, so the sidebar moves too. Only scroll when
+  // the full-width repaint after the shift is cheaper than the plain diff.
+  struct tb_cell blank = {.ch = ' ', .fg = global.fg, .bg = global.bg};
+  int cost_plain = 0;
+  int cost_scrolled = SCROLL_REGION_OVERHEAD_CELLS;
+  for (int y = top; y <= bottom; y++) {
+    cost_plain += count_row_diff(y, y, width, &blank);
+    int source = y + best_shift <= bottom ? y + best_shift : -1;
+    cost_scrolled += count_row_diff(y, source, width, &blank);
+  }
+
+  return cost_scrolled < cost_plain ? best_shift : 0;
+}
+
+static void apply_terminal_scroll(int top, int bottom, int lines) {
+  int width = global.front.width;
+  uint32_t space = ' ';
+
+  // Lines scrolled in take the current background, so reset to the clear
+  // attributes first.
+  send_attr(global.fg, global.bg);
+  tb_sendf("\x1b[%d;%dr", top + 1, bottom + 1);
+  tb_sendf("\x1b[%d;1H", bottom + 1);
+  for (int i = 0; i < lines; i++) {
+    tb_send("\x1b" "D", 2);
+  }
+  tb_send("\x1b[r", 3);
+
+  global.last_x = -1;
+  global.last_y = -1;
+
+  for (int y = top; y <= bottom; y++) {
+    for (int x = 0; x < width; x++) {
+      struct tb_cell *dst = &global.front.cells[y * width + x];
+      if (y + lines <= bottom) {
+        cell_copy(dst, &global.front.cells[(y + lines) * width + x]);
+      } else {
+        cell_set(dst, &space, 1, global.fg, global.bg);
+      }
+    }
+  }
+}
+
+/*
+ * Equivalent of tb_present() that can prepend a terminal-side scroll, wrap
+ * the frame in synchronized output mode and account for the bytes sent.
+ */
+static void present_frame(void) {
+  size_t start_len = global.out.len;
+
+  if (global.back.width != global.front.width ||
+      global.back.height != global.front.height) {
+    tb_present();
+    return;
+  }
+
+  if (app.output.sync_output) {
+    tb_send(SYNC_OUTPUT_BEGIN, strlen(SYNC_OUTPUT_BEGIN));
+  }
+
+  app.output.last_scroll_lines = 0;
+  if (app.output.scroll_regions && app.state == STATE_CHAT) {
+    int bottom = app.chat_height - 1;
+    if (bottom >= global.front.height) bottom = global.front.height - 1;
+
+    int lines = detect_chat_scroll(0, bottom);
+    if (lines > 0) {
+      apply_terminal_scroll(0, bottom, lines);
+      app.output.last_scroll_lines = lines;
+      app.output.scrolled_frames++;
+    }
+  }
+
+  global.last_x = -1;
+  global.last_y = -1;
+
+  for (int y = 0; y < global.front.height; y++) {
+    for (int x = 0; x < global.front.width;) {
+      struct tb_cell *back = &global.back.cells[y * global.back.width + x];
+      struct tb_cell *front = &global.front.cells[y * global.front.width + x];
+
+      int w = back->nech > 0 ? tb_wcswidth(back->ech, back->nech)
+                             : tb_wcwidth((wchar_t)back->ch);
+      if (w < 1) w = 1;
+
+      if (cell_cmp(back, front) != 0) {
+        cell_copy(front, back);
+        send_attr(back->fg, back->bg);
+
+        if (w > 1 && x >= global.front.width - (w - 1)) {
+          for (int i = x; i < global.front.width; i++) {
+            send_char(i, y, ' ');
+          }
+        } else {
+          if (back->nech > 0) {
+            send_cluster(x, y, back->ech, back->nech);
+          } else {
+            send_char(x, y, back->ch);
+          }
+
+          for (int i = 1; i < w; i++) {
+            uint32_t invalid = -1;
+            cell_set(&global.front.cells[y * global.front.width + x + i],
+                     &invalid, 1, -1, -1);
+          }
+        }
+      }
+      x += w;
+    }
+  }
+
+  send_cursor_if(global.cursor_x, global.cursor_y);
+
+  if (app.output.sync_output) {
+    tb_send(SYNC_OUTPUT_END, strlen(SYNC_OUTPUT_END));
+  }
+
+  size_t frame_bytes = global.out.len - start_len;
+  app.output.last_frame_bytes = frame_bytes;
+  app.output.total_bytes += frame_bytes;
+
+  float alpha = 0.1f;
+  app.output.smooth_frame_bytes =
+      alpha * frame_bytes + (1.0f - alpha) * app.output.smooth_frame_bytes;
+
+  bytebuf_flush(&global.out, global.wfd);
+}
+
 static void render_frame(void) {
   process_message_updates();
 
@@ -3344,6 +3842,7 @@ static void render_frame(void) {
     if (msg->needs_rerender) {
       render_message_content(msg);
     }
+    update_message_header(msg);
     msg = msg->next;
   }
 
@@ -3369,7 +3868,7 @@ static void render_frame(void) {
 
   draw_input_bar();
 
-  tb_present();
+  present_frame();
 }
 
 static bool pending_escape = false;
@@ -3413,6 +3912,7 @@ static void handle_input(struct tb_event *ev) {
     if (app.current_streaming) {
       app.current_streaming->is_streaming = false;
       app.current_streaming->needs_rerender = true;
+      app.current_streaming->header_dirty = true;
     }
     pthread_mutex_unlock(&app.streaming.mutex);
 
@@ -3928,6 +4428,23 @@ static void draw_sidebar(void) {
   tb_printf(x + 2, y++, COLOR_FG, COLOR_BG, "Lines: %d", app.chat.total_lines);
   tb_printf(x + 2, y++, COLOR_ACCENT, COLOR_BG, "FPS: %.1f",
             app.timing.smooth_fps);
+  tb_printf(x + 2, y++, COLOR_ACCENT, COLOR_BG, "Out: %.0f B/frame",
+            app.output.smooth_frame_bytes);
+  tb_printf(x + 2, y++, COLOR_FG, COLOR_BG, "Scrolls: %" PRIu64 "%s",
+            app.output.scrolled_frames, app.output.sync_output ? " (sync)" : "");
+  y++;
+
+  tb_printf(x, y++, COLOR_LABEL_SYSTEM | TB_BOLD, COLOR_BG, "▶ PERFORMANCE");
+  tb_printf(x + 2, y++, COLOR_FG, COLOR_BG, "Responses: %d",
+            app.perf.responses);
+  if (app.perf.window_count > 0) {
+    tb_printf(x + 2, y++, COLOR_ACCENT, COLOR_BG, "Avg TTFT: %.2fs",
+              window_average(app.perf.ttft_window, app.perf.window_count));
+    tb_printf(x + 2, y++, COLOR_ACCENT, COLOR_BG, "Avg tok/s: %.1f",
+              window_average(app.perf.tps_window, app.perf.window_count));
+  }
+  tb_printf(x + 2, y++, COLOR_FG, COLOR_BG, "Tokens: ~%" PRIu64,
+            app.perf.total_tokens);
   y++;
 
   tb_printf(x, y++, COLOR_LABEL_SYSTEM | TB_BOLD, COLOR_BG, "▶ CONTROLS");
@@ -4188,6 +4705,7 @@ static void process_command(const char *input) {
         ai_clear_session_history(app.ai_context, app.ai_session);
     if (result == AI_SUCCESS) {
       free_messages();
+      reset_session_perf();
       calculate_chat_metrics();
       scroll_to_bottom();
       add_message(MSG_SYSTEM, "◆ Chat history cleared successfully");
@@ -4196,6 +4714,7 @@ static void process_command(const char *input) {
     }
   } else if (strcmp(input, "/new") == 0) {
     free_messages();
+    reset_session_perf();
     cleanup_ai_session();
     if (init_ai_session()) {
       app.state = STATE_CHAT;
@@ -4257,11 +4776,32 @@ static void process_command(const char *input) {
              "▶ Max Tokens: %d\n"
              "▶ MCP Tools: %d\n"
              "▶ Thread Safety: ENABLED\n"
-             "▶ Performance: %.1f FPS",
+             "▶ Performance: %.1f FPS\n"
+             "▶ Output: %.0f B/frame, %" PRIu64 " scrolled frames%s",
              avail_icon, avail_desc,
              app.session_config.enable_tools ? "⚡ ENABLED" : "● DISABLED",
              app.session_config.temperature, app.session_config.max_tokens,
-             app.tool_count, app.timing.smooth_fps);
+             app.tool_count, app.timing.smooth_fps,
+             app.output.smooth_frame_bytes, app.output.scrolled_frames,
+             app.output.sync_output ? " (synchronized)" : "");
+
+    ai_session_stats_t session_stats;
+    if (ai_get_session_stats(app.ai_context, app.ai_session, &session_stats) ==
+        AI_SUCCESS) {
+      size_t used = strlen(status_msg);
+      const ai_op_stats_t *model = &session_stats.model;
+      const ai_op_stats_t *tools = &session_stats.tools;
+      snprintf(status_msg + used, sizeof(status_msg) - used,
+               "\n▶ Model: %" PRIu64 " calls, %" PRIu64 " errors, %.2fs avg\n"
+               "▶ Tool Calls: %" PRIu64 ", %" PRIu64 " errors, %.1fms avg",
+               model->invocations, model->errors,
+               model->invocations ? model->total_time / model->invocations
+                                  : 0.0,
+               tools->invocations, tools->errors,
+               tools->invocations
+                   ? tools->total_time * 1000.0 / tools->invocations
+                   : 0.0);
+    }
 
     add_message(MSG_SYSTEM, status_msg);
   } else if (strncmp(input, "/temp ", 6) == 0) {
@@ -4304,14 +4844,27 @@ static void streaming_callback(ai_context_t *context, const char *chunk,
 
   pthread_mutex_lock(&app.streaming.mutex);
 
-  if (chunk == NULL) {
+  // An error chunk, such as a stalled stream the watchdog cancelled, is the
+  // last one the stream delivers and is shown in place of the reply
+  bool is_error = chunk && strncmp(chunk, "Error:", 6) == 0;
+  if (is_error) {
+    free(app.streaming.accumulated_text);
+    app.streaming.accumulated_text = strdup(chunk);
+    app.streaming.accumulated_length =
+        app.streaming.accumulated_text ? strlen(chunk) : 0;
+  }
+
+  if (chunk == NULL || is_error) {
     app.streaming.active = false;
     app.streaming.stream_id = AI_INVALID_ID;
     app.streaming.waiting_for_stream = false;
 
+    app.streaming.timing.finished_at = get_monotonic_seconds();
+
     if (app.current_streaming && app.streaming.accumulated_text) {
-      queue_message_update(app.current_streaming,
-                           app.streaming.accumulated_text, false, NULL);
+      queue_stream_update(app.current_streaming,
+                          app.streaming.accumulated_text, false,
+                          &app.streaming.timing);
     }
 
     if (app.streaming.accumulated_text) {
@@ -4326,6 +4879,14 @@ static void streaming_callback(ai_context_t *context, const char *chunk,
 
     size_t chunk_len = strlen(chunk);
     size_t old_len = app.streaming.accumulated_length;
+
+    double now = get_monotonic_seconds();
+    if (app.streaming.timing.chunk_count == 0) {
+      app.streaming.timing.first_chunk_at = now;
+    }
+    app.streaming.timing.last_chunk_at = now;
+    app.streaming.timing.chunk_count++;
+    app.streaming.timing.output_bytes += chunk_len;
     size_t new_len = old_len + chunk_len;
 
     char *new_text = realloc(app.streaming.accumulated_text, new_len + 1);
@@ -4338,8 +4899,9 @@ static void streaming_callback(ai_context_t *context, const char *chunk,
       app.streaming.accumulated_text[new_len] = '\0';
 
       if (app.current_streaming) {
-        queue_message_update(app.current_streaming,
-                             app.streaming.accumulated_text, true, NULL);
+        queue_stream_update(app.current_streaming,
+                            app.streaming.accumulated_text, true,
+                            &app.streaming.timing);
       }
     }
   }
@@ -4395,6 +4957,9 @@ static void start_streaming_response(const char *prompt, const char *schema) {
   app.streaming.accumulated_text = malloc(1);
   app.streaming.accumulated_text[0] = '\0';
   app.streaming.accumulated_length = 0;
+  app.streaming.timing = (generation_timing_t){
+      .started_at = get_monotonic_seconds()};
+  generation_timing_t timing = app.streaming.timing;
   pthread_mutex_unlock(&app.streaming.mutex);
 
   add_message(MSG_ASSISTANT, "");
@@ -4408,9 +4973,13 @@ static void start_streaming_response(const char *prompt, const char *schema) {
   app.current_streaming = msg;
   pthread_mutex_unlock(&app.streaming.mutex);
 
+  // The header shows how long the reply has waited until the first chunk
   if (msg) {
     msg->is_streaming = true;
     msg->needs_rerender = true;
+    msg->timing = timing;
+    msg->has_timing = true;
+    msg->header_dirty = true;
   }
 
   ai_generation_params_t params = AI_DEFAULT_PARAMS;
@@ -4469,6 +5038,11 @@ static void add_message(message_type_t type, const char *content) {
   msg->needs_rerender = true;
   msg->next = NULL;
   msg->tool_executions = NULL;
+  msg->timing = (generation_timing_t){0};
+  msg->has_timing = false;
+  msg->timing_recorded = false;
+  msg->header_dirty = true;
+  msg->header_wait_s = -1;
 
   if (!app.messages) {
     app.messages = msg;
@@ -4567,6 +5141,9 @@ static void cleanup_app(void) {
     free(app.app_dir);
   }
 
+  ai_metrics_exporter_stop();
+  ai_log_shutdown();
+
   tb_shutdown();
 }
 
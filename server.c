@@ -0,0 +1,2077 @@
+/*
+ * libai-server: OpenAI-compatible HTTP front end for libai.
+ *
+ * One process owns the model and every client shares it. The server exposes
+ *
+ *   POST /v1/chat/completions   chat completions, optionally streamed as SSE,
+ *                               with json_schema response_format support
+ *   GET  /v1/models             the single system model
+ *   GET  /health                liveness probe
+ *   GET  /metrics               libai OpenMetrics plus server counters
+ *
+ * on a loopback TCP port or a Unix socket. With --ipc, co-located processes
+ * linked against libai-client can also drive the model directly through
+ * shared memory (see server_ipc.c). A single poll() event loop owns all
+ * sockets and does all socket I/O. Parsed requests go to a bounded FIFO
+ * scheduler drained by a fixed set of workers. Each worker has its own libai
+ * context and keeps one prewarmed session with the server's default
+ * instructions, so a request only pays for session creation when it brings
+ * its own system prompt. Sessions keep their transcript, so every request gets
+ * a fresh one and the spare is refilled after the response has been queued.
+ *
+ * Workers and stream callbacks never touch sockets: they append to the
+ * connection's output buffer and wake the loop through a pipe.
+ *
+ * Requests with an explicit temperature of 0 are treated as deterministic and
+ * answered from an exact-match LRU cache when possible, without reaching the
+ * scheduler at all. Deterministic json_schema requests can also be answered
+ * from a second cache of near-duplicates (--similar-cache-size): prompts that
+ * differ only in whitespace, casing, punctuation, timestamps or a reworded
+ * phrase have SimHash signatures a few bits apart. Any other number in the
+ * prompt has to match exactly.
+ *
+ * Usage:
+ *   libai-server [--port N | --unix PATH] [--workers N] [--queue N]
+ *                [--instructions TEXT] [--cache-size N] [--max-body BYTES]
+ *                [--similar-cache-size N] [--similar-distance BITS]
+ *                [--ipc PATH]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ai.h"
+#include "server_ipc.h"
+#include "third-party/cJSON.h"
+
+#define SERVER_NAME "libai-server"
+#define MODEL_ID "apple-foundation-model"
+#define DEFAULT_PORT 8080
+#define MAX_WORKERS 16
+#define HEADER_LIMIT (16 * 1024)
+#define IDLE_TIMEOUT_S 30.0
+#define POLL_INTERVAL_MS 1000
+#define CANCEL_CHECK_MS 200
+// libai treats 0 as "model default", so an explicit 0 is sent as this
+#define MIN_TEMPERATURE 1e-3
+// Similar-prompt signatures are split into bands for LSH lookup. Probing
+// every one-bit neighbour of each band finds any signature that differs in
+// fewer than 2 * SIMILAR_BANDS bits.
+#define SIMILAR_BANDS 4
+#define SIMILAR_BAND_BITS 16
+#define SIMILAR_MAX_DISTANCE (2 * SIMILAR_BANDS - 1)
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+} buffer_t;
+
+typedef struct connection {
+  int fd;
+  _Atomic(int) refs;
+
+  // Shared with workers and stream callbacks
+  pthread_mutex_t mutex;
+  buffer_t out;
+  bool response_done;
+  bool closed;
+
+  // Event loop only
+  buffer_t in;
+  size_t out_sent;
+  bool busy;
+  bool keep_alive;
+  double last_active_s;
+} connection_t;
+
+typedef struct job {
+  connection_t *conn;
+  char id[40];
+  char *model;
+  long long created;
+  char *instructions; /* NULL uses the server default */
+  char *prompt;
+  char *schema; /* NULL for plain text */
+  ai_generation_params_t params;
+  bool stream;
+  char *cache_key; /* non-NULL when the answer may be cached */
+  size_t cache_key_length;
+  char *similar_scope; /* non-NULL when a near-duplicate answer may be used */
+  size_t similar_scope_length;
+  uint64_t signature;
+  double enqueued_s;
+  struct job *next;
+} job_t;
+
+typedef struct {
+  int index;
+  pthread_t thread;
+  ai_context_t *context;
+  ai_session_id_t spare;
+
+  // Stream state, shared with the stream callback
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  job_t *job;
+  bool stream_done;
+  bool stream_failed;
+  char error[256];
+  buffer_t text;
+} worker_t;
+
+typedef struct cache_entry {
+  uint64_t hash;
+  char *key;
+  size_t key_length;
+  char *content;
+  struct cache_entry *bucket_next;
+  struct cache_entry *lru_prev;
+  struct cache_entry *lru_next;
+} cache_entry_t;
+
+typedef struct similar_entry {
+  uint64_t signature;
+  uint64_t scope_hash;
+  char *scope; /* instructions, schema and max_tokens, which must match */
+  size_t scope_length;
+  char *content;
+  struct similar_entry *bucket_next[SIMILAR_BANDS];
+  struct similar_entry *lru_prev;
+  struct similar_entry *lru_next;
+} similar_entry_t;
+
+static struct {
+  uint16_t port;
+  const char *unix_path;
+  const char *ipc_path;
+  int workers;
+  int queue;
+  const char *instructions;
+  int cache_size;
+  int similar_cache_size;
+  int similar_distance;
+  size_t max_body;
+} options = {
+    .port = DEFAULT_PORT,
+    .workers = 4,
+    .queue = 256,
+    .cache_size = 256,
+    .similar_distance = 3,
+    .max_body = 1024 * 1024,
+};
+
+static struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  job_t *head;
+  job_t *tail;
+  int depth;
+  bool stopping;
+} g_queue = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+             .cond = PTHREAD_COND_INITIALIZER};
+
+static struct {
+  pthread_mutex_t mutex;
+  cache_entry_t **buckets;
+  size_t bucket_count;
+  cache_entry_t *lru_head; /* most recently used */
+  cache_entry_t *lru_tail;
+  int entries;
+} g_cache = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static struct {
+  pthread_mutex_t mutex;
+  similar_entry_t **buckets[SIMILAR_BANDS];
+  size_t bucket_count;
+  similar_entry_t *lru_head; /* most recently used */
+  similar_entry_t *lru_tail;
+  int entries;
+} g_similar = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static struct {
+  _Atomic(uint64_t) requests;
+  _Atomic(uint64_t) responses[6]; /* 1xx..5xx by first digit, [0] unused */
+  _Atomic(uint64_t) rejected;
+  _Atomic(uint64_t) cache_hits;
+  _Atomic(uint64_t) cache_misses;
+  _Atomic(uint64_t) similar_misses;
+  _Atomic(uint64_t) similar_hits[SIMILAR_MAX_DISTANCE + 1]; /* by distance */
+  _Atomic(uint64_t) queue_wait_us;
+  _Atomic(uint64_t) scheduled;
+  _Atomic(int64_t) connections;
+} g_stats;
+
+static int g_wake_pipe[2] = {-1, -1};
+static volatile sig_atomic_t g_stop;
+
+static double monotonic_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ---- Buffers and JSON text --------------------------------------------- */
+
+static bool buffer_reserve(buffer_t *buffer, size_t extra) {
+  if (buffer->length + extra + 1 <= buffer->capacity) return true;
+
+  size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+  while (capacity < buffer->length + extra + 1) capacity *= 2;
+  char *data = realloc(buffer->data, capacity);
+  if (!data) return false;
+  buffer->data = data;
+  buffer->capacity = capacity;
+  return true;
+}
+
+static bool buffer_append(buffer_t *buffer, const char *data, size_t length) {
+  if (!buffer_reserve(buffer, length)) return false;
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+  buffer->data[buffer->length] = '\0';
+  return true;
+}
+
+static bool buffer_appendf(buffer_t *buffer, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int needed = vsnprintf(NULL, 0, fmt, args);
+  va_end(args);
+  if (needed < 0 || !buffer_reserve(buffer, (size_t)needed)) return false;
+
+  va_start(args, fmt);
+  vsnprintf(buffer->data + buffer->length, (size_t)needed + 1, fmt, args);
+  va_end(args);
+  buffer->length += (size_t)needed;
+  return true;
+}
+
+static void buffer_consume(buffer_t *buffer, size_t length) {
+  memmove(buffer->data, buffer->data + length, buffer->length - length);
+  buffer->length -= length;
+  if (buffer->data) buffer->data[buffer->length] = '\0';
+}
+
+static void buffer_free(buffer_t *buffer) {
+  free(buffer->data);
+  *buffer = (buffer_t){0};
+}
+
+/* Appends text as a quoted JSON string */
+static bool append_json_string(buffer_t *buffer, const char *text) {
+  if (!buffer_append(buffer, "\"", 1)) return false;
+
+  const char *run = text;
+  for (const char *p = text; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+    if (!buffer_append(buffer, run, (size_t)(p - run))) return false;
+    char escaped[8];
+    switch (c) {
+      case '"':
+        strcpy(escaped, "\\\"");
+        break;
+      case '\\':
+        strcpy(escaped, "\\\\");
+        break;
+      case '\n':
+        strcpy(escaped, "\\n");
+        break;
+      case '\r':
+        strcpy(escaped, "\\r");
+        break;
+      case '\t':
+        strcpy(escaped, "\\t");
+        break;
+      default:
+        snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+    }
+    if (!buffer_append(buffer, escaped, strlen(escaped))) return false;
+    run = p + 1;
+  }
+  return buffer_append(buffer, run, strlen(run)) &&
+         buffer_append(buffer, "\"", 1);
+}
+
+/* ---- Connections ------------------------------------------------------- */
+
+static void wake_loop(void) {
+  char byte = 0;
+  ssize_t written = write(g_wake_pipe[1], &byte, 1);
+  (void)written;  // A full pipe already guarantees a wake-up
+}
+
+static connection_t *connection_create(int fd) {
+  connection_t *conn = calloc(1, sizeof(*conn));
+  if (!conn) return NULL;
+  conn->fd = fd;
+  conn->refs = 1;
+  conn->last_active_s = monotonic_s();
+  pthread_mutex_init(&conn->mutex, NULL);
+  atomic_fetch_add(&g_stats.connections, 1);
+  return conn;
+}
+
+static void connection_release(connection_t *conn) {
+  if (atomic_fetch_sub(&conn->refs, 1) != 1) return;
+
+  pthread_mutex_destroy(&conn->mutex);
+  buffer_free(&conn->in);
+  buffer_free(&conn->out);
+  free(conn);
+  atomic_fetch_sub(&g_stats.connections, 1);
+}
+
+/*
+ * Queues response bytes from any thread; false once the peer is gone.
+ * Setting done marks the end of the response.
+ */
+static bool connection_send(connection_t *conn, const char *data,
+                            size_t length, bool done) {
+  pthread_mutex_lock(&conn->mutex);
+  bool open = !conn->closed;
+  if (open) {
+    if (!buffer_append(&conn->out, data, length)) {
+      conn->closed = true;
+      open = false;
+    }
+    conn->response_done |= done;
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  wake_loop();
+  return open;
+}
+
+static bool connection_closed(connection_t *conn) {
+  pthread_mutex_lock(&conn->mutex);
+  bool closed = conn->closed;
+  pthread_mutex_unlock(&conn->mutex);
+  return closed;
+}
+
+static void count_response(int status) {
+  int index = status / 100;
+  if (index >= 1 && index <= 5) {
+    atomic_fetch_add_explicit(&g_stats.responses[index], 1,
+                              memory_order_relaxed);
+  }
+}
+
+static const char *status_text(int status) {
+  switch (status) {
+    case 200:
+      return "OK";
+    case 400:
+      return "Bad Request";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 413:
+      return "Payload Too Large";
+    case 429:
+      return "Too Many Requests";
+    case 503:
+      return "Service Unavailable";
+    default:
+      return "Internal Server Error";
+  }
+}
+
+static void send_response(connection_t *conn, int status,
+                          const char *content_type, const char *body,
+                          bool keep_alive) {
+  count_response(status);
+
+  buffer_t response = {0};
+  size_t body_length = body ? strlen(body) : 0;
+  bool ok = buffer_appendf(&response,
+                           "HTTP/1.1 %d %s\r\n"
+                           "Content-Type: %s\r\n"
+                           "Content-Length: %zu\r\n"
+                           "Connection: %s\r\n\r\n",
+                           status, status_text(status), content_type,
+                           body_length, keep_alive ? "keep-alive" : "close") &&
+            buffer_append(&response, body ? body : "", body_length);
+  if (ok) {
+    connection_send(conn, response.data, response.length, true);
+  } else {
+    connection_send(conn, "", 0, true);
+  }
+  buffer_free(&response);
+}
+
+static void send_error_code(connection_t *conn, int status, const char *type,
+                            const char *code, const char *message,
+                            bool keep_alive) {
+  buffer_t body = {0};
+  bool ok = buffer_appendf(&body, "{\"error\":{\"message\":") &&
+            append_json_string(&body, message) &&
+            buffer_appendf(&body, ",\"type\":\"%s\",\"param\":null,\"code\":",
+                           type) &&
+            (code ? buffer_appendf(&body, "\"%s\"}}", code)
+                  : buffer_appendf(&body, "null}}"));
+  send_response(conn, ok ? status : 500, "application/json",
+                ok ? body.data : "", keep_alive);
+  buffer_free(&body);
+}
+
+static void send_error(connection_t *conn, int status, const char *type,
+                       const char *message, bool keep_alive) {
+  send_error_code(conn, status, type, NULL, message, keep_alive);
+}
+
+/* ---- Response cache ---------------------------------------------------- */
+
+static uint64_t fnv1a(const char *data, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static void cache_unlink_lru(cache_entry_t *entry) {
+  if (entry->lru_prev) {
+    entry->lru_prev->lru_next = entry->lru_next;
+  } else {
+    g_cache.lru_head = entry->lru_next;
+  }
+  if (entry->lru_next) {
+    entry->lru_next->lru_prev = entry->lru_prev;
+  } else {
+    g_cache.lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void cache_push_lru(cache_entry_t *entry) {
+  entry->lru_next = g_cache.lru_head;
+  if (g_cache.lru_head) g_cache.lru_head->lru_prev = entry;
+  g_cache.lru_head = entry;
+  if (!g_cache.lru_tail) g_cache.lru_tail = entry;
+}
+
+static cache_entry_t **cache_slot(uint64_t hash, const char *key,
+                                  size_t key_length) {
+  cache_entry_t **slot = &g_cache.buckets[hash % g_cache.bucket_count];
+  while (*slot && ((*slot)->hash != hash ||
+                   (*slot)->key_length != key_length ||
+                   memcmp((*slot)->key, key, key_length) != 0)) {
+    slot = &(*slot)->bucket_next;
+  }
+  return slot;
+}
+
+static bool cache_init(void) {
+  if (options.cache_size <= 0) return true;
+  g_cache.bucket_count = (size_t)options.cache_size * 2;
+  g_cache.buckets = calloc(g_cache.bucket_count, sizeof(*g_cache.buckets));
+  return g_cache.buckets != NULL;
+}
+
+/* Returns a copy of the cached content, or NULL on a miss */
+static char *cache_lookup(const char *key, size_t key_length) {
+  if (!g_cache.buckets) return NULL;
+
+  uint64_t hash = fnv1a(key, key_length);
+  char *content = NULL;
+  pthread_mutex_lock(&g_cache.mutex);
+  cache_entry_t *entry = *cache_slot(hash, key, key_length);
+  if (entry) {
+    cache_unlink_lru(entry);
+    cache_push_lru(entry);
+    content = strdup(entry->content);
+  }
+  pthread_mutex_unlock(&g_cache.mutex);
+
+  atomic_fetch_add_explicit(content ? &g_stats.cache_hits
+                                    : &g_stats.cache_misses,
+                            1, memory_order_relaxed);
+  return content;
+}
+
+static void cache_store(const char *key, size_t key_length,
+                        const char *content) {
+  if (!g_cache.buckets) return;
+
+  cache_entry_t *entry = calloc(1, sizeof(*entry));
+  if (!entry) return;
+  entry->hash = fnv1a(key, key_length);
+  entry->key = malloc(key_length);
+  entry->key_length = key_length;
+  entry->content = strdup(content);
+  if (!entry->key || !entry->content) {
+    free(entry->key);
+    free(entry->content);
+    free(entry);
+    return;
+  }
+  memcpy(entry->key, key, key_length);
+
+  pthread_mutex_lock(&g_cache.mutex);
+  cache_entry_t **slot = cache_slot(entry->hash, key, key_length);
+  cache_entry_t *evicted = NULL;
+  if (*slot) {
+    // Another worker answered the same request first
+    pthread_mutex_unlock(&g_cache.mutex);
+    free(entry->key);
+    free(entry->content);
+    free(entry);
+    return;
+  }
+  *slot = entry;
+  cache_push_lru(entry);
+  if (++g_cache.entries > options.cache_size) {
+    evicted = g_cache.lru_tail;
+    cache_unlink_lru(evicted);
+    *cache_slot(evicted->hash, evicted->key, evicted->key_length) =
+        evicted->bucket_next;
+    g_cache.entries--;
+  }
+  pthread_mutex_unlock(&g_cache.mutex);
+
+  if (evicted) {
+    free(evicted->key);
+    free(evicted->content);
+    free(evicted);
+  }
+}
+
+/* ---- Similar-prompt cache ---------------------------------------------- */
+
+/* splitmix64 finalizer; spreads FNV hashes of short words over all 64 bits */
+static uint64_t mix64(uint64_t value) {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
+static void signature_vote(int32_t votes[64], uint64_t feature) {
+  feature = mix64(feature);
+  for (int bit = 0; bit < 64; bit++) {
+    votes[bit] += (feature >> bit) & 1 ? 1 : -1;
+  }
+}
+
+static size_t digit_run(const unsigned char *p, size_t max) {
+  size_t n = 0;
+  while (n < max && p[n] >= '0' && p[n] <= '9') n++;
+  return n;
+}
+
+/* Length of a clock time such as 9:30 or 09:30:15.250 at p, or 0. */
+static size_t time_length(const unsigned char *p) {
+  size_t n = digit_run(p, 2);
+  if (!n || p[n] != ':' || digit_run(p + n + 1, 2) != 2) return 0;
+  n += 3;
+  if (p[n] == ':' && digit_run(p + n + 1, 2) == 2) {
+    n += 3;
+    if (p[n] == '.' && digit_run(p + n + 1, 9)) {
+      n += 1 + digit_run(p + n + 1, 9);
+    }
+  }
+  return n;
+}
+
+/*
+ * Length of the date, time or ISO 8601 date-time at p, or 0 when p does not
+ * start one. Dates are three digit groups joined by the same '-' or '/'.
+ */
+static size_t timestamp_length(const unsigned char *p) {
+  size_t n = time_length(p);
+  if (!n) {
+    size_t year = digit_run(p, 4);
+    unsigned char separator = p[year];
+    if (!year || (separator != '-' && separator != '/')) return 0;
+    size_t month = digit_run(p + year + 1, 2);
+    if (!month || p[year + 1 + month] != separator) return 0;
+    n = year + 1 + month + 1;
+    size_t day = digit_run(p + n, 4);
+    if (!day) return 0;
+    n += day;
+    if (p[n] == 'T' || p[n] == 't') {
+      size_t time = time_length(p + n + 1);
+      if (time) n += 1 + time;
+    }
+  }
+  if (p[n] == 'Z' || p[n] == 'z') n++;
+  unsigned char next = p[n];
+  if ((next >= '0' && next <= '9') || (next >= 'a' && next <= 'z') ||
+      (next >= 'A' && next <= 'Z') || next >= 0x80) {
+    return 0;
+  }
+  return n;
+}
+
+/*
+ * SimHash of the normalised prompt. ASCII letters are lowercased, dates and
+ * clock times read as a single '0' and punctuation separates words, so those
+ * differences do not change the signature at all. Each word and each pair of
+ * adjacent words then votes on the 64 bits. Every other number is hashed in
+ * order into *numbers, which the caller keeps in the exact-match scope: a
+ * near-duplicate with a different amount or ID must not share an answer.
+ * Returns false for a prompt without words.
+ */
+static bool prompt_signature(const char *prompt, uint64_t *signature,
+                             uint64_t *numbers) {
+  int32_t votes[64] = {0};
+  uint64_t word = 0;
+  uint64_t previous = 0;
+  bool in_word = false;
+  bool in_number = false;
+  bool have_previous = false;
+  int features = 0;
+
+  *numbers = 0xcbf29ce484222325ULL;
+  for (const unsigned char *p = (const unsigned char *)prompt;; p++) {
+    unsigned char c = *p;
+    bool digit = c >= '0' && c <= '9';
+    bool word_char = digit || (c >= 'a' && c <= 'z') ||
+                     (c >= 'A' && c <= 'Z') || c >= 0x80;
+
+    if (word_char) {
+      if (!in_word) {
+        word = 0xcbf29ce484222325ULL;
+        size_t skip = digit ? timestamp_length(p) : 0;
+        if (skip) {
+          word = (word ^ '0') * 0x100000001b3ULL;
+          p += skip - 1;
+          in_word = true;
+          continue;
+        }
+      }
+      in_word = true;
+      if (digit) {
+        *numbers = (*numbers ^ c) * 0x100000001b3ULL;
+        in_number = true;
+      } else if (in_number) {
+        *numbers = (*numbers ^ ' ') * 0x100000001b3ULL;
+        in_number = false;
+      }
+      unsigned char folded = c >= 'A' && c <= 'Z' ? (unsigned char)(c + 32)
+                                                  : c;
+      word = (word ^ folded) * 0x100000001b3ULL;
+      continue;
+    }
+
+    if (in_number) *numbers = (*numbers ^ ' ') * 0x100000001b3ULL;
+    in_number = false;
+    if (in_word) {
+      signature_vote(votes, word);
+      if (have_previous) signature_vote(votes, previous * 31 + word);
+      previous = word;
+      have_previous = true;
+      in_word = false;
+      features++;
+    }
+    if (!c) break;
+  }
+
+  *signature = 0;
+  for (int bit = 0; bit < 64; bit++) {
+    if (votes[bit] > 0) *signature |= 1ULL << bit;
+  }
+  return features > 0;
+}
+
+static unsigned band_value(uint64_t signature, int band) {
+  return (unsigned)(signature >> (band * SIMILAR_BAND_BITS)) &
+         ((1u << SIMILAR_BAND_BITS) - 1);
+}
+
+static similar_entry_t **similar_bucket(int band, unsigned value,
+                                        uint64_t scope_hash) {
+  uint64_t hash = mix64(scope_hash ^ value);
+  return &g_similar.buckets[band][hash % g_similar.bucket_count];
+}
+
+static void similar_unlink_lru(similar_entry_t *entry) {
+  if (entry->lru_prev) {
+    entry->lru_prev->lru_next = entry->lru_next;
+  } else {
+    g_similar.lru_head = entry->lru_next;
+  }
+  if (entry->lru_next) {
+    entry->lru_next->lru_prev = entry->lru_prev;
+  } else {
+    g_similar.lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void similar_push_lru(similar_entry_t *entry) {
+  entry->lru_next = g_similar.lru_head;
+  if (g_similar.lru_head) g_similar.lru_head->lru_prev = entry;
+  g_similar.lru_head = entry;
+  if (!g_similar.lru_tail) g_similar.lru_tail = entry;
+}
+
+static bool similar_init(void) {
+  if (options.similar_cache_size <= 0) return true;
+  g_similar.bucket_count = (size_t)options.similar_cache_size * 2;
+  for (int band = 0; band < SIMILAR_BANDS; band++) {
+    g_similar.buckets[band] =
+        calloc(g_similar.bucket_count, sizeof(*g_similar.buckets[band]));
+    if (!g_similar.buckets[band]) return false;
+  }
+  return true;
+}
+
+/*
+ * Closest entry with the job's scope within the distance threshold. A
+ * signature that differs in at most 2 * SIMILAR_BANDS - 1 bits matches at
+ * least one band exactly or in one bit, so thresholds below SIMILAR_BANDS
+ * only need the exact band buckets.
+ */
+static similar_entry_t *similar_find(const job_t *job, uint64_t scope_hash,
+                                     int *distance) {
+  int radius = options.similar_distance >= SIMILAR_BANDS ? 1 : 0;
+  similar_entry_t *best = NULL;
+  *distance = options.similar_distance + 1;
+
+  for (int band = 0; band < SIMILAR_BANDS; band++) {
+    unsigned value = band_value(job->signature, band);
+    for (int probe = -1; probe < (radius ? SIMILAR_BAND_BITS : 0); probe++) {
+      unsigned probed = probe < 0 ? value : value ^ (1u << probe);
+      for (similar_entry_t *entry = *similar_bucket(band, probed, scope_hash);
+           entry; entry = entry->bucket_next[band]) {
+        int bits = __builtin_popcountll(entry->signature ^ job->signature);
+        if (bits >= *distance || entry->scope_hash != scope_hash ||
+            entry->scope_length != job->similar_scope_length ||
+            memcmp(entry->scope, job->similar_scope, entry->scope_length) !=
+                0) {
+          continue;
+        }
+        best = entry;
+        *distance = bits;
+        if (bits == 0) return best;
+      }
+    }
+  }
+  return best;
+}
+
+/* Returns a copy of the closest cached content, or NULL on a miss */
+static char *similar_lookup(const job_t *job) {
+  uint64_t scope_hash = fnv1a(job->similar_scope, job->similar_scope_length);
+  char *content = NULL;
+  int distance;
+  pthread_mutex_lock(&g_similar.mutex);
+  similar_entry_t *entry = similar_find(job, scope_hash, &distance);
+  if (entry) {
+    similar_unlink_lru(entry);
+    similar_push_lru(entry);
+    content = strdup(entry->content);
+  }
+  pthread_mutex_unlock(&g_similar.mutex);
+
+  atomic_fetch_add_explicit(content ? &g_stats.similar_hits[distance]
+                                    : &g_stats.similar_misses,
+                            1, memory_order_relaxed);
+  return content;
+}
+
+static void similar_remove(similar_entry_t *entry) {
+  for (int band = 0; band < SIMILAR_BANDS; band++) {
+    similar_entry_t **slot = similar_bucket(
+        band, band_value(entry->signature, band), entry->scope_hash);
+    while (*slot != entry) slot = &(*slot)->bucket_next[band];
+    *slot = entry->bucket_next[band];
+  }
+  similar_unlink_lru(entry);
+}
+
+static void similar_store(const job_t *job, const char *content) {
+  similar_entry_t *entry = calloc(1, sizeof(*entry));
+  if (!entry) return;
+  entry->signature = job->signature;
+  entry->scope_hash = fnv1a(job->similar_scope, job->similar_scope_length);
+  entry->scope = malloc(job->similar_scope_length);
+  entry->scope_length = job->similar_scope_length;
+  entry->content = strdup(content);
+  if (!entry->scope || !entry->content) {
+    free(entry->scope);
+    free(entry->content);
+    free(entry);
+    return;
+  }
+  memcpy(entry->scope, job->similar_scope, job->similar_scope_length);
+
+  pthread_mutex_lock(&g_similar.mutex);
+  int distance;
+  similar_entry_t *evicted = NULL;
+  if (similar_find(job, entry->scope_hash, &distance) && distance == 0) {
+    // Another worker answered an equivalent request first
+    pthread_mutex_unlock(&g_similar.mutex);
+    free(entry->scope);
+    free(entry->content);
+    free(entry);
+    return;
+  }
+  for (int band = 0; band < SIMILAR_BANDS; band++) {
+    similar_entry_t **slot = similar_bucket(
+        band, band_value(entry->signature, band), entry->scope_hash);
+    entry->bucket_next[band] = *slot;
+    *slot = entry;
+  }
+  similar_push_lru(entry);
+  if (++g_similar.entries > options.similar_cache_size) {
+    evicted = g_similar.lru_tail;
+    similar_remove(evicted);
+    g_similar.entries--;
+  }
+  pthread_mutex_unlock(&g_similar.mutex);
+
+  if (evicted) {
+    free(evicted->scope);
+    free(evicted->content);
+    free(evicted);
+  }
+}
+
+/* ---- Scheduler --------------------------------------------------------- */
+
+static void job_free(job_t *job) {
+  if (!job) return;
+  if (job->conn) connection_release(job->conn);
+  free(job->model);
+  free(job->instructions);
+  free(job->prompt);
+  free(job->schema);
+  free(job->cache_key);
+  free(job->similar_scope);
+  free(job);
+}
+
+static bool schedule(job_t *job) {
+  pthread_mutex_lock(&g_queue.mutex);
+  if (g_queue.stopping || g_queue.depth >= options.queue) {
+    pthread_mutex_unlock(&g_queue.mutex);
+    return false;
+  }
+  job->enqueued_s = monotonic_s();
+  if (g_queue.tail) {
+    g_queue.tail->next = job;
+  } else {
+    g_queue.head = job;
+  }
+  g_queue.tail = job;
+  g_queue.depth++;
+  pthread_cond_signal(&g_queue.cond);
+  pthread_mutex_unlock(&g_queue.mutex);
+  return true;
+}
+
+static job_t *next_job(void) {
+  pthread_mutex_lock(&g_queue.mutex);
+  while (!g_queue.head && !g_queue.stopping) {
+    pthread_cond_wait(&g_queue.cond, &g_queue.mutex);
+  }
+  job_t *job = g_queue.head;
+  if (job) {
+    g_queue.head = job->next;
+    if (!g_queue.head) g_queue.tail = NULL;
+    g_queue.depth--;
+    job->next = NULL;
+  }
+  pthread_mutex_unlock(&g_queue.mutex);
+  return job;
+}
+
+/* ---- Completions ------------------------------------------------------- */
+
+static void append_chunk_prefix(buffer_t *buffer, const job_t *job) {
+  buffer_appendf(buffer, "data: {\"id\":\"%s\",\"object\":"
+                         "\"chat.completion.chunk\",\"created\":%lld,"
+                         "\"model\":",
+                 job->id, job->created);
+  append_json_string(buffer, job->model);
+  buffer_appendf(buffer, ",\"choices\":[{\"index\":0,\"delta\":");
+}
+
+// Event streams end by closing the connection
+static void send_sse_headers(const job_t *job) {
+  count_response(200);
+  job->conn->keep_alive = false;
+
+  static const char headers[] = "HTTP/1.1 200 OK\r\n"
+                                "Content-Type: text/event-stream\r\n"
+                                "Cache-Control: no-cache\r\n"
+                                "Connection: close\r\n\r\n";
+  buffer_t event = {0};
+  buffer_append(&event, headers, sizeof(headers) - 1);
+  append_chunk_prefix(&event, job);
+  buffer_appendf(&event, "{\"role\":\"assistant\",\"content\":\"\"},"
+                         "\"finish_reason\":null}]}\n\n");
+  connection_send(job->conn, event.data, event.length, false);
+  buffer_free(&event);
+}
+
+static bool send_sse_content(const job_t *job, const char *content) {
+  buffer_t event = {0};
+  append_chunk_prefix(&event, job);
+  buffer_appendf(&event, "{\"content\":");
+  append_json_string(&event, content);
+  buffer_appendf(&event, "},\"finish_reason\":null}]}\n\n");
+  bool open = connection_send(job->conn, event.data, event.length, false);
+  buffer_free(&event);
+  return open;
+}
+
+static void send_sse_end(const job_t *job, const char *error) {
+  buffer_t event = {0};
+  if (error) {
+    buffer_appendf(&event, "data: {\"error\":{\"message\":");
+    append_json_string(&event, error);
+    buffer_appendf(&event, ",\"type\":\"server_error\"}}\n\n");
+  } else {
+    append_chunk_prefix(&event, job);
+    buffer_appendf(&event, "{},\"finish_reason\":\"stop\"}]}\n\n");
+  }
+  buffer_appendf(&event, "data: [DONE]\n\n");
+  connection_send(job->conn, event.data, event.length, true);
+  buffer_free(&event);
+}
+
+static void send_completion(const job_t *job, const char *content) {
+  buffer_t body = {0};
+  buffer_appendf(&body,
+                 "{\"id\":\"%s\",\"object\":\"chat.completion\","
+                 "\"created\":%lld,\"model\":",
+                 job->id, job->created);
+  append_json_string(&body, job->model);
+  buffer_appendf(&body, ",\"choices\":[{\"index\":0,\"message\":{\"role\":"
+                        "\"assistant\",\"content\":");
+  append_json_string(&body, content);
+  buffer_appendf(&body, "},\"finish_reason\":\"stop\"}]}");
+  send_response(job->conn, 200, "application/json", body.data,
+                job->conn->keep_alive);
+  buffer_free(&body);
+}
+
+/* Answers a job whose content is already known (cache hit or sync call) */
+static void answer(const job_t *job, const char *content) {
+  if (job->stream) {
+    send_sse_headers(job);
+    send_sse_content(job, content);
+    send_sse_end(job, NULL);
+  } else {
+    send_completion(job, content);
+  }
+}
+
+/* Structured results arrive as {"text": ..., "object": ...} */
+static char *structured_content(const char *response) {
+  cJSON *root = cJSON_Parse(response);
+  cJSON *object = root ? cJSON_GetObjectItem(root, "object") : NULL;
+  char *content = object ? cJSON_PrintUnformatted(object) : NULL;
+  cJSON_Delete(root);
+  return content;
+}
+
+static void stream_callback(ai_context_t *context, const char *chunk,
+                            void *user_data) {
+  (void)context;
+  worker_t *worker = user_data;
+  bool is_error = chunk && strncmp(chunk, "Error:", 6) == 0;
+
+  if (chunk && !is_error) {
+    send_sse_content(worker->job, chunk);
+    if (worker->job->cache_key) {
+      buffer_append(&worker->text, chunk, strlen(chunk));
+    }
+    return;
+  }
+
+  pthread_mutex_lock(&worker->mutex);
+  if (is_error) {
+    worker->stream_failed = true;
+    snprintf(worker->error, sizeof(worker->error), "%s", chunk + 6);
+  }
+  worker->stream_done = true;
+  pthread_cond_signal(&worker->cond);
+  pthread_mutex_unlock(&worker->mutex);
+}
+
+/* Streams a text completion, cancelling if the client goes away */
+static void run_stream(worker_t *worker, job_t *job,
+                       ai_session_id_t session) {
+  worker->job = job;
+  worker->stream_done = false;
+  worker->stream_failed = false;
+  worker->text.length = 0;
+
+  // Reject before the 200 goes out; the server never compacts, so this is
+  // the same check the generation call makes
+  int32_t estimate = 0;
+  if (ai_preflight_prompt(worker->context, session, job->prompt, NULL,
+                          &job->params, &estimate) ==
+      AI_ERROR_PROMPT_TOO_LONG) {
+    char error[160];
+    snprintf(error, sizeof(error),
+             "Request needs about %d tokens; the context window holds %d",
+             (int)estimate, AI_CONTEXT_WINDOW_TOKENS);
+    send_error_code(job->conn, 400, "invalid_request_error",
+                    "context_length_exceeded", error, job->conn->keep_alive);
+    return;
+  }
+
+  send_sse_headers(job);
+  ai_stream_id_t stream =
+      ai_generate_response_stream(worker->context, session, job->prompt,
+                                  &job->params, stream_callback, worker);
+  if (stream == AI_INVALID_ID) {
+    send_sse_end(job, ai_get_last_error(worker->context));
+    return;
+  }
+
+  bool cancelled = false;
+  pthread_mutex_lock(&worker->mutex);
+  while (!worker->stream_done) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += CANCEL_CHECK_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&worker->cond, &worker->mutex, &deadline);
+    if (!worker->stream_done && !cancelled && connection_closed(job->conn)) {
+      // The terminal chunk still arrives after a cancel
+      pthread_mutex_unlock(&worker->mutex);
+      ai_cancel_stream(worker->context, stream);
+      cancelled = true;
+      pthread_mutex_lock(&worker->mutex);
+    }
+  }
+  pthread_mutex_unlock(&worker->mutex);
+
+  if (worker->stream_failed) {
+    send_sse_end(job, worker->error);
+  } else {
+    send_sse_end(job, NULL);
+    if (job->cache_key && worker->text.data) {
+      cache_store(job->cache_key, job->cache_key_length, worker->text.data);
+    }
+  }
+}
+
+static void run_sync(worker_t *worker, job_t *job, ai_session_id_t session) {
+  char *response =
+      job->schema
+          ? ai_generate_structured_response(worker->context, session,
+                                            job->prompt, job->schema,
+                                            &job->params)
+          : ai_generate_response(worker->context, session, job->prompt,
+                                 &job->params);
+  if (!response) {
+    const char *error = ai_get_last_error(worker->context);
+    if (ai_get_last_error_code(worker->context) == AI_ERROR_PROMPT_TOO_LONG) {
+      send_error_code(job->conn, 400, "invalid_request_error",
+                      "context_length_exceeded", error, job->conn->keep_alive);
+    } else if (job->stream) {
+      send_sse_headers(job);
+      send_sse_end(job, error);
+    } else {
+      send_error(job->conn, 500, "server_error", error,
+                 job->conn->keep_alive);
+    }
+    return;
+  }
+
+  char *content = job->schema ? structured_content(response) : response;
+  if (!content) {
+    send_error(job->conn, 500, "server_error",
+               "Model returned an unreadable structured response",
+               job->conn->keep_alive);
+  } else {
+    answer(job, content);
+    if (job->cache_key) {
+      cache_store(job->cache_key, job->cache_key_length, content);
+    }
+    if (job->similar_scope) similar_store(job, content);
+  }
+  if (content != response) free(content);
+  ai_free_string(response);
+}
+
+static ai_session_id_t create_session(worker_t *worker,
+                                      const char *instructions, bool prewarm) {
+  ai_session_config_t config = AI_DEFAULT_SESSION_CONFIG;
+  config.instructions = instructions;
+  config.prewarm = prewarm;
+  return ai_create_session(worker->context, &config);
+}
+
+static void *worker_main(void *arg) {
+  worker_t *worker = arg;
+  worker->spare = create_session(worker, options.instructions, true);
+
+  job_t *job;
+  while ((job = next_job())) {
+    uint64_t waited_us =
+        (uint64_t)((monotonic_s() - job->enqueued_s) * 1e6);
+    atomic_fetch_add_explicit(&g_stats.queue_wait_us, waited_us,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_stats.scheduled, 1, memory_order_relaxed);
+
+    if (connection_closed(job->conn)) {
+      job_free(job);
+      continue;
+    }
+
+    // The spare only matches requests without their own system prompt
+    ai_session_id_t session;
+    if (!job->instructions && worker->spare != AI_INVALID_ID) {
+      session = worker->spare;
+      worker->spare = AI_INVALID_ID;
+    } else {
+      session = create_session(worker, job->instructions
+                                           ? job->instructions
+                                           : options.instructions,
+                               false);
+    }
+
+    if (session == AI_INVALID_ID) {
+      send_error(job->conn, 503, "server_error",
+                 ai_get_last_error(worker->context), job->conn->keep_alive);
+    } else if (job->stream && !job->schema) {
+      run_stream(worker, job, session);
+    } else {
+      run_sync(worker, job, session);
+    }
+
+    // Warm the replacement only after the client has its answer
+    if (session != AI_INVALID_ID) ai_destroy_session(worker->context, session);
+    if (worker->spare == AI_INVALID_ID) {
+      worker->spare = create_session(worker, options.instructions, true);
+    }
+    job_free(job);
+  }
+  return NULL;
+}
+
+/* ---- Request parsing --------------------------------------------------- */
+
+/* Message content is a string or an array of {"type":"text","text":...} */
+static bool append_content(buffer_t *out, const cJSON *content) {
+  if (cJSON_IsString(content)) {
+    return buffer_append(out, content->valuestring,
+                         strlen(content->valuestring));
+  }
+  if (!cJSON_IsArray(content)) return false;
+
+  const cJSON *part;
+  cJSON_ArrayForEach(part, content) {
+    const cJSON *type = cJSON_GetObjectItem(part, "type");
+    const cJSON *text = cJSON_GetObjectItem(part, "text");
+    if (!cJSON_IsString(type) || strcmp(type->valuestring, "text") != 0 ||
+        !cJSON_IsString(text)) {
+      return false;
+    }
+    if (!buffer_append(out, text->valuestring, strlen(text->valuestring))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Comparisons are false for NaN, so it fails the range check too
+static bool valid_max_tokens(const cJSON *max_tokens) {
+  if (!cJSON_IsNumber(max_tokens)) return false;
+  double value = max_tokens->valuedouble;
+  return value >= 1 && value <= INT32_MAX && value == (double)(int32_t)value;
+}
+
+/*
+ * System and developer messages become the session instructions. Because a
+ * fresh session has no transcript, earlier turns are folded into the prompt.
+ */
+static const char *build_prompt(job_t *job, const cJSON *messages) {
+  buffer_t instructions = {0};
+  buffer_t prompt = {0};
+  int turns = 0;
+  const cJSON *last = NULL;
+  const cJSON *message;
+
+  cJSON_ArrayForEach(message, messages) {
+    const cJSON *role = cJSON_GetObjectItem(message, "role");
+    if (!cJSON_IsString(role)) return "every message needs a role";
+    if (strcmp(role->valuestring, "system") != 0 &&
+        strcmp(role->valuestring, "developer") != 0) {
+      turns++;
+      last = message;
+    }
+  }
+  if (!last ||
+      strcmp(cJSON_GetObjectItem(last, "role")->valuestring, "user") != 0) {
+    return "the last non-system message must have role 'user'";
+  }
+
+  const char *error = NULL;
+  cJSON_ArrayForEach(message, messages) {
+    const char *role = cJSON_GetObjectItem(message, "role")->valuestring;
+    const cJSON *content = cJSON_GetObjectItem(message, "content");
+    bool system =
+        strcmp(role, "system") == 0 || strcmp(role, "developer") == 0;
+
+    buffer_t *out = system ? &instructions : &prompt;
+    if (out->length) buffer_append(out, "\n\n", 2);
+    if (!system && turns > 1) {
+      if (strcmp(role, "user") == 0) {
+        buffer_append(out, "User: ", 6);
+      } else if (strcmp(role, "assistant") == 0) {
+        buffer_append(out, "Assistant: ", 11);
+      } else {
+        error = "only system, developer, user and assistant roles are "
+                "supported";
+        break;
+      }
+    }
+    if (!append_content(out, content)) {
+      error = "message content must be a string or text parts";
+      break;
+    }
+  }
+
+  if (error || !prompt.data) {
+    buffer_free(&instructions);
+    buffer_free(&prompt);
+    return error ? error : "the prompt is empty";
+  }
+  job->instructions = instructions.data;
+  job->prompt = prompt.data;
+  return NULL;
+}
+
+static const char *parse_response_format(job_t *job, const cJSON *format) {
+  if (!format || cJSON_IsNull(format)) return NULL;
+
+  const cJSON *type = cJSON_GetObjectItem(format, "type");
+  if (!cJSON_IsString(type)) return "response_format needs a type";
+  if (strcmp(type->valuestring, "text") == 0) return NULL;
+  if (strcmp(type->valuestring, "json_schema") != 0) {
+    return "only text and json_schema response formats are supported";
+  }
+
+  const cJSON *json_schema = cJSON_GetObjectItem(format, "json_schema");
+  const cJSON *schema = cJSON_GetObjectItem(json_schema, "schema");
+  if (!cJSON_IsObject(schema)) return "json_schema.schema must be an object";
+  job->schema = cJSON_PrintUnformatted(schema);
+  return job->schema ? NULL : "out of memory";
+}
+
+static bool build_cache_key(job_t *job) {
+  buffer_t key = {0};
+  const char *instructions =
+      job->instructions ? job->instructions
+                        : (options.instructions ? options.instructions : "");
+  // NUL separators keep field boundaries unambiguous
+  bool ok = buffer_append(&key, instructions, strlen(instructions) + 1) &&
+            buffer_append(&key, job->prompt, strlen(job->prompt) + 1) &&
+            buffer_append(&key, job->schema ? job->schema : "",
+                          job->schema ? strlen(job->schema) + 1 : 1) &&
+            buffer_appendf(&key, "%d", job->params.max_tokens);
+  if (!ok) {
+    buffer_free(&key);
+    return false;
+  }
+  job->cache_key = key.data;
+  job->cache_key_length = key.length;
+  return true;
+}
+
+/*
+ * Near-duplicate reuse is limited to structured requests, where the schema
+ * constrains the answer. Everything except the prompt must match exactly,
+ * and so must the prompt's numbers other than dates and times.
+ */
+static bool build_similar_key(job_t *job) {
+  uint64_t numbers;
+  if (!g_similar.bucket_count || !job->schema ||
+      !prompt_signature(job->prompt, &job->signature, &numbers)) {
+    return true;
+  }
+
+  buffer_t scope = {0};
+  const char *instructions =
+      job->instructions ? job->instructions
+                        : (options.instructions ? options.instructions : "");
+  bool ok = buffer_append(&scope, instructions, strlen(instructions) + 1) &&
+            buffer_append(&scope, job->schema, strlen(job->schema) + 1) &&
+            buffer_appendf(&scope, "%d", job->params.max_tokens) &&
+            buffer_append(&scope, (const char *)&numbers, sizeof numbers);
+  if (!ok) {
+    buffer_free(&scope);
+    return false;
+  }
+  job->similar_scope = scope.data;
+  job->similar_scope_length = scope.length;
+  return true;
+}
+
+static void handle_completion(connection_t *conn, const char *body,
+                              size_t length) {
+  cJSON *root = cJSON_ParseWithLength(body, length);
+  if (!cJSON_IsObject(root)) {
+    cJSON_Delete(root);
+    send_error(conn, 400, "invalid_request_error",
+               "request body must be a JSON object", conn->keep_alive);
+    return;
+  }
+
+  job_t *job = calloc(1, sizeof(*job));
+  if (!job) {
+    cJSON_Delete(root);
+    send_error(conn, 500, "server_error", "out of memory", false);
+    return;
+  }
+
+  static _Atomic(uint64_t) next_id = 1;
+  snprintf(job->id, sizeof(job->id), "chatcmpl-%" PRIx64 "%06" PRIx64,
+           (uint64_t)time(NULL), atomic_fetch_add(&next_id, 1));
+  job->created = (long long)time(NULL);
+
+  const cJSON *model = cJSON_GetObjectItem(root, "model");
+  job->model = strdup(cJSON_IsString(model) ? model->valuestring : MODEL_ID);
+
+  const cJSON *messages = cJSON_GetObjectItem(root, "messages");
+  const cJSON *stream = cJSON_GetObjectItem(root, "stream");
+  const cJSON *temperature = cJSON_GetObjectItem(root, "temperature");
+  const cJSON *max_tokens = cJSON_GetObjectItem(root, "max_completion_tokens");
+  if (!max_tokens) max_tokens = cJSON_GetObjectItem(root, "max_tokens");
+
+  const char *error = NULL;
+  if (!cJSON_IsArray(messages) || cJSON_GetArraySize(messages) == 0) {
+    error = "messages must be a non-empty array";
+  } else if (temperature && !cJSON_IsNull(temperature) &&
+             (!cJSON_IsNumber(temperature) || temperature->valuedouble < 0 ||
+              temperature->valuedouble > 2)) {
+    error = "temperature must be between 0 and 2";
+  } else if (max_tokens && !cJSON_IsNull(max_tokens) &&
+             !valid_max_tokens(max_tokens)) {
+    error = "max_tokens must be an integer between 1 and 2147483647";
+  }
+  if (!error) error = build_prompt(job, messages);
+  if (!error) {
+    error = parse_response_format(job,
+                                  cJSON_GetObjectItem(root, "response_format"));
+  }
+  if (error) {
+    cJSON_Delete(root);
+    job_free(job);
+    send_error(conn, 400, "invalid_request_error", error, conn->keep_alive);
+    return;
+  }
+
+  job->stream = cJSON_IsTrue(stream);
+  job->params = (ai_generation_params_t)AI_DEFAULT_PARAMS;
+  bool deterministic = false;
+  if (cJSON_IsNumber(temperature)) {
+    deterministic = temperature->valuedouble == 0;
+    job->params.temperature =
+        deterministic ? MIN_TEMPERATURE : temperature->valuedouble;
+  }
+  if (cJSON_IsNumber(max_tokens)) {
+    job->params.max_tokens = (int32_t)max_tokens->valuedouble;
+  }
+  cJSON_Delete(root);
+
+  if (!job->model ||
+      (deterministic && !(build_cache_key(job) && build_similar_key(job)))) {
+    job_free(job);
+    send_error(conn, 500, "server_error", "out of memory", false);
+    return;
+  }
+
+  conn->busy = true;
+  atomic_fetch_add(&conn->refs, 1);
+  job->conn = conn;
+
+  char *cached =
+      job->cache_key ? cache_lookup(job->cache_key, job->cache_key_length)
+                     : NULL;
+  if (!cached && job->similar_scope) cached = similar_lookup(job);
+  if (cached) {
+    answer(job, cached);
+    free(cached);
+    job_free(job);
+    return;
+  }
+
+  if (!schedule(job)) {
+    atomic_fetch_add_explicit(&g_stats.rejected, 1, memory_order_relaxed);
+    send_error(conn, 429, "rate_limit_error",
+               "the request queue is full; retry later", conn->keep_alive);
+    job_free(job);
+  }
+}
+
+static void handle_metrics(connection_t *conn) {
+  char *metrics = ai_metrics_render();
+  buffer_t body = {0};
+  if (metrics) {
+    // Splice the server's families in before libai's terminator
+    char *eof = strstr(metrics, "# EOF");
+    buffer_append(&body, metrics, eof ? (size_t)(eof - metrics)
+                                      : strlen(metrics));
+    ai_free_string(metrics);
+  }
+
+  pthread_mutex_lock(&g_queue.mutex);
+  int depth = g_queue.depth;
+  pthread_mutex_unlock(&g_queue.mutex);
+  pthread_mutex_lock(&g_cache.mutex);
+  int entries = g_cache.entries;
+  pthread_mutex_unlock(&g_cache.mutex);
+
+  buffer_appendf(&body,
+                 "# TYPE server_requests counter\n"
+                 "# HELP server_requests HTTP requests parsed.\n"
+                 "server_requests_total %" PRIu64 "\n"
+                 "# TYPE server_responses counter\n"
+                 "# HELP server_responses HTTP responses by status class.\n",
+                 atomic_load(&g_stats.requests));
+  for (int i = 1; i <= 5; i++) {
+    buffer_appendf(&body, "server_responses_total{class=\"%dxx\"} %" PRIu64
+                          "\n",
+                   i, atomic_load(&g_stats.responses[i]));
+  }
+  buffer_appendf(
+      &body,
+      "# TYPE server_rejected counter\n"
+      "# HELP server_rejected Requests refused because the queue was full.\n"
+      "server_rejected_total %" PRIu64 "\n"
+      "# TYPE server_queue_depth gauge\n"
+      "# HELP server_queue_depth Requests waiting for a worker.\n"
+      "server_queue_depth %d\n"
+      "# TYPE server_queue_wait_seconds counter\n"
+      "# HELP server_queue_wait_seconds Total time scheduled requests "
+      "waited.\n"
+      "server_queue_wait_seconds_total %.6f\n"
+      "# TYPE server_scheduled counter\n"
+      "# HELP server_scheduled Requests taken by a worker.\n"
+      "server_scheduled_total %" PRIu64 "\n"
+      "# TYPE server_connections gauge\n"
+      "# HELP server_connections Open client connections.\n"
+      "server_connections %" PRId64 "\n"
+      "# TYPE server_cache_lookups counter\n"
+      "# HELP server_cache_lookups Response cache lookups by outcome.\n"
+      "server_cache_lookups_total{outcome=\"hit\"} %" PRIu64 "\n"
+      "server_cache_lookups_total{outcome=\"miss\"} %" PRIu64 "\n"
+      "# TYPE server_cache_entries gauge\n"
+      "# HELP server_cache_entries Responses currently cached.\n"
+      "server_cache_entries %d\n",
+      atomic_load(&g_stats.rejected), depth,
+      (double)atomic_load(&g_stats.queue_wait_us) / 1e6,
+      atomic_load(&g_stats.scheduled), atomic_load(&g_stats.connections),
+      atomic_load(&g_stats.cache_hits), atomic_load(&g_stats.cache_misses),
+      entries);
+
+  if (g_similar.bucket_count) {
+    pthread_mutex_lock(&g_similar.mutex);
+    int similar_entries = g_similar.entries;
+    pthread_mutex_unlock(&g_similar.mutex);
+
+    uint64_t hits[SIMILAR_MAX_DISTANCE + 1];
+    uint64_t total_hits = 0;
+    for (int distance = 0; distance <= options.similar_distance;
+         distance++) {
+      hits[distance] = atomic_load(&g_stats.similar_hits[distance]);
+      total_hits += hits[distance];
+    }
+    buffer_appendf(
+        &body,
+        "# TYPE server_similar_cache_lookups counter\n"
+        "# HELP server_similar_cache_lookups Similar-prompt cache lookups "
+        "by outcome.\n"
+        "server_similar_cache_lookups_total{outcome=\"hit\"} %" PRIu64 "\n"
+        "server_similar_cache_lookups_total{outcome=\"miss\"} %" PRIu64 "\n"
+        "# TYPE server_similar_cache_hits counter\n"
+        "# HELP server_similar_cache_hits Similar-prompt cache hits by "
+        "signature distance in bits.\n",
+        total_hits, atomic_load(&g_stats.similar_misses));
+    for (int distance = 0; distance <= options.similar_distance;
+         distance++) {
+      buffer_appendf(&body,
+                     "server_similar_cache_hits_total{distance=\"%d\"} "
+                     "%" PRIu64 "\n",
+                     distance, hits[distance]);
+    }
+    buffer_appendf(
+        &body,
+        "# TYPE server_similar_cache_entries gauge\n"
+        "# HELP server_similar_cache_entries Responses currently cached by "
+        "prompt signature.\n"
+        "server_similar_cache_entries %d\n",
+        similar_entries);
+  }
+
+  if (options.ipc_path) {
+    ipc_server_stats_t ipc;
+    ipc_server_get_stats(&ipc);
+    buffer_appendf(
+        &body,
+        "# TYPE server_ipc_clients gauge\n"
+        "# HELP server_ipc_clients Connected shared-memory clients.\n"
+        "server_ipc_clients %" PRId64 "\n"
+        "# TYPE server_ipc_records counter\n"
+        "# HELP server_ipc_records Stream records written to client "
+        "rings.\n"
+        "server_ipc_records_total %" PRIu64 "\n"
+        "# TYPE server_ipc_doorbells counter\n"
+        "# HELP server_ipc_doorbells Wake-ups sent to idle client "
+        "readers.\n"
+        "server_ipc_doorbells_total %" PRIu64 "\n"
+        "# TYPE server_ipc_ring_full_waits counter\n"
+        "# HELP server_ipc_ring_full_waits Writes that waited for a slow "
+        "reader.\n"
+        "server_ipc_ring_full_waits_total %" PRIu64 "\n",
+        ipc.clients, ipc.records, ipc.doorbells, ipc.ring_full_waits);
+  }
+  buffer_appendf(&body, "# EOF\n");
+
+  send_response(conn,
+                body.data ? 200 : 500,
+                "application/openmetrics-text; version=1.0.0; "
+                "charset=utf-8",
+                body.data, conn->keep_alive);
+  buffer_free(&body);
+}
+
+/* Finds a header value in the raw header block; case-insensitive name */
+static bool header_value(const char *headers, const char *name, char *value,
+                         size_t size) {
+  size_t name_length = strlen(name);
+  for (const char *line = strstr(headers, "\r\n"); line;
+       line = strstr(line + 2, "\r\n")) {
+    const char *start = line + 2;
+    if (strncasecmp(start, name, name_length) != 0 ||
+        start[name_length] != ':') {
+      continue;
+    }
+    start += name_length + 1;
+    while (*start == ' ' || *start == '\t') start++;
+    size_t length = strcspn(start, "\r\n");
+    if (length >= size) length = size - 1;
+    memcpy(value, start, length);
+    value[length] = '\0';
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Parses one request from the input buffer. Returns false while the request
+ * is incomplete; a complete request is dispatched and removed from the buffer.
+ */
+static bool process_request(connection_t *conn) {
+  char *end = strstr(conn->in.data ? conn->in.data : "", "\r\n\r\n");
+  if (!end) {
+    if (conn->in.length > HEADER_LIMIT) {
+      conn->keep_alive = false;
+      send_error(conn, 413, "invalid_request_error", "headers too large",
+                 false);
+      conn->busy = true;
+      return true;
+    }
+    return false;
+  }
+  size_t header_length = (size_t)(end - conn->in.data) + 4;
+
+  char method[16] = "", path[256] = "", version[16] = "";
+  sscanf(conn->in.data, "%15s %255s %15s", method, path, version);
+  // Terminate the header block so header lookups stay inside it
+  end[2] = '\0';
+
+  char value[64];
+  size_t content_length = 0;
+  if (header_value(conn->in.data, "Content-Length", value, sizeof(value))) {
+    content_length = strtoull(value, NULL, 10);
+  }
+  bool close_requested =
+      header_value(conn->in.data, "Connection", value, sizeof(value)) &&
+      strcasecmp(value, "close") == 0;
+  conn->keep_alive = strcmp(version, "HTTP/1.1") == 0 && !close_requested;
+
+  if (content_length > options.max_body) {
+    end[2] = '\r';
+    conn->keep_alive = false;
+    conn->busy = true;
+    send_error(conn, 413, "invalid_request_error", "request body too large",
+               false);
+    return true;
+  }
+  if (conn->in.length < header_length + content_length) {
+    end[2] = '\r';
+    return false;
+  }
+
+  atomic_fetch_add_explicit(&g_stats.requests, 1, memory_order_relaxed);
+  conn->busy = true;
+  const char *body = conn->in.data + header_length;
+  char *query = strchr(path, '?');
+  if (query) *query = '\0';
+
+  if (strcmp(path, "/v1/chat/completions") == 0) {
+    if (strcmp(method, "POST") == 0) {
+      handle_completion(conn, body, content_length);
+    } else {
+      send_error(conn, 405, "invalid_request_error", "use POST",
+                 conn->keep_alive);
+    }
+  } else if (strcmp(method, "GET") != 0) {
+    send_error(conn, strcmp(path, "/v1/models") == 0 ||
+                             strcmp(path, "/health") == 0 ||
+                             strcmp(path, "/metrics") == 0
+                         ? 405
+                         : 404,
+               "invalid_request_error", "unsupported method or path",
+               conn->keep_alive);
+  } else if (strcmp(path, "/v1/models") == 0) {
+    char models[160];
+    snprintf(models, sizeof(models),
+             "{\"object\":\"list\",\"data\":[{\"id\":\"%s\",\"object\":"
+             "\"model\",\"created\":0,\"owned_by\":\"system\"}]}",
+             MODEL_ID);
+    send_response(conn, 200, "application/json", models, conn->keep_alive);
+  } else if (strcmp(path, "/health") == 0) {
+    bool ready = ai_is_ready();
+    send_response(conn, ready ? 200 : 503, "application/json",
+                  ready ? "{\"status\":\"ok\"}"
+                        : "{\"status\":\"model unavailable\"}",
+                  conn->keep_alive);
+  } else if (strcmp(path, "/metrics") == 0) {
+    handle_metrics(conn);
+  } else {
+    send_error(conn, 404, "invalid_request_error", "unknown path",
+               conn->keep_alive);
+  }
+
+  buffer_consume(&conn->in, header_length + content_length);
+  return true;
+}
+
+/* ---- Event loop -------------------------------------------------------- */
+
+static int open_listener(void) {
+  int fd;
+  if (options.unix_path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(options.unix_path) >= sizeof(addr.sun_path)) return -1;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", options.unix_path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    unlink(options.unix_path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      close(fd);
+      return -1;
+    }
+  } else {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(options.port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      close(fd);
+      return -1;
+    }
+  }
+
+  if (listen(fd, 128) != 0) {
+    close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  return fd;
+}
+
+static void close_connection(connection_t *conn) {
+  pthread_mutex_lock(&conn->mutex);
+  conn->closed = true;
+  pthread_mutex_unlock(&conn->mutex);
+  close(conn->fd);
+  connection_release(conn);
+}
+
+static bool read_connection(connection_t *conn) {
+  char chunk[16384];
+  for (;;) {
+    ssize_t n = read(conn->fd, chunk, sizeof(chunk));
+    if (n > 0) {
+      if (!buffer_append(&conn->in, chunk, (size_t)n)) return false;
+      conn->last_active_s = monotonic_s();
+      continue;
+    }
+    if (n == 0) return false;
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+}
+
+/*
+ * Writes queued output. Returns false when the connection should close:
+ * on errors, or once a response ends and the connection is not kept alive.
+ */
+static bool flush_connection(connection_t *conn) {
+  pthread_mutex_lock(&conn->mutex);
+  while (conn->out_sent < conn->out.length) {
+    ssize_t n = write(conn->fd, conn->out.data + conn->out_sent,
+                      conn->out.length - conn->out_sent);
+    if (n < 0) {
+      bool retry = errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+      pthread_mutex_unlock(&conn->mutex);
+      return retry;
+    }
+    conn->out_sent += (size_t)n;
+    conn->last_active_s = monotonic_s();
+  }
+  conn->out.length = 0;
+  conn->out_sent = 0;
+
+  bool finished = conn->busy && conn->response_done;
+  if (finished) conn->response_done = false;
+  pthread_mutex_unlock(&conn->mutex);
+
+  if (!finished) return true;
+  conn->busy = false;
+  return conn->keep_alive;
+}
+
+static bool has_output(connection_t *conn) {
+  pthread_mutex_lock(&conn->mutex);
+  bool pending = conn->out.length > conn->out_sent || conn->response_done;
+  pthread_mutex_unlock(&conn->mutex);
+  return pending;
+}
+
+static void run_loop(int listen_fd) {
+  size_t count = 0, capacity = 64;
+  connection_t **conns = malloc(capacity * sizeof(*conns));
+  struct pollfd *fds = malloc((capacity + 2) * sizeof(*fds));
+  if (!conns || !fds) {
+    free(conns);
+    free(fds);
+    return;
+  }
+
+  while (!g_stop) {
+    fds[0] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+    fds[1] = (struct pollfd){.fd = g_wake_pipe[0], .events = POLLIN};
+    for (size_t i = 0; i < count; i++) {
+      short events = conns[i]->busy ? 0 : POLLIN;
+      if (has_output(conns[i])) events |= POLLOUT;
+      fds[i + 2] = (struct pollfd){.fd = conns[i]->fd, .events = events};
+    }
+
+    if (poll(fds, count + 2, POLL_INTERVAL_MS) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char drain[256];
+      while (read(g_wake_pipe[0], drain, sizeof(drain)) > 0) {
+      }
+    }
+
+    double now = monotonic_s();
+    for (size_t i = 0; i < count;) {
+      connection_t *conn = conns[i];
+      short revents = fds[i + 2].revents;
+      bool keep = true;
+
+      if (revents & (POLLERR | POLLNVAL)) keep = false;
+      if (keep && (revents & (POLLIN | POLLHUP)) && !conn->busy) {
+        keep = read_connection(conn);
+      }
+      // A busy connection is still polled so a hang-up cancels its stream
+      if (keep && conn->busy && (revents & POLLHUP)) keep = false;
+      if (keep) keep = flush_connection(conn);
+      while (keep && !conn->busy && conn->in.length &&
+             process_request(conn)) {
+        keep = flush_connection(conn);
+      }
+      if (keep && !conn->busy && now - conn->last_active_s > IDLE_TIMEOUT_S) {
+        keep = false;
+      }
+
+      if (keep) {
+        i++;
+        continue;
+      }
+      close_connection(conn);
+      conns[i] = conns[--count];
+      fds[i + 2] = fds[count + 2];
+    }
+
+    if (fds[0].revents & POLLIN) {
+      for (;;) {
+        int client = accept(listen_fd, NULL, NULL);
+        if (client < 0) break;
+        fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+        fcntl(client, F_SETFD, FD_CLOEXEC);
+
+        if (count == capacity) {
+          size_t grown = capacity * 2;
+          connection_t **more_conns = realloc(conns, grown * sizeof(*conns));
+          if (more_conns) conns = more_conns;
+          struct pollfd *more_fds =
+              realloc(fds, (grown + 2) * sizeof(*fds));
+          if (more_fds) fds = more_fds;
+          if (!more_conns || !more_fds) {
+            close(client);
+            break;
+          }
+          capacity = grown;
+        }
+        connection_t *conn = connection_create(client);
+        if (!conn) {
+          close(client);
+          break;
+        }
+        conns[count++] = conn;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) close_connection(conns[i]);
+  free(conns);
+  free(fds);
+}
+
+/* ---- Startup ----------------------------------------------------------- */
+
+static void handle_signal(int signal_number) {
+  (void)signal_number;
+  g_stop = 1;
+  wake_loop();
+}
+
+static void usage(FILE *out) {
+  fprintf(out,
+          "Usage: " SERVER_NAME " [options]\n"
+          "  -p, --port N            loopback TCP port (default %d)\n"
+          "  -u, --unix PATH         listen on a Unix socket instead\n"
+          "  -w, --workers N         concurrent generations (default 4, max "
+          "%d)\n"
+          "  -q, --queue N           requests waiting for a worker before "
+          "429 (default 256)\n"
+          "  -i, --instructions TEXT default system prompt for warm "
+          "sessions\n"
+          "  -c, --cache-size N      cached temperature-0 answers, 0 "
+          "disables (default 256)\n"
+          "  -b, --max-body BYTES    largest accepted request body "
+          "(default 1048576)\n"
+          "  -n, --similar-cache-size N\n"
+          "                          cached temperature-0 json_schema "
+          "answers reused for\n"
+          "                          near-duplicate prompts, 0 disables "
+          "(default 0)\n"
+          "  -d, --similar-distance BITS\n"
+          "                          largest signature distance treated as "
+          "a match,\n"
+          "                          0..%d (default 3)\n"
+          "  -s, --ipc PATH          also serve libai-client processes on "
+          "this socket\n",
+          DEFAULT_PORT, MAX_WORKERS, SIMILAR_MAX_DISTANCE);
+}
+
+static bool parse_options(int argc, char **argv) {
+  static const struct option long_options[] = {
+      {"port", required_argument, NULL, 'p'},
+      {"unix", required_argument, NULL, 'u'},
+      {"workers", required_argument, NULL, 'w'},
+      {"queue", required_argument, NULL, 'q'},
+      {"instructions", required_argument, NULL, 'i'},
+      {"cache-size", required_argument, NULL, 'c'},
+      {"max-body", required_argument, NULL, 'b'},
+      {"similar-cache-size", required_argument, NULL, 'n'},
+      {"similar-distance", required_argument, NULL, 'd'},
+      {"ipc", required_argument, NULL, 's'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:u:w:q:i:c:b:n:d:s:h", long_options,
+                            NULL)) != -1) {
+    switch (opt) {
+      case 'p':
+        options.port = (uint16_t)atoi(optarg);
+        break;
+      case 'u':
+        options.unix_path = optarg;
+        break;
+      case 'w':
+        options.workers = atoi(optarg);
+        break;
+      case 'q':
+        options.queue = atoi(optarg);
+        break;
+      case 'i':
+        options.instructions = optarg;
+        break;
+      case 'c':
+        options.cache_size = atoi(optarg);
+        break;
+      case 'b':
+        options.max_body = strtoull(optarg, NULL, 10);
+        break;
+      case 'n':
+        options.similar_cache_size = atoi(optarg);
+        break;
+      case 'd':
+        options.similar_distance = atoi(optarg);
+        break;
+      case 's':
+        options.ipc_path = optarg;
+        break;
+      case 'h':
+        usage(stdout);
+        exit(0);
+      default:
+        usage(stderr);
+        return false;
+    }
+  }
+
+  if (options.workers < 1 || options.workers > MAX_WORKERS ||
+      options.queue < 1 || options.cache_size < 0 || options.max_body == 0 ||
+      options.similar_cache_size < 0 || options.similar_distance < 0 ||
+      options.similar_distance > SIMILAR_MAX_DISTANCE ||
+      (!options.unix_path && options.port == 0)) {
+    fprintf(stderr, SERVER_NAME ": invalid options\n");
+    usage(stderr);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (!parse_options(argc, argv)) return 1;
+
+  if (ai_init() != AI_SUCCESS) {
+    fprintf(stderr, SERVER_NAME ": ai_init failed\n");
+    return 1;
+  }
+  if (!ai_is_ready()) {
+    char *reason = ai_get_availability_reason();
+    fprintf(stderr, SERVER_NAME ": model not ready yet: %s\n",
+            reason ? reason : "unknown reason");
+    ai_free_string(reason);
+  }
+
+  if (pipe(g_wake_pipe) != 0 || !cache_init() || !similar_init()) {
+    fprintf(stderr, SERVER_NAME ": setup failed\n");
+    return 1;
+  }
+  for (int i = 0; i < 2; i++) {
+    fcntl(g_wake_pipe[i], F_SETFL, fcntl(g_wake_pipe[i], F_GETFL) | O_NONBLOCK);
+    fcntl(g_wake_pipe[i], F_SETFD, FD_CLOEXEC);
+  }
+
+  int listen_fd = open_listener();
+  if (listen_fd < 0) {
+    fprintf(stderr, SERVER_NAME ": cannot listen on %s: %s\n",
+            options.unix_path ? options.unix_path : "loopback port",
+            strerror(errno));
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+
+  worker_t workers[MAX_WORKERS] = {0};
+  int started = 0;
+  for (; started < options.workers; started++) {
+    worker_t *worker = &workers[started];
+    worker->index = started;
+    worker->context = ai_context_create();
+    pthread_mutex_init(&worker->mutex, NULL);
+    pthread_cond_init(&worker->cond, NULL);
+    if (!worker->context ||
+        pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+      fprintf(stderr, SERVER_NAME ": failed to start worker %d\n", started);
+      ai_context_free(worker->context);
+      break;
+    }
+  }
+
+  bool serving = started == options.workers;
+  if (serving && options.ipc_path && !ipc_server_start(options.ipc_path)) {
+    fprintf(stderr, SERVER_NAME ": cannot listen on %s: %s\n",
+            options.ipc_path, strerror(errno));
+    serving = false;
+  }
+
+  if (serving) {
+    if (options.ipc_path) {
+      fprintf(stderr, SERVER_NAME ": serving libai-client on %s\n",
+              options.ipc_path);
+    }
+    if (options.unix_path) {
+      fprintf(stderr, SERVER_NAME ": listening on %s\n", options.unix_path);
+    } else {
+      fprintf(stderr, SERVER_NAME ": listening on http://127.0.0.1:%u\n",
+              options.port);
+    }
+    run_loop(listen_fd);
+  }
+  ipc_server_stop();
+
+  // Workers finish the request in hand; queued requests are dropped
+  pthread_mutex_lock(&g_queue.mutex);
+  g_queue.stopping = true;
+  job_t *pending = g_queue.head;
+  g_queue.head = g_queue.tail = NULL;
+  pthread_cond_broadcast(&g_queue.cond);
+  pthread_mutex_unlock(&g_queue.mutex);
+  while (pending) {
+    job_t *next = pending->next;
+    job_free(pending);
+    pending = next;
+  }
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+    ai_context_free(workers[i].context);
+    pthread_mutex_destroy(&workers[i].mutex);
+    pthread_cond_destroy(&workers[i].cond);
+    buffer_free(&workers[i].text);
+  }
+
+  close(listen_fd);
+  if (options.unix_path) unlink(options.unix_path);
+  ai_cleanup();
+  return serving ? 0 : 1;
+}
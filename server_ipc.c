@@ -0,0 +1,893 @@
+/*
+ * Shared-memory IPC endpoint of libai-server.
+ *
+ * Clients linked against libai-client (libai built on ipc_bridge.c) connect
+ * here and drive the server's bridge directly: they own real sessions, so
+ * history, tools and the whole ai.h API behave as in-process. Control frames
+ * arrive on a Unix socket; stream output is written into the client's
+ * shared-memory ring from the bridge's callback threads. See ai_ipc.h for the
+ * wire format.
+ *
+ * Every connection has a reader thread. Calls that can block on the model
+ * run on their own threads, at most MAX_TASKS_PER_CONN per connection, so
+ * one slow generation does not hold up the rest of a multi-threaded client.
+ * Sessions and streams are owned by the connection that created them;
+ * requests naming anything else are refused, and everything a connection owns
+ * is torn down when it goes away.
+ */
+
+#include "server_ipc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ai_bridge.h"
+#include "ai_ipc.h"
+#include "third-party/cJSON.h"
+
+#define MAX_SESSION_IDS 256
+#define RING_FULL_SLEEP_US 500
+#define RING_FULL_TIMEOUT_S 5.0
+#define MAX_TASKS_PER_CONN 32
+
+typedef struct ipc_conn ipc_conn_t;
+
+typedef struct ipc_stream {
+  ipc_conn_t *conn;
+  uint32_t tag;
+  ai_bridge_stream_id_t stream_id;
+  _Atomic(int) refs; /* the starter and the terminal callback */
+  bool done;         /* guarded by conn->mutex */
+  struct ipc_stream *next;
+} ipc_stream_t;
+
+typedef struct ipc_tool_call {
+  uint64_t call_id;
+  char *result;
+  bool done;
+  struct ipc_tool_call *next;
+} ipc_tool_call_t;
+
+/*
+ * The bridge keeps tool user_data for as long as it likes, so it gets a
+ * binding number rather than a pointer; bindings are looked up and removed
+ * under g_ipc.mutex.
+ */
+typedef struct ipc_tool {
+  uintptr_t binding;
+  ipc_conn_t *conn;
+  ai_bridge_session_id_t session_id;
+  char *name;
+  struct ipc_tool *next;
+} ipc_tool_t;
+
+struct ipc_conn {
+  int fd;
+  _Atomic(int) refs;
+  _Atomic(bool) closed;
+  pthread_mutex_t send_mutex;
+
+  pthread_mutex_t ring_mutex;
+  ai_ipc_ring_t *ring;
+  size_t ring_size;
+  int doorbell;
+
+  _Atomic(int) tasks; /* blocking calls running on their own threads */
+
+  // Guards the fields below
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool sessions[MAX_SESSION_IDS];
+  ipc_stream_t *streams;
+  ipc_tool_call_t *tool_calls;
+  uint64_t next_call_id;
+
+  struct ipc_conn *next; /* g_ipc.conns, guarded by g_ipc.mutex */
+};
+
+typedef struct {
+  ipc_conn_t *conn;
+  cJSON *request;
+} ipc_task_t;
+
+static struct {
+  pthread_mutex_t mutex;
+  int listen_fd;
+  int wake_pipe[2];
+  char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+  pthread_t thread;
+  bool running;
+  ipc_conn_t *conns;
+  ipc_tool_t *tools;
+  uintptr_t next_binding;
+
+  _Atomic(int64_t) clients;
+  _Atomic(uint64_t) records;
+  _Atomic(uint64_t) doorbells;
+  _Atomic(uint64_t) ring_full_waits;
+} g_ipc = {.mutex = PTHREAD_MUTEX_INITIALIZER,
+           .listen_fd = -1,
+           .wake_pipe = {-1, -1}};
+
+static void conn_release(ipc_conn_t *conn) {
+  if (atomic_fetch_sub(&conn->refs, 1) != 1) return;
+
+  if (conn->ring) munmap(conn->ring, conn->ring_size);
+  if (conn->doorbell >= 0) close(conn->doorbell);
+  close(conn->fd);
+  pthread_mutex_destroy(&conn->send_mutex);
+  pthread_mutex_destroy(&conn->ring_mutex);
+  pthread_mutex_destroy(&conn->mutex);
+  pthread_cond_destroy(&conn->cond);
+  free(conn);
+  atomic_fetch_sub(&g_ipc.clients, 1);
+}
+
+/* Marks the connection dead; the reader thread notices and tears it down */
+static void conn_close(ipc_conn_t *conn) {
+  if (atomic_exchange(&conn->closed, true)) return;
+  shutdown(conn->fd, SHUT_RDWR);
+  pthread_mutex_lock(&conn->mutex);
+  pthread_cond_broadcast(&conn->cond);
+  pthread_mutex_unlock(&conn->mutex);
+}
+
+static void send_json(ipc_conn_t *conn, cJSON *message) {
+  char *json = cJSON_PrintUnformatted(message);
+  if (!json) {
+    conn_close(conn);
+    return;
+  }
+  pthread_mutex_lock(&conn->send_mutex);
+  bool sent = !atomic_load(&conn->closed) &&
+              ai_ipc_send_frame(conn->fd, json, strlen(json), NULL, 0);
+  pthread_mutex_unlock(&conn->send_mutex);
+  free(json);
+  if (!sent) conn_close(conn);
+}
+
+/* Sends @p reply (consumed) as the answer to @p request */
+static void send_reply(ipc_conn_t *conn, const cJSON *request, cJSON *reply) {
+  if (!reply) reply = cJSON_CreateObject();
+  if (!reply) {
+    conn_close(conn);
+    return;
+  }
+  cJSON *id = cJSON_GetObjectItem(request, "id");
+  cJSON_AddNumberToObject(reply, "id", cJSON_IsNumber(id) ? id->valuedouble
+                                                          : 0);
+  send_json(conn, reply);
+  cJSON_Delete(reply);
+}
+
+static void send_error(ipc_conn_t *conn, const cJSON *request,
+                       const char *message) {
+  cJSON *reply = cJSON_CreateObject();
+  cJSON_AddStringToObject(reply, "error", message);
+  send_reply(conn, request, reply);
+}
+
+/* ---- Stream output ----------------------------------------------------- */
+
+static void ring_doorbell(ipc_conn_t *conn) {
+  char byte = 0;
+  if (write(conn->doorbell, &byte, 1) == 1) {
+    atomic_fetch_add_explicit(&g_ipc.doorbells, 1, memory_order_relaxed);
+  }
+}
+
+static double monotonic_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Writes one chunk into the client's ring, splitting it if it is large. A
+ * client that leaves its ring full for RING_FULL_TIMEOUT_S is disconnected,
+ * which cancels its streams, rather than holding the bridge's callback
+ * threads indefinitely.
+ */
+static void publish(ipc_conn_t *conn, uint32_t tag, uint8_t kind,
+                    const char *chunk) {
+  if (atomic_load(&conn->closed)) return;
+
+  size_t remaining = chunk ? strlen(chunk) : 0;
+  size_t max_payload = AI_IPC_MAX_RECORD_PAYLOAD(conn->ring->capacity);
+  double deadline = 0;
+
+  pthread_mutex_lock(&conn->ring_mutex);
+  do {
+    size_t piece = remaining < max_payload ? remaining : max_payload;
+    uint8_t piece_kind = remaining > max_payload ? AI_IPC_RECORD_PART : kind;
+    bool corrupt;
+    while (!ai_ipc_ring_write(conn->ring, tag, piece_kind, chunk,
+                              (uint32_t)piece, &corrupt)) {
+      if (!deadline) deadline = monotonic_s() + RING_FULL_TIMEOUT_S;
+      if (corrupt || atomic_load(&conn->closed) ||
+          monotonic_s() > deadline) {
+        pthread_mutex_unlock(&conn->ring_mutex);
+        conn_close(conn);
+        return;
+      }
+      // The reader is behind; make sure it is awake, then back off
+      atomic_fetch_add_explicit(&g_ipc.ring_full_waits, 1,
+                                memory_order_relaxed);
+      ring_doorbell(conn);
+      usleep(RING_FULL_SLEEP_US);
+    }
+    atomic_fetch_add_explicit(&g_ipc.records, 1, memory_order_relaxed);
+    if (chunk) chunk += piece;
+    remaining -= piece;
+  } while (remaining > 0);
+
+  if (ai_ipc_ring_take_waiter(conn->ring)) ring_doorbell(conn);
+  pthread_mutex_unlock(&conn->ring_mutex);
+}
+
+static void stream_release(ipc_stream_t *stream) {
+  if (atomic_fetch_sub(&stream->refs, 1) != 1) return;
+  conn_release(stream->conn);
+  free(stream);
+}
+
+/* Unlinks a finished stream; returns false if it was already finished */
+static bool stream_finish(ipc_stream_t *stream) {
+  ipc_conn_t *conn = stream->conn;
+  pthread_mutex_lock(&conn->mutex);
+  bool first = !stream->done;
+  stream->done = true;
+  for (ipc_stream_t **link = &conn->streams; first && *link;
+       link = &(*link)->next) {
+    if (*link == stream) {
+      *link = stream->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  return first;
+}
+
+static void stream_callback(void *context, const char *chunk,
+                            void *user_data) {
+  (void)user_data;
+  ipc_stream_t *stream = context;
+  // An "Error:" chunk travels as a normal chunk; only NULL ends the stream
+  uint8_t kind = chunk ? AI_IPC_RECORD_CHUNK : AI_IPC_RECORD_END;
+  publish(stream->conn, stream->tag, kind, chunk);
+  if (kind == AI_IPC_RECORD_END && stream_finish(stream)) {
+    stream_release(stream);
+  }
+}
+
+/* ---- Tools ------------------------------------------------------------- */
+
+static char *tool_callback(const char *parameters_json, void *user_data) {
+  uintptr_t binding = (uintptr_t)user_data;
+
+  pthread_mutex_lock(&g_ipc.mutex);
+  ipc_tool_t *tool = g_ipc.tools;
+  while (tool && tool->binding != binding) tool = tool->next;
+  ipc_conn_t *conn = tool ? tool->conn : NULL;
+  char *name = tool ? strdup(tool->name) : NULL;
+  ai_bridge_session_id_t session_id = tool ? tool->session_id : 0;
+  if (conn) atomic_fetch_add(&conn->refs, 1);
+  pthread_mutex_unlock(&g_ipc.mutex);
+  if (!conn) return NULL;
+
+  ipc_tool_call_t call = {0};
+  pthread_mutex_lock(&conn->mutex);
+  call.call_id = ++conn->next_call_id;
+  call.next = conn->tool_calls;
+  conn->tool_calls = &call;
+  pthread_mutex_unlock(&conn->mutex);
+
+  cJSON *event = cJSON_CreateObject();
+  cJSON_AddStringToObject(event, "event", "tool_call");
+  cJSON_AddNumberToObject(event, "call", (double)call.call_id);
+  cJSON_AddNumberToObject(event, "session", session_id);
+  cJSON_AddStringToObject(event, "name", name ? name : "");
+  cJSON_AddStringToObject(event, "arguments",
+                          parameters_json ? parameters_json : "{}");
+  send_json(conn, event);
+  cJSON_Delete(event);
+  free(name);
+
+  pthread_mutex_lock(&conn->mutex);
+  while (!call.done && !atomic_load(&conn->closed)) {
+    pthread_cond_wait(&conn->cond, &conn->mutex);
+  }
+  for (ipc_tool_call_t **link = &conn->tool_calls; *link;
+       link = &(*link)->next) {
+    if (*link == &call) {
+      *link = call.next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+
+  conn_release(conn);
+  return call.result;
+}
+
+static void remove_tools(ipc_conn_t *conn, int session_id) {
+  pthread_mutex_lock(&g_ipc.mutex);
+  for (ipc_tool_t **link = &g_ipc.tools; *link;) {
+    ipc_tool_t *tool = *link;
+    if (tool->conn == conn &&
+        (session_id < 0 || tool->session_id == session_id)) {
+      *link = tool->next;
+      free(tool->name);
+      free(tool);
+    } else {
+      link = &tool->next;
+    }
+  }
+  pthread_mutex_unlock(&g_ipc.mutex);
+}
+
+/* ---- Requests ---------------------------------------------------------- */
+
+static const char *json_string(const cJSON *object, const char *key) {
+  const cJSON *item = cJSON_GetObjectItem(object, key);
+  return cJSON_IsString(item) ? item->valuestring : NULL;
+}
+
+static double json_number(const cJSON *object, const char *key) {
+  const cJSON *item = cJSON_GetObjectItem(object, key);
+  return cJSON_IsNumber(item) ? item->valuedouble : 0;
+}
+
+static bool json_bool(const cJSON *object, const char *key) {
+  return cJSON_IsTrue(cJSON_GetObjectItem(object, key));
+}
+
+/* Returns the request's session if this connection owns it, else 0 */
+static ai_bridge_session_id_t owned_session(ipc_conn_t *conn,
+                                            const cJSON *request) {
+  double value = json_number(request, "session");
+  if (value < 1 || value >= MAX_SESSION_IDS) return AI_BRIDGE_INVALID_ID;
+
+  ai_bridge_session_id_t session_id = (ai_bridge_session_id_t)value;
+  pthread_mutex_lock(&conn->mutex);
+  bool owned = conn->sessions[session_id];
+  pthread_mutex_unlock(&conn->mutex);
+  return owned ? session_id : AI_BRIDGE_INVALID_ID;
+}
+
+static cJSON *text_reply(char *text) {
+  cJSON *reply = cJSON_CreateObject();
+  if (text) {
+    cJSON_AddStringToObject(reply, "text", text);
+  } else {
+    cJSON_AddNullToObject(reply, "text");
+  }
+  ai_bridge_free_string(text);
+  return reply;
+}
+
+static cJSON *ok_reply(bool ok) {
+  cJSON *reply = cJSON_CreateObject();
+  cJSON_AddBoolToObject(reply, "ok", ok);
+  return reply;
+}
+
+static cJSON *handle_create_session(ipc_conn_t *conn, const cJSON *request) {
+  // Older clients send no use case and get the general model; out-of-range
+  // values are passed on as -1 for the bridge to reject
+  double use_case = json_number(request, "use_case");
+  ai_bridge_session_id_t session_id = ai_bridge_create_session_with_use_case(
+      json_string(request, "instructions"), json_string(request, "tools_json"),
+      json_bool(request, "guardrails"), json_bool(request, "history"),
+      json_bool(request, "structured"),
+      json_string(request, "default_schema"), json_bool(request, "prewarm"),
+      use_case >= 0 && use_case <= INT32_MAX ? (int32_t)use_case : -1);
+
+  if (session_id != AI_BRIDGE_INVALID_ID) {
+    pthread_mutex_lock(&conn->mutex);
+    conn->sessions[session_id] = true;
+    pthread_mutex_unlock(&conn->mutex);
+  }
+  cJSON *reply = cJSON_CreateObject();
+  cJSON_AddNumberToObject(reply, "session", session_id);
+  return reply;
+}
+
+static cJSON *handle_destroy_session(ipc_conn_t *conn, const cJSON *request) {
+  ai_bridge_session_id_t session_id = owned_session(conn, request);
+  if (session_id == AI_BRIDGE_INVALID_ID) return ok_reply(false);
+
+  ai_bridge_destroy_session(session_id);
+  remove_tools(conn, session_id);
+  pthread_mutex_lock(&conn->mutex);
+  conn->sessions[session_id] = false;
+  pthread_mutex_unlock(&conn->mutex);
+  return ok_reply(true);
+}
+
+static cJSON *handle_register_tool(ipc_conn_t *conn, const cJSON *request) {
+  ai_bridge_session_id_t session_id = owned_session(conn, request);
+  const char *name = json_string(request, "name");
+  if (session_id == AI_BRIDGE_INVALID_ID || !name) return ok_reply(false);
+
+  ipc_tool_t *tool = calloc(1, sizeof(*tool));
+  if (!tool || !(tool->name = strdup(name))) {
+    free(tool);
+    return ok_reply(false);
+  }
+  tool->conn = conn;
+  tool->session_id = session_id;
+  pthread_mutex_lock(&g_ipc.mutex);
+  tool->binding = ++g_ipc.next_binding;
+  tool->next = g_ipc.tools;
+  g_ipc.tools = tool;
+  pthread_mutex_unlock(&g_ipc.mutex);
+
+  return ok_reply(ai_bridge_register_tool(session_id, name, tool_callback,
+                                          (void *)tool->binding));
+}
+
+static cJSON *handle_tool_result(ipc_conn_t *conn, const cJSON *request) {
+  uint64_t call_id = (uint64_t)json_number(request, "call");
+  const char *result = json_string(request, "result");
+
+  pthread_mutex_lock(&conn->mutex);
+  for (ipc_tool_call_t *call = conn->tool_calls; call; call = call->next) {
+    if (call->call_id == call_id && !call->done) {
+      call->result = result ? strdup(result) : NULL;
+      call->done = true;
+      pthread_cond_broadcast(&conn->cond);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+  return NULL;
+}
+
+static cJSON *handle_generate(ipc_conn_t *conn, const cJSON *request,
+                              bool structured) {
+  ai_bridge_session_id_t session_id = owned_session(conn, request);
+  if (session_id == AI_BRIDGE_INVALID_ID) {
+    return text_reply(strdup("Error: Session not found"));
+  }
+
+  const char *prompt = json_string(request, "prompt");
+  double temperature = json_number(request, "temperature");
+  int32_t max_tokens = (int32_t)json_number(request, "max_tokens");
+  char *text = structured
+                   ? ai_bridge_generate_structured_response(
+                         session_id, prompt ? prompt : "",
+                         json_string(request, "schema"), temperature,
+                         max_tokens)
+                   : ai_bridge_generate_response(session_id,
+                                                 prompt ? prompt : "",
+                                                 temperature, max_tokens);
+  return text_reply(text);
+}
+
+static cJSON *handle_stream(ipc_conn_t *conn, const cJSON *request) {
+  cJSON *reply = cJSON_CreateObject();
+  ai_bridge_session_id_t session_id = owned_session(conn, request);
+  const char *prompt = json_string(request, "prompt");
+  ipc_stream_t *stream =
+      session_id && prompt ? calloc(1, sizeof(*stream)) : NULL;
+  if (!stream) {
+    cJSON_AddNumberToObject(reply, "stream", AI_BRIDGE_INVALID_ID);
+    return reply;
+  }
+
+  stream->conn = conn;
+  stream->tag = (uint32_t)json_number(request, "tag");
+  stream->refs = 2;
+  atomic_fetch_add(&conn->refs, 1);
+  pthread_mutex_lock(&conn->mutex);
+  stream->next = conn->streams;
+  conn->streams = stream;
+  pthread_mutex_unlock(&conn->mutex);
+
+  double temperature = json_number(request, "temperature");
+  int32_t max_tokens = (int32_t)json_number(request, "max_tokens");
+  // Output may arrive before this returns; records carry the client's tag
+  ai_bridge_stream_id_t stream_id =
+      json_bool(request, "structured")
+          ? ai_bridge_generate_structured_response_stream(
+                session_id, prompt, json_string(request, "schema"),
+                temperature, max_tokens, stream, stream_callback, NULL)
+          : ai_bridge_generate_response_stream(session_id, prompt,
+                                               temperature, max_tokens,
+                                               stream, stream_callback, NULL);
+
+  pthread_mutex_lock(&conn->mutex);
+  stream->stream_id = stream_id;
+  pthread_mutex_unlock(&conn->mutex);
+  if (stream_id == AI_BRIDGE_INVALID_ID && stream_finish(stream)) {
+    stream_release(stream);  // No callback will come
+  }
+  stream_release(stream);
+
+  cJSON_AddNumberToObject(reply, "stream", stream_id);
+  return reply;
+}
+
+static cJSON *handle_cancel(ipc_conn_t *conn, const cJSON *request) {
+  double value = json_number(request, "stream");
+  bool owned = false;
+  pthread_mutex_lock(&conn->mutex);
+  for (ipc_stream_t *stream = conn->streams; stream; stream = stream->next) {
+    if (stream->stream_id != AI_BRIDGE_INVALID_ID &&
+        stream->stream_id == value) {
+      owned = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&conn->mutex);
+
+  // Outside the lock: the bridge may deliver the final chunk synchronously
+  return ok_reply(owned &&
+                  ai_bridge_cancel_stream((ai_bridge_stream_id_t)value));
+}
+
+static cJSON *handle_request(ipc_conn_t *conn, const cJSON *request,
+                             const char *op) {
+  if (strcmp(op, "availability") == 0) {
+    cJSON *reply = cJSON_CreateObject();
+    cJSON_AddNumberToObject(reply, "status", ai_bridge_check_availability());
+    return reply;
+  }
+  if (strcmp(op, "availability_reason") == 0) {
+    return text_reply(ai_bridge_get_availability_reason());
+  }
+  if (strcmp(op, "languages_count") == 0) {
+    cJSON *reply = cJSON_CreateObject();
+    cJSON_AddNumberToObject(reply, "count",
+                            ai_bridge_get_supported_languages_count());
+    return reply;
+  }
+  if (strcmp(op, "language") == 0) {
+    return text_reply(ai_bridge_get_supported_language(
+        (int32_t)json_number(request, "index")));
+  }
+  if (strcmp(op, "languages") == 0) {
+    return text_reply(ai_bridge_get_supported_languages());
+  }
+  if (strcmp(op, "create_session") == 0) {
+    return handle_create_session(conn, request);
+  }
+  if (strcmp(op, "destroy_session") == 0) {
+    return handle_destroy_session(conn, request);
+  }
+  if (strcmp(op, "register_tool") == 0) {
+    return handle_register_tool(conn, request);
+  }
+  if (strcmp(op, "generate") == 0) return handle_generate(conn, request, false);
+  if (strcmp(op, "generate_structured") == 0) {
+    return handle_generate(conn, request, true);
+  }
+  if (strcmp(op, "stream") == 0) return handle_stream(conn, request);
+  if (strcmp(op, "cancel") == 0) return handle_cancel(conn, request);
+
+  ai_bridge_session_id_t session_id = owned_session(conn, request);
+  if (strcmp(op, "history") == 0) {
+    return text_reply(session_id ? ai_bridge_get_session_history(session_id)
+                                 : NULL);
+  }
+  if (strcmp(op, "clear_history") == 0) {
+    return ok_reply(session_id &&
+                    ai_bridge_clear_session_history(session_id));
+  }
+  if (strcmp(op, "add_message") == 0) {
+    const char *role = json_string(request, "role");
+    const char *content = json_string(request, "content");
+    return ok_reply(session_id && role && content &&
+                    ai_bridge_add_message_to_history(session_id, role,
+                                                     content));
+  }
+  return NULL;
+}
+
+static void *task_main(void *arg) {
+  ipc_task_t *task = arg;
+  const char *op = json_string(task->request, "op");
+  send_reply(task->conn, task->request,
+             handle_request(task->conn, task->request, op));
+  cJSON_Delete(task->request);
+  atomic_fetch_sub(&task->conn->tasks, 1);
+  conn_release(task->conn);
+  free(task);
+  return NULL;
+}
+
+/* Runs calls that wait on the model off the reader thread */
+static bool may_block(const char *op) {
+  return strcmp(op, "generate") == 0 ||
+         strcmp(op, "generate_structured") == 0 ||
+         strcmp(op, "create_session") == 0 ||
+         strcmp(op, "destroy_session") == 0;
+}
+
+static void dispatch(ipc_conn_t *conn, cJSON *request) {
+  const char *op = json_string(request, "op");
+  if (!op) {
+    send_error(conn, request, "missing op");
+    cJSON_Delete(request);
+    return;
+  }
+  if (strcmp(op, "tool_result") == 0) {
+    handle_tool_result(conn, request);
+    cJSON_Delete(request);
+    return;
+  }
+
+  if (may_block(op)) {
+    // The reader must keep serving tool results, so over the limit the
+    // call is refused rather than queued behind the running ones
+    if (atomic_fetch_add(&conn->tasks, 1) >= MAX_TASKS_PER_CONN) {
+      atomic_fetch_sub(&conn->tasks, 1);
+      send_error(conn, request, "too many calls in flight");
+      cJSON_Delete(request);
+      return;
+    }
+    ipc_task_t *task = malloc(sizeof(*task));
+    pthread_t thread;
+    if (task) {
+      task->conn = conn;
+      task->request = request;
+      atomic_fetch_add(&conn->refs, 1);
+      if (pthread_create(&thread, NULL, task_main, task) == 0) {
+        pthread_detach(thread);
+        return;
+      }
+      atomic_fetch_sub(&conn->refs, 1);
+      free(task);
+    }
+    atomic_fetch_sub(&conn->tasks, 1);
+    send_error(conn, request, "server is out of threads");
+    cJSON_Delete(request);
+    return;
+  }
+
+  cJSON *reply = handle_request(conn, request, op);
+  if (reply) {
+    send_reply(conn, request, reply);
+  } else {
+    send_error(conn, request, "unknown op");
+  }
+  cJSON_Delete(request);
+}
+
+/* ---- Connections ------------------------------------------------------- */
+
+/* Maps the client's ring and takes its doorbell; false rejects the client */
+static bool accept_hello(ipc_conn_t *conn) {
+  int fds[2];
+  int fd_count = 0;
+  char *json = ai_ipc_recv_frame(conn->fd, fds, 2, &fd_count);
+  cJSON *hello = json ? cJSON_Parse(json) : NULL;
+  free(json);
+
+  const char *op = json_string(hello, "op");
+  bool ok = op && strcmp(op, "hello") == 0 && fd_count == 2 &&
+            json_number(hello, "version") == AI_IPC_PROTOCOL_VERSION;
+  struct stat st;
+  if (ok && fstat(fds[0], &st) == 0 && st.st_size > 0) {
+    void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fds[0], 0);
+    if (mapped != MAP_FAILED) {
+      conn->ring = mapped;
+      conn->ring_size = (size_t)st.st_size;
+    }
+  }
+  ok = ok && conn->ring && ai_ipc_ring_valid(conn->ring, conn->ring_size);
+
+  if (fd_count > 0) close(fds[0]);
+  if (ok) {
+    conn->doorbell = fds[1];
+    fcntl(conn->doorbell, F_SETFL,
+          fcntl(conn->doorbell, F_GETFL) | O_NONBLOCK);
+    fcntl(conn->doorbell, F_SETFD, FD_CLOEXEC);
+  } else if (fd_count > 1) {
+    close(fds[1]);
+  }
+
+  if (hello) {
+    cJSON *reply = cJSON_CreateObject();
+    cJSON_AddBoolToObject(reply, "ok", ok);
+    cJSON_AddNumberToObject(reply, "version", AI_IPC_PROTOCOL_VERSION);
+    send_reply(conn, hello, reply);
+  }
+  cJSON_Delete(hello);
+  return ok;
+}
+
+/* Releases everything the connection still owns */
+static void teardown(ipc_conn_t *conn) {
+  conn_close(conn);
+
+  bool sessions[MAX_SESSION_IDS];
+  size_t stream_count = 0;
+  pthread_mutex_lock(&conn->mutex);
+  memcpy(sessions, conn->sessions, sizeof(sessions));
+  memset(conn->sessions, 0, sizeof(conn->sessions));
+  for (ipc_stream_t *stream = conn->streams; stream; stream = stream->next) {
+    stream_count++;
+  }
+  // Streams that cannot be cancelled still end; their output is dropped
+  ai_bridge_stream_id_t *streams =
+      malloc((stream_count ? stream_count : 1) * sizeof(*streams));
+  stream_count = 0;
+  for (ipc_stream_t *stream = conn->streams; streams && stream;
+       stream = stream->next) {
+    if (stream->stream_id) streams[stream_count++] = stream->stream_id;
+  }
+  pthread_mutex_unlock(&conn->mutex);
+
+  for (size_t i = 0; i < stream_count; i++) {
+    ai_bridge_cancel_stream(streams[i]);
+  }
+  free(streams);
+  for (int i = 1; i < MAX_SESSION_IDS; i++) {
+    if (sessions[i]) ai_bridge_destroy_session((ai_bridge_session_id_t)i);
+  }
+  remove_tools(conn, -1);
+
+  pthread_mutex_lock(&g_ipc.mutex);
+  for (ipc_conn_t **link = &g_ipc.conns; *link; link = &(*link)->next) {
+    if (*link == conn) {
+      *link = conn->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_ipc.mutex);
+}
+
+static void *conn_main(void *arg) {
+  ipc_conn_t *conn = arg;
+
+  if (accept_hello(conn)) {
+    char *json;
+    while ((json = ai_ipc_recv_frame(conn->fd, NULL, 0, NULL))) {
+      cJSON *request = cJSON_Parse(json);
+      free(json);
+      if (!cJSON_IsObject(request)) {
+        cJSON_Delete(request);
+        break;
+      }
+      dispatch(conn, request);
+    }
+  }
+
+  teardown(conn);
+  conn_release(conn);
+  return NULL;
+}
+
+static void start_conn(int fd) {
+  ipc_conn_t *conn = calloc(1, sizeof(*conn));
+  if (!conn) {
+    close(fd);
+    return;
+  }
+  conn->fd = fd;
+  conn->doorbell = -1;
+  conn->refs = 1;
+  pthread_mutex_init(&conn->send_mutex, NULL);
+  pthread_mutex_init(&conn->ring_mutex, NULL);
+  pthread_mutex_init(&conn->mutex, NULL);
+  pthread_cond_init(&conn->cond, NULL);
+  atomic_fetch_add(&g_ipc.clients, 1);
+
+  pthread_mutex_lock(&g_ipc.mutex);
+  conn->next = g_ipc.conns;
+  g_ipc.conns = conn;
+  pthread_mutex_unlock(&g_ipc.mutex);
+
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, conn_main, conn) != 0) {
+    teardown(conn);
+    conn_release(conn);
+    return;
+  }
+  pthread_detach(thread);
+}
+
+static void *listener_main(void *arg) {
+  (void)arg;
+  struct pollfd fds[2] = {
+      {.fd = g_ipc.listen_fd, .events = POLLIN},
+      {.fd = g_ipc.wake_pipe[0], .events = POLLIN},
+  };
+
+  for (;;) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (fds[1].revents) break;
+    if (!(fds[0].revents & POLLIN)) continue;
+
+    int fd = accept(g_ipc.listen_fd, NULL, NULL);
+    if (fd < 0) continue;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    start_conn(fd);
+  }
+  return NULL;
+}
+
+bool ipc_server_start(const char *path) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  if (strlen(path) >= sizeof(addr.sun_path)) return false;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+  snprintf(g_ipc.path, sizeof(g_ipc.path), "%s", path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  unlink(path);
+  // Clients share the model; keep the socket to this user
+  mode_t mask = umask(077);
+  bool bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+  umask(mask);
+  if (!bound || listen(fd, 64) != 0 || pipe(g_ipc.wake_pipe) != 0) {
+    close(fd);
+    return false;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(g_ipc.wake_pipe[0], F_SETFD, FD_CLOEXEC);
+  fcntl(g_ipc.wake_pipe[1], F_SETFD, FD_CLOEXEC);
+  g_ipc.listen_fd = fd;
+
+  if (pthread_create(&g_ipc.thread, NULL, listener_main, NULL) != 0) {
+    close(fd);
+    close(g_ipc.wake_pipe[0]);
+    close(g_ipc.wake_pipe[1]);
+    g_ipc.listen_fd = -1;
+    return false;
+  }
+  g_ipc.running = true;
+  return true;
+}
+
+void ipc_server_stop(void) {
+  if (!g_ipc.running) return;
+
+  char byte = 0;
+  ssize_t written = write(g_ipc.wake_pipe[1], &byte, 1);
+  (void)written;
+  pthread_join(g_ipc.thread, NULL);
+  g_ipc.running = false;
+
+  // Reader threads notice the shutdown and release what their clients own
+  pthread_mutex_lock(&g_ipc.mutex);
+  for (ipc_conn_t *conn = g_ipc.conns; conn; conn = conn->next) {
+    conn_close(conn);
+  }
+  pthread_mutex_unlock(&g_ipc.mutex);
+
+  close(g_ipc.listen_fd);
+  close(g_ipc.wake_pipe[0]);
+  close(g_ipc.wake_pipe[1]);
+  g_ipc.listen_fd = -1;
+  unlink(g_ipc.path);
+}
+
+void ipc_server_get_stats(ipc_server_stats_t *stats) {
+  stats->clients = atomic_load(&g_ipc.clients);
+  stats->records = atomic_load(&g_ipc.records);
+  stats->doorbells = atomic_load(&g_ipc.doorbells);
+  stats->ring_full_waits = atomic_load(&g_ipc.ring_full_waits);
+}
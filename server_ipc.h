@@ -0,0 +1,26 @@
+/*
+ * Shared-memory IPC endpoint of libai-server; see server_ipc.c.
+ */
+
+#ifndef SERVER_IPC_H
+#define SERVER_IPC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  int64_t clients;          /* connected IPC clients */
+  uint64_t records;         /* ring records written */
+  uint64_t doorbells;       /* wake-ups sent to sleeping readers */
+  uint64_t ring_full_waits; /* times a producer found a ring full */
+} ipc_server_stats_t;
+
+/* Starts accepting IPC clients on a Unix socket; false if it cannot listen */
+bool ipc_server_start(const char *path);
+
+/* Stops accepting clients and disconnects the connected ones */
+void ipc_server_stop(void);
+
+void ipc_server_get_stats(ipc_server_stats_t *stats);
+
+#endif /* SERVER_IPC_H */
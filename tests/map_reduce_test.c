@@ -0,0 +1,113 @@
+/*
+ * Tests for ai_map_reduce() against the synthetic bridge.
+ *
+ * With a fan-in of 2, every reduce step must combine exactly two results, so
+ * n chunks take n - 1 reduce steps whatever the parity of n; an odd result
+ * left over at the end of a round is carried to the next one instead of
+ * being reduced on its own.
+ *
+ * Usage:
+ *   map-reduce-test
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../ai.h"
+
+#define PARAGRAPH_BYTES 1500
+
+typedef struct {
+  size_t chunks;
+  size_t map_steps;
+  size_t reduce_steps;
+} counts_t;
+
+static int failures;
+
+static void on_progress(ai_context_t *context,
+                        const ai_map_reduce_progress_t *progress,
+                        void *user_data) {
+  (void)context;
+  counts_t *counts = user_data;
+  counts->chunks = progress->chunks;
+  if (progress->stage == AI_MAP_REDUCE_MAP) {
+    counts->map_steps++;
+  } else {
+    counts->reduce_steps++;
+  }
+}
+
+// Paragraphs just under the chunk budget, so each becomes one chunk
+static char *make_input(size_t paragraphs) {
+  char *input = malloc(paragraphs * (PARAGRAPH_BYTES + 2) + 1);
+  size_t length = 0;
+  for (size_t i = 0; i < paragraphs; i++) {
+    for (size_t j = 0; j < PARAGRAPH_BYTES; j++) {
+      input[length++] = j % 8 == 7 ? ' ' : (char)('a' + i % 26);
+    }
+    input[length++] = '\n';
+    input[length++] = '\n';
+  }
+  input[length] = '\0';
+  return input;
+}
+
+static void check(ai_context_t *context, size_t paragraphs,
+                  const char *schema) {
+  counts_t counts = {0};
+  ai_map_reduce_config_t config = AI_DEFAULT_MAP_REDUCE_CONFIG;
+  config.progress = on_progress;
+  config.user_data = &counts;
+  ai_chunk_policy_t policy = AI_DEFAULT_CHUNK_POLICY;
+  policy.max_chunk_tokens = 512;
+  policy.max_fan_in = 2;
+
+  char *input = make_input(paragraphs);
+  char *result = ai_map_reduce(context, &config, input, strlen(input),
+                               &policy, "S", "C", schema);
+  free(input);
+
+  const char *kind = schema ? "structured" : "text";
+  if (!result) {
+    fprintf(stderr, "FAIL %zu %s paragraphs: %s\n", paragraphs, kind,
+            ai_get_last_error(context));
+    failures++;
+    return;
+  }
+  ai_free_string(result);
+  if (counts.chunks != paragraphs || counts.map_steps != paragraphs ||
+      counts.reduce_steps != paragraphs - 1) {
+    fprintf(stderr,
+            "FAIL %zu %s paragraphs: %zu chunks, %zu map and %zu reduce "
+            "steps\n",
+            paragraphs, kind, counts.chunks, counts.map_steps,
+            counts.reduce_steps);
+    failures++;
+  }
+}
+
+int main(void) {
+  if (ai_init() != AI_SUCCESS) return 1;
+  ai_context_t *context = ai_context_create();
+  if (!context) return 1;
+
+  for (size_t paragraphs = 2; paragraphs <= 9; paragraphs++) {
+    check(context, paragraphs, NULL);
+    check(context, paragraphs, "{\"type\":\"object\"}");
+  }
+
+  ai_stats_t stats;
+  ai_get_stats(context, &stats);
+  if (stats.total_requests == 0) {
+    fprintf(stderr, "FAIL map-reduce steps are missing from the stats\n");
+    failures++;
+  }
+
+  ai_context_free(context);
+  ai_cleanup();
+  if (failures) return 1;
+  printf("map-reduce-test: ok\n");
+  return 0;
+}
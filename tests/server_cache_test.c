@@ -0,0 +1,81 @@
+/*
+ * Tests for libai-server's near-duplicate cache.
+ *
+ * Builds server.c into this translation unit (its main() renamed) and drives
+ * the similar-prompt cache directly: an answer stored for one json_schema
+ * prompt must be reused for a variant that only differs in formatting or a
+ * timestamp, and never for one that differs in an amount or an ID.
+ *
+ * Usage:
+ *   server-cache-test
+ */
+
+// server.c provides its own main(); keep it out of the way
+#define main server_main
+#include "../server.c"
+#undef main
+
+#define SCHEMA "{\"type\":\"object\"}"
+
+static int failures;
+
+static job_t *make_job(const char *prompt) {
+  job_t *job = calloc(1, sizeof(*job));
+  job->prompt = strdup(prompt);
+  job->schema = strdup(SCHEMA);
+  job->params = (ai_generation_params_t)AI_DEFAULT_PARAMS;
+  if (!build_similar_key(job) || !job->similar_scope) {
+    fprintf(stderr, "no similar key for \"%s\"\n", prompt);
+    exit(1);
+  }
+  return job;
+}
+
+static void store(const char *prompt, const char *content) {
+  job_t *job = make_job(prompt);
+  similar_store(job, content);
+  job_free(job);
+}
+
+static void expect(const char *prompt, const char *content) {
+  job_t *job = make_job(prompt);
+  char *cached = similar_lookup(job);
+  bool ok = content ? cached && strcmp(cached, content) == 0 : !cached;
+  if (!ok) {
+    fprintf(stderr, "FAIL \"%s\": expected %s, got %s\n", prompt,
+            content ? content : "a miss", cached ? cached : "a miss");
+    failures++;
+  }
+  free(cached);
+  job_free(job);
+}
+
+int main(void) {
+  options.similar_cache_size = 64;
+  options.similar_distance = SIMILAR_MAX_DISTANCE;
+  if (!similar_init()) return 1;
+
+  store("Extract the invoice total: 450 dollars, due 2024-03-01", "{\"a\":1}");
+  expect("extract the   invoice TOTAL 450 dollars; due 2024-03-01",
+         "{\"a\":1}");
+  expect("Extract the invoice total: 450 dollars, due 2025-11-30",
+         "{\"a\":1}");
+  expect("Extract the invoice total: 450 dollars, due 2024/3/1", "{\"a\":1}");
+  expect("Extract the invoice total: 9999 dollars, due 2024-03-01", NULL);
+  expect("Extract the invoice total: 45 dollars, due 2024-03-01", NULL);
+  expect("Extract the invoice total: 4.50 dollars, due 2024-03-01", NULL);
+
+  store("Summarise ticket 18273 logged at 2024-05-02T09:15:00Z", "{\"b\":2}");
+  expect("Summarise ticket 18273 logged at 2024-05-03T17:40:12.5Z",
+         "{\"b\":2}");
+  expect("Summarise ticket 18274 logged at 2024-05-02T09:15:00Z", NULL);
+  expect("Summarise ticket 18273 logged at 10:30", "{\"b\":2}");
+
+  store("Order 12 of 7 widgets", "{\"c\":3}");
+  expect("Order 127 widgets", NULL);
+  expect("Order 7 of 12 widgets", NULL);
+
+  if (failures) return 1;
+  printf("server-cache-test: ok\n");
+  return 0;
+}
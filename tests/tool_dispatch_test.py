@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""
+Queued tool calls with several AIBridge instances in one process.
+
+The bridge's tool queue is shared by every AIBridge on a library, so each
+call must reach the tool registered by the bridge that owns the session,
+whichever bridge's dispatcher happens to take it from the queue. Runs against
+the synthetic bridge, whose sessions answer by calling their tool once with
+{"prompt": <prompt>}.
+
+Usage:
+    make synthetic-bridge
+    python3 tests/tool_dispatch_test.py
+"""
+
+import os
+import sys
+import threading
+from pathlib import Path
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(REPO_ROOT))
+
+import ai_bridge  # noqa: E402
+
+BRIDGES = 2
+SESSIONS_PER_BRIDGE = 4
+CALLS_PER_SESSION = 50
+
+
+def find_synthetic_bridge() -> Path:
+    if env_path := os.environ.get('AI_SYNTH_LIBRARY'):
+        return Path(env_path)
+    for name in ('libsynthbridge.dylib', 'libsynthbridge.so'):
+        for candidate in REPO_ROOT.glob(f'build/**/{name}'):
+            return candidate
+    sys.exit("synthetic bridge not found; run `make synthetic-bridge` "
+             "or set AI_SYNTH_LIBRARY")
+
+
+def make_tool(owner: str) -> ai_bridge.Tool:
+    return ai_bridge.Tool(name='echo',
+                          function=lambda prompt: f'{owner}:{prompt}')
+
+
+def run_session(session: ai_bridge.AISession,
+                owner: str,
+                failures: list) -> None:
+    for call in range(CALLS_PER_SESSION):
+        prompt = f'{session.session_id}-{call}'
+        try:
+            answer = session.generate_response(prompt)
+        except ai_bridge.AIBridgeError as e:
+            answer = f'{type(e).__name__}: {e}'
+        if answer != f'{owner}:{prompt}':
+            failures.append(f'{owner} session {session.session_id}: '
+                            f'expected {owner}:{prompt}, got {answer!r}')
+
+
+def main() -> int:
+    library = find_synthetic_bridge()
+    bridges = [ai_bridge.AIBridge(library) for _ in range(BRIDGES)]
+    failures: list = []
+
+    threads = []
+    for index, bridge in enumerate(bridges):
+        owner = f'bridge{index}'
+        for _ in range(SESSIONS_PER_BRIDGE):
+            session = bridge.create_session(tools=[make_tool(owner)])
+            threads.append(threading.Thread(
+                target=run_session, args=(session, owner, failures)))
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    # The remaining bridge keeps dispatching after the other one goes away
+    bridges[0].cleanup()
+    session = bridges[1].create_session(tools=[make_tool('bridge1')])
+    run_session(session, 'bridge1', failures)
+    bridges[1].cleanup()
+
+    for failure in failures[:10]:
+        print(f'FAIL {failure}', file=sys.stderr)
+    if failures:
+        return 1
+    print('tool-dispatch-test: ok')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())